@@ -5,6 +5,7 @@
 
 #include <chrono>
 #include <memory>
+#include <stdexcept>
 #include <string>
 #include <type_traits>
 
@@ -19,6 +20,10 @@ namespace Azure { namespace Core {
    *  @brief ContextValue exists as a substitute for variant which isn't available until C++17
    */
   class ContextValue {
+  public:
+    /**
+     * @brief Type of the value held, as returned by Alternative.
+     */
     enum class ContextValueType
     {
       Undefined,
@@ -28,6 +33,7 @@ namespace Azure { namespace Core {
       UniquePtr
     };
 
+  private:
     ContextValueType m_contextValueType;
     union
     {
@@ -43,7 +49,7 @@ namespace Azure { namespace Core {
     ContextValue(int i) noexcept : m_contextValueType(ContextValueType::Int), m_i(i) {}
     ContextValue(const std::string& s) : m_contextValueType(ContextValueType::StdString), m_s(s) {}
     ContextValue(std::string&& s) noexcept
-        : m_contextValueType(ContextValueType::UniquePtr), m_s(std::move(s))
+        : m_contextValueType(ContextValueType::StdString), m_s(std::move(s))
     {
     }
     template <
@@ -137,6 +143,14 @@ namespace Azure { namespace Core {
     return m_p;
   }
 
+  /**
+   * @brief Thrown when an operation is abandoned because its Context was canceled.
+   */
+  struct OperationCanceledException : public std::runtime_error
+  {
+    explicit OperationCanceledException(std::string const& msg) : std::runtime_error(msg) {}
+  };
+
   class Context {
   public:
     using time_point = std::chrono::system_clock::time_point;
@@ -225,8 +239,7 @@ namespace Azure { namespace Core {
     {
       if (CancelWhen() < std::chrono::system_clock::now())
       {
-        // TODO: Runtime Exc
-        throw;
+        throw OperationCanceledException("Request was canceled by context.");
       }
     }
   };
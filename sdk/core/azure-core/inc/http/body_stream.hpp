@@ -21,6 +21,7 @@
 #include <cstdio>
 #include <cstring>
 #include <memory>
+#include <utility>
 #include <vector>
 
 namespace Azure { namespace Core { namespace Http {
@@ -48,6 +49,7 @@ namespace Azure { namespace Core { namespace Http {
     // Keep reading until buffer is all fill out of the end of stream content is reached
     static int64_t ReadToCount(Context& context, BodyStream& body, uint8_t* buffer, int64_t count);
 
+    // Reads the rest of the body, in a buffer allocated once from Length() when it is known
     static std::vector<uint8_t> ReadToEnd(Context& context, BodyStream& body);
   };
 
@@ -76,6 +78,40 @@ namespace Azure { namespace Core { namespace Http {
     int64_t Read(Context& context, uint8_t* buffer, int64_t count) override;
 
     void Rewind() override { m_offset = 0; }
+
+    // Used by transports to send the data left without copying it.
+    const uint8_t* GetData() const { return this->m_data + this->m_offset; }
+    int64_t GetRemaining() const { return this->m_length - this->m_offset; }
+    void Skip(int64_t count) { this->m_offset = std::min(this->m_offset + count, this->m_length); }
+  };
+
+  // A stream over a range of a body shared with other streams, which it keeps alive
+  class SharedBodyStream : public BodyStream {
+  private:
+    std::shared_ptr<const std::vector<uint8_t>> m_body;
+    int64_t m_begin;
+    int64_t m_length;
+    int64_t m_offset = 0;
+
+  public:
+    explicit SharedBodyStream(std::shared_ptr<const std::vector<uint8_t>> body)
+        : SharedBodyStream(body, 0, static_cast<int64_t>(body->size()))
+    {
+    }
+
+    explicit SharedBodyStream(
+        std::shared_ptr<const std::vector<uint8_t>> body,
+        int64_t begin,
+        int64_t length)
+        : m_body(std::move(body)), m_begin(begin), m_length(length)
+    {
+    }
+
+    int64_t Length() const override { return this->m_length; }
+
+    int64_t Read(Context& context, uint8_t* buffer, int64_t count) override;
+
+    void Rewind() override { m_offset = 0; }
   };
 
   // Use for request with no body
@@ -124,6 +160,13 @@ namespace Azure { namespace Core { namespace Http {
     int64_t Read(Azure::Core::Context& context, uint8_t* buffer, int64_t count) override;
 
     int64_t Length() const override { return this->m_length; };
+
+    // Used by transports that move the file to the socket in the kernel, see
+    // CurlTransportOptions::KernelFileTransfer.
+    int GetFileDescriptor() const { return this->m_fd; }
+    int64_t GetFileOffset() const { return this->m_baseOffset + this->m_offset; }
+    int64_t GetRemaining() const { return this->m_length - this->m_offset; }
+    void Skip(int64_t count) { this->m_offset = std::min(this->m_offset + count, this->m_length); }
   };
 #endif
 
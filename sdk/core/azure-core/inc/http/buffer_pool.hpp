@@ -0,0 +1,176 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// SPDX-License-Identifier: MIT
+
+/**
+ * @file
+ * @brief Pool of transfer buffers shared by the clients of a process, with a memory budget.
+ */
+
+#pragma once
+
+#include "context.hpp"
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace Azure { namespace Core { namespace Http {
+
+  class BufferPool;
+
+  /**
+   * @brief A buffer taken from a BufferPool, given back to it when destroyed.
+   */
+  class PooledBuffer {
+  public:
+    PooledBuffer() = default;
+    PooledBuffer(PooledBuffer&& other) noexcept;
+    PooledBuffer& operator=(PooledBuffer&& other) noexcept;
+    PooledBuffer(const PooledBuffer&) = delete;
+    PooledBuffer& operator=(const PooledBuffer&) = delete;
+    ~PooledBuffer() { Reset(); }
+
+    /**
+     * @brief The data of the buffer, aligned to 4096 bytes. Its content isn't initialized.
+     */
+    uint8_t* Data() const { return m_data; }
+
+    /**
+     * @brief The size requested. The buffer may be larger, see GetCapacity.
+     */
+    int64_t Size() const { return m_size; }
+
+    int64_t GetCapacity() const;
+
+    explicit operator bool() const { return m_data != nullptr; }
+
+    /**
+     * @brief Gives the buffer back to its pool.
+     */
+    void Reset();
+
+  private:
+    friend class BufferPool;
+    PooledBuffer(BufferPool* pool, uint8_t* data, int64_t size, int sizeClass)
+        : m_pool(pool), m_data(data), m_size(size), m_sizeClass(sizeClass)
+    {
+    }
+
+    BufferPool* m_pool = nullptr;
+    uint8_t* m_data = nullptr;
+    int64_t m_size = 0;
+    int m_sizeClass = 0;
+  };
+
+  /**
+   * @brief Thread-safe pool of buffers, from 4KB to a few GB, used for the transfers.
+   *
+   * @remark Sizes are rounded up to a size class, four per power of two, and the buffers given
+   * back are kept on a free list per class to be reused without going to the allocator. The
+   * bytes of the buffers acquired and of the ones kept count against an optional budget: once it
+   * is exhausted, the buffers kept are freed first, then AcquireWithinBudget waits for buffers to
+   * be given back, which slows down the transfers taking their buffers from the pool instead of
+   * growing the memory of the process. Each free list has its own lock and the byte counts are
+   * atomic, so that threads taking buffers of different sizes don't contend.
+   */
+  class BufferPool {
+  public:
+    BufferPool() = default;
+    BufferPool(const BufferPool&) = delete;
+    BufferPool& operator=(const BufferPool&) = delete;
+    ~BufferPool();
+
+    /**
+     * @brief The pool shared by the clients of the process. It is never destroyed, so that
+     * buffers can be given back during the destruction of static objects.
+     */
+    static BufferPool& GetDefault();
+
+    /**
+     * @brief Sets the maximum number of bytes acquired and kept by the pool, 0 means no limit.
+     * Takes effect immediately, including for the callers waiting.
+     */
+    void SetBudget(int64_t budget);
+
+    int64_t GetBudget() const;
+
+    /**
+     * @brief Backs the buffers of 2MB or more with transparent huge pages where the platform
+     * supports it, for the buffers allocated from now on.
+     */
+    void SetUseHugePages(bool useHugePages);
+
+    /**
+     * @brief Takes a buffer of at least size bytes. Never waits: the buffer is counted against
+     * the budget but may exceed it, for short lived buffers that can't wait.
+     */
+    PooledBuffer Acquire(int64_t size);
+
+    /**
+     * @brief Waits until a buffer of at least size bytes fits in the budget and takes it. A
+     * buffer larger than the budget is given once no other buffer is acquired.
+     *
+     * @param context A context to cancel the wait, Azure::Core::OperationCanceledException is
+     * thrown if it is canceled.
+     * @param size Number of bytes needed.
+     */
+    PooledBuffer AcquireWithinBudget(Context& context, int64_t size);
+
+    /**
+     * @brief Takes a buffer of at least size bytes if it fits in the budget, returns an empty
+     * buffer otherwise.
+     */
+    PooledBuffer TryAcquireWithinBudget(int64_t size);
+
+    /**
+     * @brief Bytes of the buffers acquired and not given back yet.
+     */
+    int64_t GetBytesInUse() const;
+
+    /**
+     * @brief Bytes of the buffers kept for reuse.
+     */
+    int64_t GetBytesCached() const;
+
+    /**
+     * @brief Frees the buffers kept for reuse.
+     */
+    void Trim();
+
+  private:
+    friend class PooledBuffer;
+
+    // Classes up to 64GB are kept for reuse, larger buffers are always freed.
+    static constexpr int c_CachedSizeClasses = 96;
+
+    struct FreeList
+    {
+      std::mutex Mutex;
+      std::vector<uint8_t*> Buffers;
+    };
+
+    static int GetSizeClass(int64_t size);
+    static int64_t GetClassSize(int sizeClass);
+
+    bool TryReserve(int64_t classSize);
+    PooledBuffer Take(int64_t size, int sizeClass);
+    void Release(uint8_t* data, int sizeClass);
+    void FreeCached(int64_t bytes);
+    void NotifyWaiters();
+
+    std::atomic<int64_t> m_budget{0};
+    std::atomic<bool> m_useHugePages{false};
+    std::atomic<int64_t> m_bytesInUse{0};
+    std::atomic<int64_t> m_bytesCached{0};
+    // Only the callers waiting for the budget take the mutex, or wake them up.
+    std::mutex m_waitMutex;
+    std::condition_variable m_cv;
+    std::atomic<int> m_waiters{0};
+    // Buffers kept for reuse by size class.
+    std::array<FreeList, c_CachedSizeClasses> m_freeLists;
+  };
+
+}}} // namespace Azure::Core::Http
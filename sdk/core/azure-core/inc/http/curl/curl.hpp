@@ -19,8 +19,40 @@ namespace Azure { namespace Core { namespace Http {
     // This can be customizable in the HttpRequest
     constexpr int64_t c_UploadDefaultChunkSize = 1024 * 64;
     constexpr auto c_LibcurlReaderSize = 1024;
+
+    /**
+     * @brief Sets the name lookup, connect and TLS handshake durations measured by libcurl for the
+     * connection of handle, and counts the connections it opened in the default metrics registry.
+     */
+    void GetCurlConnectionTimings(CURL* handle, HttpTimings& timings);
+
+    /**
+     * @brief Parses the status line and headers of a response with the parser of CurlSession,
+     * feeding it readSize bytes at a time as reads from a socket would. Lets the parser be tested
+     * and benchmarked without a connection.
+     *
+     * @return The response, or null if buffer doesn't hold the end of the headers.
+     */
+    std::unique_ptr<RawResponse> ParseResponseHead(
+        uint8_t const* buffer,
+        int64_t size,
+        int64_t readSize);
   } // namespace Details
 
+  /**
+   * @brief Options used to construct a CurlTransport.
+   */
+  struct CurlTransportOptions
+  {
+    /**
+     * @brief On Linux, send the bodies of files, FileBodyStream, from the kernel with sendfile
+     * instead of reading them to a buffer first. For https, kernel TLS is requested from OpenSSL
+     * and the file is only sent from the kernel if the handshake enabled it. Bodies are read and
+     * sent as usual when the file can't be sent from the kernel.
+     */
+    bool KernelFileTransfer = false;
+  };
+
   /**
    * @brief Statefull component that controls sending an HTTP Request with libcurl thru the wire and
    * parsing and building an HTTP RawResponse.
@@ -34,6 +66,11 @@ namespace Azure { namespace Core { namespace Http {
    * transporter to be re usuable in multiple pipelines while every call to network is unique.
    */
   class CurlSession : public BodyStream {
+    friend std::unique_ptr<RawResponse> Details::ParseResponseHead(
+        uint8_t const* buffer,
+        int64_t size,
+        int64_t readSize);
+
   private:
     /**
      * @brief Enum used by ResponseBufferParser to control the parsing internal state while building
@@ -206,6 +243,8 @@ namespace Azure { namespace Core { namespace Http {
      */
     int64_t m_uploadedBytes;
 
+    CurlTransportOptions m_options;
+
     /**
      * @brief Control field that gets true as soon as there is no more data to read from network. A
      * network socket will return 0 once we got the entire reponse.
@@ -251,6 +290,11 @@ namespace Azure { namespace Core { namespace Http {
 
     int64_t m_sessionTotalRead = 0;
 
+    /**
+     * @brief Timings of the connection and of the request, set on the response by GetResponse.
+     */
+    HttpTimings m_timings;
+
     /**
      * @brief Internal buffer from a session used to read bytes from a socket. This buffer is only
      * used while constructing an HTTP RawResponse without adding a body to it. Customers would
@@ -328,6 +372,15 @@ namespace Azure { namespace Core { namespace Http {
     CURLcode HttpRawSend(Context& context);
     CURLcode UploadBody(Context& context);
 
+    /**
+     * @brief Sends the rest of a file body with sendfile, when the socket is plain TCP or kernel
+     * TLS encrypts what is written to it.
+     *
+     * @return CURLE_UNSUPPORTED_PROTOCOL, before anything is sent, if the file can't be sent from
+     * the kernel.
+     */
+    CURLcode SendFileBody(Context& context, BodyStream& body);
+
     /**
      * @brief This method will use libcurl socket to write all the bytes from buffer.
      *
@@ -343,36 +396,40 @@ namespace Azure { namespace Core { namespace Http {
      * @brief This function is used after sending an HTTP request to the server to read the HTTP
      * RawResponse from wire until the end of headers only.
      *
+     * @param context #Context so that the wait for the response can be canceled.
      * @return CURL_OK when an HTTP response is created.
      */
-    void ReadStatusLineAndHeadersFromRawResponse();
+    void ReadStatusLineAndHeadersFromRawResponse(Context& context);
 
     /**
      * @brief Reads from inner buffer or from Wire until chunkSize is parsed and converted to
      * unsigned long long
      *
      */
-    void ParseChunkSize();
+    void ParseChunkSize(Context& context);
 
     /**
      * @brief This function is used when working with streams to pull more data from the wire.
      * Function will try to keep pulling data from socket until the buffer is all written or until
      * there is no more data to get from the socket.
      *
+     * @param context #Context so that the wait for data can be canceled.
      * @param buffer ptr to buffer where to copy bytes from socket.
      * @param bufferSize size of the buffer and the requested bytes to be pulled from wire.
      * @return return the numbers of bytes pulled from socket. It can be less than what it was
      * requested.
      */
-    int64_t ReadSocketToBuffer(uint8_t* buffer, int64_t bufferSize);
+    int64_t ReadSocketToBuffer(Context& context, uint8_t* buffer, int64_t bufferSize);
 
   public:
     /**
      * @brief Construct a new Curl Session object. Init internal libcurl handler.
      *
      * @param request reference to an HTTP Request.
+     * @param options Options of the transport the session belongs to.
      */
-    CurlSession(Request& request) : m_request(request)
+    CurlSession(Request& request, CurlTransportOptions options = CurlTransportOptions())
+        : m_request(request), m_options(std::move(options))
     {
       this->m_pCurl = curl_easy_init();
       this->m_bodyStartInBuffer = -1;
@@ -413,7 +470,20 @@ namespace Azure { namespace Core { namespace Http {
    *
    */
   class CurlTransport : public HttpTransport {
+  private:
+    CurlTransportOptions m_options;
+
   public:
+    /**
+     * @brief Construct a new CurlTransport.
+     *
+     * @param options Optional parameters for the transport.
+     */
+    explicit CurlTransport(CurlTransportOptions options = CurlTransportOptions())
+        : m_options(std::move(options))
+    {
+    }
+
     /**
      * @brief Implements interface to send an HTTP Request and produce an HTTP RawResponse
      *
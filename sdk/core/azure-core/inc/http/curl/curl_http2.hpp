@@ -0,0 +1,86 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// SPDX-License-Identifier: MIT
+
+/**
+ * @file
+ * @brief HTTP transport that multiplexes concurrent requests over HTTP/2 connections using the
+ * libcurl multi interface.
+ *
+ * Only built with libcurl 7.68 or later, which defines AZ_CORE_WITH_CURL_HTTP2.
+ */
+
+#pragma once
+
+#include "http/http.hpp"
+#include "http/transport.hpp"
+
+#include <cstdint>
+#include <memory>
+
+namespace Azure { namespace Core { namespace Http {
+
+  namespace Details {
+    class CurlMultiWorker;
+  } // namespace Details
+
+  /**
+   * @brief Options used to construct a CurlHttp2Transport.
+   */
+  struct CurlHttp2TransportOptions
+  {
+    /**
+     * @brief Maximum number of connections opened to the same host. Requests above this limit are
+     * queued until a connection, or an HTTP/2 stream on a connection, is available. 0 means no
+     * limit.
+     */
+    long MaxConnectionsPerHost = 0;
+
+    /**
+     * @brief Use HTTP/2 for http:// URLs without negotiating it first (h2c with prior knowledge).
+     * https:// URLs always negotiate the protocol with ALPN and fall back to HTTP/1.1 if the server
+     * doesn't support HTTP/2.
+     */
+    bool Http2PriorKnowledge = false;
+
+    /**
+     * @brief Maximum number of response body bytes buffered for a request before the transfer is
+     * paused waiting for the body stream to be read.
+     */
+    int64_t MaxBufferedBodySize = 1024 * 1024;
+  };
+
+  /**
+   * @brief HttpTransport that sends requests through a single libcurl multi handle. Concurrent
+   * requests to the same host share a few connections: with HTTP/2 they are multiplexed as
+   * streams of one connection, with HTTP/1.1 idle connections are reused.
+   *
+   * @remark A background thread drives all the transfers. The response is returned as soon as the
+   * headers arrive, and the body is read from a stream fed by that thread.
+   */
+  class CurlHttp2Transport : public HttpTransport {
+  public:
+    /**
+     * @brief Construct a new CurlHttp2Transport and start the thread that drives the transfers.
+     *
+     * @param options Optional parameters for the transport.
+     */
+    explicit CurlHttp2Transport(
+        const CurlHttp2TransportOptions& options = CurlHttp2TransportOptions());
+
+    ~CurlHttp2Transport() override;
+
+    /**
+     * @brief Implements interface to send an HTTP Request and produce an HTTP RawResponse
+     *
+     * @param context A context to cancel the request.
+     * @param request an HTTP Request to be send.
+     * @return unique ptr to an HTTP RawResponse.
+     */
+    std::unique_ptr<RawResponse> Send(Context& context, Request& request) override;
+
+  private:
+    CurlHttp2TransportOptions m_options;
+    std::shared_ptr<Details::CurlMultiWorker> m_worker;
+  };
+
+}}} // namespace Azure::Core::Http
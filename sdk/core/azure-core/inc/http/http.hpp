@@ -6,6 +6,8 @@
 #include "body_stream.hpp"
 
 #include <algorithm>
+#include <chrono>
+#include <cstdint>
 #include <internal/contract.hpp>
 #include <map>
 #include <memory>
@@ -196,8 +198,8 @@ namespace Azure { namespace Core { namespace Http {
       return this->m_scheme + "://" + this->m_host + port + this->m_path;
     }
     std::string GetPath() const { return this->m_path; }
-    std::string GetHost() const { return this->m_host; }
-    std::map<std::string, std::string> GetQueryParameters() const
+    std::string const& GetHost() const { return this->m_host; }
+    std::map<std::string, std::string> const& GetQueryParameters() const
     {
       return this->m_queryParameters;
     }
@@ -207,7 +209,15 @@ namespace Azure { namespace Core { namespace Http {
     }
   };
 
+  class Request;
+
+  namespace Details {
+    uint64_t GetOperationKey(Request const& request);
+  } // namespace Details
+
   class Request {
+    // Reads the URL and headers in place, since it runs for every request.
+    friend uint64_t Details::GetOperationKey(Request const& request);
 
   private:
     HttpMethod m_method;
@@ -273,6 +283,8 @@ namespace Azure { namespace Core { namespace Http {
     void AddHeader(std::string const& name, std::string const& value);
     void StartRetry(); // only called by retry policy
     void SetUploadChunkSize(int64_t size) { this->m_uploadChunkSize = size; }
+    // Used by policies that wrap the body, the stream must outlive the request being sent
+    void SetBodyStream(BodyStream* bodyStream) { this->m_bodyStream = bodyStream; }
 
     // Methods used by transport layer (and logger) to send request
     HttpMethod GetMethod() const;
@@ -299,6 +311,73 @@ namespace Azure { namespace Core { namespace Http {
     explicit TransportException(std::string const& msg) : std::runtime_error(msg) {}
   };
 
+  /**
+   * @brief Where the time of a request went. Connection phases are the ones of the final attempt
+   * as reported by the transport; they are zero when a connection is reused or when the
+   * transport doesn't measure them.
+   */
+  struct HttpTimings
+  {
+    /**
+     * @brief Time spent in the pipeline outside of the transport, retries and back off, e.g.
+     * waiting for a rate limiter or a token. Set by the InstrumentationPolicy.
+     */
+    std::chrono::microseconds Queueing{0};
+
+    /**
+     * @brief Time to resolve the host name.
+     */
+    std::chrono::microseconds NameLookup{0};
+
+    /**
+     * @brief Time to establish the TCP connection.
+     */
+    std::chrono::microseconds Connect{0};
+
+    /**
+     * @brief Time of the TLS handshake.
+     */
+    std::chrono::microseconds TlsHandshake{0};
+
+    /**
+     * @brief Time to send the request line, headers and body.
+     */
+    std::chrono::microseconds RequestSend{0};
+
+    /**
+     * @brief Time from the end of the request to the first byte of the response.
+     */
+    std::chrono::microseconds TimeToFirstByte{0};
+
+    /**
+     * @brief Time to receive the response body, for responses whose body is read by the
+     * pipeline. The body of a streamed response is read after the response is returned.
+     */
+    std::chrono::microseconds BodyTransfer{0};
+
+    /**
+     * @brief Number of retries before the final attempt.
+     */
+    int Retries = 0;
+
+    /**
+     * @brief Time spent in the attempts that were retried.
+     */
+    std::chrono::microseconds FailedAttempts{0};
+
+    /**
+     * @brief Time spent sleeping between retries or waiting for a back off requested by the
+     * service.
+     */
+    std::chrono::microseconds RetryBackOff{0};
+
+    /**
+     * @brief Time from the start of the pipeline to the response. Set by the
+     * InstrumentationPolicy.
+     */
+    std::chrono::microseconds Total{0};
+  };
+
   class RawResponse {
 
   private:
@@ -310,6 +389,7 @@ namespace Azure { namespace Core { namespace Http {
 
     std::unique_ptr<BodyStream> m_bodyStream;
     std::vector<uint8_t> m_body;
+    HttpTimings m_timings;
 
     explicit RawResponse(
         int32_t majorVersion,
@@ -354,6 +434,8 @@ namespace Azure { namespace Core { namespace Http {
     }
     std::vector<uint8_t>& GetBody() { return this->m_body; }
     std::vector<uint8_t> const& GetBody() const { return this->m_body; }
+    HttpTimings& GetTimings() { return this->m_timings; }
+    HttpTimings const& GetTimings() const { return this->m_timings; }
   };
 
 }}} // namespace Azure::Core::Http
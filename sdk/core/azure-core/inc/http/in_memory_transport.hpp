@@ -0,0 +1,145 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// SPDX-License-Identifier: MIT
+
+/**
+ * @file
+ * @brief HTTP transport serving canned, generated or replayed responses from memory.
+ */
+
+#pragma once
+
+#include "context.hpp"
+#include "http.hpp"
+#include "transport.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <istream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Azure { namespace Core { namespace Http {
+
+  /**
+   * @brief A response served by an InMemoryTransport.
+   */
+  struct InMemoryResponse
+  {
+    HttpStatusCode StatusCode = HttpStatusCode::Ok;
+    std::string ReasonPhrase = "OK";
+
+    /**
+     * @brief Headers of the response, content-length is added from the body.
+     */
+    std::map<std::string, std::string> Headers;
+
+    /**
+     * @brief Body of the response, shared by all the responses served from it.
+     */
+    std::shared_ptr<const std::vector<uint8_t>> Body;
+
+    /**
+     * @brief If true, a request with a range or x-ms-range header is answered 206 Partial Content
+     * with the range of the body, like a ranged download of a blob.
+     */
+    bool ServeRanges = false;
+
+    /**
+     * @brief Delay before the response is returned, added to InMemoryTransportOptions::Latency.
+     */
+    std::chrono::microseconds Latency{0};
+  };
+
+  /**
+   * @brief Options of an InMemoryTransport.
+   */
+  struct InMemoryTransportOptions
+  {
+    /**
+     * @brief Delay before every response is returned.
+     */
+    std::chrono::microseconds Latency{0};
+
+    /**
+     * @brief Generates the response of the requests no route matches. Without a handler, they
+     * are answered 404 Not Found.
+     */
+    std::function<InMemoryResponse(Context& context, Request& request)> Handler;
+  };
+
+  /**
+   * @brief An HttpTransport that serves responses from memory without any socket, to measure the
+   * overhead of the pipeline and the clients or load test them.
+   *
+   * @remark A request is answered by the route of its method with the longest prefix of its path
+   * whose query parameters the request has, the route with the most parameters if several have
+   * the same prefix. A route with several responses serves them in turn, wrapping around.
+   * Request bodies are read and discarded. Downloads via stream get a stream over the body of the
+   * response.
+   *
+   * Routes must be added before the transport is shared, Send can then be called concurrently.
+   */
+  class InMemoryTransport : public HttpTransport {
+  public:
+    explicit InMemoryTransport(InMemoryTransportOptions options = InMemoryTransportOptions())
+        : m_options(std::move(options))
+    {
+    }
+
+    /**
+     * @brief Adds a response to the route of method and pathPrefix, a prefix of the path of the
+     * requests optionally followed by query parameters they must have, in any order, for instance
+     * "/container/blob?comp=block".
+     */
+    void AddResponse(HttpMethod method, std::string const& pathPrefix, InMemoryResponse response);
+
+    /**
+     * @brief Adds the routes of recorded traffic. Each exchange is written as:
+     *
+     * @code
+     * GET /container/blob
+     * 200 OK
+     * x-ms-blob-type: BlockBlob
+     * content-length: 5
+     *
+     * hello
+     * @endcode
+     *
+     * The request line has the method and the path prefix, the status line is followed by the
+     * headers, an empty line and content-length bytes of body. Lines starting with # between
+     * exchanges are ignored. Throws std::runtime_error if the traffic is malformed.
+     */
+    void LoadReplay(std::istream& traffic);
+
+    /**
+     * @brief Adds the routes of the recorded traffic in file, see LoadReplay.
+     */
+    void LoadReplayFile(std::string const& file);
+
+    std::unique_ptr<RawResponse> Send(Context& context, Request& request) override;
+
+    /**
+     * @brief Number of requests sent so far.
+     */
+    uint64_t GetRequestCount() const { return m_requestCount.load(std::memory_order_relaxed); }
+
+  private:
+    struct Route
+    {
+      std::string PathPrefix;
+      std::map<std::string, std::string> Query;
+      std::vector<InMemoryResponse> Responses;
+      std::unique_ptr<std::atomic<uint64_t>> Next = std::make_unique<std::atomic<uint64_t>>(0);
+    };
+
+    InMemoryTransportOptions m_options;
+    // Routes by method and prefix, with its query parameters.
+    std::map<std::pair<HttpMethod, std::string>, Route> m_routes;
+    std::atomic<uint64_t> m_requestCount{0};
+  };
+
+}}} // namespace Azure::Core::Http
@@ -0,0 +1,82 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// SPDX-License-Identifier: MIT
+
+/**
+ * @file
+ * @brief Latency histogram used to track the distribution of request durations.
+ */
+
+#pragma once
+
+#include "http.hpp"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+namespace Azure { namespace Core { namespace Http {
+
+  /**
+   * @brief Lock-free log-linear histogram of durations in microseconds. Each power of two is split
+   * in 16 buckets, so percentiles are accurate to about 6%.
+   */
+  class LatencyHistogram {
+  public:
+    /**
+     * @brief Construct a new LatencyHistogram.
+     *
+     * @param decayThreshold If not 0, all the buckets are halved each time this many samples have
+     * been recorded, so that the histogram follows changes of the distribution.
+     */
+    explicit LatencyHistogram(uint64_t decayThreshold = 0) : m_decayThreshold(decayThreshold) {}
+
+    void Record(std::chrono::microseconds duration);
+
+    /**
+     * @brief Number of samples in the histogram.
+     */
+    uint64_t Count() const { return m_count.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Returns an upper bound of the given percentile, in the range [0, 100], of the samples.
+     * 0 if the histogram is empty.
+     */
+    std::chrono::microseconds Percentile(double percentile) const;
+
+  private:
+    constexpr static int c_SubBucketBits = 4;
+    constexpr static int64_t c_SubBuckets = 1 << c_SubBucketBits;
+    constexpr static int c_MaxExponent = 40; // about 12 days
+    constexpr static std::size_t c_NumBuckets
+        = c_SubBuckets + (c_MaxExponent - c_SubBucketBits + 1) * c_SubBuckets;
+
+    static std::size_t BucketIndex(int64_t value);
+    static int64_t BucketUpperBound(std::size_t index);
+    void Decay();
+
+    uint64_t m_decayThreshold;
+    std::array<std::atomic<uint64_t>, c_NumBuckets> m_buckets{};
+    std::atomic<uint64_t> m_count{0};
+    std::mutex m_decayMutex;
+  };
+
+  namespace Details {
+    /**
+     * @brief Name of the operation of a request used to group latencies: method, host, names of
+     * the query parameters and, for ranged reads, the power of two of the range size. It
+     * separates most operations without growing unbounded.
+     */
+    std::string GetOperationName(Request& request);
+
+    /**
+     * @brief Hash of the parts of a request that make its operation name. It doesn't allocate, so
+     * it can key per-request lookups of what depends on the operation.
+     */
+    uint64_t GetOperationKey(Request const& request);
+  } // namespace Details
+
+}}} // namespace Azure::Core::Http
@@ -6,10 +6,18 @@
 #include "azure.hpp"
 #include "context.hpp"
 #include "http.hpp"
+#include "latency_histogram.hpp"
+#include "rate_limiter.hpp"
 #include "transport.hpp"
 
+#include <atomic>
 #include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
 #include <utility>
+#include <vector>
 
 namespace Azure { namespace Core { namespace Http {
 
@@ -54,10 +62,8 @@ namespace Azure { namespace Core { namespace Http {
     std::shared_ptr<HttpTransport> m_transport;
 
   public:
-    explicit TransportPolicy(std::shared_ptr<HttpTransport> transport)
-        : m_transport(std::move(transport))
-    {
-    }
+    // A null transport falls back to a CurlTransport.
+    explicit TransportPolicy(std::shared_ptr<HttpTransport> transport);
 
     std::unique_ptr<HttpPolicy> Clone() const override
     {
@@ -68,6 +74,76 @@ namespace Azure { namespace Core { namespace Http {
         const override;
   };
 
+  /**
+   * @brief Options used to construct a RetryBudget.
+   */
+  struct RetryBudgetOptions
+  {
+    /**
+     * @brief Number of retries earned by every request that completes without needing a retry.
+     */
+    double RetryRatio = 0.1;
+
+    /**
+     * @brief Number of retries earned every second regardless of the requests, so that pipelines
+     * sending few requests can still retry.
+     */
+    double MinRetriesPerSecond = 10.0;
+
+    /**
+     * @brief Maximum number of retries that can be saved up, which bounds a burst of retries.
+     */
+    double MaxRetries = 100.0;
+  };
+
+  /**
+   * @brief Retry state shared by the pipelines sending requests to the same service: a token
+   * bucket that allows retries only as a fraction of the successful requests, and a gate that
+   * delays every request when the service asked a client to back off with a retry-after header.
+   * Without it each request retries on its own, which prolongs throttling under load.
+   */
+  class RetryBudget {
+  public:
+    explicit RetryBudget(RetryBudgetOptions options = RetryBudgetOptions());
+
+    /**
+     * @brief Returns the budget shared by everyone that asks for the same key, e.g. an account
+     * host. It is created with default options on first use.
+     */
+    static std::shared_ptr<RetryBudget> GetShared(std::string const& key);
+
+    /**
+     * @brief Records a request that completed without needing a retry. Called once per request,
+     * with its final response.
+     */
+    void OnSuccess();
+
+    /**
+     * @brief Takes one retry from the budget.
+     * @return false if the budget is exhausted and the request must not be retried.
+     */
+    bool TryAcquireRetry();
+
+    /**
+     * @brief Delays every request sent with this budget until delay has elapsed.
+     */
+    void BackOff(std::chrono::milliseconds delay);
+
+    /**
+     * @brief Time until which requests are delayed, in the past if they aren't.
+     */
+    std::chrono::steady_clock::time_point GetBackOffUntil() const;
+
+  private:
+    void Refill(std::chrono::steady_clock::time_point now);
+
+    RetryBudgetOptions m_options;
+    mutable std::mutex m_mutex;
+    double m_tokens;
+    std::chrono::steady_clock::time_point m_lastRefill;
+    std::chrono::steady_clock::time_point m_backOffUntil;
+  };
+
   struct RetryOptions
   {
     int MaxRetries = 3;
@@ -77,11 +153,18 @@ namespace Azure { namespace Core { namespace Http {
 
     std::vector<HttpStatusCode> StatusCodes{
         HttpStatusCode::RequestTimeout,
+        HttpStatusCode::TooManyRequests,
         HttpStatusCode::InternalServerError,
         HttpStatusCode::BadGateway,
         HttpStatusCode::ServiceUnavailable,
         HttpStatusCode::GatewayTimeout,
     };
+
+    /**
+     * @brief Retry budget and back off gate shared with other pipelines. Null lets every request
+     * retry independently.
+     */
+    std::shared_ptr<RetryBudget> Budget;
   };
 
   class RetryPolicy : public HttpPolicy {
@@ -100,6 +183,322 @@ namespace Azure { namespace Core { namespace Http {
         const override;
   };
 
+  namespace Details {
+    class OperationLatencies;
+    class HedgeScheduler;
+  } // namespace Details
+
+  /**
+   * @brief Options used to construct a HedgingPolicy.
+   */
+  struct HedgingOptions
+  {
+    /**
+     * @brief Maximum number of duplicate requests sent in addition to the original one. 0 disables
+     * hedging.
+     */
+    int MaxHedgedRequests = 1;
+
+    /**
+     * @brief Delay after which a duplicate request is sent if no response has arrived. Used until
+     * MinSamples latencies have been observed for the operation, or always if HedgePercentile is
+     * 0.
+     */
+    std::chrono::milliseconds HedgeDelay = std::chrono::milliseconds(100);
+
+    /**
+     * @brief Percentile, in the range (0, 100), of the latencies observed for the operation that
+     * is used as the hedge delay. 0 disables self tuning.
+     */
+    double HedgePercentile = 95.0;
+
+    /**
+     * @brief Number of latencies that must be observed for an operation before the hedge delay is
+     * derived from them.
+     */
+    int MinSamples = 50;
+
+    /**
+     * @brief Bounds of the hedge delay derived from the observed latencies.
+     */
+    std::chrono::milliseconds MinHedgeDelay = std::chrono::milliseconds(5);
+    decltype(MinHedgeDelay) MaxHedgeDelay = std::chrono::seconds(10);
+  };
+
+  /**
+   * @brief Sends a duplicate of an idempotent GET or HEAD request when no response arrives within
+   * the hedge delay, returns the first response and cancels the other requests. Other requests
+   * are forwarded unchanged.
+   *
+   * @remark Latencies are tracked per operation, i.e. per method, host, set of query parameters
+   * and size of the requested range, and the hedge delay is set to a percentile of them. The
+   * original request is sent from the calling thread, a duplicate is sent from its own thread
+   * once the delay elapses. The call returns once the losers have stopped, which is prompt when
+   * the transport honors the cancellation of their context. It should be placed after the
+   * RetryPolicy so that each duplicate is authenticated separately.
+   */
+  class HedgingPolicy : public HttpPolicy {
+  private:
+    HedgingOptions m_hedgingOptions;
+    std::shared_ptr<Details::OperationLatencies> m_latencies;
+    std::unique_ptr<Details::HedgeScheduler> m_scheduler;
+
+  public:
+    explicit HedgingPolicy(HedgingOptions options);
+
+    /**
+     * @brief Shares the observed latencies with other, but not the thread that starts the
+     * duplicate requests.
+     */
+    HedgingPolicy(const HedgingPolicy& other);
+
+    ~HedgingPolicy() override;
+
+    std::unique_ptr<HttpPolicy> Clone() const override
+    {
+      return std::make_unique<HedgingPolicy>(*this);
+    }
+
+    std::unique_ptr<RawResponse> Send(Context& ctx, Request& request, NextHttpPolicy nextHttpPolicy)
+        const override;
+  };
+
+  /**
+   * @brief Options used to construct a RateLimitPolicy. The limiters can be shared by the
+   * pipelines of several clients to limit them together; a null limiter doesn't limit anything.
+   */
+  struct RateLimitOptions
+  {
+    /**
+     * @brief Limits the number of requests sent per second.
+     */
+    std::shared_ptr<RateLimiter> RequestRate;
+
+    /**
+     * @brief Limits the number of request body bytes sent per second.
+     */
+    std::shared_ptr<RateLimiter> UploadRate;
+
+    /**
+     * @brief Limits the number of response body bytes received per second.
+     */
+    std::shared_ptr<RateLimiter> DownloadRate;
+
+    /**
+     * @brief Priority of the requests of this pipeline. It can be overridden for an operation
+     * with an int value of RateLimitPolicy::PriorityContextKey in its context; Send throws
+     * std::invalid_argument if that value isn't the int value of a RateLimitPriority.
+     */
+    RateLimitPriority Priority = RateLimitPriority::Normal;
+  };
+
+  /**
+   * @brief Limits the request rate and the upload and download bandwidth, so that bulk transfers
+   * can run next to latency sensitive traffic. Response bodies that are streamed are limited as
+   * they are read, buffered ones before the response is returned.
+   */
+  class RateLimitPolicy : public HttpPolicy {
+  private:
+    RateLimitOptions m_rateLimitOptions;
+
+  public:
+    static const std::string PriorityContextKey;
+
+    explicit RateLimitPolicy(RateLimitOptions options) : m_rateLimitOptions(std::move(options)) {}
+
+    std::unique_ptr<HttpPolicy> Clone() const override
+    {
+      return std::make_unique<RateLimitPolicy>(*this);
+    }
+
+    std::unique_ptr<RawResponse> Send(Context& ctx, Request& request, NextHttpPolicy nextHttpPolicy)
+        const override;
+  };
+
+  namespace Details {
+    class ConditionalGetCacheEntries;
+  } // namespace Details
+
+  /**
+   * @brief Options used to construct a ConditionalGetCachePolicy.
+   */
+  struct ConditionalGetCacheOptions
+  {
+    /**
+     * @brief Time during which a cached response is returned without asking the service. 0
+     * revalidates the response on every request.
+     */
+    std::chrono::milliseconds FreshFor = std::chrono::milliseconds(0);
+
+    /**
+     * @brief Time after a response was last validated during which it is still returned when
+     * revalidating it fails with a transport error. 0 lets the error through.
+     */
+    std::chrono::milliseconds StaleIfErrorFor = std::chrono::milliseconds(0);
+
+    /**
+     * @brief Responses with a larger body aren't cached.
+     */
+    int64_t MaxBodySize = 1024 * 1024;
+
+    /**
+     * @brief Total size of the bodies cached, the least recently used responses are evicted
+     * beyond it.
+     */
+    int64_t MaxCacheSize = 64 * 1024 * 1024;
+  };
+
+  /**
+   * @brief Caches the successful responses of GET and HEAD requests that have an ETag or a
+   * Last-Modified header, and revalidates them with If-None-Match or If-Modified-Since. A 304 Not
+   * Modified response, which has no body, is answered with the cached response.
+   *
+   * @remark Responses are cached per method, URL and the headers selecting the range and the
+   * version of the representation. Requests that have conditional headers or a lease id of their
+   * own are forwarded unchanged. The copies of the policy share the memory of the cache and Clear,
+   * but each copy only returns the responses it cached: they are given to the pipelines of
+   * clients that may authenticate with different credentials. A response returned from the cache
+   * has the x-ms-client-request-id of the request, and the x-ms-request-id of the 304 response
+   * that revalidated it. The cache is safe for concurrent use. It should be placed before the
+   * RetryPolicy and the policies authenticating the request, so that the conditional headers are
+   * signed.
+   */
+  class ConditionalGetCachePolicy : public HttpPolicy {
+  private:
+    ConditionalGetCacheOptions m_cacheOptions;
+    std::shared_ptr<Details::ConditionalGetCacheEntries> m_entries;
+    // Part of the keys of the responses cached by this copy of the policy.
+    uint64_t m_scope;
+
+  public:
+    explicit ConditionalGetCachePolicy(ConditionalGetCacheOptions options);
+
+    std::unique_ptr<HttpPolicy> Clone() const override;
+
+    /**
+     * @brief Removes every cached response.
+     */
+    void Clear() const;
+
+    std::unique_ptr<RawResponse> Send(Context& ctx, Request& request, NextHttpPolicy nextHttpPolicy)
+        const override;
+  };
+
+  namespace Details {
+    class InFlightRequests;
+  } // namespace Details
+
+  /**
+   * @brief Options used to construct a RequestCoalescingPolicy.
+   */
+  struct RequestCoalescingOptions
+  {
+    /**
+     * @brief Responses with a larger body, or a body of unknown length, aren't shared: the
+     * requests that waited for them are sent on their own.
+     */
+    int64_t MaxBodySize = 4 * 1024 * 1024;
+  };
+
+  /**
+   * @brief Sends a single request for identical GET or HEAD requests in flight at the same time,
+   * i.e. with the same URL and headers, and returns a copy of its response to all of them. Other
+   * requests are forwarded unchanged.
+   *
+   * @remark The first request is sent, the identical ones arriving before its response wait for
+   * it. The response body is only buffered when there are requests waiting for it. An error is
+   * thrown to all the requests, except a cancellation of the first request, after which the
+   * other ones are sent on their own. Each copy of the policy coalesces its own requests only,
+   * the copies are given to the pipelines of clients that may authenticate with different
+   * credentials. It should be placed before the RetryPolicy, so that the waiting requests share
+   * the retries too, and the per-attempt headers aren't compared.
+   */
+  class RequestCoalescingPolicy : public HttpPolicy {
+  private:
+    RequestCoalescingOptions m_coalescingOptions;
+    std::shared_ptr<Details::InFlightRequests> m_inFlight;
+
+  public:
+    explicit RequestCoalescingPolicy(RequestCoalescingOptions options);
+
+    std::unique_ptr<HttpPolicy> Clone() const override;
+
+    std::unique_ptr<RawResponse> Send(Context& ctx, Request& request, NextHttpPolicy nextHttpPolicy)
+        const override;
+  };
+
+  /**
+   * @brief Latency histograms of the phases of the requests, per operation, as aggregated by the
+   * InstrumentationPolicy. The connection phases are only recorded for requests that opened a
+   * new connection.
+   */
+  class RequestTimingHistograms {
+  public:
+    struct OperationHistograms
+    {
+      LatencyHistogram Total;
+      LatencyHistogram Queueing;
+      LatencyHistogram NameLookup;
+      LatencyHistogram Connect;
+      LatencyHistogram TlsHandshake;
+      LatencyHistogram RequestSend;
+      LatencyHistogram TimeToFirstByte;
+      LatencyHistogram BodyTransfer;
+      LatencyHistogram RetryBackOff;
+      std::atomic<uint64_t> Retries{0};
+    };
+
+    void Record(std::string const& operation, HttpTimings const& timings);
+
+    /**
+     * @brief Names of the operations recorded so far, see Details::GetOperationName.
+     */
+    std::vector<std::string> GetOperations() const;
+
+    /**
+     * @brief Returns the histograms of an operation, or null if it wasn't recorded.
+     */
+    std::shared_ptr<const OperationHistograms> GetHistograms(std::string const& operation) const;
+
+  private:
+    mutable std::mutex m_mutex;
+    std::map<std::string, std::shared_ptr<OperationHistograms>> m_operations;
+  };
+
+  /**
+   * @brief Completes the timings of the response with the total and queueing times and records
+   * them in per-operation histograms. It should be the first policy of the pipeline so that the
+   * time spent in the other policies is accounted for.
+   */
+  class InstrumentationPolicy : public HttpPolicy {
+  private:
+    std::shared_ptr<RequestTimingHistograms> m_histograms;
+
+  public:
+    /**
+     * @brief Construct a new InstrumentationPolicy.
+     *
+     * @param histograms The histograms the timings are recorded in, which can be shared by
+     * several pipelines.
+     */
+    explicit InstrumentationPolicy(
+        std::shared_ptr<RequestTimingHistograms> histograms
+        = std::make_shared<RequestTimingHistograms>())
+        : m_histograms(std::move(histograms))
+    {
+    }
+
+    std::shared_ptr<RequestTimingHistograms> GetHistograms() const { return m_histograms; }
+
+    std::unique_ptr<HttpPolicy> Clone() const override
+    {
+      return std::make_unique<InstrumentationPolicy>(*this);
+    }
+
+    std::unique_ptr<RawResponse> Send(Context& ctx, Request& request, NextHttpPolicy nextHttpPolicy)
+        const override;
+  };
+
   class RequestIdPolicy : public HttpPolicy {
   public:
     explicit RequestIdPolicy() {}
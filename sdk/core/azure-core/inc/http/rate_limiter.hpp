@@ -0,0 +1,120 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// SPDX-License-Identifier: MIT
+
+/**
+ * @file
+ * @brief Token bucket rate limiter and the body stream that applies it to the bytes read.
+ */
+
+#pragma once
+
+#include "body_stream.hpp"
+#include "context.hpp"
+
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+namespace Azure { namespace Core { namespace Http {
+
+  /**
+   * @brief Priority of the callers waiting on a RateLimiter. A caller doesn't get tokens while
+   * callers with a higher priority are waiting.
+   */
+  enum class RateLimitPriority
+  {
+    High,
+    Normal,
+    Low,
+  };
+
+  /**
+   * @brief Thread-safe token bucket. Shared by several pipelines, it limits their combined rate of
+   * requests or bytes.
+   *
+   * @remark A caller is let through as soon as the bucket isn't empty and takes all the tokens it
+   * needs, which may leave the bucket in debt. The following callers wait until the debt is paid,
+   * so the long term rate is respected even for amounts larger than the burst.
+   */
+  class RateLimiter {
+  public:
+    /**
+     * @brief Construct a new RateLimiter.
+     *
+     * @param ratePerSecond Number of tokens added to the bucket every second. 0 means no limit.
+     * @param burst Maximum number of tokens the bucket holds. 0 means one second worth of tokens.
+     */
+    explicit RateLimiter(double ratePerSecond, double burst = 0);
+
+    /**
+     * @brief Changes the limit. Takes effect immediately, including for the callers waiting.
+     */
+    void SetRate(double ratePerSecond, double burst = 0);
+
+    double GetRate() const;
+
+    double GetBurst() const;
+
+    /**
+     * @brief Waits until amount tokens can be taken from the bucket and takes them.
+     *
+     * @param context A context to cancel the wait, Azure::Core::OperationCanceledException is
+     * thrown if it is canceled.
+     * @param amount Number of tokens to take.
+     * @param priority Priority of the caller.
+     */
+    void Acquire(
+        Context& context,
+        int64_t amount,
+        RateLimitPriority priority = RateLimitPriority::Normal);
+
+  private:
+    void Refill(std::chrono::steady_clock::time_point now);
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_cv;
+    double m_rate;
+    double m_burst;
+    double m_tokens;
+    std::chrono::steady_clock::time_point m_lastRefill;
+    std::array<int, 3> m_waiting{};
+  };
+
+  /**
+   * @brief Body stream that takes the bytes read from the inner stream from a RateLimiter, which
+   * blocks the reader once the rate is exceeded.
+   */
+  class RateLimitedBodyStream : public BodyStream {
+  private:
+    std::unique_ptr<BodyStream> m_ownedInner;
+    BodyStream* m_inner;
+    std::shared_ptr<RateLimiter> m_limiter;
+    RateLimitPriority m_priority;
+
+  public:
+    RateLimitedBodyStream(
+        BodyStream* inner,
+        std::shared_ptr<RateLimiter> limiter,
+        RateLimitPriority priority = RateLimitPriority::Normal)
+        : m_inner(inner), m_limiter(std::move(limiter)), m_priority(priority)
+    {
+    }
+
+    RateLimitedBodyStream(
+        std::unique_ptr<BodyStream> inner,
+        std::shared_ptr<RateLimiter> limiter,
+        RateLimitPriority priority = RateLimitPriority::Normal)
+        : m_ownedInner(std::move(inner)), m_inner(m_ownedInner.get()),
+          m_limiter(std::move(limiter)), m_priority(priority)
+    {
+    }
+
+    int64_t Length() const override { return this->m_inner->Length(); }
+    void Rewind() override { this->m_inner->Rewind(); }
+    int64_t Read(Context& context, uint8_t* buffer, int64_t count) override;
+  };
+
+}}} // namespace Azure::Core::Http
@@ -0,0 +1,272 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// SPDX-License-Identifier: MIT
+
+/**
+ * @file
+ * @brief Counters, gauges and histograms recorded by the SDK, and their Prometheus export.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace Azure { namespace Core { namespace Metrics {
+
+  /**
+   * @brief Label names and values of a metric.
+   */
+  using MetricLabels = std::map<std::string, std::string>;
+
+  namespace Details {
+    constexpr std::size_t c_MetricShards = 16;
+    constexpr std::size_t c_CacheLineSize = 64;
+
+    /**
+     * @brief Base of the metrics, whose shards are aligned to cache lines. Before C++17, new
+     * ignores alignments larger than the one of std::max_align_t, so they allocate aligned
+     * storage themselves.
+     */
+    class CacheAligned {
+    public:
+      static void* operator new(std::size_t size);
+      static void operator delete(void* pointer) noexcept;
+    };
+
+    /**
+     * @brief Index of the shard the calling thread records in. Threads are spread across the
+     * shards round-robin, so that threads recording the same metric rarely share a cache line.
+     */
+    inline std::size_t GetShardIndex()
+    {
+      static std::atomic<std::size_t> nextShard{0};
+      thread_local std::size_t shard
+          = nextShard.fetch_add(1, std::memory_order_relaxed) % c_MetricShards;
+      return shard;
+    }
+
+    class ShardedInt64 {
+    public:
+      void Add(int64_t amount)
+      {
+        m_shards[GetShardIndex()].Value.fetch_add(amount, std::memory_order_relaxed);
+      }
+
+      int64_t Sum() const
+      {
+        int64_t sum = 0;
+        for (const auto& shard : m_shards)
+        {
+          sum += shard.Value.load(std::memory_order_relaxed);
+        }
+        return sum;
+      }
+
+    private:
+      struct alignas(c_CacheLineSize) Shard
+      {
+        std::atomic<int64_t> Value{0};
+      };
+
+      std::array<Shard, c_MetricShards> m_shards;
+    };
+  } // namespace Details
+
+  /**
+   * @brief Monotonic counter. Increment is a relaxed atomic add on a per-thread shard.
+   */
+  class Counter : public Details::CacheAligned {
+  public:
+    Counter() = default;
+    Counter(const Counter&) = delete;
+    Counter& operator=(const Counter&) = delete;
+
+    void Increment(int64_t amount = 1) { m_value.Add(amount); }
+
+    int64_t Value() const { return m_value.Sum(); }
+
+  private:
+    Details::ShardedInt64 m_value;
+  };
+
+  /**
+   * @brief Value that goes up and down, such as the number of operations in progress.
+   */
+  class Gauge : public Details::CacheAligned {
+  public:
+    Gauge() = default;
+    Gauge(const Gauge&) = delete;
+    Gauge& operator=(const Gauge&) = delete;
+
+    void Add(int64_t amount) { m_value.Add(amount); }
+
+    void Subtract(int64_t amount) { m_value.Add(-amount); }
+
+    int64_t Value() const { return m_value.Sum(); }
+
+  private:
+    Details::ShardedInt64 m_value;
+  };
+
+  /**
+   * @brief Histogram with fixed bucket bounds, as exported to Prometheus. Observe finds the
+   * bucket with a binary search and adds to the per-thread shard without taking a lock.
+   */
+  class Histogram : public Details::CacheAligned {
+  public:
+    /**
+     * @brief Construct a new Histogram.
+     *
+     * @param bounds Inclusive upper bounds of the buckets, in increasing order. Values larger
+     * than the last bound are counted in an additional bucket.
+     */
+    explicit Histogram(std::vector<double> bounds);
+
+    Histogram(const Histogram&) = delete;
+    Histogram& operator=(const Histogram&) = delete;
+
+    void Observe(double value);
+
+    std::vector<double> const& GetBounds() const { return m_bounds; }
+
+    /**
+     * @brief Number of values in each bucket, the last one being the bucket of the values larger
+     * than all the bounds. The counts aren't cumulative.
+     */
+    std::vector<uint64_t> GetBucketCounts() const;
+
+    double GetSum() const;
+
+  private:
+    struct alignas(Details::c_CacheLineSize) Shard
+    {
+      std::unique_ptr<std::atomic<uint64_t>[]> Buckets;
+      std::atomic<double> Sum{0.0};
+    };
+
+    std::vector<double> m_bounds;
+    std::array<Shard, Details::c_MetricShards> m_shards;
+  };
+
+  enum class MetricType
+  {
+    Counter,
+    Gauge,
+    Histogram,
+  };
+
+  /**
+   * @brief Value of one set of labels of a metric at the time of the snapshot.
+   */
+  struct MetricSample
+  {
+    MetricLabels Labels;
+    /**
+     * @brief Value of a counter or a gauge.
+     */
+    int64_t Value = 0;
+    /**
+     * @brief Bucket bounds of a histogram.
+     */
+    std::vector<double> BucketBounds;
+    /**
+     * @brief Number of values in each bucket of a histogram, the last one being the bucket of the
+     * values larger than all the bounds. The counts aren't cumulative.
+     */
+    std::vector<uint64_t> BucketCounts;
+    double Sum = 0.0;
+  };
+
+  struct MetricFamily
+  {
+    std::string Name;
+    std::string Help;
+    MetricType Type = MetricType::Counter;
+    std::vector<MetricSample> Samples;
+  };
+
+  /**
+   * @brief Owns the metrics, identified by their name and labels.
+   *
+   * @remark Looking a metric up takes a lock. Callers on a hot path keep the reference it returns,
+   * which stays valid as long as the registry, and only record through it.
+   */
+  class MetricsRegistry {
+  public:
+    MetricsRegistry() = default;
+    MetricsRegistry(const MetricsRegistry&) = delete;
+    MetricsRegistry& operator=(const MetricsRegistry&) = delete;
+
+    /**
+     * @brief The registry the SDK records its metrics in. It is never destroyed, so that it can
+     * be used during the destruction of static objects.
+     */
+    static MetricsRegistry& GetDefault();
+
+    /**
+     * @brief Returns the counter with the given name and labels, creating it if needed.
+     *
+     * @remark A metric has at most 1024 sets of labels, the values of the labels of the ones
+     * created after that are replaced by "other" to bound the memory used.
+     * @throw std::invalid_argument if a metric with the same name but another type exists.
+     */
+    Counter& GetCounter(
+        std::string const& name,
+        std::string const& help,
+        MetricLabels const& labels = MetricLabels());
+
+    Gauge& GetGauge(
+        std::string const& name,
+        std::string const& help,
+        MetricLabels const& labels = MetricLabels());
+
+    /**
+     * @brief Returns the histogram with the given name and labels, creating it if needed. The
+     * bounds of the first histogram created with that name are used for all of its labels.
+     */
+    Histogram& GetHistogram(
+        std::string const& name,
+        std::string const& help,
+        std::vector<double> const& bounds,
+        MetricLabels const& labels = MetricLabels());
+
+    /**
+     * @brief Returns the current value of every metric, sorted by name.
+     */
+    std::vector<MetricFamily> Snapshot() const;
+
+  private:
+    struct Family
+    {
+      std::string Help;
+      MetricType Type;
+      std::vector<double> Bounds;
+      std::map<MetricLabels, std::unique_ptr<Counter>> Counters;
+      std::map<MetricLabels, std::unique_ptr<Gauge>> Gauges;
+      std::map<MetricLabels, std::unique_ptr<Histogram>> Histograms;
+    };
+
+    Family& GetFamily(std::string const& name, std::string const& help, MetricType type);
+
+    mutable std::mutex m_mutex;
+    std::map<std::string, Family> m_families;
+  };
+
+  /**
+   * @brief Formats a snapshot in the Prometheus text exposition format.
+   */
+  std::string FormatPrometheusText(std::vector<MetricFamily> const& families);
+
+  /**
+   * @brief Default bucket bounds of the latency histograms, in seconds.
+   */
+  std::vector<double> const& GetDefaultLatencyBounds();
+
+}}} // namespace Azure::Core::Metrics
@@ -2,6 +2,7 @@
 // SPDX-License-Identifier: MIT
 
 #include <credentials/policy/policies.hpp>
+#include <metrics.hpp>
 
 using namespace Azure::Core::Credentials::Policy;
 
@@ -15,6 +16,11 @@ std::unique_ptr<Azure::Core::Http::RawResponse> BearerTokenAuthenticationPolicy:
 
     if (std::chrono::system_clock::now() > m_accessToken.ExpiresOn)
     {
+      static auto& tokenRefreshes
+          = Azure::Core::Metrics::MetricsRegistry::GetDefault().GetCounter(
+              "azure_core_credential_token_refreshes_total",
+              "Number of access tokens requested.");
+      tokenRefreshes.Increment();
       m_accessToken = m_credential->GetToken(context, m_scopes);
     }
 
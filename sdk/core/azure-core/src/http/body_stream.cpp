@@ -18,6 +18,7 @@
 #include <cstring>
 #include <http/body_stream.hpp>
 #include <memory>
+#include <utility>
 #include <vector>
 
 using namespace Azure::Core::Http;
@@ -41,21 +42,61 @@ int64_t BodyStream::ReadToCount(Context& context, BodyStream& body, uint8_t* buf
 
 std::vector<uint8_t> BodyStream::ReadToEnd(Context& context, BodyStream& body)
 {
-  constexpr int64_t chunkSize = 1024 * 8;
-  auto buffer = std::vector<uint8_t>();
-
-  for (auto chunkNumber = 0;; chunkNumber++)
+  // A known length is read in place with a single allocation, up to a bound in case the length
+  // announced by the server is bogus.
+  constexpr int64_t maxPresizedLength = 256 * 1024 * 1024;
+  constexpr int64_t minChunkSize = 1024 * 8;
+  constexpr int64_t maxChunkSize = 1024 * 1024;
+
+  std::vector<uint8_t> buffer;
+  auto const length = body.Length();
+  if (length > 0)
   {
-    buffer.resize((chunkNumber + 1) * chunkSize);
-    int64_t readBytes
-        = ReadToCount(context, body, buffer.data() + (chunkNumber * chunkSize), chunkSize);
+    buffer.resize(static_cast<size_t>(std::min(length, maxPresizedLength)));
+    auto readBytes
+        = ReadToCount(context, body, buffer.data(), static_cast<int64_t>(buffer.size()));
+    if (readBytes < static_cast<int64_t>(buffer.size()))
+    {
+      buffer.resize(static_cast<size_t>(readBytes));
+      return buffer;
+    }
+    // The whole length was read, there is nothing left to probe for.
+    if (length <= maxPresizedLength)
+    {
+      return buffer;
+    }
+  }
 
+  // What is left, of unknown length, is read into chunks growing geometrically so each byte is
+  // copied once when they are put together, rather than every time the buffer grows.
+  std::vector<std::vector<uint8_t>> chunks;
+  auto totalLength = buffer.size();
+  for (auto chunkSize = minChunkSize;; chunkSize = std::min(chunkSize * 2, maxChunkSize))
+  {
+    std::vector<uint8_t> chunk(static_cast<size_t>(chunkSize));
+    auto readBytes = ReadToCount(context, body, chunk.data(), chunkSize);
+    if (readBytes > 0)
+    {
+      chunk.resize(static_cast<size_t>(readBytes));
+      totalLength += chunk.size();
+      chunks.push_back(std::move(chunk));
+    }
     if (readBytes < chunkSize)
     {
-      buffer.resize(static_cast<size_t>((chunkNumber * chunkSize) + readBytes));
-      return buffer;
+      break;
     }
   }
+
+  if (buffer.empty() && chunks.size() == 1)
+  {
+    return std::move(chunks.front());
+  }
+  buffer.reserve(totalLength);
+  for (auto const& chunk : chunks)
+  {
+    buffer.insert(buffer.end(), chunk.begin(), chunk.end());
+  }
+  return buffer;
 }
 
 int64_t MemoryBodyStream::Read(Context& context, uint8_t* buffer, int64_t count)
@@ -71,6 +112,19 @@ int64_t MemoryBodyStream::Read(Context& context, uint8_t* buffer, int64_t count)
   return copy_length;
 }
 
+int64_t SharedBodyStream::Read(Context& context, uint8_t* buffer, int64_t count)
+{
+  context.ThrowIfCanceled();
+  auto copied = std::min(count, this->m_length - this->m_offset);
+  if (copied > 0)
+  {
+    std::memcpy(
+        buffer, this->m_body->data() + this->m_begin + this->m_offset, static_cast<size_t>(copied));
+    this->m_offset += copied;
+  }
+  return copied;
+}
+
 #ifdef POSIX
 
 int64_t FileBodyStream::Read(Azure::Core::Context& context, uint8_t* buffer, int64_t count)
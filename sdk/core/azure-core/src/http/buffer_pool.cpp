@@ -0,0 +1,379 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// SPDX-License-Identifier: MIT
+
+#include <http/buffer_pool.hpp>
+#include <metrics.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <limits>
+#include <new>
+#include <utility>
+
+#if defined(_WIN32)
+#include <malloc.h>
+#elif defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+using namespace Azure::Core::Http;
+using Azure::Core::Context;
+
+namespace {
+constexpr int64_t c_MinBufferSize = 4096;
+// Buffers this large are mapped rather than allocated, aligned to the huge page size.
+constexpr int64_t c_HugePageSize = 2 * 1024 * 1024;
+// Without a budget, at most this many bytes are kept for reuse.
+constexpr int64_t c_MaxCachedBytesWithoutBudget = 256 * 1024 * 1024;
+// Waiters wake up at least this often to notice cancellation.
+constexpr auto c_MaxBudgetWait = std::chrono::milliseconds(50);
+
+Azure::Core::Metrics::Gauge& BytesInUseGauge()
+{
+  static auto& gauge = Azure::Core::Metrics::MetricsRegistry::GetDefault().GetGauge(
+      "azure_core_buffer_pool_bytes_in_use",
+      "Number of bytes of the pooled buffers acquired and not given back yet.");
+  return gauge;
+}
+
+Azure::Core::Metrics::Gauge& BytesCachedGauge()
+{
+  static auto& gauge = Azure::Core::Metrics::MetricsRegistry::GetDefault().GetGauge(
+      "azure_core_buffer_pool_bytes_cached",
+      "Number of bytes of the pooled buffers kept for reuse.");
+  return gauge;
+}
+
+uint8_t* AllocateBuffer(int64_t size, bool useHugePages)
+{
+#if defined(_WIN32)
+  (void)useHugePages;
+  auto data = _aligned_malloc(static_cast<std::size_t>(size), c_MinBufferSize);
+#elif defined(__linux__)
+  void* data = nullptr;
+  if (size >= c_HugePageSize)
+  {
+    // Map a huge page more and unmap what is around the aligned range, transparent huge pages
+    // only back aligned ranges.
+    auto mappedSize = static_cast<std::size_t>(size + c_HugePageSize);
+    auto mapped
+        = mmap(nullptr, mappedSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapped == MAP_FAILED)
+    {
+      throw std::bad_alloc();
+    }
+    auto address = reinterpret_cast<uintptr_t>(mapped);
+    auto aligned = (address + c_HugePageSize - 1) / c_HugePageSize * c_HugePageSize;
+    if (aligned > address)
+    {
+      munmap(mapped, aligned - address);
+    }
+    auto end = aligned + static_cast<uintptr_t>(size);
+    if (address + mappedSize > end)
+    {
+      munmap(reinterpret_cast<void*>(end), address + mappedSize - end);
+    }
+    data = reinterpret_cast<void*>(aligned);
+#ifdef MADV_HUGEPAGE
+    if (useHugePages)
+    {
+      madvise(data, static_cast<std::size_t>(size), MADV_HUGEPAGE);
+    }
+#else
+    (void)useHugePages;
+#endif
+  }
+  else if (posix_memalign(&data, c_MinBufferSize, static_cast<std::size_t>(size)) != 0)
+  {
+    data = nullptr;
+  }
+#else
+  (void)useHugePages;
+  void* data = nullptr;
+  if (posix_memalign(&data, c_MinBufferSize, static_cast<std::size_t>(size)) != 0)
+  {
+    data = nullptr;
+  }
+#endif
+  if (data == nullptr)
+  {
+    throw std::bad_alloc();
+  }
+  return static_cast<uint8_t*>(data);
+}
+
+void FreeBuffer(uint8_t* data, int64_t size)
+{
+#if defined(_WIN32)
+  (void)size;
+  _aligned_free(data);
+#elif defined(__linux__)
+  if (size >= c_HugePageSize)
+  {
+    munmap(data, static_cast<std::size_t>(size));
+  }
+  else
+  {
+    std::free(data);
+  }
+#else
+  (void)size;
+  std::free(data);
+#endif
+}
+} // namespace
+
+PooledBuffer::PooledBuffer(PooledBuffer&& other) noexcept
+    : m_pool(other.m_pool), m_data(other.m_data), m_size(other.m_size),
+      m_sizeClass(other.m_sizeClass)
+{
+  other.m_pool = nullptr;
+  other.m_data = nullptr;
+  other.m_size = 0;
+}
+
+PooledBuffer& PooledBuffer::operator=(PooledBuffer&& other) noexcept
+{
+  if (this != &other)
+  {
+    Reset();
+    std::swap(m_pool, other.m_pool);
+    std::swap(m_data, other.m_data);
+    std::swap(m_size, other.m_size);
+    std::swap(m_sizeClass, other.m_sizeClass);
+  }
+  return *this;
+}
+
+int64_t PooledBuffer::GetCapacity() const
+{
+  return m_data == nullptr ? 0 : BufferPool::GetClassSize(m_sizeClass);
+}
+
+void PooledBuffer::Reset()
+{
+  if (m_data != nullptr)
+  {
+    m_pool->Release(m_data, m_sizeClass);
+    m_pool = nullptr;
+    m_data = nullptr;
+    m_size = 0;
+  }
+}
+
+BufferPool::~BufferPool() { Trim(); }
+
+BufferPool& BufferPool::GetDefault()
+{
+  static auto pool = new BufferPool();
+  return *pool;
+}
+
+int BufferPool::GetSizeClass(int64_t size)
+{
+  int sizeClass = 0;
+  while (GetClassSize(sizeClass) < size)
+  {
+    ++sizeClass;
+  }
+  return sizeClass;
+}
+
+int64_t BufferPool::GetClassSize(int sizeClass)
+{
+  auto base = c_MinBufferSize << (sizeClass / 4);
+  return base + base / 4 * (sizeClass % 4);
+}
+
+void BufferPool::SetBudget(int64_t budget)
+{
+  m_budget = std::max<int64_t>(budget, 0);
+  auto excess = m_bytesInUse + m_bytesCached - m_budget;
+  if (m_budget > 0 && excess > 0)
+  {
+    FreeCached(excess);
+  }
+  NotifyWaiters();
+}
+
+int64_t BufferPool::GetBudget() const { return m_budget; }
+
+void BufferPool::SetUseHugePages(bool useHugePages) { m_useHugePages = useHugePages; }
+
+int64_t BufferPool::GetBytesInUse() const { return m_bytesInUse; }
+
+int64_t BufferPool::GetBytesCached() const { return m_bytesCached; }
+
+bool BufferPool::TryReserve(int64_t classSize)
+{
+  auto bytesInUse = m_bytesInUse.load();
+  do
+  {
+    auto budget = m_budget.load();
+    if (budget > 0 && bytesInUse > 0 && bytesInUse + classSize > budget)
+    {
+      return false;
+    }
+  } while (!m_bytesInUse.compare_exchange_weak(bytesInUse, bytesInUse + classSize));
+  return true;
+}
+
+PooledBuffer BufferPool::Acquire(int64_t size)
+{
+  auto sizeClass = GetSizeClass(size);
+  m_bytesInUse += GetClassSize(sizeClass);
+  return Take(size, sizeClass);
+}
+
+PooledBuffer BufferPool::AcquireWithinBudget(Context& context, int64_t size)
+{
+  auto sizeClass = GetSizeClass(size);
+  auto classSize = GetClassSize(sizeClass);
+  if (!TryReserve(classSize))
+  {
+    static auto& budgetWaits = Azure::Core::Metrics::MetricsRegistry::GetDefault().GetCounter(
+        "azure_core_buffer_pool_budget_waits_total",
+        "Number of pooled buffer acquisitions that waited for the memory budget.");
+    budgetWaits.Increment();
+    // Counted as a waiter before checking again, so that a release in between notifies.
+    std::unique_lock<std::mutex> lock(m_waitMutex);
+    ++m_waiters;
+    try
+    {
+      while (!TryReserve(classSize))
+      {
+        context.ThrowIfCanceled();
+        m_cv.wait_for(lock, c_MaxBudgetWait);
+      }
+    }
+    catch (...)
+    {
+      --m_waiters;
+      throw;
+    }
+    --m_waiters;
+  }
+  return Take(size, sizeClass);
+}
+
+PooledBuffer BufferPool::TryAcquireWithinBudget(int64_t size)
+{
+  auto sizeClass = GetSizeClass(size);
+  if (!TryReserve(GetClassSize(sizeClass)))
+  {
+    return PooledBuffer();
+  }
+  return Take(size, sizeClass);
+}
+
+PooledBuffer BufferPool::Take(int64_t size, int sizeClass)
+{
+  // The bytes are already counted in use.
+  auto classSize = GetClassSize(sizeClass);
+  BytesInUseGauge().Add(classSize);
+  if (sizeClass < c_CachedSizeClasses)
+  {
+    auto& freeList = m_freeLists[static_cast<std::size_t>(sizeClass)];
+    std::unique_lock<std::mutex> lock(freeList.Mutex);
+    if (!freeList.Buffers.empty())
+    {
+      auto data = freeList.Buffers.back();
+      freeList.Buffers.pop_back();
+      lock.unlock();
+      m_bytesCached -= classSize;
+      BytesCachedGauge().Subtract(classSize);
+      return PooledBuffer(this, data, size, sizeClass);
+    }
+  }
+
+  // Make room for the new buffer by freeing the ones kept for other sizes.
+  auto excess = m_bytesInUse + m_bytesCached - m_budget;
+  if (m_budget > 0 && excess > 0)
+  {
+    FreeCached(excess);
+  }
+  try
+  {
+    return PooledBuffer(this, AllocateBuffer(classSize, m_useHugePages), size, sizeClass);
+  }
+  catch (std::bad_alloc&)
+  {
+    m_bytesInUse -= classSize;
+    BytesInUseGauge().Subtract(classSize);
+    NotifyWaiters();
+    throw;
+  }
+}
+
+void BufferPool::Release(uint8_t* data, int sizeClass)
+{
+  auto classSize = GetClassSize(sizeClass);
+  m_bytesInUse -= classSize;
+  BytesInUseGauge().Subtract(classSize);
+  NotifyWaiters();
+
+  if (sizeClass < c_CachedSizeClasses)
+  {
+    // The bytes are counted as cached before the buffer is kept, the check and the count can't
+    // be separated by another release.
+    auto bytesCached = m_bytesCached.load();
+    bool fits;
+    do
+    {
+      auto budget = m_budget.load();
+      fits = budget > 0 ? m_bytesInUse + bytesCached + classSize <= budget
+                        : bytesCached + classSize <= c_MaxCachedBytesWithoutBudget;
+    } while (fits && !m_bytesCached.compare_exchange_weak(bytesCached, bytesCached + classSize));
+    if (fits)
+    {
+      auto& freeList = m_freeLists[static_cast<std::size_t>(sizeClass)];
+      {
+        std::lock_guard<std::mutex> guard(freeList.Mutex);
+        freeList.Buffers.push_back(data);
+      }
+      BytesCachedGauge().Add(classSize);
+      return;
+    }
+  }
+  FreeBuffer(data, classSize);
+}
+
+void BufferPool::NotifyWaiters()
+{
+  // A waiter counts itself with the mutex held, then checks the budget again before waiting.
+  if (m_waiters > 0)
+  {
+    std::lock_guard<std::mutex> guard(m_waitMutex);
+    m_cv.notify_all();
+  }
+}
+
+void BufferPool::FreeCached(int64_t bytes)
+{
+  // The largest buffers go first, they are the least likely to be reused.
+  for (auto sizeClass = c_CachedSizeClasses; sizeClass > 0 && bytes > 0; --sizeClass)
+  {
+    auto& freeList = m_freeLists[static_cast<std::size_t>(sizeClass - 1)];
+    auto classSize = GetClassSize(sizeClass - 1);
+    std::vector<uint8_t*> freed;
+    {
+      std::lock_guard<std::mutex> guard(freeList.Mutex);
+      while (!freeList.Buffers.empty() && bytes > 0)
+      {
+        freed.push_back(freeList.Buffers.back());
+        freeList.Buffers.pop_back();
+        bytes -= classSize;
+      }
+    }
+    for (auto data : freed)
+    {
+      FreeBuffer(data, classSize);
+    }
+    auto freedBytes = classSize * static_cast<int64_t>(freed.size());
+    m_bytesCached -= freedBytes;
+    BytesCachedGauge().Subtract(freedBytes);
+  }
+}
+
+void BufferPool::Trim() { FreeCached(std::numeric_limits<int64_t>::max()); }
@@ -0,0 +1,405 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// SPDX-License-Identifier: MIT
+
+#include <http/body_stream.hpp>
+#include <http/policy.hpp>
+#include <metrics.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <list>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+using namespace Azure::Core::Http;
+using namespace Azure::Core::Metrics;
+using Azure::Core::Context;
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+struct CachedResponse
+{
+  int32_t MajorVersion = 1;
+  int32_t MinorVersion = 1;
+  HttpStatusCode StatusCode = HttpStatusCode::Ok;
+  std::string ReasonPhrase;
+  std::map<std::string, std::string> Headers;
+  std::shared_ptr<const std::vector<uint8_t>> Body;
+  std::string ETag;
+  std::string LastModified;
+  Clock::time_point ValidatedAt;
+};
+
+struct CacheMetrics
+{
+  Counter& Hits;
+  Counter& Revalidated;
+  Counter& Stale;
+  Counter& Misses;
+};
+
+CacheMetrics& GetCacheMetrics()
+{
+  static CacheMetrics metrics{
+      MetricsRegistry::GetDefault().GetCounter(
+          "azure_core_http_cache_hits_total",
+          "Number of cached responses returned without sending a request."),
+      MetricsRegistry::GetDefault().GetCounter(
+          "azure_core_http_cache_revalidated_total",
+          "Number of cached responses returned after a 304 Not Modified response."),
+      MetricsRegistry::GetDefault().GetCounter(
+          "azure_core_http_cache_stale_total",
+          "Number of stale cached responses returned because revalidating them failed."),
+      MetricsRegistry::GetDefault().GetCounter(
+          "azure_core_http_cache_misses_total",
+          "Number of cacheable requests for which no cached response could be returned.")};
+  return metrics;
+}
+
+// The headers a request brings its own conditions with, the cache stays out of its way.
+bool HasOwnConditions(std::map<std::string, std::string> const& headers)
+{
+  for (auto const& header : headers)
+  {
+    if (header.first.compare(0, 3, "if-") == 0 || header.first.compare(0, 8, "x-ms-if-") == 0
+        || header.first == "x-ms-lease-id")
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Each copy of the policy gets its own scope, the clients it is given to may not share their
+// credential.
+std::atomic<uint64_t> g_nextScope{0};
+
+std::string GetCacheKey(
+    uint64_t scope,
+    Request& request,
+    std::map<std::string, std::string> const& headers)
+{
+  // The headers selecting which representation, or which part of it, is returned, and the
+  // credential if the request is already authenticated.
+  static const char* const keyHeaders[] = {
+      "accept",
+      "authorization",
+      "range",
+      "x-ms-encryption-key-sha256",
+      "x-ms-range",
+      "x-ms-range-get-content-crc64",
+      "x-ms-range-get-content-md5",
+      "x-ms-version",
+  };
+  auto key = std::to_string(scope) + '\n' + std::to_string(static_cast<int>(request.GetMethod()))
+      + '\n' + request.GetEncodedUrl();
+  for (auto name : keyHeaders)
+  {
+    auto header = headers.find(name);
+    if (header != headers.end())
+    {
+      key += '\n' + header->first + ':' + header->second;
+    }
+  }
+  return key;
+}
+
+// The request ids of a cached response are those of the request and of the response revalidating
+// it, if any, rather than those of the request that got it.
+std::unique_ptr<RawResponse> MakeResponse(
+    CachedResponse const& cached,
+    Request& request,
+    std::map<std::string, std::string> const& requestHeaders,
+    RawResponse const* revalidation = nullptr)
+{
+  auto response = std::make_unique<RawResponse>(
+      cached.MajorVersion, cached.MinorVersion, cached.StatusCode, cached.ReasonPhrase);
+  auto clientRequestId = requestHeaders.find("x-ms-client-request-id");
+  if (clientRequestId != requestHeaders.end())
+  {
+    response->AddHeader(clientRequestId->first, clientRequestId->second);
+  }
+  if (revalidation != nullptr)
+  {
+    auto const& revalidationHeaders = revalidation->GetHeaders();
+    auto requestId = revalidationHeaders.find("x-ms-request-id");
+    if (requestId != revalidationHeaders.end())
+    {
+      response->AddHeader(requestId->first, requestId->second);
+    }
+  }
+  // The headers added already aren't replaced.
+  for (auto const& header : cached.Headers)
+  {
+    if (header.first != "x-ms-client-request-id")
+    {
+      response->AddHeader(header.first, header.second);
+    }
+  }
+  if (request.IsDownloadViaStream())
+  {
+    response->SetBodyStream(std::make_unique<SharedBodyStream>(cached.Body));
+  }
+  else
+  {
+    response->SetBody(*cached.Body);
+  }
+  return response;
+}
+
+bool IsServerError(RawResponse const& response)
+{
+  return static_cast<int>(response.GetStatusCode()) >= 500;
+}
+} // namespace
+
+namespace Azure { namespace Core { namespace Http { namespace Details {
+
+  class ConditionalGetCacheEntries {
+  public:
+    std::shared_ptr<const CachedResponse> Get(std::string const& key)
+    {
+      std::lock_guard<std::mutex> guard(m_mutex);
+      auto ite = m_entries.find(key);
+      if (ite == m_entries.end())
+      {
+        return nullptr;
+      }
+      m_lru.splice(m_lru.begin(), m_lru, ite->second.LruPosition);
+      return ite->second.Response;
+    }
+
+    void Put(
+        std::string const& key,
+        std::shared_ptr<const CachedResponse> response,
+        int64_t maxCacheSize)
+    {
+      std::lock_guard<std::mutex> guard(m_mutex);
+      RemoveLocked(key);
+      m_size += static_cast<int64_t>(response->Body->size());
+      m_lru.push_front(key);
+      m_entries.emplace(key, Entry{std::move(response), m_lru.begin()});
+      while (m_size > maxCacheSize && !m_lru.empty())
+      {
+        RemoveLocked(m_lru.back());
+      }
+    }
+
+    void Remove(std::string const& key)
+    {
+      std::lock_guard<std::mutex> guard(m_mutex);
+      RemoveLocked(key);
+    }
+
+    void Clear()
+    {
+      std::lock_guard<std::mutex> guard(m_mutex);
+      m_entries.clear();
+      m_lru.clear();
+      m_size = 0;
+    }
+
+  private:
+    struct Entry
+    {
+      std::shared_ptr<const CachedResponse> Response;
+      std::list<std::string>::iterator LruPosition;
+    };
+
+    void RemoveLocked(std::string const& key)
+    {
+      auto ite = m_entries.find(key);
+      if (ite != m_entries.end())
+      {
+        m_size -= static_cast<int64_t>(ite->second.Response->Body->size());
+        // The key is erased from the map first, it may be the one stored in the list.
+        auto lruPosition = ite->second.LruPosition;
+        m_entries.erase(ite);
+        m_lru.erase(lruPosition);
+      }
+    }
+
+    std::mutex m_mutex;
+    std::unordered_map<std::string, Entry> m_entries;
+    // Most recently used first.
+    std::list<std::string> m_lru;
+    int64_t m_size = 0;
+  };
+
+}}}} // namespace Azure::Core::Http::Details
+
+namespace {
+// Caches the response if it is cacheable, and returns it with its body read if it was cached.
+std::unique_ptr<RawResponse> StoreResponse(
+    Context& context,
+    Request& request,
+    std::unique_ptr<RawResponse> response,
+    std::string const& key,
+    ConditionalGetCacheOptions const& options,
+    Azure::Core::Http::Details::ConditionalGetCacheEntries& entries)
+{
+  auto statusCode = response->GetStatusCode();
+  if (statusCode != HttpStatusCode::Ok && statusCode != HttpStatusCode::PartialContent)
+  {
+    // The cached response is outdated unless the service failed to answer.
+    if (!IsServerError(*response))
+    {
+      entries.Remove(key);
+    }
+    return response;
+  }
+
+  auto const& headers = response->GetHeaders();
+  auto etag = headers.find("etag");
+  auto lastModified = headers.find("last-modified");
+  if (etag == headers.end() && lastModified == headers.end())
+  {
+    entries.Remove(key);
+    return response;
+  }
+
+  std::shared_ptr<const std::vector<uint8_t>> body;
+  if (request.IsDownloadViaStream())
+  {
+    auto bodyStream = response->GetBodyStream();
+    if (bodyStream)
+    {
+      // A body of unknown length isn't read, the caller may want to stream it.
+      if (bodyStream->Length() < 0 || bodyStream->Length() > options.MaxBodySize)
+      {
+        response->SetBodyStream(std::move(bodyStream));
+        entries.Remove(key);
+        return response;
+      }
+      body = std::make_shared<const std::vector<uint8_t>>(
+          BodyStream::ReadToEnd(context, *bodyStream));
+    }
+    else
+    {
+      body = std::make_shared<const std::vector<uint8_t>>();
+    }
+    response->SetBodyStream(std::make_unique<SharedBodyStream>(body));
+  }
+  else
+  {
+    if (static_cast<int64_t>(response->GetBody().size()) > options.MaxBodySize)
+    {
+      entries.Remove(key);
+      return response;
+    }
+    body = std::make_shared<const std::vector<uint8_t>>(response->GetBody());
+  }
+
+  auto cached = std::make_shared<CachedResponse>();
+  cached->MajorVersion = response->GetMajorVersion();
+  cached->MinorVersion = response->GetMinorVersion();
+  cached->StatusCode = statusCode;
+  cached->ReasonPhrase = response->GetReasonPhrase();
+  cached->Headers = headers;
+  cached->Body = std::move(body);
+  cached->ETag = etag == headers.end() ? std::string() : etag->second;
+  cached->LastModified = lastModified == headers.end() ? std::string() : lastModified->second;
+  cached->ValidatedAt = Clock::now();
+  entries.Put(key, std::move(cached), options.MaxCacheSize);
+  return response;
+}
+} // namespace
+
+ConditionalGetCachePolicy::ConditionalGetCachePolicy(ConditionalGetCacheOptions options)
+    : m_cacheOptions(std::move(options)),
+      m_entries(std::make_shared<Details::ConditionalGetCacheEntries>()), m_scope(g_nextScope++)
+{
+}
+
+std::unique_ptr<HttpPolicy> ConditionalGetCachePolicy::Clone() const
+{
+  auto policy = std::make_unique<ConditionalGetCachePolicy>(*this);
+  policy->m_scope = g_nextScope++;
+  return policy;
+}
+
+void ConditionalGetCachePolicy::Clear() const { m_entries->Clear(); }
+
+std::unique_ptr<RawResponse> ConditionalGetCachePolicy::Send(
+    Context& ctx,
+    Request& request,
+    NextHttpPolicy nextHttpPolicy) const
+{
+  auto method = request.GetMethod();
+  auto headers = request.GetHeaders();
+  if ((method != HttpMethod::Get && method != HttpMethod::Head) || HasOwnConditions(headers))
+  {
+    return nextHttpPolicy.Send(ctx, request);
+  }
+
+  auto& metrics = GetCacheMetrics();
+  auto key = GetCacheKey(m_scope, request, headers);
+  auto cached = m_entries->Get(key);
+  if (!cached)
+  {
+    metrics.Misses.Increment();
+    return StoreResponse(
+        ctx, request, nextHttpPolicy.Send(ctx, request), key, m_cacheOptions, *m_entries);
+  }
+
+  auto age = Clock::now() - cached->ValidatedAt;
+  if (age < m_cacheOptions.FreshFor)
+  {
+    metrics.Hits.Increment();
+    return MakeResponse(*cached, request, headers);
+  }
+
+  // The request is copied so that the caller's one doesn't keep the conditional header.
+  Request conditionalRequest = request;
+  if (!cached->ETag.empty())
+  {
+    conditionalRequest.AddHeader("if-none-match", cached->ETag);
+  }
+  else
+  {
+    conditionalRequest.AddHeader("if-modified-since", cached->LastModified);
+  }
+
+  std::unique_ptr<RawResponse> response;
+  try
+  {
+    response = nextHttpPolicy.Send(ctx, conditionalRequest);
+  }
+  catch (TransportException const&)
+  {
+    if (age >= m_cacheOptions.StaleIfErrorFor)
+    {
+      throw;
+    }
+  }
+  catch (CouldNotResolveHostException const&)
+  {
+    if (age >= m_cacheOptions.StaleIfErrorFor)
+    {
+      throw;
+    }
+  }
+
+  if (!response || (IsServerError(*response) && age < m_cacheOptions.StaleIfErrorFor))
+  {
+    metrics.Stale.Increment();
+    return MakeResponse(*cached, request, headers);
+  }
+
+  if (response->GetStatusCode() == HttpStatusCode::NotModified)
+  {
+    auto revalidated = std::make_shared<CachedResponse>(*cached);
+    revalidated->ValidatedAt = Clock::now();
+    m_entries->Put(key, revalidated, m_cacheOptions.MaxCacheSize);
+    metrics.Revalidated.Increment();
+    return MakeResponse(*revalidated, request, headers, response.get());
+  }
+
+  metrics.Misses.Increment();
+  return StoreResponse(ctx, request, std::move(response), key, m_cacheOptions, *m_entries);
+}
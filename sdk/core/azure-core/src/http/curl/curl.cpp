@@ -2,16 +2,81 @@
 #include "http/curl/curl.hpp"
 
 #include "azure.hpp"
+#include "http/buffer_pool.hpp"
 #include "http/http.hpp"
+#include "metrics.hpp"
 
+#include <algorithm>
+#include <chrono>
+#include <cstring>
 #include <string>
 
+#ifdef __linux__
+#include <cerrno>
+#include <linux/tls.h>
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+#endif
+
+#if defined(__linux__) && defined(AZ_CORE_WITH_OPENSSL)
+#include <openssl/ssl.h>
+#endif
+
 using namespace Azure::Core::Http;
 
+namespace {
+
+// Memory bodies are sent in slices of this size, checking for cancellation between them.
+constexpr int64_t c_MaxMemoryBodySendSize = 1024 * 1024;
+
+// Waits for a response are split in slices of this duration, checking for cancellation between
+// them.
+constexpr long c_CancelCheckIntervalMs = 10;
+
+// Aborts the connection, which libcurl establishes on its own, once the context is canceled.
+int AbortConnectIfCanceled(void* clientp, curl_off_t, curl_off_t, curl_off_t, curl_off_t)
+{
+  auto context = static_cast<Azure::Core::Context*>(clientp);
+  return context->CancelWhen() < std::chrono::system_clock::now() ? 1 : 0;
+}
+
+#ifdef __linux__
+// sendfile moves at most about 2GB at a time.
+constexpr int64_t c_MaxSendFileSize = 1024 * 1024 * 1024;
+#endif
+
+#if defined(__linux__) && defined(AZ_CORE_WITH_OPENSSL) && defined(SSL_OP_ENABLE_KTLS)
+CURLcode EnableKernelTls(CURL* handle, void* sslContext, void* userData)
+{
+  AZURE_UNREFERENCED_PARAMETER(handle);
+  AZURE_UNREFERENCED_PARAMETER(userData);
+  SSL_CTX_set_options(static_cast<SSL_CTX*>(sslContext), SSL_OP_ENABLE_KTLS);
+  return CURLE_OK;
+}
+#endif
+
+// Asks OpenSSL to hand the encryption of the connection over to the kernel once the handshake is
+// done. The SSL_CTX given by libcurl is only touched if libcurl uses OpenSSL 3, the version the
+// option was introduced in and the one this library is built against.
+void RequestKernelTls(CURL* handle)
+{
+#if defined(__linux__) && defined(AZ_CORE_WITH_OPENSSL) && defined(SSL_OP_ENABLE_KTLS)
+  auto version = curl_version_info(CURLVERSION_NOW);
+  if (version->ssl_version != nullptr && std::strncmp(version->ssl_version, "OpenSSL/3", 9) == 0)
+  {
+    curl_easy_setopt(handle, CURLOPT_SSL_CTX_FUNCTION, EnableKernelTls);
+  }
+#else
+  AZURE_UNREFERENCED_PARAMETER(handle);
+#endif
+}
+
+} // namespace
+
 std::unique_ptr<RawResponse> CurlTransport::Send(Context& context, Request& request)
 {
   // Create CurlSession to perform request
-  auto session = std::make_unique<CurlSession>(request);
+  auto session = std::make_unique<CurlSession>(request, m_options);
 
   auto performing = session->Perform(context);
 
@@ -41,8 +106,6 @@ std::unique_ptr<RawResponse> CurlTransport::Send(Context& context, Request& requ
 
 CURLcode CurlSession::Perform(Context& context)
 {
-  AZURE_UNREFERENCED_PARAMETER(context);
-
   // Working with Body Buffer. let Libcurl use the classic callback to read/write
   auto result = SetUrl();
   if (result != CURLE_OK)
@@ -85,12 +148,26 @@ CURLcode CurlSession::Perform(Context& context)
     this->m_request.AddHeader("expect", "100-continue");
   }
 
+  if (this->m_options.KernelFileTransfer)
+  {
+    RequestKernelTls(this->m_pCurl);
+  }
+
   // establish connection only (won't send or receive anything yet)
+  curl_easy_setopt(this->m_pCurl, CURLOPT_XFERINFOFUNCTION, AbortConnectIfCanceled);
+  curl_easy_setopt(this->m_pCurl, CURLOPT_XFERINFODATA, &context);
+  curl_easy_setopt(this->m_pCurl, CURLOPT_NOPROGRESS, 0L);
   result = curl_easy_perform(this->m_pCurl);
+  curl_easy_setopt(this->m_pCurl, CURLOPT_NOPROGRESS, 1L);
+  if (result == CURLE_ABORTED_BY_CALLBACK)
+  {
+    context.ThrowIfCanceled();
+  }
   if (result != CURLE_OK)
   {
     return result;
   }
+  Details::GetCurlConnectionTimings(this->m_pCurl, this->m_timings);
   // Record socket to be used
   result = curl_easy_getinfo(this->m_pCurl, CURLINFO_ACTIVESOCKET, &this->m_curlSocket);
   if (result != CURLE_OK)
@@ -99,35 +176,81 @@ CURLcode CurlSession::Perform(Context& context)
   }
 
   // Send request
+  auto sendStart = std::chrono::steady_clock::now();
   result = HttpRawSend(context);
   if (result != CURLE_OK)
   {
     return result;
   }
 
-  ReadStatusLineAndHeadersFromRawResponse();
-
   // Upload body for PUT
-  if (this->m_request.GetMethod() != HttpMethod::Put)
+  if (this->m_request.GetMethod() == HttpMethod::Put)
   {
-    return result;
+    ReadStatusLineAndHeadersFromRawResponse(context);
+
+    // Check server response from Expect:100-continue for PUT;
+    // This help to prevent us from start uploading data when Server can't handle it
+    if (this->m_response->GetStatusCode() != HttpStatusCode::Continue)
+    {
+      // Won't upload. The response was the first byte received after sending the headers.
+      this->m_timings.RequestSend = std::chrono::duration_cast<std::chrono::microseconds>(
+          std::chrono::steady_clock::now() - sendStart);
+      return result;
+    }
+
+    // Start upload
+    result = this->UploadBody(context);
+    if (result != CURLE_OK)
+    {
+      return result; // will throw transport exception before trying to read
+    }
   }
 
-  // Check server response from Expect:100-continue for PUT;
-  // This help to prevent us from start uploading data when Server can't handle it
-  if (this->m_response->GetStatusCode() != HttpStatusCode::Continue)
+  auto sendEnd = std::chrono::steady_clock::now();
+  ReadStatusLineAndHeadersFromRawResponse(context);
+  this->m_timings.RequestSend
+      = std::chrono::duration_cast<std::chrono::microseconds>(sendEnd - sendStart);
+  this->m_timings.TimeToFirstByte = std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - sendEnd);
+  return result;
+}
+
+void Details::GetCurlConnectionTimings(CURL* handle, HttpTimings& timings)
+{
+  // Each value is the time from the start of the transfer to the end of the phase, 0 for the
+  // phases that didn't happen.
+  curl_off_t nameLookup = 0;
+  curl_off_t connect = 0;
+  curl_off_t appConnect = 0;
+  curl_easy_getinfo(handle, CURLINFO_NAMELOOKUP_TIME_T, &nameLookup);
+  curl_easy_getinfo(handle, CURLINFO_CONNECT_TIME_T, &connect);
+  curl_easy_getinfo(handle, CURLINFO_APPCONNECT_TIME_T, &appConnect);
+
+  timings.NameLookup = std::chrono::microseconds(nameLookup);
+  timings.Connect = std::chrono::microseconds(connect > nameLookup ? connect - nameLookup : 0);
+  timings.TlsHandshake
+      = std::chrono::microseconds(appConnect > connect ? appConnect - connect : 0);
+
+  static auto& connectionsOpened = Azure::Core::Metrics::MetricsRegistry::GetDefault().GetCounter(
+      "azure_core_http_connections_opened_total", "Number of connections opened by libcurl.");
+  long numConnects = 0;
+  if (curl_easy_getinfo(handle, CURLINFO_NUM_CONNECTS, &numConnects) == CURLE_OK && numConnects > 0)
   {
-    return result; // Won't upload.
+    connectionsOpened.Increment(numConnects);
   }
+}
 
-  // Start upload
-  result = this->UploadBody(context);
-  if (result != CURLE_OK)
+std::unique_ptr<RawResponse> Details::ParseResponseHead(
+    uint8_t const* buffer,
+    int64_t size,
+    int64_t readSize)
+{
+  CurlSession::ResponseBufferParser parser;
+  for (int64_t offset = 0; offset < size && !parser.IsParseCompleted(); offset += readSize)
   {
-    return result; // will throw transport exception before trying to read
+    parser.Parse(buffer + offset, std::min(readSize, size - offset));
   }
-  ReadStatusLineAndHeadersFromRawResponse();
-  return result;
+  return parser.GetResponse();
 }
 
 // Creates an HTTP Response with specific bodyType
@@ -197,6 +320,26 @@ static int WaitForSocketReady(curl_socket_t sockfd, int for_recv, long timeout_m
   return res;
 }
 
+// Waits for the socket in slices, so that a canceled context doesn't wait for the whole timeout.
+static int WaitForSocketReady(
+    Azure::Core::Context& context,
+    curl_socket_t sockfd,
+    int for_recv,
+    long timeout_ms)
+{
+  for (long waited = 0; waited < timeout_ms; waited += c_CancelCheckIntervalMs)
+  {
+    context.ThrowIfCanceled();
+    auto slice = std::min(c_CancelCheckIntervalMs, timeout_ms - waited);
+    auto res = WaitForSocketReady(sockfd, for_recv, slice);
+    if (res != 0)
+    {
+      return res;
+    }
+  }
+  return 0;
+}
+
 bool CurlSession::isUploadRequest()
 {
   return this->m_request.GetMethod() == HttpMethod::Put
@@ -252,27 +395,54 @@ CURLcode CurlSession::SendBuffer(uint8_t const* buffer, size_t bufferSize)
 CURLcode CurlSession::UploadBody(Context& context)
 {
   // Send body UploadStreamPageSize at a time (libcurl default)
-  // NOTE: if stream is on top a contiguous memory, we can avoid allocating this copying buffer
   auto streamBody = this->m_request.GetBodyStream();
   CURLcode sendResult = CURLE_OK;
   this->m_uploadedBytes = 0;
 
+  // Streams on top of contiguous memory are sent from it, without a copying buffer.
+  if (auto memoryBody = dynamic_cast<MemoryBodyStream*>(streamBody))
+  {
+    while (memoryBody->GetRemaining() > 0)
+    {
+      context.ThrowIfCanceled();
+      auto sendSize = std::min(memoryBody->GetRemaining(), c_MaxMemoryBodySendSize);
+      sendResult = SendBuffer(memoryBody->GetData(), static_cast<size_t>(sendSize));
+      if (sendResult != CURLE_OK)
+      {
+        return sendResult;
+      }
+      memoryBody->Skip(sendSize);
+    }
+    return CURLE_OK;
+  }
+
+  if (this->m_options.KernelFileTransfer)
+  {
+    sendResult = SendFileBody(context, *streamBody);
+    if (sendResult != CURLE_UNSUPPORTED_PROTOCOL)
+    {
+      return sendResult;
+    }
+    sendResult = CURLE_OK;
+  }
+
   int64_t uploadChunkSize = this->m_request.GetUploadChunkSize();
   if (uploadChunkSize <= 0)
   {
     // use default size
     uploadChunkSize = Details::c_UploadDefaultChunkSize;
   }
-  auto unique_buffer = std::make_unique<uint8_t[]>(static_cast<size_t>(uploadChunkSize));
+  // The staging buffer is short lived, it doesn't wait for the budget of the pool.
+  auto buffer = BufferPool::GetDefault().Acquire(uploadChunkSize);
 
   while (true)
   {
-    auto rawRequestLen = streamBody->Read(context, unique_buffer.get(), uploadChunkSize);
+    auto rawRequestLen = streamBody->Read(context, buffer.Data(), uploadChunkSize);
     if (rawRequestLen == 0)
     {
       break;
     }
-    sendResult = SendBuffer(unique_buffer.get(), static_cast<size_t>(rawRequestLen));
+    sendResult = SendBuffer(buffer.Data(), static_cast<size_t>(rawRequestLen));
     if (sendResult != CURLE_OK)
     {
       return sendResult;
@@ -281,6 +451,68 @@ CURLcode CurlSession::UploadBody(Context& context)
   return sendResult;
 }
 
+CURLcode CurlSession::SendFileBody(Context& context, BodyStream& body)
+{
+#ifdef __linux__
+  auto fileBody = dynamic_cast<FileBodyStream*>(&body);
+  if (fileBody == nullptr)
+  {
+    return CURLE_UNSUPPORTED_PROTOCOL;
+  }
+  // Plain TCP sockets take the file as is, TLS ones only if the kernel encrypts what is written.
+  auto const url = this->m_request.GetEncodedUrl();
+  if (Azure::Core::Details::ToLower(url.substr(0, 7)) != "http://")
+  {
+    tls12_crypto_info_aes_gcm_256 cryptoInfo;
+    socklen_t cryptoInfoLength = sizeof(cryptoInfo);
+    if (getsockopt(this->m_curlSocket, SOL_TLS, TLS_TX, &cryptoInfo, &cryptoInfoLength) != 0)
+    {
+      return CURLE_UNSUPPORTED_PROTOCOL;
+    }
+  }
+
+  static auto& kernelBytes = Azure::Core::Metrics::MetricsRegistry::GetDefault().GetCounter(
+      "azure_core_http_kernel_file_transfer_bytes_total",
+      "Number of request body bytes sent from files by the kernel with sendfile.");
+  while (fileBody->GetRemaining() > 0)
+  {
+    context.ThrowIfCanceled();
+    auto offset = static_cast<off_t>(fileBody->GetFileOffset());
+    auto sent = sendfile(
+        this->m_curlSocket,
+        fileBody->GetFileDescriptor(),
+        &offset,
+        static_cast<size_t>(std::min(fileBody->GetRemaining(), c_MaxSendFileSize)));
+    if (sent < 0 && errno == EINTR)
+    {
+      continue;
+    }
+    if (sent < 0 && errno == EAGAIN)
+    {
+      if (!WaitForSocketReady(this->m_curlSocket, 0, 60000L))
+      {
+        return CURLE_OPERATION_TIMEDOUT;
+      }
+      continue;
+    }
+    if (sent <= 0)
+    {
+      // Files sendfile doesn't support fail right away, they are read and sent as usual.
+      return this->m_uploadedBytes == 0 && sent < 0 ? CURLE_UNSUPPORTED_PROTOCOL
+                                                     : CURLE_SEND_ERROR;
+    }
+    fileBody->Skip(sent);
+    this->m_uploadedBytes += sent;
+    kernelBytes.Increment(sent);
+  }
+  return CURLE_OK;
+#else
+  AZURE_UNREFERENCED_PARAMETER(context);
+  AZURE_UNREFERENCED_PARAMETER(body);
+  return CURLE_UNSUPPORTED_PROTOCOL;
+#endif
+}
+
 // custom sending to wire an http request
 CURLcode CurlSession::HttpRawSend(Context& context)
 {
@@ -306,7 +538,7 @@ CURLcode CurlSession::HttpRawSend(Context& context)
   return this->UploadBody(context);
 }
 
-void CurlSession::ParseChunkSize()
+void CurlSession::ParseChunkSize(Context& context)
 {
   // Use this string to construct the chunk size. This is because we could have an internal
   // buffer like [headers...\r\n123], where 123 is chunk size but we still need to pull more
@@ -328,7 +560,7 @@ void CurlSession::ParseChunkSize()
         if (index + 1 == this->m_innerBufferSize)
         { // on last index. Whatever we read is the BodyStart here
           this->m_innerBufferSize
-              = ReadSocketToBuffer(this->m_readBuffer, Details::c_LibcurlReaderSize);
+              = ReadSocketToBuffer(context, this->m_readBuffer, Details::c_LibcurlReaderSize);
           this->m_bodyStartInBuffer = 0;
         }
         else
@@ -342,7 +574,7 @@ void CurlSession::ParseChunkSize()
     if (keepPolling)
     { // Read all internal buffer and \n was not found, pull from wire
       this->m_innerBufferSize
-          = ReadSocketToBuffer(this->m_readBuffer, Details::c_LibcurlReaderSize);
+          = ReadSocketToBuffer(context, this->m_readBuffer, Details::c_LibcurlReaderSize);
       this->m_bodyStartInBuffer = 0;
     }
   }
@@ -350,7 +582,7 @@ void CurlSession::ParseChunkSize()
 }
 
 // Read status line plus headers to create a response with no body
-void CurlSession::ReadStatusLineAndHeadersFromRawResponse()
+void CurlSession::ReadStatusLineAndHeadersFromRawResponse(Context& context)
 {
   auto parser = ResponseBufferParser();
   auto bufferSize = int64_t();
@@ -360,7 +592,7 @@ void CurlSession::ReadStatusLineAndHeadersFromRawResponse()
   {
     // Try to fill internal buffer from socket.
     // If response is smaller than buffer, we will get back the size of the response
-    bufferSize = ReadSocketToBuffer(this->m_readBuffer, Details::c_LibcurlReaderSize);
+    bufferSize = ReadSocketToBuffer(context, this->m_readBuffer, Details::c_LibcurlReaderSize);
 
     // returns the number of bytes parsed up to the body Start
     auto bytesParsed = parser.Parse(this->m_readBuffer, static_cast<size_t>(bufferSize));
@@ -376,8 +608,11 @@ void CurlSession::ReadStatusLineAndHeadersFromRawResponse()
 
   // For Head request, set the length of body response to 0.
   // Response will give us content-length as if we were not doing Head saying what would it be the
-  // length of the body. However, Server won't send body
-  if (this->m_request.GetMethod() == HttpMethod::Head)
+  // length of the body. However, Server won't send body. The same goes for 204 and 304 responses,
+  // a 304 may have the content-length of the representation it validated.
+  auto statusCode = this->m_response->GetStatusCode();
+  if (this->m_request.GetMethod() == HttpMethod::Head || statusCode == HttpStatusCode::NoContent
+      || statusCode == HttpStatusCode::NotModified)
   {
     this->m_contentLength = 0;
     this->m_bodyStartInBuffer = -1;
@@ -413,11 +648,11 @@ void CurlSession::ReadStatusLineAndHeadersFromRawResponse()
       if (this->m_bodyStartInBuffer == -1)
       { // if nothing on inner buffer, pull from wire
         this->m_innerBufferSize
-            = ReadSocketToBuffer(this->m_readBuffer, Details::c_LibcurlReaderSize);
+            = ReadSocketToBuffer(context, this->m_readBuffer, Details::c_LibcurlReaderSize);
         this->m_bodyStartInBuffer = 0;
       }
 
-      ParseChunkSize();
+      ParseChunkSize(context);
       return;
     }
   }
@@ -454,12 +689,12 @@ int64_t CurlSession::Read(Azure::Core::Context& context, uint8_t* buffer, int64_
       else
       { // end of buffer, pull data from wire
         this->m_innerBufferSize
-            = ReadSocketToBuffer(this->m_readBuffer, Details::c_LibcurlReaderSize);
+            = ReadSocketToBuffer(context, this->m_readBuffer, Details::c_LibcurlReaderSize);
         this->m_bodyStartInBuffer = 1; // jump first char (could be \r or \n)
       }
     }
     // get the size of next chunk
-    ParseChunkSize();
+    ParseChunkSize(context);
 
     if (this->m_chunkSize == 0)
     {
@@ -515,7 +750,7 @@ int64_t CurlSession::Read(Azure::Core::Context& context, uint8_t* buffer, int64_
 
   // Read from socket when no more data on internal buffer
   // For chunk request, read a chunk based on chunk size
-  totalRead = ReadSocketToBuffer(buffer, static_cast<size_t>(readRequestLength));
+  totalRead = ReadSocketToBuffer(context, buffer, static_cast<size_t>(readRequestLength));
   this->m_sessionTotalRead += totalRead;
   if (this->m_isChunkedResponseType)
   {
@@ -526,7 +761,10 @@ int64_t CurlSession::Read(Azure::Core::Context& context, uint8_t* buffer, int64_
 }
 
 // Read from socket and return the number of bytes taken from socket
-int64_t CurlSession::ReadSocketToBuffer(uint8_t* buffer, int64_t bufferSize)
+int64_t CurlSession::ReadSocketToBuffer(
+    Context& context,
+    uint8_t* buffer,
+    int64_t bufferSize)
 {
   // loop until read result is not CURLE_AGAIN
   size_t readBytes = 0;
@@ -537,7 +775,7 @@ int64_t CurlSession::ReadSocketToBuffer(uint8_t* buffer, int64_t bufferSize)
     switch (readResult)
     {
       case CURLE_AGAIN:
-        if (!WaitForSocketReady(this->m_curlSocket, 0, 60000L))
+        if (!WaitForSocketReady(context, this->m_curlSocket, 1, 60000L))
         {
           // TODO: Change this to somehing more relevant
           throw Azure::Core::Http::TransportException(
@@ -556,6 +794,10 @@ int64_t CurlSession::ReadSocketToBuffer(uint8_t* buffer, int64_t bufferSize)
 
 std::unique_ptr<Azure::Core::Http::RawResponse> CurlSession::GetResponse()
 {
+  if (this->m_response)
+  {
+    this->m_response->GetTimings() = this->m_timings;
+  }
   return std::move(this->m_response);
 }
 
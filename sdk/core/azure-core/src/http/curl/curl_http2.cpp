@@ -0,0 +1,660 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// SPDX-License-Identifier: MIT
+
+#include "http/curl/curl_http2.hpp"
+
+#include "azure.hpp"
+#include "http/curl/curl.hpp"
+#include "http/http.hpp"
+
+#include <curl/curl.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// curl_multi_poll and curl_multi_wakeup were added in 7.68.0.
+#if LIBCURL_VERSION_NUM < 0x074400
+#error "CurlHttp2Transport requires libcurl 7.68.0 or later"
+#endif
+
+using namespace Azure::Core::Http;
+
+namespace Azure { namespace Core { namespace Http { namespace Details {
+
+  /**
+   * @brief State of one request sent by the CurlHttp2Transport. It's shared by the thread calling
+   * Send, the body stream of the response and the worker thread running the libcurl callbacks.
+   */
+  struct CurlHttp2Transfer
+  {
+    CURL* Handle = nullptr;
+    curl_slist* HeaderList = nullptr;
+    char ErrorBuffer[CURL_ERROR_SIZE] = {};
+
+    // Used by the read callback, only until the upload is completed.
+    Context UploadContext;
+    BodyStream* UploadStream = nullptr;
+    int64_t UploadRemaining = 0;
+
+    int64_t MaxBufferedBodySize = 0;
+
+    std::mutex Mutex;
+    std::condition_variable Cv;
+    std::unique_ptr<RawResponse> Response;
+    bool HeadersCompleted = false;
+    bool UploadCompleted = true;
+    std::chrono::steady_clock::time_point UploadCompletedAt;
+    std::chrono::steady_clock::time_point HeadersCompletedAt;
+    bool TransferCompleted = false;
+    CURLcode Result = CURLE_OK;
+    std::vector<uint8_t> Body;
+    size_t BodyOffset = 0;
+    bool Paused = false;
+
+    CurlHttp2Transfer() : Handle(curl_easy_init()) {}
+
+    ~CurlHttp2Transfer()
+    {
+      curl_easy_cleanup(Handle);
+      curl_slist_free_all(HeaderList);
+    }
+
+    void Complete(CURLcode result)
+    {
+      std::lock_guard<std::mutex> guard(Mutex);
+      TransferCompleted = true;
+      Result = result;
+      Cv.notify_all();
+    }
+
+    std::string GetErrorMessage() const
+    {
+      std::string message = curl_easy_strerror(Result);
+      if (ErrorBuffer[0] != '\0')
+      {
+        message += ": " + std::string(ErrorBuffer);
+      }
+      return message;
+    }
+  };
+
+  /**
+   * @brief Owns the libcurl multi handle and the thread driving it. libcurl handles can only be
+   * used by one thread at a time, so other threads post commands to run on the worker thread.
+   */
+  class CurlMultiWorker {
+  public:
+    explicit CurlMultiWorker(const CurlHttp2TransportOptions& options)
+    {
+      static const CURLcode globalInitResult = curl_global_init(CURL_GLOBAL_ALL);
+      AZURE_UNREFERENCED_PARAMETER(globalInitResult);
+
+      m_multiHandle = curl_multi_init();
+      curl_multi_setopt(m_multiHandle, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+      curl_multi_setopt(
+          m_multiHandle, CURLMOPT_MAX_HOST_CONNECTIONS, options.MaxConnectionsPerHost);
+      m_thread = std::thread([this]() { Run(); });
+    }
+
+    ~CurlMultiWorker()
+    {
+      {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        m_stopping = true;
+      }
+      curl_multi_wakeup(m_multiHandle);
+      m_thread.join();
+
+      // The worker thread is gone, the commands posted since it last ran them are run here so
+      // that none is dropped: a transfer added is aborted below, and a RemoveTransfer waiting for
+      // its command returns.
+      std::vector<std::function<void()>> commands;
+      {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        commands.swap(m_commands);
+      }
+      for (auto& command : commands)
+      {
+        command();
+      }
+
+      for (auto& transfer : m_transfers)
+      {
+        curl_multi_remove_handle(m_multiHandle, transfer.first);
+        transfer.second->Complete(CURLE_ABORTED_BY_CALLBACK);
+      }
+      curl_multi_cleanup(m_multiHandle);
+    }
+
+    void AddTransfer(std::shared_ptr<CurlHttp2Transfer> transfer)
+    {
+      Post([this, transfer]() {
+        CURLMcode result = curl_multi_add_handle(m_multiHandle, transfer->Handle);
+        if (result != CURLM_OK)
+        {
+          transfer->Complete(CURLE_FAILED_INIT);
+          return;
+        }
+        m_transfers.emplace(transfer->Handle, transfer);
+      });
+    }
+
+    // When wait is true, this function returns only after the handle was removed, after that no
+    // more callbacks are invoked for the transfer.
+    void RemoveTransfer(std::shared_ptr<CurlHttp2Transfer> transfer, bool wait)
+    {
+      std::shared_ptr<bool> removed = std::make_shared<bool>(false);
+      Post([this, transfer, removed]() {
+        auto ite = m_transfers.find(transfer->Handle);
+        if (ite != m_transfers.end())
+        {
+          curl_multi_remove_handle(m_multiHandle, transfer->Handle);
+          m_transfers.erase(ite);
+          transfer->Complete(CURLE_ABORTED_BY_CALLBACK);
+        }
+        std::lock_guard<std::mutex> guard(m_mutex);
+        *removed = true;
+        m_cv.notify_all();
+      });
+      if (wait)
+      {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_cv.wait(lock, [&removed]() { return *removed; });
+      }
+    }
+
+    void ResumeTransfer(std::shared_ptr<CurlHttp2Transfer> transfer)
+    {
+      Post([this, transfer]() {
+        if (m_transfers.find(transfer->Handle) != m_transfers.end())
+        {
+          curl_easy_pause(transfer->Handle, CURLPAUSE_CONT);
+        }
+      });
+    }
+
+  private:
+    CURLM* m_multiHandle = nullptr;
+    std::thread m_thread;
+
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::vector<std::function<void()>> m_commands;
+    bool m_stopping = false;
+
+    // Only accessed by the worker thread.
+    std::map<CURL*, std::shared_ptr<CurlHttp2Transfer>> m_transfers;
+
+    void Post(std::function<void()> command)
+    {
+      {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        m_commands.emplace_back(std::move(command));
+      }
+      curl_multi_wakeup(m_multiHandle);
+    }
+
+    void Run()
+    {
+      while (true)
+      {
+        std::vector<std::function<void()>> commands;
+        {
+          std::lock_guard<std::mutex> guard(m_mutex);
+          if (m_stopping)
+          {
+            break;
+          }
+          commands.swap(m_commands);
+        }
+        for (auto& command : commands)
+        {
+          command();
+        }
+
+        int runningHandles = 0;
+        curl_multi_perform(m_multiHandle, &runningHandles);
+
+        int messagesLeft = 0;
+        while (CURLMsg* message = curl_multi_info_read(m_multiHandle, &messagesLeft))
+        {
+          if (message->msg != CURLMSG_DONE)
+          {
+            continue;
+          }
+          auto ite = m_transfers.find(message->easy_handle);
+          if (ite == m_transfers.end())
+          {
+            continue;
+          }
+          auto transfer = ite->second;
+          CURLcode result = message->data.result;
+          curl_multi_remove_handle(m_multiHandle, transfer->Handle);
+          m_transfers.erase(ite);
+          transfer->Complete(result);
+        }
+
+        curl_multi_poll(m_multiHandle, nullptr, 0, 1000, nullptr);
+      }
+    }
+  };
+
+}}}} // namespace Azure::Core::Http::Details
+
+namespace {
+
+using Azure::Core::Context;
+using Azure::Core::Http::Details::CurlHttp2Transfer;
+using Azure::Core::Http::Details::CurlMultiWorker;
+
+// Waits until the predicate is satisfied or the context is canceled. Context::Cancel doesn't notify
+// anyone, so the cancellation time is checked again at least every c_CancellationPollInterval.
+// Returns the predicate, false once Context::ThrowIfCanceled throws.
+template <class Predicate>
+bool WaitUntilCanceled(
+    std::condition_variable& cv,
+    std::unique_lock<std::mutex>& lock,
+    Context& context,
+    Predicate predicate)
+{
+  constexpr auto c_CancellationPollInterval = std::chrono::milliseconds(50);
+  while (!predicate())
+  {
+    auto cancelWhen = context.CancelWhen();
+    auto now = std::chrono::system_clock::now();
+    if (cancelWhen < now)
+    {
+      return false;
+    }
+    auto wakeAt = cancelWhen - now > c_CancellationPollInterval ? now + c_CancellationPollInterval
+                                                                : cancelWhen;
+    cv.wait_until(lock, wakeAt);
+  }
+  return true;
+}
+
+/**
+ * @brief Body of a response received by the CurlHttp2Transport. Reads the bytes buffered by the
+ * write callback and resumes the paused transfer once the buffer is drained.
+ */
+class CurlHttp2BodyStream : public BodyStream {
+public:
+  CurlHttp2BodyStream(
+      std::shared_ptr<CurlMultiWorker> worker,
+      std::shared_ptr<CurlHttp2Transfer> transfer,
+      int64_t length)
+      : m_worker(std::move(worker)), m_transfer(std::move(transfer)), m_length(length)
+  {
+  }
+
+  ~CurlHttp2BodyStream() override
+  {
+    bool completed;
+    {
+      std::lock_guard<std::mutex> guard(m_transfer->Mutex);
+      completed = m_transfer->TransferCompleted;
+    }
+    if (!completed)
+    {
+      // The response body wasn't read to the end, abort the transfer.
+      m_worker->RemoveTransfer(m_transfer, false);
+    }
+  }
+
+  int64_t Length() const override { return m_length; }
+
+  int64_t Read(Context& context, uint8_t* buffer, int64_t count) override
+  {
+    auto& transfer = *m_transfer;
+    std::unique_lock<std::mutex> lock(transfer.Mutex);
+    bool ready = WaitUntilCanceled(transfer.Cv, lock, context, [&transfer]() {
+      return transfer.BodyOffset < transfer.Body.size() || transfer.TransferCompleted;
+    });
+    if (!ready)
+    {
+      lock.unlock();
+      m_worker->RemoveTransfer(m_transfer, false);
+      context.ThrowIfCanceled();
+    }
+
+    if (transfer.BodyOffset < transfer.Body.size())
+    {
+      size_t bytesRead = std::min(
+          static_cast<size_t>(count), transfer.Body.size() - transfer.BodyOffset);
+      std::memcpy(buffer, transfer.Body.data() + transfer.BodyOffset, bytesRead);
+      transfer.BodyOffset += bytesRead;
+      if (transfer.BodyOffset == transfer.Body.size())
+      {
+        transfer.Body.clear();
+        transfer.BodyOffset = 0;
+      }
+      bool resume = transfer.Paused
+          && static_cast<int64_t>(transfer.Body.size() - transfer.BodyOffset)
+              < transfer.MaxBufferedBodySize / 2;
+      if (resume)
+      {
+        transfer.Paused = false;
+        lock.unlock();
+        m_worker->ResumeTransfer(m_transfer);
+      }
+      return static_cast<int64_t>(bytesRead);
+    }
+
+    if (transfer.Result != CURLE_OK)
+    {
+      throw TransportException(
+          "Error while reading response body. " + transfer.GetErrorMessage());
+    }
+    return 0;
+  }
+
+private:
+  std::shared_ptr<CurlMultiWorker> m_worker;
+  std::shared_ptr<CurlHttp2Transfer> m_transfer;
+  int64_t m_length;
+};
+
+std::unique_ptr<RawResponse> ParseStatusLine(const std::string& line)
+{
+  try
+  {
+    auto versionEnd = line.find(' ');
+    auto statusEnd = line.find(' ', versionEnd + 1);
+    std::string version = line.substr(5, versionEnd - 5);
+    auto dotPos = version.find('.');
+    int32_t majorVersion = std::stoi(version.substr(0, dotPos));
+    int32_t minorVersion = dotPos == std::string::npos ? 0 : std::stoi(version.substr(dotPos + 1));
+    int statusCode = std::stoi(line.substr(versionEnd + 1, statusEnd - versionEnd - 1));
+    std::string reasonPhrase;
+    if (statusEnd != std::string::npos)
+    {
+      reasonPhrase = line.substr(statusEnd + 1);
+      reasonPhrase.erase(reasonPhrase.find_last_not_of("\r\n") + 1);
+    }
+    return std::make_unique<RawResponse>(
+        majorVersion, minorVersion, static_cast<HttpStatusCode>(statusCode), reasonPhrase);
+  }
+  catch (std::exception const&)
+  {
+    return nullptr;
+  }
+}
+
+// libcurl 7.88 never sends a request on a reused connection opened with prior knowledge, whether
+// idle or busy, so such connections can't be shared there. Fixed in libcurl 8.0.0.
+bool IsPriorKnowledgeReuseBroken()
+{
+  static const bool broken = (curl_version_info(CURLVERSION_NOW)->version_num >> 8) == 0x0758;
+  return broken;
+}
+
+void GetTransferTimings(CURL* handle, HttpTimings& timings)
+{
+  Azure::Core::Http::Details::GetCurlConnectionTimings(handle, timings);
+
+  // libcurl sends the request by itself, so only the time from the connection to the start of
+  // the request, and from there to the first byte of the response, are known.
+  curl_off_t connected = 0;
+  curl_off_t preTransfer = 0;
+  curl_off_t startTransfer = 0;
+  curl_easy_getinfo(handle, CURLINFO_APPCONNECT_TIME_T, &connected);
+  if (connected == 0)
+  {
+    curl_easy_getinfo(handle, CURLINFO_CONNECT_TIME_T, &connected);
+  }
+  curl_easy_getinfo(handle, CURLINFO_PRETRANSFER_TIME_T, &preTransfer);
+  curl_easy_getinfo(handle, CURLINFO_STARTTRANSFER_TIME_T, &startTransfer);
+  timings.RequestSend
+      = std::chrono::microseconds(preTransfer > connected ? preTransfer - connected : 0);
+  timings.TimeToFirstByte
+      = std::chrono::microseconds(startTransfer > preTransfer ? startTransfer - preTransfer : 0);
+}
+
+size_t HeaderCallback(char* buffer, size_t size, size_t nitems, void* userdata)
+{
+  auto& transfer = *static_cast<CurlHttp2Transfer*>(userdata);
+  const size_t length = size * nitems;
+  std::string line(buffer, length);
+
+  std::lock_guard<std::mutex> guard(transfer.Mutex);
+  if (transfer.HeadersCompleted)
+  {
+    // Trailers are ignored.
+    return length;
+  }
+  if (line.compare(0, 5, "HTTP/") == 0)
+  {
+    // Status line, "HTTP/1.1 200 OK" or "HTTP/2 200". A new status line replaces the interim
+    // response (100 Continue) that may have been received before.
+    transfer.Response = ParseStatusLine(line);
+    if (!transfer.Response)
+    {
+      return 0;
+    }
+  }
+  else if (line == "\r\n" || line == "\n")
+  {
+    if (transfer.Response && static_cast<int>(transfer.Response->GetStatusCode()) >= 200)
+    {
+      GetTransferTimings(transfer.Handle, transfer.Response->GetTimings());
+      transfer.HeadersCompleted = true;
+      transfer.HeadersCompletedAt = std::chrono::steady_clock::now();
+      transfer.Cv.notify_all();
+    }
+  }
+  else if (transfer.Response)
+  {
+    transfer.Response->AddHeader(line);
+  }
+  return length;
+}
+
+size_t WriteCallback(char* buffer, size_t size, size_t nmemb, void* userdata)
+{
+  auto& transfer = *static_cast<CurlHttp2Transfer*>(userdata);
+  const size_t length = size * nmemb;
+
+  std::lock_guard<std::mutex> guard(transfer.Mutex);
+  if (static_cast<int64_t>(transfer.Body.size() - transfer.BodyOffset)
+      >= transfer.MaxBufferedBodySize)
+  {
+    // libcurl keeps the data and delivers it again once the transfer is resumed.
+    transfer.Paused = true;
+    return CURL_WRITEFUNC_PAUSE;
+  }
+  if (transfer.BodyOffset > 0 && transfer.BodyOffset >= transfer.Body.size() / 2)
+  {
+    transfer.Body.erase(
+        transfer.Body.begin(), transfer.Body.begin() + static_cast<ptrdiff_t>(transfer.BodyOffset));
+    transfer.BodyOffset = 0;
+  }
+  transfer.Body.insert(transfer.Body.end(), buffer, buffer + length);
+  transfer.Cv.notify_all();
+  return length;
+}
+
+size_t ReadCallback(char* buffer, size_t size, size_t nitems, void* userdata)
+{
+  auto& transfer = *static_cast<CurlHttp2Transfer*>(userdata);
+  try
+  {
+    int64_t bytesRead = transfer.UploadStream->Read(
+        transfer.UploadContext,
+        reinterpret_cast<uint8_t*>(buffer),
+        static_cast<int64_t>(size * nitems));
+    // libcurl stops reading once the content length is reached, without waiting for the end of
+    // the stream.
+    transfer.UploadRemaining -= bytesRead;
+    if (bytesRead == 0 || transfer.UploadRemaining <= 0)
+    {
+      std::lock_guard<std::mutex> guard(transfer.Mutex);
+      transfer.UploadCompleted = true;
+      transfer.UploadCompletedAt = std::chrono::steady_clock::now();
+      transfer.Cv.notify_all();
+    }
+    return static_cast<size_t>(bytesRead);
+  }
+  catch (std::exception const&)
+  {
+    return CURL_READFUNC_ABORT;
+  }
+}
+
+} // namespace
+
+CurlHttp2Transport::CurlHttp2Transport(const CurlHttp2TransportOptions& options)
+    : m_options(options), m_worker(std::make_shared<Details::CurlMultiWorker>(options))
+{
+}
+
+CurlHttp2Transport::~CurlHttp2Transport() {}
+
+std::unique_ptr<RawResponse> CurlHttp2Transport::Send(Context& context, Request& request)
+{
+  auto transfer = std::make_shared<CurlHttp2Transfer>();
+  transfer->MaxBufferedBodySize = std::max<int64_t>(m_options.MaxBufferedBodySize, 1);
+  CURL* handle = transfer->Handle;
+
+  curl_easy_setopt(handle, CURLOPT_URL, request.GetEncodedUrl().data());
+  curl_easy_setopt(
+      handle,
+      CURLOPT_HTTP_VERSION,
+      m_options.Http2PriorKnowledge ? CURL_HTTP_VERSION_2_PRIOR_KNOWLEDGE
+                                    : CURL_HTTP_VERSION_2TLS);
+  if (m_options.Http2PriorKnowledge && IsPriorKnowledgeReuseBroken())
+  {
+    curl_easy_setopt(handle, CURLOPT_FRESH_CONNECT, 1L);
+    curl_easy_setopt(handle, CURLOPT_FORBID_REUSE, 1L);
+  }
+  else
+  {
+    // Wait for an existing connection to tell whether it can multiplex, rather than opening a new
+    // one right away.
+    curl_easy_setopt(handle, CURLOPT_PIPEWAIT, 1L);
+  }
+  curl_easy_setopt(handle, CURLOPT_NOSIGNAL, 1L);
+  curl_easy_setopt(handle, CURLOPT_TIMEOUT, 60L * 60L * 24L);
+  curl_easy_setopt(handle, CURLOPT_ERRORBUFFER, transfer->ErrorBuffer);
+  curl_easy_setopt(handle, CURLOPT_HEADERFUNCTION, HeaderCallback);
+  curl_easy_setopt(handle, CURLOPT_HEADERDATA, transfer.get());
+  curl_easy_setopt(handle, CURLOPT_WRITEFUNCTION, WriteCallback);
+  curl_easy_setopt(handle, CURLOPT_WRITEDATA, transfer.get());
+
+  const HttpMethod method = request.GetMethod();
+  BodyStream* uploadStream = request.GetBodyStream();
+  const int64_t uploadLength = uploadStream ? uploadStream->Length() : 0;
+  if (method == HttpMethod::Head)
+  {
+    curl_easy_setopt(handle, CURLOPT_NOBODY, 1L);
+  }
+  else if (method == HttpMethod::Get)
+  {
+    curl_easy_setopt(handle, CURLOPT_HTTPGET, 1L);
+  }
+  else
+  {
+    curl_easy_setopt(handle, CURLOPT_CUSTOMREQUEST, HttpMethodToString(method).data());
+    if (method == HttpMethod::Put || method == HttpMethod::Post || uploadLength > 0)
+    {
+      transfer->UploadContext = context;
+      transfer->UploadStream = uploadStream;
+      transfer->UploadRemaining = uploadLength;
+      transfer->UploadCompleted = uploadLength <= 0;
+      curl_easy_setopt(handle, CURLOPT_UPLOAD, 1L);
+      curl_easy_setopt(handle, CURLOPT_INFILESIZE_LARGE, static_cast<curl_off_t>(uploadLength));
+      curl_easy_setopt(handle, CURLOPT_READFUNCTION, ReadCallback);
+      curl_easy_setopt(handle, CURLOPT_READDATA, transfer.get());
+      if (request.GetUploadChunkSize() > 0)
+      {
+        curl_easy_setopt(
+            handle, CURLOPT_UPLOAD_BUFFERSIZE, static_cast<long>(request.GetUploadChunkSize()));
+      }
+    }
+  }
+
+  for (auto const& header : request.GetHeaders())
+  {
+    // libcurl sets the host from the URL, and the :authority pseudo-header for HTTP/2.
+    if (header.first == "host")
+    {
+      continue;
+    }
+    std::string headerLine = header.first + ": " + header.second;
+    if (header.second.empty())
+    {
+      // "name;" sends a header with no value, "name:" would remove it.
+      headerLine = header.first + ";";
+    }
+    transfer->HeaderList = curl_slist_append(transfer->HeaderList, headerLine.data());
+  }
+  // Let the server answer right away instead of waiting for "Expect: 100-continue".
+  transfer->HeaderList = curl_slist_append(transfer->HeaderList, "Expect:");
+  curl_easy_setopt(handle, CURLOPT_HTTPHEADER, transfer->HeaderList);
+
+  auto sendStart = std::chrono::steady_clock::now();
+  m_worker->AddTransfer(transfer);
+
+  std::unique_lock<std::mutex> lock(transfer->Mutex);
+  bool ready = WaitUntilCanceled(transfer->Cv, lock, context, [&transfer]() {
+    return (transfer->HeadersCompleted && transfer->UploadCompleted)
+        || transfer->TransferCompleted;
+  });
+  if (!ready)
+  {
+    lock.unlock();
+    // Wait for the removal so that the upload stream is no longer used after returning.
+    m_worker->RemoveTransfer(transfer, true);
+    context.ThrowIfCanceled();
+  }
+
+  if (!transfer->HeadersCompleted)
+  {
+    CURLcode result = transfer->Result == CURLE_OK ? CURLE_GOT_NOTHING : transfer->Result;
+    transfer->Result = result;
+    if (result == CURLE_COULDNT_RESOLVE_HOST)
+    {
+      throw CouldNotResolveHostException("Could not resolve host " + request.GetHost());
+    }
+    throw TransportException("Error while sending request. " + transfer->GetErrorMessage());
+  }
+
+  auto response = std::move(transfer->Response);
+  if (uploadLength > 0)
+  {
+    // libcurl doesn't tell when the upload completed, the read callback does.
+    auto& timings = response->GetTimings();
+    auto connected = sendStart + timings.NameLookup + timings.Connect + timings.TlsHandshake;
+    timings.RequestSend = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::max(transfer->UploadCompletedAt - connected, std::chrono::steady_clock::duration()));
+    timings.TimeToFirstByte = std::chrono::duration_cast<std::chrono::microseconds>(std::max(
+        transfer->HeadersCompletedAt - transfer->UploadCompletedAt,
+        std::chrono::steady_clock::duration()));
+  }
+  lock.unlock();
+
+  int64_t contentLength = -1;
+  const auto statusCode = static_cast<int>(response->GetStatusCode());
+  if (method == HttpMethod::Head || statusCode == 204 || statusCode == 304)
+  {
+    contentLength = 0;
+  }
+  else
+  {
+    auto const& headers = response->GetHeaders();
+    auto contentLengthHeader = headers.find("content-length");
+    if (contentLengthHeader != headers.end())
+    {
+      contentLength = std::stoll(contentLengthHeader->second);
+    }
+  }
+  response->SetBodyStream(std::make_unique<CurlHttp2BodyStream>(m_worker, transfer, contentLength));
+  return response;
+}
@@ -0,0 +1,384 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// SPDX-License-Identifier: MIT
+
+#include <http/latency_histogram.hpp>
+#include <http/policy.hpp>
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using namespace Azure::Core::Http;
+using Azure::Core::Context;
+
+namespace Azure { namespace Core { namespace Http { namespace Details {
+
+  // Halving the histograms once this many samples are recorded keeps the hedge delay following
+  // changes of the latencies.
+  constexpr uint64_t c_HedgingDecayThreshold = 4096;
+
+  class OperationLatencies {
+  public:
+    std::shared_ptr<LatencyHistogram> Get(const std::string& operation)
+    {
+      std::lock_guard<std::mutex> guard(m_mutex);
+      auto ite = m_histograms.find(operation);
+      if (ite != m_histograms.end())
+      {
+        return ite->second;
+      }
+      if (m_histograms.size() >= c_MaxOperations)
+      {
+        return m_overflow;
+      }
+      auto histogram = std::make_shared<LatencyHistogram>(c_HedgingDecayThreshold);
+      m_histograms.emplace(operation, histogram);
+      return histogram;
+    }
+
+  private:
+    // Operations aren't expected to be that many, this only bounds the memory used when they are.
+    constexpr static std::size_t c_MaxOperations = 1024;
+
+    std::mutex m_mutex;
+    std::map<std::string, std::shared_ptr<LatencyHistogram>> m_histograms;
+    std::shared_ptr<LatencyHistogram> m_overflow
+        = std::make_shared<LatencyHistogram>(c_HedgingDecayThreshold);
+  };
+
+  // Runs the tasks that start the hedged requests when their delay elapses, so that a thread is
+  // only created for the requests that are actually hedged.
+  class HedgeScheduler {
+  public:
+    using Clock = std::chrono::steady_clock;
+    using TaskKey = std::pair<Clock::time_point, uint64_t>;
+
+    ~HedgeScheduler()
+    {
+      {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        m_stopped = true;
+      }
+      m_cv.notify_all();
+      if (m_thread.joinable())
+      {
+        m_thread.join();
+      }
+    }
+
+    TaskKey Schedule(Clock::time_point at, std::function<void()> task)
+    {
+      std::lock_guard<std::mutex> guard(m_mutex);
+      if (!m_thread.joinable())
+      {
+        m_thread = std::thread([this]() { Run(); });
+      }
+      TaskKey key(at, m_nextId++);
+      m_tasks.emplace(key, std::move(task));
+      m_cv.notify_all();
+      return key;
+    }
+
+    void Cancel(const TaskKey& key)
+    {
+      std::lock_guard<std::mutex> guard(m_mutex);
+      m_tasks.erase(key);
+    }
+
+  private:
+    void Run()
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      while (!m_stopped)
+      {
+        if (m_tasks.empty())
+        {
+          m_cv.wait(lock);
+          continue;
+        }
+        auto next = m_tasks.begin();
+        if (next->first.first > Clock::now())
+        {
+          m_cv.wait_until(lock, next->first.first);
+          continue;
+        }
+        auto task = std::move(next->second);
+        m_tasks.erase(next);
+        lock.unlock();
+        task();
+        lock.lock();
+      }
+    }
+
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::map<TaskKey, std::function<void()>> m_tasks;
+    uint64_t m_nextId = 0;
+    bool m_stopped = false;
+    std::thread m_thread;
+  };
+
+}}}} // namespace Azure::Core::Http::Details
+
+namespace {
+using Azure::Core::Http::Details::HedgeScheduler;
+using Clock = std::chrono::steady_clock;
+
+struct HedgeAttempt
+{
+  Context AttemptContext;
+  Clock::time_point StartedAt;
+  bool Finished = false;
+};
+
+// The state of one call to Send. The calling thread runs the first attempt and joins the threads
+// of the hedged ones before returning, so that none of them outlives the call.
+struct HedgeState
+{
+  std::mutex Mutex;
+  std::condition_variable Cv;
+  Context ParentContext;
+  std::vector<HedgeAttempt> Attempts;
+  std::vector<std::thread> Threads;
+  std::unique_ptr<RawResponse> Response;
+  std::exception_ptr FirstError;
+  int Failed = 0;
+  bool Done = false;
+  bool HedgePending = false;
+  HedgeScheduler::TaskKey PendingHedge;
+};
+
+std::chrono::milliseconds GetHedgeDelay(
+    const HedgingOptions& options,
+    const LatencyHistogram& histogram)
+{
+  if (options.HedgePercentile <= 0.0
+      || histogram.Count() < static_cast<uint64_t>(std::max(options.MinSamples, 1)))
+  {
+    return options.HedgeDelay;
+  }
+  auto delay = std::chrono::duration_cast<std::chrono::milliseconds>(
+      histogram.Percentile(std::min(options.HedgePercentile, 100.0)));
+  return std::min(std::max(delay, options.MinHedgeDelay), options.MaxHedgeDelay);
+}
+
+void RunAttempt(
+    HedgeState& state,
+    LatencyHistogram& histogram,
+    std::size_t attemptIndex,
+    Request& request,
+    NextHttpPolicy nextHttpPolicy)
+{
+  Context context;
+  Clock::time_point startedAt;
+  {
+    std::lock_guard<std::mutex> guard(state.Mutex);
+    context = state.Attempts[attemptIndex].AttemptContext;
+    startedAt = state.Attempts[attemptIndex].StartedAt;
+  }
+
+  std::unique_ptr<RawResponse> response;
+  std::exception_ptr error;
+  try
+  {
+    response = nextHttpPolicy.Send(context, request);
+  }
+  catch (...)
+  {
+    error = std::current_exception();
+  }
+
+  {
+    std::lock_guard<std::mutex> guard(state.Mutex);
+    auto& attempt = state.Attempts[attemptIndex];
+    if (!attempt.Finished)
+    {
+      attempt.Finished = true;
+      if (response)
+      {
+        auto now = Clock::now();
+        histogram.Record(std::chrono::duration_cast<std::chrono::microseconds>(now - startedAt));
+        state.Response = std::move(response);
+
+        // Cancel the attempts still running. Their elapsed time is a lower bound of their
+        // latency, recording it keeps the slow requests that were hedged away in the percentile.
+        for (auto& other : state.Attempts)
+        {
+          if (!other.Finished)
+          {
+            other.Finished = true;
+            histogram.Record(
+                std::chrono::duration_cast<std::chrono::microseconds>(now - other.StartedAt));
+            other.AttemptContext.Cancel();
+          }
+        }
+      }
+      else
+      {
+        if (!state.FirstError)
+        {
+          state.FirstError = error;
+        }
+        ++state.Failed;
+      }
+      state.Cv.notify_all();
+    }
+  }
+
+  // A response that lost the race is dropped here, outside of the lock, since closing it may
+  // block on the connection.
+  response.reset();
+}
+
+void ScheduleHedge(
+    HedgeScheduler& scheduler,
+    const std::shared_ptr<HedgeState>& state,
+    const std::shared_ptr<LatencyHistogram>& histogram,
+    std::chrono::milliseconds delay,
+    std::size_t maxAttempts,
+    const Request& request,
+    NextHttpPolicy nextHttpPolicy);
+
+// Starts a hedged attempt, unless the call has completed in the meantime, and schedules the next
+// one. Called from the scheduler thread with no lock held.
+void StartHedge(
+    HedgeScheduler& scheduler,
+    const std::shared_ptr<HedgeState>& state,
+    const std::shared_ptr<LatencyHistogram>& histogram,
+    std::chrono::milliseconds delay,
+    std::size_t maxAttempts,
+    const Request& request,
+    NextHttpPolicy nextHttpPolicy)
+{
+  std::lock_guard<std::mutex> guard(state->Mutex);
+  state->HedgePending = false;
+  if (state->Done || state->Response)
+  {
+    return;
+  }
+
+  HedgeAttempt attempt;
+  attempt.AttemptContext
+      = state->ParentContext.WithDeadline(state->ParentContext.CancelWhen());
+  attempt.StartedAt = Clock::now();
+  state->Attempts.push_back(std::move(attempt));
+  auto attemptIndex = state->Attempts.size() - 1;
+  state->Threads.emplace_back(
+      [state, histogram, attemptIndex, hedgeRequest = request, nextHttpPolicy]() mutable {
+        RunAttempt(*state, *histogram, attemptIndex, hedgeRequest, nextHttpPolicy);
+      });
+
+  if (state->Attempts.size() < maxAttempts)
+  {
+    ScheduleHedge(scheduler, state, histogram, delay, maxAttempts, request, nextHttpPolicy);
+  }
+}
+
+// Must be called with the lock of the state held.
+void ScheduleHedge(
+    HedgeScheduler& scheduler,
+    const std::shared_ptr<HedgeState>& state,
+    const std::shared_ptr<LatencyHistogram>& histogram,
+    std::chrono::milliseconds delay,
+    std::size_t maxAttempts,
+    const Request& request,
+    NextHttpPolicy nextHttpPolicy)
+{
+  // The request is copied when the hedge is started, the copy is then owned by its thread. The
+  // calling thread doesn't touch the original while the call isn't done.
+  const Request* original = &request;
+  state->PendingHedge = scheduler.Schedule(
+      Clock::now() + delay,
+      [&scheduler, state, histogram, delay, maxAttempts, original, nextHttpPolicy]() {
+        StartHedge(scheduler, state, histogram, delay, maxAttempts, *original, nextHttpPolicy);
+      });
+  state->HedgePending = true;
+}
+} // namespace
+
+HedgingPolicy::HedgingPolicy(HedgingOptions options)
+    : m_hedgingOptions(std::move(options)),
+      m_latencies(std::make_shared<Details::OperationLatencies>()),
+      m_scheduler(std::make_unique<Details::HedgeScheduler>())
+{
+}
+
+HedgingPolicy::HedgingPolicy(const HedgingPolicy& other)
+    : HttpPolicy(other), m_hedgingOptions(other.m_hedgingOptions), m_latencies(other.m_latencies),
+      m_scheduler(std::make_unique<Details::HedgeScheduler>())
+{
+}
+
+HedgingPolicy::~HedgingPolicy() {}
+
+std::unique_ptr<RawResponse> HedgingPolicy::Send(
+    Context& ctx,
+    Request& request,
+    NextHttpPolicy nextHttpPolicy) const
+{
+  auto method = request.GetMethod();
+  if ((method != HttpMethod::Get && method != HttpMethod::Head)
+      || m_hedgingOptions.MaxHedgedRequests <= 0)
+  {
+    return nextHttpPolicy.Send(ctx, request);
+  }
+
+  auto histogram = m_latencies->Get(Details::GetOperationName(request));
+  auto delay = GetHedgeDelay(m_hedgingOptions, *histogram);
+  auto maxAttempts = static_cast<std::size_t>(m_hedgingOptions.MaxHedgedRequests) + 1;
+
+  // Every attempt runs with its own child context, so that the losers can be canceled. The first
+  // one runs on the calling thread, on a copy of the request since the hedges copy the original.
+  auto state = std::make_shared<HedgeState>();
+  state->ParentContext = ctx;
+  state->Attempts.reserve(maxAttempts);
+  HedgeAttempt first;
+  first.AttemptContext = ctx.WithDeadline(ctx.CancelWhen());
+  first.StartedAt = Clock::now();
+  state->Attempts.push_back(std::move(first));
+  {
+    std::lock_guard<std::mutex> guard(state->Mutex);
+    ScheduleHedge(*m_scheduler, state, histogram, delay, maxAttempts, request, nextHttpPolicy);
+  }
+
+  Request firstRequest(request);
+  RunAttempt(*state, *histogram, 0, firstRequest, nextHttpPolicy);
+
+  std::vector<std::thread> threads;
+  {
+    std::unique_lock<std::mutex> lock(state->Mutex);
+    // Errors are left to the RetryPolicy, a duplicate request is only sent for a slow one. The
+    // call fails once all the attempts started have failed.
+    state->Cv.wait(lock, [&state]() {
+      return state->Response || state->Failed == static_cast<int>(state->Attempts.size());
+    });
+    state->Done = true;
+    if (state->HedgePending)
+    {
+      m_scheduler->Cancel(state->PendingHedge);
+      state->HedgePending = false;
+    }
+    threads = std::move(state->Threads);
+  }
+
+  // The losers have been canceled when the response arrived, they are joined so that none of
+  // them uses the policies after this one once the call returns.
+  for (auto& thread : threads)
+  {
+    thread.join();
+  }
+
+  if (!state->Response)
+  {
+    std::rethrow_exception(state->FirstError);
+  }
+  return std::move(state->Response);
+}
@@ -0,0 +1,290 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// SPDX-License-Identifier: MIT
+
+#include <azure.hpp>
+#include <http/in_memory_transport.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <thread>
+
+using namespace Azure::Core::Http;
+
+namespace {
+
+HttpMethod ParseMethod(std::string const& method)
+{
+  static const std::pair<const char*, HttpMethod> methods[] = {
+      {"GET", HttpMethod::Get},
+      {"HEAD", HttpMethod::Head},
+      {"POST", HttpMethod::Post},
+      {"PUT", HttpMethod::Put},
+      {"DELETE", HttpMethod::Delete},
+      {"PATCH", HttpMethod::Patch},
+  };
+  for (auto const& candidate : methods)
+  {
+    if (method == candidate.first)
+    {
+      return candidate.second;
+    }
+  }
+  throw std::runtime_error("unknown HTTP method " + method);
+}
+
+// Splits the path and query of an URL, or of a route, at the '?'.
+void SplitPathAndQuery(
+    std::string const& pathAndQuery,
+    std::string& path,
+    std::map<std::string, std::string>& query)
+{
+  auto queryStart = pathAndQuery.find('?');
+  path = pathAndQuery.substr(0, queryStart);
+  while (queryStart != std::string::npos)
+  {
+    auto parameterEnd = pathAndQuery.find('&', queryStart + 1);
+    auto parameter = pathAndQuery.substr(
+        queryStart + 1,
+        parameterEnd == std::string::npos ? std::string::npos : parameterEnd - queryStart - 1);
+    auto equal = parameter.find('=');
+    query[parameter.substr(0, equal)]
+        = equal == std::string::npos ? std::string() : parameter.substr(equal + 1);
+    queryStart = parameterEnd;
+  }
+}
+
+std::string GetPathAndQuery(std::string const& url)
+{
+  auto schemeEnd = url.find("://");
+  auto pathStart = url.find('/', schemeEnd == std::string::npos ? 0 : schemeEnd + 3);
+  return pathStart == std::string::npos ? std::string("/") : url.substr(pathStart);
+}
+
+std::string TrimLineEnd(std::string line)
+{
+  if (!line.empty() && line.back() == '\r')
+  {
+    line.pop_back();
+  }
+  return line;
+}
+
+} // namespace
+
+void InMemoryTransport::AddResponse(
+    HttpMethod method,
+    std::string const& pathPrefix,
+    InMemoryResponse response)
+{
+  auto& route = m_routes[std::make_pair(method, pathPrefix)];
+  if (route.Responses.empty())
+  {
+    SplitPathAndQuery(pathPrefix, route.PathPrefix, route.Query);
+  }
+  route.Responses.push_back(std::move(response));
+}
+
+void InMemoryTransport::LoadReplay(std::istream& traffic)
+{
+  std::string line;
+  while (std::getline(traffic, line))
+  {
+    line = TrimLineEnd(line);
+    if (line.empty() || line[0] == '#')
+    {
+      continue;
+    }
+
+    auto methodEnd = line.find(' ');
+    if (methodEnd == std::string::npos)
+    {
+      throw std::runtime_error("malformed request line: " + line);
+    }
+    auto method = ParseMethod(line.substr(0, methodEnd));
+    auto pathPrefix = line.substr(methodEnd + 1);
+
+    InMemoryResponse response;
+    int statusCode = 0;
+    if (!std::getline(traffic, line) || std::sscanf(line.data(), "%d", &statusCode) != 1)
+    {
+      throw std::runtime_error("malformed status line for " + pathPrefix);
+    }
+    line = TrimLineEnd(line);
+    auto reasonStart = line.find(' ');
+    response.StatusCode = static_cast<HttpStatusCode>(statusCode);
+    response.ReasonPhrase = reasonStart == std::string::npos ? "" : line.substr(reasonStart + 1);
+
+    std::size_t contentLength = 0;
+    while (std::getline(traffic, line) && !(line = TrimLineEnd(line)).empty())
+    {
+      auto colon = line.find(':');
+      if (colon == std::string::npos)
+      {
+        throw std::runtime_error("malformed header: " + line);
+      }
+      auto name = Azure::Core::Details::ToLower(line.substr(0, colon));
+      auto valueStart = line.find_first_not_of(' ', colon + 1);
+      auto value = valueStart == std::string::npos ? std::string() : line.substr(valueStart);
+      if (name == "content-length")
+      {
+        contentLength = static_cast<std::size_t>(std::stoull(value));
+        continue;
+      }
+      response.Headers[name] = value;
+    }
+
+    auto body = std::make_shared<std::vector<uint8_t>>(contentLength);
+    if (contentLength > 0
+        && !traffic.read(
+            reinterpret_cast<char*>(body->data()), static_cast<std::streamsize>(contentLength)))
+    {
+      throw std::runtime_error("truncated body for " + pathPrefix);
+    }
+    response.Body = std::move(body);
+    AddResponse(method, pathPrefix, std::move(response));
+  }
+}
+
+void InMemoryTransport::LoadReplayFile(std::string const& file)
+{
+  std::ifstream traffic(file, std::ios::binary);
+  if (!traffic)
+  {
+    throw std::runtime_error("failed to open file " + file);
+  }
+  LoadReplay(traffic);
+}
+
+std::unique_ptr<RawResponse> InMemoryTransport::Send(Context& context, Request& request)
+{
+  m_requestCount.fetch_add(1, std::memory_order_relaxed);
+
+  // Consume the body of the request like a real transport would.
+  if (auto requestBody = request.GetBodyStream())
+  {
+    uint8_t buffer[16 * 1024];
+    while (requestBody->Read(context, buffer, sizeof(buffer)) > 0)
+    {
+    }
+  }
+
+  auto method = request.GetMethod();
+  std::string path;
+  std::map<std::string, std::string> query;
+  SplitPathAndQuery(GetPathAndQuery(request.GetEncodedUrl()), path, query);
+  const Route* route = nullptr;
+  for (auto ite = m_routes.lower_bound(std::make_pair(method, std::string()));
+       ite != m_routes.end() && ite->first.first == method;
+       ++ite)
+  {
+    auto const& candidate = ite->second;
+    if (path.compare(0, candidate.PathPrefix.size(), candidate.PathPrefix) != 0
+        || !std::all_of(
+            candidate.Query.begin(),
+            candidate.Query.end(),
+            [&query](std::pair<const std::string, std::string> const& parameter) {
+              auto value = query.find(parameter.first);
+              return value != query.end() && value->second == parameter.second;
+            }))
+    {
+      continue;
+    }
+    if (route == nullptr || candidate.PathPrefix.size() > route->PathPrefix.size()
+        || (candidate.PathPrefix.size() == route->PathPrefix.size()
+            && candidate.Query.size() > route->Query.size()))
+    {
+      route = &candidate;
+    }
+  }
+
+  InMemoryResponse generated;
+  const InMemoryResponse* source;
+  if (route != nullptr)
+  {
+    auto index = route->Next->fetch_add(1, std::memory_order_relaxed) % route->Responses.size();
+    source = &route->Responses[static_cast<std::size_t>(index)];
+  }
+  else
+  {
+    if (m_options.Handler)
+    {
+      generated = m_options.Handler(context, request);
+    }
+    else
+    {
+      generated.StatusCode = HttpStatusCode::NotFound;
+      generated.ReasonPhrase = "Not Found";
+    }
+    source = &generated;
+  }
+
+  auto latency = m_options.Latency + source->Latency;
+  if (latency.count() > 0)
+  {
+    std::this_thread::sleep_for(latency);
+  }
+
+  auto statusCode = source->StatusCode;
+  auto reasonPhrase = source->ReasonPhrase;
+  int64_t bodySize = source->Body ? static_cast<int64_t>(source->Body->size()) : 0;
+  int64_t begin = 0;
+  int64_t length = bodySize;
+  std::string contentRange;
+  if (source->ServeRanges && statusCode == HttpStatusCode::Ok)
+  {
+    auto headers = request.GetHeaders();
+    auto range = headers.find("x-ms-range");
+    if (range == headers.end())
+    {
+      range = headers.find("range");
+    }
+    long long first = 0;
+    long long last = -1;
+    if (range != headers.end()
+        && std::sscanf(range->second.data(), "bytes=%lld-%lld", &first, &last) >= 1)
+    {
+      if (first >= bodySize)
+      {
+        statusCode = HttpStatusCode::RangeNotSatisfiable;
+        reasonPhrase = "Range Not Satisfiable";
+        length = 0;
+      }
+      else
+      {
+        if (last < first || last >= bodySize)
+        {
+          last = bodySize - 1;
+        }
+        statusCode = HttpStatusCode::PartialContent;
+        reasonPhrase = "Partial Content";
+        begin = first;
+        length = last - first + 1;
+        contentRange = "bytes " + std::to_string(first) + "-" + std::to_string(last) + "/"
+            + std::to_string(bodySize);
+      }
+    }
+  }
+
+  auto response = std::make_unique<RawResponse>(1, 1, statusCode, reasonPhrase);
+  for (auto const& header : source->Headers)
+  {
+    response->AddHeader(header.first, header.second);
+  }
+  if (!contentRange.empty())
+  {
+    response->AddHeader("content-range", contentRange);
+  }
+  response->AddHeader("content-length", std::to_string(length));
+  if (method == HttpMethod::Head || length == 0)
+  {
+    response->SetBodyStream(std::make_unique<MemoryBodyStream>(nullptr, 0));
+  }
+  else
+  {
+    response->SetBodyStream(std::make_unique<SharedBodyStream>(source->Body, begin, length));
+  }
+  return response;
+}
@@ -0,0 +1,83 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// SPDX-License-Identifier: MIT
+
+#include <http/latency_histogram.hpp>
+#include <http/policy.hpp>
+
+#include <algorithm>
+#include <chrono>
+
+using namespace Azure::Core::Http;
+
+void RequestTimingHistograms::Record(std::string const& operation, HttpTimings const& timings)
+{
+  std::shared_ptr<OperationHistograms> histograms;
+  {
+    std::lock_guard<std::mutex> guard(m_mutex);
+    auto& entry = m_operations[operation];
+    if (!entry)
+    {
+      entry = std::make_shared<OperationHistograms>();
+    }
+    histograms = entry;
+  }
+
+  histograms->Total.Record(timings.Total);
+  histograms->Queueing.Record(timings.Queueing);
+  if (timings.Connect.count() > 0)
+  {
+    histograms->NameLookup.Record(timings.NameLookup);
+    histograms->Connect.Record(timings.Connect);
+    histograms->TlsHandshake.Record(timings.TlsHandshake);
+  }
+  histograms->RequestSend.Record(timings.RequestSend);
+  histograms->TimeToFirstByte.Record(timings.TimeToFirstByte);
+  histograms->BodyTransfer.Record(timings.BodyTransfer);
+  histograms->RetryBackOff.Record(timings.RetryBackOff);
+  histograms->Retries.fetch_add(static_cast<uint64_t>(timings.Retries), std::memory_order_relaxed);
+}
+
+std::vector<std::string> RequestTimingHistograms::GetOperations() const
+{
+  std::lock_guard<std::mutex> guard(m_mutex);
+  std::vector<std::string> operations;
+  operations.reserve(m_operations.size());
+  for (const auto& operation : m_operations)
+  {
+    operations.push_back(operation.first);
+  }
+  return operations;
+}
+
+std::shared_ptr<const RequestTimingHistograms::OperationHistograms>
+RequestTimingHistograms::GetHistograms(std::string const& operation) const
+{
+  std::lock_guard<std::mutex> guard(m_mutex);
+  auto ite = m_operations.find(operation);
+  return ite == m_operations.end() ? nullptr : ite->second;
+}
+
+std::unique_ptr<RawResponse> InstrumentationPolicy::Send(
+    Context& ctx,
+    Request& request,
+    NextHttpPolicy nextHttpPolicy) const
+{
+  auto operation = Details::GetOperationName(request);
+  auto start = std::chrono::steady_clock::now();
+  auto response = nextHttpPolicy.Send(ctx, request);
+  if (!response)
+  {
+    return response;
+  }
+
+  auto& timings = response->GetTimings();
+  timings.Total = std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - start);
+  auto accounted = timings.NameLookup + timings.Connect + timings.TlsHandshake
+      + timings.RequestSend + timings.TimeToFirstByte + timings.BodyTransfer
+      + timings.FailedAttempts + timings.RetryBackOff;
+  timings.Queueing = std::max(timings.Total - accounted, std::chrono::microseconds(0));
+
+  m_histograms->Record(operation, timings);
+  return response;
+}
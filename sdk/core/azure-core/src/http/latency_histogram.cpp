@@ -0,0 +1,218 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// SPDX-License-Identifier: MIT
+
+#include <http/latency_histogram.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <set>
+#include <string>
+
+using namespace Azure::Core::Http;
+
+namespace {
+constexpr uint64_t c_FnvOffsetBasis = 14695981039346656037ULL;
+constexpr uint64_t c_FnvPrime = 1099511628211ULL;
+
+uint64_t HashValue(uint64_t hash, uint64_t value)
+{
+  for (int i = 0; i < 8; ++i, value >>= 8)
+  {
+    hash = (hash ^ (value & 0xff)) * c_FnvPrime;
+  }
+  return hash;
+}
+
+uint64_t HashString(uint64_t hash, std::string const& value)
+{
+  for (auto c : value)
+  {
+    hash = (hash ^ static_cast<uint8_t>(c)) * c_FnvPrime;
+  }
+  // The length separates consecutive strings.
+  return HashValue(hash, value.size());
+}
+
+// Power of two of the size of a range header, 64 when it can't be parsed.
+int GetRangeBits(std::string const& range)
+{
+  unsigned long long first = 0;
+  unsigned long long last = 0;
+  if (std::sscanf(range.data(), "bytes=%llu-%llu", &first, &last) != 2 || last < first)
+  {
+    return 64;
+  }
+  int bits = 0;
+  for (auto size = last - first + 1; size != 0; size >>= 1)
+  {
+    ++bits;
+  }
+  return bits;
+}
+} // namespace
+
+void LatencyHistogram::Record(std::chrono::microseconds duration)
+{
+  m_buckets[BucketIndex(duration.count())].fetch_add(1, std::memory_order_relaxed);
+  if (m_count.fetch_add(1, std::memory_order_relaxed) + 1 == m_decayThreshold)
+  {
+    Decay();
+  }
+}
+
+std::chrono::microseconds LatencyHistogram::Percentile(double percentile) const
+{
+  uint64_t total = 0;
+  std::array<uint64_t, c_NumBuckets> snapshot;
+  for (std::size_t i = 0; i < c_NumBuckets; ++i)
+  {
+    snapshot[i] = m_buckets[i].load(std::memory_order_relaxed);
+    total += snapshot[i];
+  }
+  if (total == 0)
+  {
+    return std::chrono::microseconds(0);
+  }
+
+  auto target = static_cast<uint64_t>(std::ceil(percentile / 100.0 * total));
+  target = std::max<uint64_t>(1, std::min(target, total));
+  uint64_t cumulative = 0;
+  for (std::size_t i = 0; i < c_NumBuckets; ++i)
+  {
+    cumulative += snapshot[i];
+    if (cumulative >= target)
+    {
+      return std::chrono::microseconds(BucketUpperBound(i));
+    }
+  }
+  return std::chrono::microseconds(BucketUpperBound(c_NumBuckets - 1));
+}
+
+std::size_t LatencyHistogram::BucketIndex(int64_t value)
+{
+  if (value < c_SubBuckets)
+  {
+    return static_cast<std::size_t>(std::max<int64_t>(value, 0));
+  }
+  int exponent = 0;
+  while ((value >> (exponent + 1)) != 0)
+  {
+    ++exponent;
+  }
+  if (exponent > c_MaxExponent)
+  {
+    return c_NumBuckets - 1;
+  }
+  auto shift = exponent - c_SubBucketBits;
+  auto subBucket = (value >> shift) - c_SubBuckets;
+  return static_cast<std::size_t>(c_SubBuckets + shift * c_SubBuckets + subBucket);
+}
+
+int64_t LatencyHistogram::BucketUpperBound(std::size_t index)
+{
+  if (index < static_cast<std::size_t>(c_SubBuckets))
+  {
+    return static_cast<int64_t>(index);
+  }
+  auto shift = static_cast<int>((index - c_SubBuckets) / c_SubBuckets);
+  auto subBucket = static_cast<int64_t>((index - c_SubBuckets) % c_SubBuckets);
+  return ((c_SubBuckets + subBucket + 1) << shift) - 1;
+}
+
+void LatencyHistogram::Decay()
+{
+  // Samples recorded concurrently with the decay may be lost, which doesn't matter for an
+  // estimate.
+  std::lock_guard<std::mutex> guard(m_decayMutex);
+  uint64_t total = 0;
+  for (auto& bucket : m_buckets)
+  {
+    auto halved = bucket.load(std::memory_order_relaxed) / 2;
+    bucket.store(halved, std::memory_order_relaxed);
+    total += halved;
+  }
+  m_count.store(total, std::memory_order_relaxed);
+}
+
+std::string Details::GetOperationName(Request& request)
+{
+  std::string name = HttpMethodToString(request.GetMethod()) + " " + request.GetHost();
+
+  auto url = request.GetEncodedUrl();
+  auto queryStart = url.find('?');
+  if (queryStart != std::string::npos)
+  {
+    std::set<std::string> parameterNames;
+    auto position = queryStart + 1;
+    while (position < url.length())
+    {
+      auto end = url.find('&', position);
+      if (end == std::string::npos)
+      {
+        end = url.length();
+      }
+      auto parameter = url.substr(position, end - position);
+      parameterNames.insert(parameter.substr(0, parameter.find('=')));
+      position = end + 1;
+    }
+    for (const auto& parameterName : parameterNames)
+    {
+      name += " " + parameterName;
+    }
+  }
+
+  auto headers = request.GetHeaders();
+  auto range = headers.find("x-ms-range");
+  if (range == headers.end())
+  {
+    range = headers.find("range");
+  }
+  if (range != headers.end())
+  {
+    name += " range:" + std::to_string(GetRangeBits(range->second));
+  }
+  return name;
+}
+
+uint64_t Details::GetOperationKey(Request const& request)
+{
+  auto key = HashValue(c_FnvOffsetBasis, static_cast<uint64_t>(request.m_method));
+  key = HashString(key, request.m_url.GetHost());
+
+  // The names of the query parameters in order, as the two maps are merged by GetQueryString.
+  auto const& parameters = request.m_url.GetQueryParameters();
+  auto const& retryParameters = request.m_retryQueryParameters;
+  auto parameter = parameters.begin();
+  auto retryParameter = retryParameters.begin();
+  while (parameter != parameters.end() || retryParameter != retryParameters.end())
+  {
+    if (retryParameter == retryParameters.end()
+        || (parameter != parameters.end() && parameter->first < retryParameter->first))
+    {
+      key = HashString(key, parameter->first);
+      ++parameter;
+      continue;
+    }
+    if (parameter != parameters.end() && parameter->first == retryParameter->first)
+    {
+      ++parameter;
+    }
+    key = HashString(key, retryParameter->first);
+    ++retryParameter;
+  }
+
+  // The headers added by a retry take precedence, as in GetHeaders.
+  for (auto const name : {"x-ms-range", "range"})
+  {
+    for (auto const* headers : {&request.m_retryHeaders, &request.m_headers})
+    {
+      auto range = headers->find(name);
+      if (range != headers->end())
+      {
+        return HashValue(key, static_cast<uint64_t>(GetRangeBits(range->second)) + 1);
+      }
+    }
+  }
+  return key;
+}
@@ -0,0 +1,186 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// SPDX-License-Identifier: MIT
+
+#include <http/policy.hpp>
+#include <http/rate_limiter.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+
+using namespace Azure::Core::Http;
+using Azure::Core::Context;
+using Azure::Core::ContextValue;
+
+namespace {
+// Waiters wake up at least this often to notice cancellation.
+constexpr auto c_MaxRateLimitWait = std::chrono::milliseconds(50);
+
+// Restores the body stream of the request once the policies after RateLimitPolicy are done with
+// the wrapper.
+class BodyStreamRestorer {
+public:
+  explicit BodyStreamRestorer(Request& request)
+      : m_request(request), m_bodyStream(request.GetBodyStream())
+  {
+  }
+  ~BodyStreamRestorer() { m_request.SetBodyStream(m_bodyStream); }
+
+private:
+  Request& m_request;
+  BodyStream* m_bodyStream;
+};
+} // namespace
+
+RateLimiter::RateLimiter(double ratePerSecond, double burst)
+    : m_rate(ratePerSecond), m_burst(burst > 0 ? burst : ratePerSecond),
+      m_tokens(burst > 0 ? burst : ratePerSecond), m_lastRefill(std::chrono::steady_clock::now())
+{
+}
+
+void RateLimiter::SetRate(double ratePerSecond, double burst)
+{
+  std::lock_guard<std::mutex> guard(m_mutex);
+  Refill(std::chrono::steady_clock::now());
+  m_rate = ratePerSecond;
+  m_burst = burst > 0 ? burst : ratePerSecond;
+  m_tokens = std::min(m_tokens, m_burst);
+  m_cv.notify_all();
+}
+
+double RateLimiter::GetRate() const
+{
+  std::lock_guard<std::mutex> guard(m_mutex);
+  return m_rate;
+}
+
+double RateLimiter::GetBurst() const
+{
+  std::lock_guard<std::mutex> guard(m_mutex);
+  return m_burst;
+}
+
+void RateLimiter::Refill(std::chrono::steady_clock::time_point now)
+{
+  auto elapsed = std::chrono::duration<double>(now - m_lastRefill).count();
+  m_tokens = std::min(m_tokens + elapsed * m_rate, m_burst);
+  m_lastRefill = now;
+}
+
+void RateLimiter::Acquire(Context& context, int64_t amount, RateLimitPriority priority)
+{
+  if (amount <= 0)
+  {
+    return;
+  }
+
+  auto const priorityIndex = static_cast<std::size_t>(priority);
+  std::unique_lock<std::mutex> lock(m_mutex);
+  ++m_waiting[priorityIndex];
+  while (m_rate > 0)
+  {
+    Refill(std::chrono::steady_clock::now());
+    auto higherPriorityWaiting
+        = std::any_of(m_waiting.begin(), m_waiting.begin() + priorityIndex, [](int waiting) {
+            return waiting > 0;
+          });
+    if (!higherPriorityWaiting && m_tokens > 0)
+    {
+      m_tokens -= static_cast<double>(amount);
+      break;
+    }
+
+    if (context.CancelWhen() < std::chrono::system_clock::now())
+    {
+      --m_waiting[priorityIndex];
+      m_cv.notify_all();
+      throw OperationCanceledException("Request was canceled by context.");
+    }
+
+    auto wait = c_MaxRateLimitWait;
+    if (!higherPriorityWaiting)
+    {
+      // Sleep until the debt is paid.
+      auto debtDuration = std::chrono::duration_cast<std::chrono::milliseconds>(
+          std::chrono::duration<double>(-m_tokens / m_rate));
+      wait = std::max(std::min(debtDuration, wait), std::chrono::milliseconds(1));
+    }
+    m_cv.wait_for(lock, wait);
+  }
+  --m_waiting[priorityIndex];
+  m_cv.notify_all();
+}
+
+int64_t RateLimitedBodyStream::Read(Context& context, uint8_t* buffer, int64_t count)
+{
+  // Reads are capped to the burst, so a large read is paced rather than let through at once.
+  auto const burst = static_cast<int64_t>(this->m_limiter->GetBurst());
+  if (this->m_limiter->GetRate() > 0 && burst > 0)
+  {
+    count = std::min(count, burst);
+  }
+  // The bytes are paid after being read, since the inner stream may return fewer than count.
+  auto bytesRead = this->m_inner->Read(context, buffer, count);
+  this->m_limiter->Acquire(context, bytesRead, this->m_priority);
+  return bytesRead;
+}
+
+const std::string RateLimitPolicy::PriorityContextKey = "RateLimitPriority";
+
+std::unique_ptr<RawResponse> RateLimitPolicy::Send(
+    Context& ctx,
+    Request& request,
+    NextHttpPolicy nextHttpPolicy) const
+{
+  auto priority = m_rateLimitOptions.Priority;
+  auto const& priorityValue = ctx[PriorityContextKey];
+  if (priorityValue.Alternative() != ContextValue::ContextValueType::Undefined)
+  {
+    // Get aborts on a type mismatch, and the priority indexes the waiters of the limiters.
+    if (priorityValue.Alternative() != ContextValue::ContextValueType::Int
+        || priorityValue.Get<int>() < static_cast<int>(RateLimitPriority::High)
+        || priorityValue.Get<int>() > static_cast<int>(RateLimitPriority::Low))
+    {
+      throw std::invalid_argument(
+          "The value of " + PriorityContextKey + " must be the int value of a RateLimitPriority.");
+    }
+    priority = static_cast<RateLimitPriority>(priorityValue.Get<int>());
+  }
+
+  if (m_rateLimitOptions.RequestRate)
+  {
+    m_rateLimitOptions.RequestRate->Acquire(ctx, 1, priority);
+  }
+
+  std::unique_ptr<RawResponse> response;
+  {
+    BodyStreamRestorer restorer(request);
+    std::unique_ptr<RateLimitedBodyStream> uploadStream;
+    auto bodyStream = request.GetBodyStream();
+    if (m_rateLimitOptions.UploadRate && bodyStream != nullptr && bodyStream->Length() > 0)
+    {
+      uploadStream = std::make_unique<RateLimitedBodyStream>(
+          bodyStream, m_rateLimitOptions.UploadRate, priority);
+      request.SetBodyStream(uploadStream.get());
+    }
+    response = nextHttpPolicy.Send(ctx, request);
+  }
+
+  if (m_rateLimitOptions.DownloadRate && response)
+  {
+    auto responseBodyStream = response->GetBodyStream();
+    if (responseBodyStream)
+    {
+      response->SetBodyStream(std::make_unique<RateLimitedBodyStream>(
+          std::move(responseBodyStream), m_rateLimitOptions.DownloadRate, priority));
+    }
+    else
+    {
+      m_rateLimitOptions.DownloadRate->Acquire(
+          ctx, static_cast<int64_t>(response->GetBody().size()), priority);
+    }
+  }
+  return response;
+}
@@ -0,0 +1,271 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// SPDX-License-Identifier: MIT
+
+#include <http/body_stream.hpp>
+#include <http/policy.hpp>
+#include <metrics.hpp>
+
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+using namespace Azure::Core::Http;
+using namespace Azure::Core::Metrics;
+using Azure::Core::Context;
+
+namespace {
+
+// A response buffered to be copied to the requests that waited for it.
+struct SharedResponse
+{
+  int32_t MajorVersion = 1;
+  int32_t MinorVersion = 1;
+  HttpStatusCode StatusCode = HttpStatusCode::Ok;
+  std::string ReasonPhrase;
+  std::map<std::string, std::string> Headers;
+  std::shared_ptr<const std::vector<uint8_t>> Body;
+};
+
+struct Flight
+{
+  std::mutex Mutex;
+  std::condition_variable Cv;
+  bool Done = false;
+  // Null when the response isn't shared, the followers then send their own request.
+  std::shared_ptr<const SharedResponse> Response;
+  std::exception_ptr Error;
+};
+
+Counter& GetCoalescedCounter()
+{
+  static Counter& counter = MetricsRegistry::GetDefault().GetCounter(
+      "azure_core_http_coalesced_requests_total",
+      "Number of requests answered with the response of an identical request in flight.");
+  return counter;
+}
+
+// The headers set for each attempt, that don't make two requests different. The Authorization
+// header, if the request is already authenticated, is compared: it tells the credential.
+bool IsPerAttemptHeader(std::string const& name)
+{
+  return name == "user-agent" || name == "x-ms-client-request-id" || name == "x-ms-date";
+}
+
+std::string GetFlightKey(Request& request)
+{
+  auto key = std::to_string(static_cast<int>(request.GetMethod())) + '\n'
+      + request.GetEncodedUrl();
+  for (auto const& header : request.GetHeaders())
+  {
+    if (!IsPerAttemptHeader(header.first))
+    {
+      key += '\n' + header.first + ':' + header.second;
+    }
+  }
+  return key;
+}
+
+std::unique_ptr<RawResponse> MakeResponse(SharedResponse const& shared, Request& request)
+{
+  auto response = std::make_unique<RawResponse>(
+      shared.MajorVersion, shared.MinorVersion, shared.StatusCode, shared.ReasonPhrase);
+  auto const requestHeaders = request.GetHeaders();
+  auto clientRequestId = requestHeaders.find("x-ms-client-request-id");
+  if (clientRequestId != requestHeaders.end())
+  {
+    response->AddHeader(clientRequestId->first, clientRequestId->second);
+  }
+  // The headers added already aren't replaced. The x-ms-request-id is the one of the request that
+  // got the response.
+  for (auto const& header : shared.Headers)
+  {
+    if (header.first != "x-ms-client-request-id")
+    {
+      response->AddHeader(header.first, header.second);
+    }
+  }
+  if (request.IsDownloadViaStream())
+  {
+    response->SetBodyStream(std::make_unique<SharedBodyStream>(shared.Body));
+  }
+  else
+  {
+    response->SetBody(*shared.Body);
+  }
+  return response;
+}
+
+void Complete(
+    Flight& flight,
+    std::shared_ptr<const SharedResponse> response,
+    std::exception_ptr error = nullptr)
+{
+  std::lock_guard<std::mutex> guard(flight.Mutex);
+  flight.Done = true;
+  flight.Response = std::move(response);
+  flight.Error = std::move(error);
+  flight.Cv.notify_all();
+}
+} // namespace
+
+namespace Azure { namespace Core { namespace Http { namespace Details {
+
+  class InFlightRequests {
+  public:
+    // Returns the flight of the key and whether the caller leads it.
+    std::pair<std::shared_ptr<Flight>, bool> Join(std::string const& key)
+    {
+      std::lock_guard<std::mutex> guard(m_mutex);
+      auto ite = m_flights.find(key);
+      if (ite != m_flights.end())
+      {
+        ++ite->second.Followers;
+        return std::make_pair(ite->second.SharedFlight, false);
+      }
+      auto flight = std::make_shared<Flight>();
+      m_flights.emplace(key, Entry{flight, 0});
+      return std::make_pair(flight, true);
+    }
+
+    // Removes the flight of the key, no request joins it afterwards, and returns the number of
+    // requests waiting for it.
+    int Land(std::string const& key)
+    {
+      std::lock_guard<std::mutex> guard(m_mutex);
+      auto ite = m_flights.find(key);
+      auto followers = ite->second.Followers;
+      m_flights.erase(ite);
+      return followers;
+    }
+
+  private:
+    struct Entry
+    {
+      std::shared_ptr<Flight> SharedFlight;
+      int Followers;
+    };
+
+    std::mutex m_mutex;
+    std::unordered_map<std::string, Entry> m_flights;
+  };
+
+}}}} // namespace Azure::Core::Http::Details
+
+RequestCoalescingPolicy::RequestCoalescingPolicy(RequestCoalescingOptions options)
+    : m_coalescingOptions(std::move(options)),
+      m_inFlight(std::make_shared<Details::InFlightRequests>())
+{
+}
+
+std::unique_ptr<HttpPolicy> RequestCoalescingPolicy::Clone() const
+{
+  // The copy doesn't share the requests in flight, its client may use another credential.
+  return std::make_unique<RequestCoalescingPolicy>(m_coalescingOptions);
+}
+
+std::unique_ptr<RawResponse> RequestCoalescingPolicy::Send(
+    Context& ctx,
+    Request& request,
+    NextHttpPolicy nextHttpPolicy) const
+{
+  auto method = request.GetMethod();
+  if (method != HttpMethod::Get && method != HttpMethod::Head)
+  {
+    return nextHttpPolicy.Send(ctx, request);
+  }
+
+  auto key = GetFlightKey(request);
+  auto joined = m_inFlight->Join(key);
+  auto& flight = *joined.first;
+
+  if (!joined.second)
+  {
+    std::unique_lock<std::mutex> lock(flight.Mutex);
+    // The context is polled, a canceled follower stops waiting without affecting the others.
+    while (!flight.Cv.wait_for(
+        lock, std::chrono::milliseconds(10), [&flight]() { return flight.Done; }))
+    {
+      ctx.ThrowIfCanceled();
+    }
+    if (flight.Response)
+    {
+      GetCoalescedCounter().Increment();
+      return MakeResponse(*flight.Response, request);
+    }
+    if (flight.Error)
+    {
+      std::rethrow_exception(flight.Error);
+    }
+    lock.unlock();
+    return nextHttpPolicy.Send(ctx, request);
+  }
+
+  std::unique_ptr<RawResponse> response;
+  try
+  {
+    response = nextHttpPolicy.Send(ctx, request);
+  }
+  catch (...)
+  {
+    m_inFlight->Land(key);
+    // The cancellation of this request isn't an error of the other ones.
+    auto canceled = ctx.CancelWhen() < std::chrono::system_clock::now();
+    Complete(flight, nullptr, canceled ? nullptr : std::current_exception());
+    throw;
+  }
+
+  // Nothing is buffered when no request waits for the response.
+  if (m_inFlight->Land(key) == 0)
+  {
+    Complete(flight, nullptr);
+    return response;
+  }
+
+  std::shared_ptr<const std::vector<uint8_t>> body;
+  auto bodyStream = response->GetBodyStream();
+  if (bodyStream)
+  {
+    if (bodyStream->Length() < 0 || bodyStream->Length() > m_coalescingOptions.MaxBodySize)
+    {
+      response->SetBodyStream(std::move(bodyStream));
+      Complete(flight, nullptr);
+      return response;
+    }
+    try
+    {
+      body = std::make_shared<const std::vector<uint8_t>>(
+          BodyStream::ReadToEnd(ctx, *bodyStream));
+    }
+    catch (...)
+    {
+      Complete(flight, nullptr);
+      throw;
+    }
+    response->SetBodyStream(std::make_unique<SharedBodyStream>(body));
+  }
+  else
+  {
+    if (static_cast<int64_t>(response->GetBody().size()) > m_coalescingOptions.MaxBodySize)
+    {
+      Complete(flight, nullptr);
+      return response;
+    }
+    body = std::make_shared<const std::vector<uint8_t>>(response->GetBody());
+  }
+
+  auto shared = std::make_shared<SharedResponse>();
+  shared->MajorVersion = response->GetMajorVersion();
+  shared->MinorVersion = response->GetMinorVersion();
+  shared->StatusCode = response->GetStatusCode();
+  shared->ReasonPhrase = response->GetReasonPhrase();
+  shared->Headers = response->GetHeaders();
+  shared->Body = std::move(body);
+  Complete(flight, std::move(shared));
+  return response;
+}
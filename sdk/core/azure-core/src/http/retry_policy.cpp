@@ -2,10 +2,13 @@
 // SPDX-License-Identifier: MIT
 
 #include <http/policy.hpp>
+#include <metrics.hpp>
 
 #include <algorithm>
-#include <cstdlib>
+#include <chrono>
 #include <limits>
+#include <map>
+#include <random>
 #include <thread>
 
 using namespace Azure::Core::Http;
@@ -14,6 +17,21 @@ namespace {
 typedef decltype(RetryOptions::RetryDelay) Delay;
 typedef decltype(RetryOptions::MaxRetries) RetryNumber;
 
+Azure::Core::Metrics::Counter& GetRetriesCounter()
+{
+  static auto& counter = Azure::Core::Metrics::MetricsRegistry::GetDefault().GetCounter(
+      "azure_core_http_retries_total", "Number of requests sent again by the retry policy.");
+  return counter;
+}
+
+Azure::Core::Metrics::Counter& GetThrottledCounter()
+{
+  static auto& counter = Azure::Core::Metrics::MetricsRegistry::GetDefault().GetCounter(
+      "azure_core_http_throttled_total",
+      "Number of responses with status 429 Too Many Requests or 503 Server Busy.");
+  return counter;
+}
+
 bool GetResponseHeaderBasedDelay(RawResponse const& response, Delay& retryAfter)
 {
   // Try to find retry-after headers. There are several of them possible.
@@ -61,8 +79,10 @@ Delay CalculateExponentialDelay(RetryOptions const& retryOptions, RetryNumber at
   auto exponentialRetryAfter = retryOptions.RetryDelay
       * ((attempt <= beforeLastBit) ? (1 << attempt) : std::numeric_limits<RetryNumber>::max());
 
-  // jitterFactor is a random double number in the range [0.8 .. 1.3)
-  auto jitterFactor = 0.8 + (static_cast<double>(std::rand()) / RAND_MAX) * 0.5;
+  // jitterFactor is a random double number in the range [0.8 .. 1.3). std::rand() takes a global
+  // lock, so each thread has its own generator.
+  thread_local std::minstd_rand jitterGenerator(std::random_device{}());
+  auto jitterFactor = std::uniform_real_distribution<double>(0.8, 1.3)(jitterGenerator);
 
   // Multiply exponentialRetryAfter by jitterFactor
   exponentialRetryAfter = Delay(static_cast<Delay::rep>(
@@ -88,55 +108,185 @@ bool ShouldRetryOnTransportFailure(
     return false;
   }
 
+  if (retryOptions.Budget && !retryOptions.Budget->TryAcquireRetry())
+  {
+    return false;
+  }
+
   retryAfter = CalculateExponentialDelay(retryOptions, attempt);
   return true;
 }
 
+bool IsRetriableResponse(RawResponse const& response, RetryOptions const& retryOptions)
+{
+  auto const& statusCodes = retryOptions.StatusCodes;
+  auto const statusCodesEnd = statusCodes.end();
+  return std::find(statusCodes.begin(), statusCodesEnd, response.GetStatusCode()) != statusCodesEnd;
+}
+
 bool ShouldRetryOnResponse(
     RawResponse const& response,
     RetryOptions const& retryOptions,
     RetryNumber attempt,
     Delay& retryAfter)
 {
+  // Should we retry on the given response retry code?
+  if (!IsRetriableResponse(response, retryOptions))
+  {
+    return false;
+  }
+
+  if (GetResponseHeaderBasedDelay(response, retryAfter))
+  {
+    // The service asked for a pause, which applies to every request sharing the budget, whether
+    // or not this one is retried.
+    if (retryOptions.Budget)
+    {
+      retryOptions.Budget->BackOff(retryAfter);
+    }
+  }
+  else
+  {
+    retryAfter = CalculateExponentialDelay(retryOptions, attempt);
+  }
+
   // Are we out of retry attempts?
   if (WasLastAttempt(retryOptions, attempt))
   {
     return false;
   }
 
-  // Should we retry on the given response retry code?
-  auto const& statusCodes = retryOptions.StatusCodes;
-  auto const statusCodesEnd = statusCodes.end();
-  if (std::find(statusCodes.begin(), statusCodesEnd, response.GetStatusCode()) == statusCodesEnd)
+  return !retryOptions.Budget || retryOptions.Budget->TryAcquireRetry();
+}
+
+// Sleeps in slices of this duration, so that a canceled context doesn't wait for the whole delay.
+constexpr auto c_CancelCheckInterval = std::chrono::milliseconds(10);
+
+void SleepUntil(Azure::Core::Context& ctx, std::chrono::steady_clock::time_point until)
+{
+  for (auto now = std::chrono::steady_clock::now(); now < until;
+       now = std::chrono::steady_clock::now())
   {
-    return false;
+    ctx.ThrowIfCanceled();
+    std::this_thread::sleep_for(
+        std::min<std::chrono::steady_clock::duration>(until - now, c_CancelCheckInterval));
   }
+}
 
-  if (!GetResponseHeaderBasedDelay(response, retryAfter))
+void WaitForBackOff(Azure::Core::Context& ctx, RetryOptions const& retryOptions)
+{
+  if (!retryOptions.Budget)
   {
-    retryAfter = CalculateExponentialDelay(retryOptions, attempt);
+    return;
   }
 
-  return true;
+  SleepUntil(ctx, retryOptions.Budget->GetBackOffUntil());
 }
 } // namespace
 
+RetryBudget::RetryBudget(RetryBudgetOptions options)
+    : m_options(std::move(options)), m_tokens(m_options.MaxRetries),
+      m_lastRefill(std::chrono::steady_clock::now())
+{
+}
+
+std::shared_ptr<RetryBudget> RetryBudget::GetShared(std::string const& key)
+{
+  static std::mutex sharedBudgetsMutex;
+  static std::map<std::string, std::shared_ptr<RetryBudget>> sharedBudgets;
+
+  std::lock_guard<std::mutex> guard(sharedBudgetsMutex);
+  auto& budget = sharedBudgets[key];
+  if (!budget)
+  {
+    budget = std::make_shared<RetryBudget>();
+  }
+  return budget;
+}
+
+void RetryBudget::Refill(std::chrono::steady_clock::time_point now)
+{
+  auto elapsed = std::chrono::duration<double>(now - m_lastRefill).count();
+  m_tokens = std::min(m_tokens + elapsed * m_options.MinRetriesPerSecond, m_options.MaxRetries);
+  m_lastRefill = now;
+}
+
+void RetryBudget::OnSuccess()
+{
+  std::lock_guard<std::mutex> guard(m_mutex);
+  m_tokens = std::min(m_tokens + m_options.RetryRatio, m_options.MaxRetries);
+}
+
+bool RetryBudget::TryAcquireRetry()
+{
+  std::lock_guard<std::mutex> guard(m_mutex);
+  Refill(std::chrono::steady_clock::now());
+  if (m_tokens < 1.0)
+  {
+    return false;
+  }
+  m_tokens -= 1.0;
+  return true;
+}
+
+void RetryBudget::BackOff(std::chrono::milliseconds delay)
+{
+  std::lock_guard<std::mutex> guard(m_mutex);
+  m_backOffUntil = std::max(m_backOffUntil, std::chrono::steady_clock::now() + delay);
+}
+
+std::chrono::steady_clock::time_point RetryBudget::GetBackOffUntil() const
+{
+  std::lock_guard<std::mutex> guard(m_mutex);
+  return m_backOffUntil;
+}
+
 std::unique_ptr<RawResponse> RetryPolicy::Send(
     Context& ctx,
     Request& request,
     NextHttpPolicy nextHttpPolicy) const
 {
+  using std::chrono::duration_cast;
+  using std::chrono::microseconds;
+  using std::chrono::steady_clock;
+
+  // Reported in the timings of the response.
+  microseconds failedAttempts{};
+  microseconds backOff{};
+
   for (RetryNumber attempt = 1;; ++attempt)
   {
+    auto backOffStart = steady_clock::now();
+    WaitForBackOff(ctx, m_retryOptions);
+    auto attemptStart = steady_clock::now();
+    backOff += duration_cast<microseconds>(attemptStart - backOffStart);
+
     Delay retryAfter{};
     try
     {
       auto response = nextHttpPolicy.Send(ctx, request);
+      auto statusCode = response->GetStatusCode();
+      if (statusCode == HttpStatusCode::TooManyRequests
+          || statusCode == HttpStatusCode::ServiceUnavailable)
+      {
+        GetThrottledCounter().Increment();
+      }
 
-      // If we are out of retry attempts, if a response is non-retriable (or simply 200 OK, i.e
-      // doesn't need to be retried), then ShouldRetry returns false.
+      // If we are out of retry attempts or retry budget, if a response is non-retriable (or simply
+      // 200 OK, i.e doesn't need to be retried), then ShouldRetry returns false.
       if (!ShouldRetryOnResponse(*response.get(), m_retryOptions, attempt, retryAfter))
       {
+        // Only a request that completed without a retry earns retries for the others.
+        if (m_retryOptions.Budget && attempt == 1
+            && !IsRetriableResponse(*response.get(), m_retryOptions))
+        {
+          m_retryOptions.Budget->OnSuccess();
+        }
+
+        auto& timings = response->GetTimings();
+        timings.Retries = attempt - 1;
+        timings.FailedAttempts = failedAttempts;
+        timings.RetryBackOff = backOff;
         return response;
       }
     }
@@ -154,6 +304,8 @@ std::unique_ptr<RawResponse> RetryPolicy::Send(
         throw;
       }
     }
+    failedAttempts += duration_cast<microseconds>(steady_clock::now() - attemptStart);
+    GetRetriesCounter().Increment();
 
     request.StartRetry();
     if (auto bodyStream = request.GetBodyStream())
@@ -165,7 +317,8 @@ std::unique_ptr<RawResponse> RetryPolicy::Send(
     // we proceed immediately if it is 0.
     if (retryAfter.count() > 0)
     {
-      std::this_thread::sleep_for(retryAfter);
+      SleepUntil(ctx, steady_clock::now() + retryAfter);
+      backOff += duration_cast<microseconds>(retryAfter);
     }
 
     ctx.ThrowIfCanceled();
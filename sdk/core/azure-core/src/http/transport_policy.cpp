@@ -1,9 +1,133 @@
 // Copyright (c) Microsoft Corporation. All rights reserved.
 // SPDX-License-Identifier: MIT
 
+#include <http/curl/curl.hpp>
+#include <http/latency_histogram.hpp>
 #include <http/policy.hpp>
+#include <metrics.hpp>
+
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <unordered_map>
 
 using namespace Azure::Core::Http;
+using namespace Azure::Core::Metrics;
+
+namespace {
+struct TransportMetrics
+{
+  Counter& BytesSent;
+  Counter& BytesReceived;
+  Histogram& Duration;
+};
+
+TransportMetrics& GetTransportMetrics()
+{
+  static TransportMetrics metrics{
+      MetricsRegistry::GetDefault().GetCounter(
+          "azure_core_http_sent_bytes_total", "Number of bytes of request body sent."),
+      MetricsRegistry::GetDefault().GetCounter(
+          "azure_core_http_received_bytes_total", "Number of bytes of response body received."),
+      MetricsRegistry::GetDefault().GetHistogram(
+          "azure_core_http_request_duration_seconds",
+          "Duration of the requests sent by the transport, up to the end of the response headers.",
+          GetDefaultLatencyBounds())};
+  return metrics;
+}
+
+struct RequestsCounterKey
+{
+  uint64_t Operation;
+  int Status;
+
+  bool operator==(RequestsCounterKey const& other) const
+  {
+    return Operation == other.Operation && Status == other.Status;
+  }
+};
+
+struct RequestsCounterKeyHash
+{
+  std::size_t operator()(RequestsCounterKey const& key) const
+  {
+    return static_cast<std::size_t>(key.Operation ^ (static_cast<uint64_t>(key.Status) << 48));
+  }
+};
+
+// Bounds the counters cached by each thread. The registry bounds the series it creates.
+constexpr std::size_t c_MaxCachedRequestsCounters = 1024;
+
+Counter& GetRequestsCounter(Request& request, HttpStatusCode statusCode)
+{
+  // The registry is looked up once per thread for each operation and status, the default registry
+  // is never destroyed so the counters cached stay valid. The key is computed in place, the
+  // operation name and the labels are only made on a miss.
+  thread_local std::unordered_map<RequestsCounterKey, Counter*, RequestsCounterKeyHash> counters;
+  RequestsCounterKey key{Azure::Core::Http::Details::GetOperationKey(request),
+                         static_cast<int>(statusCode)};
+  auto cached = counters.find(key);
+  if (cached != counters.end())
+  {
+    return *cached->second;
+  }
+
+  if (counters.size() >= c_MaxCachedRequestsCounters)
+  {
+    counters.clear();
+  }
+  auto& counter = MetricsRegistry::GetDefault().GetCounter(
+      "azure_core_http_requests_total",
+      "Number of requests sent by the transport, by operation and status code.",
+      {{"operation", Azure::Core::Http::Details::GetOperationName(request)},
+       {"status", std::to_string(key.Status)}});
+  counters.emplace(key, &counter);
+  return counter;
+}
+
+// The Content-Length of the response, 0 if it's missing or malformed.
+int64_t GetContentLength(RawResponse const& response)
+{
+  auto const& headers = response.GetHeaders();
+  auto contentLength = headers.find("content-length");
+  if (contentLength == headers.end())
+  {
+    return 0;
+  }
+  auto const value = contentLength->second.c_str();
+  char* end = nullptr;
+  errno = 0;
+  auto length = std::strtoll(value, &end, 10);
+  if (errno != 0 || end == value || *end != '\0' || length < 0)
+  {
+    return 0;
+  }
+  return static_cast<int64_t>(length);
+}
+
+void RecordRequest(Request& request, RawResponse const& response, int64_t bytesReceived)
+{
+  auto& metrics = GetTransportMetrics();
+  GetRequestsCounter(request, response.GetStatusCode()).Increment();
+  auto bodyStream = request.GetBodyStream();
+  if (bodyStream && bodyStream->Length() > 0)
+  {
+    metrics.BytesSent.Increment(bodyStream->Length());
+  }
+  if (bytesReceived > 0)
+  {
+    metrics.BytesReceived.Increment(bytesReceived);
+  }
+}
+} // namespace
+
+TransportPolicy::TransportPolicy(std::shared_ptr<HttpTransport> transport)
+    : m_transport(transport ? std::move(transport) : std::make_shared<CurlTransport>())
+{
+}
 
 std::unique_ptr<RawResponse> TransportPolicy::Send(
     Context& ctx,
@@ -15,16 +139,24 @@ std::unique_ptr<RawResponse> TransportPolicy::Send(
    * The transport policy is always the last policy.
    * Call the transport and return
    */
+  auto sendStart = std::chrono::steady_clock::now();
   auto response = m_transport->Send(ctx, request);
+  GetTransportMetrics().Duration.Observe(
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - sendStart).count());
   if (request.  IsDownloadViaStream())
   { // special case to return a response with BodyStream to read directly from socket
+    RecordRequest(request, *response, GetContentLength(*response));
     return response;
   }
 
   // default behavior for all request is to download body content to Response
   // If ReadToEnd fail, retry policy will eventually call this again
   auto bodyStream = response->GetBodyStream();
+  auto bodyStart = std::chrono::steady_clock::now();
   response->SetBody(BodyStream::ReadToEnd(ctx, *bodyStream));
+  response->GetTimings().BodyTransfer = std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - bodyStart);
+  RecordRequest(request, *response, static_cast<int64_t>(response->GetBody().size()));
   // BodyStream is moved out of response. This makes transport implementation to clean any active
   // session with sockets or internal state.
   return response;
@@ -0,0 +1,362 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// SPDX-License-Identifier: MIT
+
+#include <metrics.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <locale>
+#include <sstream>
+#include <stdexcept>
+
+using namespace Azure::Core::Metrics;
+
+namespace {
+// Metrics aren't expected to have that many labels, this only bounds the memory used when they do.
+constexpr std::size_t c_MaxSeriesPerMetric = 1024;
+
+template <class T, class Factory>
+T& GetSeries(
+    std::map<MetricLabels, std::unique_ptr<T>>& series,
+    MetricLabels const& labels,
+    Factory factory)
+{
+  auto ite = series.find(labels);
+  if (ite != series.end())
+  {
+    return *ite->second;
+  }
+  if (series.size() >= c_MaxSeriesPerMetric)
+  {
+    MetricLabels overflowLabels;
+    for (const auto& label : labels)
+    {
+      overflowLabels.emplace(label.first, "other");
+    }
+    ite = series.find(overflowLabels);
+    if (ite != series.end())
+    {
+      return *ite->second;
+    }
+    return *series.emplace(overflowLabels, factory()).first->second;
+  }
+  return *series.emplace(labels, factory()).first->second;
+}
+
+// Escapes the text of a HELP line, where quotes aren't special.
+std::string EscapeHelp(std::string const& help)
+{
+  std::string escaped;
+  escaped.reserve(help.size());
+  for (auto c : help)
+  {
+    switch (c)
+    {
+      case '\\':
+        escaped += "\\\\";
+        break;
+      case '\n':
+        escaped += "\\n";
+        break;
+      default:
+        escaped += c;
+    }
+  }
+  return escaped;
+}
+
+std::string EscapeLabelValue(std::string const& value)
+{
+  std::string escaped;
+  escaped.reserve(value.size());
+  for (auto c : value)
+  {
+    switch (c)
+    {
+      case '\\':
+        escaped += "\\\\";
+        break;
+      case '"':
+        escaped += "\\\"";
+        break;
+      case '\n':
+        escaped += "\\n";
+        break;
+      default:
+        escaped += c;
+    }
+  }
+  return escaped;
+}
+
+std::string FormatLabels(MetricLabels const& labels, std::string const& le = std::string())
+{
+  if (labels.empty() && le.empty())
+  {
+    return std::string();
+  }
+  std::string text = "{";
+  auto first = true;
+  for (const auto& label : labels)
+  {
+    text += (first ? "" : ",") + label.first + "=\"" + EscapeLabelValue(label.second) + "\"";
+    first = false;
+  }
+  if (!le.empty())
+  {
+    text += (first ? "" : ",") + std::string("le=\"") + le + "\"";
+  }
+  return text + "}";
+}
+
+std::string FormatDouble(double value)
+{
+  if (std::isinf(value))
+  {
+    return value > 0 ? "+Inf" : "-Inf";
+  }
+  // The shortest text that reads back as the same value, so that 0.1 isn't 0.10000000000000001.
+  std::string text;
+  for (int precision = 15; precision <= 17; ++precision)
+  {
+    std::ostringstream stream;
+    stream.imbue(std::locale::classic());
+    stream.precision(precision);
+    stream << value;
+    text = stream.str();
+
+    std::istringstream parser(text);
+    parser.imbue(std::locale::classic());
+    double parsed = 0;
+    parser >> parsed;
+    if (parsed == value)
+    {
+      break;
+    }
+  }
+  return text;
+}
+
+char const* MetricTypeName(MetricType type)
+{
+  switch (type)
+  {
+    case MetricType::Counter:
+      return "counter";
+    case MetricType::Gauge:
+      return "gauge";
+    default:
+      return "histogram";
+  }
+}
+} // namespace
+
+void* Details::CacheAligned::operator new(std::size_t size)
+{
+  // The pointer returned by the global new is kept just before the aligned storage.
+  auto raw = static_cast<char*>(::operator new(size + c_CacheLineSize + sizeof(void*)));
+  auto aligned = (reinterpret_cast<std::uintptr_t>(raw) + sizeof(void*) + c_CacheLineSize - 1)
+      & ~static_cast<std::uintptr_t>(c_CacheLineSize - 1);
+  reinterpret_cast<void**>(aligned)[-1] = raw;
+  return reinterpret_cast<void*>(aligned);
+}
+
+void Details::CacheAligned::operator delete(void* pointer) noexcept
+{
+  if (pointer)
+  {
+    ::operator delete(static_cast<void**>(pointer)[-1]);
+  }
+}
+
+Histogram::Histogram(std::vector<double> bounds) : m_bounds(std::move(bounds))
+{
+  std::sort(m_bounds.begin(), m_bounds.end());
+  for (auto& shard : m_shards)
+  {
+    shard.Buckets.reset(new std::atomic<uint64_t>[m_bounds.size() + 1]);
+    for (std::size_t i = 0; i <= m_bounds.size(); ++i)
+    {
+      shard.Buckets[i].store(0, std::memory_order_relaxed);
+    }
+  }
+}
+
+void Histogram::Observe(double value)
+{
+  auto bucket = std::lower_bound(m_bounds.begin(), m_bounds.end(), value) - m_bounds.begin();
+  auto& shard = m_shards[Details::GetShardIndex()];
+  shard.Buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+
+  // The shard is rarely shared, so the loop almost never runs more than once.
+  auto sum = shard.Sum.load(std::memory_order_relaxed);
+  while (!shard.Sum.compare_exchange_weak(sum, sum + value, std::memory_order_relaxed))
+  {
+  }
+}
+
+std::vector<uint64_t> Histogram::GetBucketCounts() const
+{
+  std::vector<uint64_t> counts(m_bounds.size() + 1);
+  for (const auto& shard : m_shards)
+  {
+    for (std::size_t i = 0; i < counts.size(); ++i)
+    {
+      counts[i] += shard.Buckets[i].load(std::memory_order_relaxed);
+    }
+  }
+  return counts;
+}
+
+double Histogram::GetSum() const
+{
+  double sum = 0.0;
+  for (const auto& shard : m_shards)
+  {
+    sum += shard.Sum.load(std::memory_order_relaxed);
+  }
+  return sum;
+}
+
+MetricsRegistry& MetricsRegistry::GetDefault()
+{
+  static auto registry = new MetricsRegistry();
+  return *registry;
+}
+
+MetricsRegistry::Family& MetricsRegistry::GetFamily(
+    std::string const& name,
+    std::string const& help,
+    MetricType type)
+{
+  auto ite = m_families.find(name);
+  if (ite == m_families.end())
+  {
+    ite = m_families.emplace(name, Family()).first;
+    ite->second.Help = help;
+    ite->second.Type = type;
+  }
+  else if (ite->second.Type != type)
+  {
+    throw std::invalid_argument("Metric " + name + " is already registered with another type.");
+  }
+  return ite->second;
+}
+
+Counter& MetricsRegistry::GetCounter(
+    std::string const& name,
+    std::string const& help,
+    MetricLabels const& labels)
+{
+  std::lock_guard<std::mutex> guard(m_mutex);
+  auto& family = GetFamily(name, help, MetricType::Counter);
+  return GetSeries(family.Counters, labels, []() { return std::make_unique<Counter>(); });
+}
+
+Gauge& MetricsRegistry::GetGauge(
+    std::string const& name,
+    std::string const& help,
+    MetricLabels const& labels)
+{
+  std::lock_guard<std::mutex> guard(m_mutex);
+  auto& family = GetFamily(name, help, MetricType::Gauge);
+  return GetSeries(family.Gauges, labels, []() { return std::make_unique<Gauge>(); });
+}
+
+Histogram& MetricsRegistry::GetHistogram(
+    std::string const& name,
+    std::string const& help,
+    std::vector<double> const& bounds,
+    MetricLabels const& labels)
+{
+  std::lock_guard<std::mutex> guard(m_mutex);
+  auto& family = GetFamily(name, help, MetricType::Histogram);
+  if (family.Histograms.empty())
+  {
+    family.Bounds = bounds;
+  }
+  return GetSeries(family.Histograms, labels, [&family]() {
+    return std::make_unique<Histogram>(family.Bounds);
+  });
+}
+
+std::vector<MetricFamily> MetricsRegistry::Snapshot() const
+{
+  std::lock_guard<std::mutex> guard(m_mutex);
+  std::vector<MetricFamily> snapshot;
+  snapshot.reserve(m_families.size());
+  for (const auto& entry : m_families)
+  {
+    MetricFamily family;
+    family.Name = entry.first;
+    family.Help = entry.second.Help;
+    family.Type = entry.second.Type;
+    for (const auto& counter : entry.second.Counters)
+    {
+      MetricSample sample;
+      sample.Labels = counter.first;
+      sample.Value = counter.second->Value();
+      family.Samples.push_back(std::move(sample));
+    }
+    for (const auto& gauge : entry.second.Gauges)
+    {
+      MetricSample sample;
+      sample.Labels = gauge.first;
+      sample.Value = gauge.second->Value();
+      family.Samples.push_back(std::move(sample));
+    }
+    for (const auto& histogram : entry.second.Histograms)
+    {
+      MetricSample sample;
+      sample.Labels = histogram.first;
+      sample.BucketBounds = histogram.second->GetBounds();
+      sample.BucketCounts = histogram.second->GetBucketCounts();
+      sample.Sum = histogram.second->GetSum();
+      family.Samples.push_back(std::move(sample));
+    }
+    snapshot.push_back(std::move(family));
+  }
+  return snapshot;
+}
+
+std::string Azure::Core::Metrics::FormatPrometheusText(std::vector<MetricFamily> const& families)
+{
+  std::string text;
+  for (const auto& family : families)
+  {
+    text += "# HELP " + family.Name + " " + EscapeHelp(family.Help) + "\n";
+    text += "# TYPE " + family.Name + " " + MetricTypeName(family.Type) + "\n";
+    for (const auto& sample : family.Samples)
+    {
+      if (family.Type != MetricType::Histogram)
+      {
+        text += family.Name + FormatLabels(sample.Labels) + " " + std::to_string(sample.Value)
+            + "\n";
+        continue;
+      }
+
+      // Prometheus buckets are cumulative and end with the +Inf one.
+      uint64_t cumulative = 0;
+      for (std::size_t i = 0; i < sample.BucketCounts.size(); ++i)
+      {
+        cumulative += sample.BucketCounts[i];
+        auto le = i < sample.BucketBounds.size() ? FormatDouble(sample.BucketBounds[i]) : "+Inf";
+        text += family.Name + "_bucket" + FormatLabels(sample.Labels, le) + " "
+            + std::to_string(cumulative) + "\n";
+      }
+      text += family.Name + "_sum" + FormatLabels(sample.Labels) + " " + FormatDouble(sample.Sum)
+          + "\n";
+      text += family.Name + "_count" + FormatLabels(sample.Labels) + " "
+          + std::to_string(cumulative) + "\n";
+    }
+  }
+  return text;
+}
+
+std::vector<double> const& Azure::Core::Metrics::GetDefaultLatencyBounds()
+{
+  static const std::vector<double> bounds{
+      0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10, 30, 60};
+  return bounds;
+}
@@ -0,0 +1,95 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// SPDX-License-Identifier: MIT
+
+#include "gtest/gtest.h"
+#include <http/body_stream.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+using namespace Azure::Core;
+using namespace Azure::Core::Http;
+
+namespace {
+
+// Gives its data in small reads and announces the length given, -1 if unknown.
+class TrickleBodyStream : public BodyStream {
+  std::vector<uint8_t> m_data;
+  int64_t m_length;
+  int64_t m_offset = 0;
+  int m_reads = 0;
+
+public:
+  TrickleBodyStream(std::vector<uint8_t> data, int64_t length)
+      : m_data(std::move(data)), m_length(length)
+  {
+  }
+
+  int64_t Length() const override { return m_length; }
+
+  void Rewind() override { m_offset = 0; }
+
+  int GetReads() const { return m_reads; }
+
+  int64_t Read(Context& context, uint8_t* buffer, int64_t count) override
+  {
+    context.ThrowIfCanceled();
+    ++m_reads;
+    auto readBytes
+        = std::min({count, int64_t(1000), static_cast<int64_t>(m_data.size()) - m_offset});
+    std::memcpy(buffer, m_data.data() + m_offset, static_cast<size_t>(readBytes));
+    m_offset += readBytes;
+    return readBytes;
+  }
+};
+
+std::vector<uint8_t> MakeData(size_t size)
+{
+  std::vector<uint8_t> data(size);
+  for (size_t i = 0; i < size; ++i)
+  {
+    data[i] = static_cast<uint8_t>(i * 7);
+  }
+  return data;
+}
+
+} // namespace
+
+TEST(BodyStream, ReadToEndKnownLength)
+{
+  auto data = MakeData(100 * 1024 + 3);
+  TrickleBodyStream body(data, static_cast<int64_t>(data.size()));
+  auto context = Context();
+  auto read = BodyStream::ReadToEnd(context, body);
+  EXPECT_EQ(read, data);
+  EXPECT_EQ(read.capacity(), data.size());
+  // No read past the known length.
+  EXPECT_EQ(body.GetReads(), 103);
+}
+
+TEST(BodyStream, ReadToEndUnknownLength)
+{
+  auto context = Context();
+  for (size_t size : {size_t(0), size_t(8 * 1024), size_t(3 * 1024 * 1024 + 5)})
+  {
+    auto data = MakeData(size);
+    TrickleBodyStream body(data, -1);
+    EXPECT_EQ(BodyStream::ReadToEnd(context, body), data);
+  }
+}
+
+TEST(BodyStream, ReadToEndWrongLength)
+{
+  auto context = Context();
+  auto data = MakeData(20 * 1024);
+  TrickleBodyStream shorter(data, 30 * 1024);
+  EXPECT_EQ(BodyStream::ReadToEnd(context, shorter), data);
+  // The length announced bounds what is read.
+  TrickleBodyStream longer(data, 10 * 1024);
+  EXPECT_EQ(
+      BodyStream::ReadToEnd(context, longer),
+      std::vector<uint8_t>(data.begin(), data.begin() + 10 * 1024));
+}
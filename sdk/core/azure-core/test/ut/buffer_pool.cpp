@@ -0,0 +1,117 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// SPDX-License-Identifier: MIT
+
+#include "gtest/gtest.h"
+#include <http/buffer_pool.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using namespace Azure::Core;
+using namespace Azure::Core::Http;
+
+TEST(BufferPool, ReusesBuffersOfTheSameClass)
+{
+  BufferPool pool;
+  uint8_t* data;
+  {
+    auto buffer = pool.Acquire(100 * 1024);
+    ASSERT_TRUE(buffer);
+    EXPECT_EQ(buffer.Size(), 100 * 1024);
+    // Four classes per power of two, 100KB is rounded up to 112KB.
+    EXPECT_EQ(buffer.GetCapacity(), 112 * 1024);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(buffer.Data()) % 4096, 0U);
+    EXPECT_EQ(pool.GetBytesInUse(), 112 * 1024);
+    data = buffer.Data();
+  }
+  EXPECT_EQ(pool.GetBytesInUse(), 0);
+  EXPECT_EQ(pool.GetBytesCached(), 112 * 1024);
+
+  auto buffer = pool.Acquire(110 * 1024);
+  EXPECT_EQ(buffer.Data(), data);
+  EXPECT_EQ(pool.GetBytesCached(), 0);
+
+  auto moved = std::move(buffer);
+  EXPECT_FALSE(buffer);
+  EXPECT_EQ(moved.Data(), data);
+  moved.Reset();
+  pool.Trim();
+  EXPECT_EQ(pool.GetBytesCached(), 0);
+}
+
+TEST(BufferPool, HugePageBuffers)
+{
+  BufferPool pool;
+  pool.SetUseHugePages(true);
+  auto buffer = pool.Acquire(4 * 1024 * 1024 + 1);
+  EXPECT_EQ(buffer.GetCapacity(), 5 * 1024 * 1024);
+  buffer.Data()[0] = 1;
+  buffer.Data()[buffer.GetCapacity() - 1] = 1;
+}
+
+TEST(BufferPool, BudgetAppliesBackpressure)
+{
+  BufferPool pool;
+  pool.SetBudget(64 * 1024);
+  auto first = pool.TryAcquireWithinBudget(40 * 1024);
+  ASSERT_TRUE(first);
+  EXPECT_FALSE(pool.TryAcquireWithinBudget(40 * 1024));
+  // Short lived buffers may exceed the budget.
+  EXPECT_TRUE(pool.Acquire(40 * 1024));
+
+  std::atomic<bool> acquired{false};
+  std::thread waiter([&]() {
+    Context context;
+    auto second = pool.AcquireWithinBudget(context, 40 * 1024);
+    acquired = true;
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  EXPECT_FALSE(acquired);
+  first.Reset();
+  waiter.join();
+  EXPECT_TRUE(acquired);
+  EXPECT_LE(pool.GetBytesInUse() + pool.GetBytesCached(), 64 * 1024);
+
+  // A buffer larger than the budget is given once nothing else is in use.
+  Context context;
+  EXPECT_TRUE(pool.AcquireWithinBudget(context, 1024 * 1024));
+}
+
+TEST(BufferPool, BudgetWaitIsCanceled)
+{
+  BufferPool pool;
+  pool.SetBudget(64 * 1024);
+  auto first = pool.Acquire(64 * 1024);
+  auto context = Context().WithDeadline(std::chrono::system_clock::now());
+  EXPECT_THROW(pool.AcquireWithinBudget(context, 4096), OperationCanceledException);
+}
+
+TEST(BufferPool, ConcurrentAcquireAndRelease)
+{
+  BufferPool pool;
+  pool.SetBudget(8 * 1024 * 1024);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 8; ++i)
+  {
+    threads.emplace_back([&pool, i]() {
+      Context context;
+      for (int j = 0; j < 1000; ++j)
+      {
+        auto buffer = pool.AcquireWithinBudget(context, 4096 * (1 + (i + j) % 64));
+        buffer.Data()[0] = 1;
+      }
+    });
+  }
+  for (auto& thread : threads)
+  {
+    thread.join();
+  }
+  EXPECT_EQ(pool.GetBytesInUse(), 0);
+  EXPECT_LE(pool.GetBytesCached(), 8 * 1024 * 1024);
+  pool.Trim();
+  EXPECT_EQ(pool.GetBytesCached(), 0);
+}
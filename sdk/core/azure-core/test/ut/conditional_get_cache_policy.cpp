@@ -0,0 +1,264 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// SPDX-License-Identifier: MIT
+
+#include "gtest/gtest.h"
+#include <http/pipeline.hpp>
+#include <http/policy.hpp>
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace Azure::Core;
+using namespace Azure::Core::Http;
+
+namespace {
+
+struct FakeBlobState
+{
+  std::string ETag = "\"0x1\"";
+  std::string Body = "manifest";
+  int Calls = 0;
+  int NotModified = 0;
+  bool Throw = false;
+  std::string LastIfNoneMatch;
+};
+
+class FakeBlobPolicy : public HttpPolicy {
+  std::shared_ptr<FakeBlobState> m_state;
+
+public:
+  explicit FakeBlobPolicy(std::shared_ptr<FakeBlobState> state) : m_state(std::move(state)) {}
+
+  std::unique_ptr<RawResponse> Send(Context& context, Request& request, NextHttpPolicy policy)
+      const override
+  {
+    (void)context;
+    (void)policy;
+
+    ++m_state->Calls;
+    if (m_state->Throw)
+    {
+      throw TransportException("Failed to connect.");
+    }
+    auto headers = request.GetHeaders();
+    auto ifNoneMatch = headers.find("if-none-match");
+    m_state->LastIfNoneMatch = ifNoneMatch == headers.end() ? "" : ifNoneMatch->second;
+    auto clientRequestId = headers.find("x-ms-client-request-id");
+    auto addRequestIds = [&](RawResponse& response) {
+      response.AddHeader("x-ms-request-id", std::to_string(m_state->Calls));
+      if (clientRequestId != headers.end())
+      {
+        response.AddHeader(clientRequestId->first, clientRequestId->second);
+      }
+    };
+    if (m_state->LastIfNoneMatch == m_state->ETag)
+    {
+      ++m_state->NotModified;
+      auto response = std::make_unique<RawResponse>(1, 1, HttpStatusCode::NotModified, "OK");
+      response->AddHeader("etag", m_state->ETag);
+      addRequestIds(*response);
+      return response;
+    }
+
+    auto response = std::make_unique<RawResponse>(1, 1, HttpStatusCode::Ok, "OK");
+    response->AddHeader("etag", m_state->ETag);
+    addRequestIds(*response);
+    std::vector<uint8_t> body(m_state->Body.begin(), m_state->Body.end());
+    if (request.IsDownloadViaStream())
+    {
+      response->SetBodyStream(std::make_unique<SharedBodyStream>(
+          std::make_shared<const std::vector<uint8_t>>(std::move(body))));
+    }
+    else
+    {
+      response->SetBody(std::move(body));
+    }
+    return response;
+  }
+
+  std::unique_ptr<HttpPolicy> Clone() const override
+  {
+    return std::make_unique<FakeBlobPolicy>(*this);
+  }
+};
+
+std::unique_ptr<HttpPipeline> CreatePipeline(
+    std::shared_ptr<FakeBlobState> state,
+    ConditionalGetCacheOptions options)
+{
+  std::vector<std::unique_ptr<HttpPolicy>> policies;
+  policies.emplace_back(std::make_unique<ConditionalGetCachePolicy>(std::move(options)));
+  policies.emplace_back(std::make_unique<FakeBlobPolicy>(std::move(state)));
+  return std::make_unique<HttpPipeline>(std::move(policies));
+}
+
+std::string ReadBody(Context& context, RawResponse& response)
+{
+  auto bodyStream = response.GetBodyStream();
+  auto body = bodyStream ? BodyStream::ReadToEnd(context, *bodyStream) : response.GetBody();
+  return std::string(body.begin(), body.end());
+}
+
+const std::string c_BlobUrl = "http://account.blob.core.windows.net/container/blob";
+
+} // namespace
+
+TEST(ConditionalGetCachePolicy, RevalidatesWithETag)
+{
+  auto state = std::make_shared<FakeBlobState>();
+  auto pipeline = CreatePipeline(state, ConditionalGetCacheOptions());
+
+  Context context;
+  for (int i = 0; i < 3; ++i)
+  {
+    Request request(HttpMethod::Get, c_BlobUrl, true);
+    auto response = pipeline->Send(context, request);
+    EXPECT_EQ(response->GetStatusCode(), HttpStatusCode::Ok);
+    EXPECT_EQ(response->GetHeaders().at("etag"), "\"0x1\"");
+    EXPECT_EQ(ReadBody(context, *response), "manifest");
+    // The caller's request isn't modified.
+    EXPECT_EQ(request.GetHeaders().count("if-none-match"), 0U);
+  }
+  EXPECT_EQ(state->Calls, 3);
+  EXPECT_EQ(state->NotModified, 2);
+
+  // A changed blob is downloaded again and replaces the cached one.
+  state->ETag = "\"0x2\"";
+  state->Body = "new manifest";
+  Request request(HttpMethod::Get, c_BlobUrl);
+  auto response = pipeline->Send(context, request);
+  EXPECT_EQ(state->LastIfNoneMatch, "\"0x1\"");
+  EXPECT_EQ(ReadBody(context, *response), "new manifest");
+  response = pipeline->Send(context, request);
+  EXPECT_EQ(state->LastIfNoneMatch, "\"0x2\"");
+  EXPECT_EQ(ReadBody(context, *response), "new manifest");
+  EXPECT_EQ(state->NotModified, 3);
+}
+
+TEST(ConditionalGetCachePolicy, FreshResponsesAreNotRevalidated)
+{
+  auto state = std::make_shared<FakeBlobState>();
+  ConditionalGetCacheOptions options;
+  options.FreshFor = std::chrono::milliseconds(100);
+  auto pipeline = CreatePipeline(state, options);
+
+  Context context;
+  Request request(HttpMethod::Get, c_BlobUrl);
+  for (int i = 0; i < 3; ++i)
+  {
+    EXPECT_EQ(ReadBody(context, *pipeline->Send(context, request)), "manifest");
+  }
+  EXPECT_EQ(state->Calls, 1);
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(150));
+  EXPECT_EQ(ReadBody(context, *pipeline->Send(context, request)), "manifest");
+  EXPECT_EQ(state->Calls, 2);
+  EXPECT_EQ(state->NotModified, 1);
+}
+
+TEST(ConditionalGetCachePolicy, StaleResponseOnError)
+{
+  auto state = std::make_shared<FakeBlobState>();
+  ConditionalGetCacheOptions options;
+  options.StaleIfErrorFor = std::chrono::minutes(1);
+  auto pipeline = CreatePipeline(state, options);
+
+  Context context;
+  Request request(HttpMethod::Get, c_BlobUrl);
+  pipeline->Send(context, request);
+  state->Throw = true;
+  EXPECT_EQ(ReadBody(context, *pipeline->Send(context, request)), "manifest");
+
+  // Without a cached response, or past the window, the error goes through.
+  Request other(HttpMethod::Get, c_BlobUrl + "2");
+  EXPECT_THROW(pipeline->Send(context, other), TransportException);
+  options.StaleIfErrorFor = std::chrono::milliseconds(0);
+  pipeline = CreatePipeline(state, options);
+  state->Throw = false;
+  pipeline->Send(context, request);
+  state->Throw = true;
+  EXPECT_THROW(pipeline->Send(context, request), TransportException);
+}
+
+TEST(ConditionalGetCachePolicy, UncacheableRequests)
+{
+  auto state = std::make_shared<FakeBlobState>();
+  ConditionalGetCacheOptions options;
+  options.FreshFor = std::chrono::minutes(1);
+  options.MaxBodySize = 4;
+  auto pipeline = CreatePipeline(state, options);
+
+  Context context;
+  // The body is larger than MaxBodySize.
+  Request request(HttpMethod::Get, c_BlobUrl, true);
+  EXPECT_EQ(ReadBody(context, *pipeline->Send(context, request)), "manifest");
+  EXPECT_EQ(ReadBody(context, *pipeline->Send(context, request)), "manifest");
+  EXPECT_EQ(state->Calls, 2);
+
+  // Requests with their own conditions and other methods are forwarded.
+  state->Body = "abc";
+  Request conditional(HttpMethod::Get, c_BlobUrl);
+  conditional.AddHeader("If-Match", "\"0x1\"");
+  pipeline->Send(context, conditional);
+  pipeline->Send(context, conditional);
+  Request put(HttpMethod::Put, c_BlobUrl);
+  pipeline->Send(context, put);
+  pipeline->Send(context, put);
+  EXPECT_EQ(state->Calls, 6);
+
+  // Different ranges are cached separately.
+  Request first(HttpMethod::Get, c_BlobUrl);
+  first.AddHeader("x-ms-range", "bytes=0-1");
+  Request second(HttpMethod::Get, c_BlobUrl);
+  second.AddHeader("x-ms-range", "bytes=2-3");
+  pipeline->Send(context, first);
+  pipeline->Send(context, second);
+  pipeline->Send(context, first);
+  pipeline->Send(context, second);
+  EXPECT_EQ(state->Calls, 8);
+}
+
+TEST(ConditionalGetCachePolicy, RequestIdsAreRefreshed)
+{
+  auto state = std::make_shared<FakeBlobState>();
+  auto pipeline = CreatePipeline(state, ConditionalGetCacheOptions());
+
+  Context context;
+  Request request(HttpMethod::Get, c_BlobUrl);
+  request.AddHeader("x-ms-client-request-id", "first");
+  auto response = pipeline->Send(context, request);
+  EXPECT_EQ(response->GetHeaders().at("x-ms-request-id"), "1");
+  EXPECT_EQ(response->GetHeaders().at("x-ms-client-request-id"), "first");
+
+  // The cached response gets the ids of the request revalidating it.
+  Request revalidation(HttpMethod::Get, c_BlobUrl);
+  revalidation.AddHeader("x-ms-client-request-id", "second");
+  response = pipeline->Send(context, revalidation);
+  EXPECT_EQ(state->NotModified, 1);
+  EXPECT_EQ(ReadBody(context, *response), "manifest");
+  EXPECT_EQ(response->GetHeaders().at("x-ms-request-id"), "2");
+  EXPECT_EQ(response->GetHeaders().at("x-ms-client-request-id"), "second");
+}
+
+TEST(ConditionalGetCachePolicy, CopiesDontShareResponses)
+{
+  // The copies given to two pipelines, as to two clients with different credentials.
+  auto state = std::make_shared<FakeBlobState>();
+  std::vector<std::unique_ptr<HttpPolicy>> policies;
+  policies.emplace_back(std::make_unique<ConditionalGetCachePolicy>(ConditionalGetCacheOptions()));
+  policies.emplace_back(std::make_unique<FakeBlobPolicy>(state));
+  HttpPipeline first(policies);
+  HttpPipeline second(policies);
+
+  Context context;
+  Request request(HttpMethod::Get, c_BlobUrl);
+  first.Send(context, request);
+  second.Send(context, request);
+  EXPECT_EQ(state->LastIfNoneMatch, "");
+  first.Send(context, request);
+  EXPECT_EQ(state->LastIfNoneMatch, "\"0x1\"");
+  EXPECT_EQ(state->NotModified, 1);
+}
@@ -0,0 +1,148 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// SPDX-License-Identifier: MIT
+
+#ifdef __linux__
+
+#include "gtest/gtest.h"
+#include <http/body_stream.hpp>
+#include <http/curl/curl.hpp>
+#include <http/http.hpp>
+#include <metrics.hpp>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cstdlib>
+#include <string>
+#include <thread>
+
+using namespace Azure::Core;
+using namespace Azure::Core::Http;
+
+namespace {
+
+// Accepts a single PUT on the loopback interface, answers its expect: 100-continue and keeps its
+// body.
+class LoopbackServer {
+private:
+  int m_listener;
+  std::thread m_thread;
+
+  static std::string ReadUntil(int connection, std::string& received, std::string const& end)
+  {
+    char buffer[4096];
+    std::string::size_type found;
+    while ((found = received.find(end)) == std::string::npos)
+    {
+      auto count = recv(connection, buffer, sizeof(buffer), 0);
+      if (count <= 0)
+      {
+        return std::string();
+      }
+      received.append(buffer, static_cast<std::size_t>(count));
+    }
+    auto head = received.substr(0, found + end.size());
+    received.erase(0, found + end.size());
+    return head;
+  }
+
+public:
+  std::string Body;
+
+  LoopbackServer()
+  {
+    m_listener = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    bind(m_listener, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+    listen(m_listener, 1);
+
+    m_thread = std::thread([this]() {
+      auto connection = accept(m_listener, nullptr, nullptr);
+      std::string received;
+      auto headers = ReadUntil(connection, received, "\r\n\r\n");
+      auto lengthStart = headers.find("content-length:");
+      auto length = lengthStart == std::string::npos
+          ? 0
+          : std::strtoull(headers.c_str() + lengthStart + 15, nullptr, 10);
+
+      std::string const continueResponse = "HTTP/1.1 100 Continue\r\n\r\n";
+      send(connection, continueResponse.data(), continueResponse.size(), MSG_NOSIGNAL);
+      char buffer[4096];
+      while (received.size() < length)
+      {
+        auto count = recv(connection, buffer, sizeof(buffer), 0);
+        if (count <= 0)
+        {
+          break;
+        }
+        received.append(buffer, static_cast<std::size_t>(count));
+      }
+      Body = received;
+
+      std::string const createdResponse = "HTTP/1.1 201 Created\r\ncontent-length: 0\r\n\r\n";
+      send(connection, createdResponse.data(), createdResponse.size(), MSG_NOSIGNAL);
+      close(connection);
+    });
+  }
+
+  ~LoopbackServer()
+  {
+    if (m_thread.joinable())
+    {
+      m_thread.join();
+    }
+    close(m_listener);
+  }
+
+  std::string GetUrl() const
+  {
+    sockaddr_in address = {};
+    socklen_t addressLength = sizeof(address);
+    getsockname(m_listener, reinterpret_cast<sockaddr*>(&address), &addressLength);
+    return "http://127.0.0.1:" + std::to_string(ntohs(address.sin_port)) + "/container/blob";
+  }
+
+  void Join() { m_thread.join(); }
+};
+
+} // namespace
+
+TEST(CurlKernelFileTransfer, SendsFileBodyWithSendfile)
+{
+  std::string const content(64 * 1024 + 3, 'k');
+  char path[] = "/tmp/azure-core-sendfileXXXXXX";
+  auto fd = mkstemp(path);
+  ASSERT_NE(fd, -1);
+  unlink(path);
+  ASSERT_EQ(write(fd, "skip", 4), 4);
+  ASSERT_EQ(write(fd, content.data(), content.size()), static_cast<ssize_t>(content.size()));
+
+  auto& kernelBytes = Metrics::MetricsRegistry::GetDefault().GetCounter(
+      "azure_core_http_kernel_file_transfer_bytes_total",
+      "Number of request body bytes sent from files by the kernel with sendfile.");
+  auto kernelBytesBefore = kernelBytes.Value();
+
+  LoopbackServer server;
+  FileBodyStream body(fd, 4, static_cast<int64_t>(content.size()));
+  Request request(HttpMethod::Put, server.GetUrl(), &body);
+  request.AddHeader("content-length", std::to_string(content.size()));
+
+  CurlTransportOptions options;
+  options.KernelFileTransfer = true;
+  CurlTransport transport(options);
+  auto context = GetApplicationContext();
+  auto response = transport.Send(context, request);
+  server.Join();
+
+  EXPECT_EQ(response->GetStatusCode(), HttpStatusCode::Created);
+  EXPECT_EQ(server.Body, content);
+  EXPECT_EQ(kernelBytes.Value() - kernelBytesBefore, static_cast<int64_t>(content.size()));
+  close(fd);
+}
+
+#endif // __linux__
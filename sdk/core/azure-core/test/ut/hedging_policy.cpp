@@ -0,0 +1,170 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// SPDX-License-Identifier: MIT
+
+#include "gtest/gtest.h"
+#include <http/pipeline.hpp>
+#include <http/policy.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace Azure::Core;
+using namespace Azure::Core::Http;
+
+namespace {
+
+struct FakeServerState
+{
+  std::atomic<int> Calls{0};
+  std::atomic<int> Canceled{0};
+  std::thread::id FirstAttemptThread;
+  // Attempts with an index lower than this one hang until they are canceled.
+  int SlowAttempts = 0;
+  bool Throw = false;
+};
+
+class FakeServerPolicy : public HttpPolicy {
+  std::shared_ptr<FakeServerState> m_state;
+
+public:
+  explicit FakeServerPolicy(std::shared_ptr<FakeServerState> state) : m_state(std::move(state)) {}
+
+  std::unique_ptr<RawResponse> Send(Context& context, Request& request, NextHttpPolicy policy)
+      const override
+  {
+    (void)request;
+    (void)policy;
+
+    auto attempt = m_state->Calls++;
+    if (attempt == 0)
+    {
+      m_state->FirstAttemptThread = std::this_thread::get_id();
+    }
+    if (m_state->Throw)
+    {
+      throw TransportException("Failed to connect.");
+    }
+    if (attempt < m_state->SlowAttempts)
+    {
+      while (context.CancelWhen() > std::chrono::system_clock::now())
+      {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+      ++m_state->Canceled;
+      throw TransportException("Canceled.");
+    }
+
+    auto response = std::make_unique<RawResponse>(1, 1, HttpStatusCode::Ok, "OK");
+    response->AddHeader("attempt", std::to_string(attempt));
+    return response;
+  }
+
+  std::unique_ptr<HttpPolicy> Clone() const override
+  {
+    return std::make_unique<FakeServerPolicy>(*this);
+  }
+};
+
+std::unique_ptr<HttpPipeline> CreatePipeline(
+    std::shared_ptr<FakeServerState> state,
+    HedgingOptions options)
+{
+  std::vector<std::unique_ptr<HttpPolicy>> policies;
+  policies.emplace_back(std::make_unique<HedgingPolicy>(std::move(options)));
+  policies.emplace_back(std::make_unique<FakeServerPolicy>(std::move(state)));
+  return std::make_unique<HttpPipeline>(std::move(policies));
+}
+
+} // namespace
+
+TEST(HedgingPolicy, SlowRequestIsHedged)
+{
+  auto state = std::make_shared<FakeServerState>();
+  state->SlowAttempts = 1;
+  HedgingOptions options;
+  options.HedgeDelay = std::chrono::milliseconds(10);
+  options.HedgePercentile = 0.0;
+  auto pipeline = CreatePipeline(state, options);
+
+  Context context;
+  Request request(HttpMethod::Get, "http://account.blob.core.windows.net/container/blob");
+  auto response = pipeline->Send(context, request);
+  EXPECT_EQ(response->GetStatusCode(), HttpStatusCode::Ok);
+  EXPECT_EQ(response->GetHeaders().at("attempt"), "1");
+
+  // The first attempt ran on the calling thread, it has been canceled before the call returned.
+  EXPECT_EQ(state->FirstAttemptThread, std::this_thread::get_id());
+  EXPECT_EQ(state->Calls, 2);
+  EXPECT_EQ(state->Canceled, 1);
+}
+
+TEST(HedgingPolicy, HedgesAreLimited)
+{
+  auto state = std::make_shared<FakeServerState>();
+  state->SlowAttempts = 3;
+  HedgingOptions options;
+  options.MaxHedgedRequests = 3;
+  options.HedgeDelay = std::chrono::milliseconds(5);
+  options.HedgePercentile = 0.0;
+  auto pipeline = CreatePipeline(state, options);
+
+  Context context;
+  Request request(HttpMethod::Get, "http://account.blob.core.windows.net/container/blob");
+  auto response = pipeline->Send(context, request);
+  EXPECT_EQ(response->GetHeaders().at("attempt"), "3");
+  EXPECT_EQ(state->Calls, 4);
+  EXPECT_EQ(state->Canceled, 3);
+}
+
+TEST(HedgingPolicy, FastRequestIsNotHedged)
+{
+  auto state = std::make_shared<FakeServerState>();
+  HedgingOptions options;
+  options.HedgeDelay = std::chrono::seconds(10);
+  auto pipeline = CreatePipeline(state, options);
+
+  Context context;
+  Request request(HttpMethod::Head, "http://account.blob.core.windows.net/container/blob");
+  auto response = pipeline->Send(context, request);
+  EXPECT_EQ(response->GetHeaders().at("attempt"), "0");
+  EXPECT_EQ(state->FirstAttemptThread, std::this_thread::get_id());
+
+  pipeline.reset();
+  EXPECT_EQ(state->Calls, 1);
+}
+
+TEST(HedgingPolicy, NonIdempotentRequestIsNotHedged)
+{
+  auto state = std::make_shared<FakeServerState>();
+  state->SlowAttempts = 1;
+  HedgingOptions options;
+  options.HedgeDelay = std::chrono::milliseconds(1);
+  auto pipeline = CreatePipeline(state, options);
+
+  Context context;
+  auto canceler = std::thread([&context]() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    context.Cancel();
+  });
+  Request request(HttpMethod::Put, "http://account.blob.core.windows.net/container/blob");
+  EXPECT_THROW(pipeline->Send(context, request), TransportException);
+  canceler.join();
+
+  pipeline.reset();
+  EXPECT_EQ(state->Calls, 1);
+}
+
+TEST(HedgingPolicy, ErrorIsRethrown)
+{
+  auto state = std::make_shared<FakeServerState>();
+  state->Throw = true;
+  auto pipeline = CreatePipeline(state, HedgingOptions());
+
+  Context context;
+  Request request(HttpMethod::Get, "http://account.blob.core.windows.net/container/blob");
+  EXPECT_THROW(pipeline->Send(context, request), TransportException);
+}
@@ -0,0 +1,179 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// SPDX-License-Identifier: MIT
+
+#include "gtest/gtest.h"
+#include <http/in_memory_transport.hpp>
+#include <http/pipeline.hpp>
+#include <http/policy.hpp>
+
+#include <atomic>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace Azure::Core;
+using namespace Azure::Core::Http;
+
+namespace {
+
+HttpPipeline CreatePipeline(std::shared_ptr<InMemoryTransport> transport)
+{
+  std::vector<std::unique_ptr<HttpPolicy>> policies;
+  policies.emplace_back(std::make_unique<TransportPolicy>(std::move(transport)));
+  return HttpPipeline(policies);
+}
+
+InMemoryResponse CreateResponse(std::string const& body)
+{
+  InMemoryResponse response;
+  response.Headers["etag"] = "\"0x1\"";
+  response.Body = std::make_shared<std::vector<uint8_t>>(body.begin(), body.end());
+  return response;
+}
+
+std::string ToString(std::vector<uint8_t> const& body)
+{
+  return std::string(body.begin(), body.end());
+}
+
+} // namespace
+
+TEST(InMemoryTransport, RoutesByLongestPrefixInTurn)
+{
+  auto transport = std::make_shared<InMemoryTransport>();
+  transport->AddResponse(HttpMethod::Get, "/container", CreateResponse("container"));
+  transport->AddResponse(HttpMethod::Get, "/container/blob", CreateResponse("first"));
+  transport->AddResponse(HttpMethod::Get, "/container/blob", CreateResponse("second"));
+  auto pipeline = CreatePipeline(transport);
+  auto context = GetApplicationContext();
+
+  std::vector<std::string> bodies;
+  for (auto const& url :
+       {"https://account.blob.core.windows.net/container/blob",
+        "https://account.blob.core.windows.net/container/blob?comp=metadata",
+        "https://account.blob.core.windows.net/container/blob",
+        "https://account.blob.core.windows.net/container?restype=container"})
+  {
+    Request request(HttpMethod::Get, url);
+    auto response = pipeline.Send(context, request);
+    EXPECT_EQ(response->GetStatusCode(), HttpStatusCode::Ok);
+    EXPECT_EQ(response->GetHeaders().at("etag"), "\"0x1\"");
+    bodies.push_back(ToString(response->GetBody()));
+  }
+  EXPECT_EQ(bodies, (std::vector<std::string>{"first", "second", "first", "container"}));
+
+  Request put(HttpMethod::Put, "https://account.blob.core.windows.net/container/blob");
+  EXPECT_EQ(pipeline.Send(context, put)->GetStatusCode(), HttpStatusCode::NotFound);
+  EXPECT_EQ(transport->GetRequestCount(), 5U);
+}
+
+TEST(InMemoryTransport, StreamsRanges)
+{
+  auto transport = std::make_shared<InMemoryTransport>();
+  auto blob = CreateResponse("0123456789");
+  blob.ServeRanges = true;
+  transport->AddResponse(HttpMethod::Get, "/container/blob", blob);
+  auto pipeline = CreatePipeline(transport);
+  auto context = GetApplicationContext();
+
+  Request request(HttpMethod::Get, "https://account.blob.core.windows.net/container/blob", true);
+  request.AddHeader("x-ms-range", "bytes=2-5");
+  auto response = pipeline.Send(context, request);
+  EXPECT_EQ(response->GetStatusCode(), HttpStatusCode::PartialContent);
+  EXPECT_EQ(response->GetHeaders().at("content-range"), "bytes 2-5/10");
+  EXPECT_EQ(response->GetHeaders().at("content-length"), "4");
+  auto stream = response->GetBodyStream();
+  ASSERT_NE(stream, nullptr);
+  EXPECT_EQ(ToString(BodyStream::ReadToEnd(context, *stream)), "2345");
+
+  Request beyond(HttpMethod::Get, "https://account.blob.core.windows.net/container/blob");
+  beyond.AddHeader("x-ms-range", "bytes=10-");
+  EXPECT_EQ(pipeline.Send(context, beyond)->GetStatusCode(), HttpStatusCode::RangeNotSatisfiable);
+}
+
+TEST(InMemoryTransport, ReplaysTraffic)
+{
+  std::istringstream traffic("# recorded traffic\n"
+                             "PUT /container/blob?comp=block\n"
+                             "201 Created\n"
+                             "x-ms-request-server-encrypted: true\n"
+                             "\n"
+                             "HEAD /container/blob\n"
+                             "200 OK\r\n"
+                             "Content-Length: 0\r\n"
+                             "x-ms-blob-type: BlockBlob\r\n"
+                             "\r\n"
+                             "GET /container?restype=container&comp=list\n"
+                             "200 OK\n"
+                             "content-type: application/xml\n"
+                             "content-length: 20\n"
+                             "\n"
+                             "<EnumerationResults>\n");
+  auto transport = std::make_shared<InMemoryTransport>();
+  transport->LoadReplay(traffic);
+  auto pipeline = CreatePipeline(transport);
+  auto context = GetApplicationContext();
+
+  std::vector<uint8_t> content(100, 'x');
+  MemoryBodyStream contentStream(content);
+  Request put(
+      HttpMethod::Put,
+      "https://account.blob.core.windows.net/container/blob?comp=block&blockid=AAAA",
+      &contentStream);
+  auto putResponse = pipeline.Send(context, put);
+  EXPECT_EQ(putResponse->GetStatusCode(), HttpStatusCode::Created);
+  EXPECT_EQ(putResponse->GetHeaders().at("x-ms-request-server-encrypted"), "true");
+
+  Request head(HttpMethod::Head, "https://account.blob.core.windows.net/container/blob");
+  EXPECT_EQ(pipeline.Send(context, head)->GetHeaders().at("x-ms-blob-type"), "BlockBlob");
+
+  Request list(
+      HttpMethod::Get,
+      "https://account.blob.core.windows.net/container?restype=container&comp=list");
+  EXPECT_EQ(ToString(pipeline.Send(context, list)->GetBody()), "<EnumerationResults>");
+
+  std::istringstream malformed("GET /container/blob\nOK\n\n");
+  EXPECT_THROW(transport->LoadReplay(malformed), std::runtime_error);
+}
+
+TEST(InMemoryTransport, HandlerServesConcurrentRequests)
+{
+  std::atomic<int> handled{0};
+  InMemoryTransportOptions options;
+  options.Handler = [&handled](Context&, Request& request) {
+    ++handled;
+    return CreateResponse(request.GetHeaders().at("x-ms-client-request-id"));
+  };
+  auto transport = std::make_shared<InMemoryTransport>(options);
+  auto pipeline = CreatePipeline(transport);
+
+  constexpr int threadCount = 4;
+  constexpr int requestsPerThread = 500;
+  std::atomic<int> mismatches{0};
+  std::vector<std::thread> threads;
+  for (int t = 0; t < threadCount; ++t)
+  {
+    threads.emplace_back([&pipeline, &mismatches, t]() {
+      auto context = GetApplicationContext();
+      for (int i = 0; i < requestsPerThread; ++i)
+      {
+        auto id = std::to_string(t) + "-" + std::to_string(i);
+        Request request(HttpMethod::Get, "https://account.blob.core.windows.net/container/blob");
+        request.AddHeader("x-ms-client-request-id", id);
+        if (ToString(pipeline.Send(context, request)->GetBody()) != id)
+        {
+          ++mismatches;
+        }
+      }
+    });
+  }
+  for (auto& thread : threads)
+  {
+    thread.join();
+  }
+  EXPECT_EQ(mismatches.load(), 0);
+  EXPECT_EQ(handled.load(), threadCount * requestsPerThread);
+  EXPECT_EQ(transport->GetRequestCount(), static_cast<uint64_t>(threadCount * requestsPerThread));
+}
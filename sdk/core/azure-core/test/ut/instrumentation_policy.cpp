@@ -0,0 +1,110 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// SPDX-License-Identifier: MIT
+
+#include "gtest/gtest.h"
+#include <http/latency_histogram.hpp>
+#include <http/pipeline.hpp>
+#include <http/policy.hpp>
+
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace Azure::Core;
+using namespace Azure::Core::Http;
+
+namespace {
+
+// Fails the first request with 503 and answers the following ones after 10ms.
+class FlakyServerPolicy : public HttpPolicy {
+  std::shared_ptr<int> m_calls;
+
+public:
+  explicit FlakyServerPolicy(std::shared_ptr<int> calls) : m_calls(std::move(calls)) {}
+
+  std::unique_ptr<RawResponse> Send(Context& context, Request& request, NextHttpPolicy policy)
+      const override
+  {
+    (void)context;
+    (void)request;
+    (void)policy;
+
+    if ((*m_calls)++ == 0)
+    {
+      return std::make_unique<RawResponse>(1, 1, HttpStatusCode::ServiceUnavailable, "Busy");
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    auto response = std::make_unique<RawResponse>(1, 1, HttpStatusCode::Ok, "OK");
+    response->GetTimings().TimeToFirstByte = std::chrono::milliseconds(10);
+    return response;
+  }
+
+  std::unique_ptr<HttpPolicy> Clone() const override
+  {
+    return std::make_unique<FlakyServerPolicy>(*this);
+  }
+};
+
+} // namespace
+
+TEST(LatencyHistogram, Percentile)
+{
+  LatencyHistogram histogram;
+  EXPECT_EQ(histogram.Percentile(50).count(), 0);
+  for (int i = 1; i <= 1000; ++i)
+  {
+    histogram.Record(std::chrono::microseconds(i * 1000));
+  }
+  EXPECT_EQ(histogram.Count(), 1000U);
+
+  // Buckets are accurate to 1/16.
+  auto median = histogram.Percentile(50).count();
+  EXPECT_GE(median, 500000);
+  EXPECT_LE(median, 500000 + 500000 / 16);
+  auto p99 = histogram.Percentile(99).count();
+  EXPECT_GE(p99, 990000);
+  EXPECT_LE(p99, 990000 + 990000 / 16);
+}
+
+TEST(LatencyHistogram, Decay)
+{
+  LatencyHistogram histogram(100);
+  for (int i = 0; i < 100; ++i)
+  {
+    histogram.Record(std::chrono::microseconds(10));
+  }
+  EXPECT_EQ(histogram.Count(), 50U);
+}
+
+TEST(InstrumentationPolicy, RecordsTimings)
+{
+  RetryOptions retryOptions;
+  retryOptions.RetryDelay = std::chrono::milliseconds(5);
+  auto instrumentation = std::make_unique<InstrumentationPolicy>();
+  auto histograms = instrumentation->GetHistograms();
+
+  std::vector<std::unique_ptr<HttpPolicy>> policies;
+  policies.emplace_back(std::move(instrumentation));
+  policies.emplace_back(std::make_unique<RetryPolicy>(retryOptions));
+  policies.emplace_back(std::make_unique<FlakyServerPolicy>(std::make_shared<int>(0)));
+  HttpPipeline pipeline(std::move(policies));
+
+  Context context;
+  Request request(HttpMethod::Get, "http://account.blob.core.windows.net/container/blob?comp=list");
+  auto response = pipeline.Send(context, request);
+
+  auto const& timings = response->GetTimings();
+  EXPECT_EQ(timings.Retries, 1);
+  EXPECT_GT(timings.RetryBackOff.count(), 0);
+  EXPECT_GE(timings.Total, timings.RetryBackOff + timings.TimeToFirstByte);
+
+  auto operations = histograms->GetOperations();
+  ASSERT_EQ(operations.size(), 1U);
+  EXPECT_EQ(operations[0], "GET account.blob.core.windows.net comp");
+  auto operationHistograms = histograms->GetHistograms(operations[0]);
+  ASSERT_NE(operationHistograms, nullptr);
+  EXPECT_EQ(operationHistograms->Total.Count(), 1U);
+  EXPECT_EQ(operationHistograms->Retries.load(), 1U);
+  EXPECT_EQ(operationHistograms->Connect.Count(), 0U);
+}
@@ -0,0 +1,215 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// SPDX-License-Identifier: MIT
+
+#include "gtest/gtest.h"
+#include <http/latency_histogram.hpp>
+#include <http/pipeline.hpp>
+#include <http/policy.hpp>
+#include <metrics.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace Azure::Core;
+using namespace Azure::Core::Http;
+using namespace Azure::Core::Metrics;
+
+namespace {
+
+const std::vector<uint8_t> g_responseBody(100, 'x');
+std::string g_contentLength = "100";
+
+// Answers every request with 200 OK and a 100 bytes body.
+class FakeTransport : public HttpTransport {
+public:
+  std::unique_ptr<RawResponse> Send(Context& context, Request& request) override
+  {
+    (void)context;
+    (void)request;
+
+    auto response = std::make_unique<RawResponse>(1, 1, HttpStatusCode::Ok, "OK");
+    response->AddHeader("content-length", g_contentLength);
+    response->SetBodyStream(std::make_unique<MemoryBodyStream>(g_responseBody));
+    return response;
+  }
+};
+
+int64_t GetCounterValue(std::string const& name, MetricLabels const& labels = MetricLabels())
+{
+  for (const auto& family : MetricsRegistry::GetDefault().Snapshot())
+  {
+    if (family.Name != name)
+    {
+      continue;
+    }
+    for (const auto& sample : family.Samples)
+    {
+      if (sample.Labels == labels)
+      {
+        return sample.Value;
+      }
+    }
+  }
+  return 0;
+}
+
+} // namespace
+
+TEST(Metrics, CounterSumsAllThreads)
+{
+  MetricsRegistry registry;
+  auto& counter = registry.GetCounter("requests_total", "Requests.");
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 8; ++i)
+  {
+    threads.emplace_back([&registry]() {
+      auto& threadCounter = registry.GetCounter("requests_total", "Requests.");
+      for (int j = 0; j < 10000; ++j)
+      {
+        threadCounter.Increment();
+      }
+    });
+  }
+  for (auto& thread : threads)
+  {
+    thread.join();
+  }
+  EXPECT_EQ(counter.Value(), 80000);
+
+  auto& gauge = registry.GetGauge("active", "Active.", {{"kind", "upload"}});
+  gauge.Add(3);
+  gauge.Subtract(1);
+  EXPECT_EQ(gauge.Value(), 2);
+  EXPECT_NE(&gauge, &registry.GetGauge("active", "Active.", {{"kind", "download"}}));
+  EXPECT_THROW(registry.GetCounter("active", "Active."), std::invalid_argument);
+}
+
+TEST(Metrics, PrometheusText)
+{
+  MetricsRegistry registry;
+  registry.GetCounter("requests_total", "Number of requests.", {{"status", "200"}}).Increment(5);
+  auto& histogram = registry.GetHistogram("duration_seconds", "Duration.", {0.1, 1});
+  histogram.Observe(0.05);
+  histogram.Observe(0.5);
+  histogram.Observe(2);
+  registry.GetGauge("queued", "Requests\\operations\nqueued.").Add(1);
+
+  EXPECT_EQ(
+      FormatPrometheusText(registry.Snapshot()),
+      "# HELP duration_seconds Duration.\n"
+      "# TYPE duration_seconds histogram\n"
+      "duration_seconds_bucket{le=\"0.1\"} 1\n"
+      "duration_seconds_bucket{le=\"1\"} 2\n"
+      "duration_seconds_bucket{le=\"+Inf\"} 3\n"
+      "duration_seconds_sum 2.55\n"
+      "duration_seconds_count 3\n"
+      "# HELP queued Requests\\\\operations\\nqueued.\n"
+      "# TYPE queued gauge\n"
+      "queued 1\n"
+      "# HELP requests_total Number of requests.\n"
+      "# TYPE requests_total counter\n"
+      "requests_total{status=\"200\"} 5\n");
+}
+
+TEST(Metrics, ShardsAreCacheAligned)
+{
+  MetricsRegistry registry;
+  for (int i = 0; i < 8; ++i)
+  {
+    auto& counter = registry.GetCounter("aligned_total", "Aligned.", {{"i", std::to_string(i)}});
+    EXPECT_EQ(reinterpret_cast<std::uintptr_t>(&counter) % Metrics::Details::c_CacheLineSize, 0U);
+  }
+  auto& histogram = registry.GetHistogram("aligned_seconds", "Aligned.", {1});
+  EXPECT_EQ(reinterpret_cast<std::uintptr_t>(&histogram) % Metrics::Details::c_CacheLineSize, 0U);
+}
+
+TEST(Metrics, OperationKey)
+{
+  auto key = [](std::string const& url, std::string const& range = std::string()) {
+    Request request(HttpMethod::Get, url);
+    if (!range.empty())
+    {
+      request.AddHeader("x-ms-range", range);
+    }
+    return Azure::Core::Http::Details::GetOperationKey(request);
+  };
+  std::string const blob = "http://account.blob.core.windows.net/container/blob";
+
+  // Keyed like the operation name: the values and the order of the query parameters don't
+  // matter, nor the size of a range within a power of two.
+  EXPECT_EQ(key(blob + "?comp=list&prefix=a"), key(blob + "?prefix=b&comp=list"));
+  EXPECT_EQ(key(blob, "bytes=0-99"), key(blob, "bytes=100-199"));
+  EXPECT_NE(key(blob + "?comp=list"), key(blob + "?comp=list&prefix=a"));
+  EXPECT_NE(key(blob), key(blob, "bytes=0-99"));
+  EXPECT_NE(key(blob, "bytes=0-99"), key(blob, "bytes=0-999"));
+  EXPECT_NE(key(blob), key("http://other.blob.core.windows.net/container/blob"));
+
+  Request head(HttpMethod::Head, blob);
+  EXPECT_NE(Azure::Core::Http::Details::GetOperationKey(head), key(blob));
+
+  // A parameter added by a retry is part of the operation, once.
+  Request retried(HttpMethod::Get, blob + "?comp=list");
+  retried.StartRetry();
+  retried.AddQueryParameter("comp", "list");
+  EXPECT_EQ(Azure::Core::Http::Details::GetOperationKey(retried), key(blob + "?comp=list"));
+  retried.AddQueryParameter("timeout", "30");
+  EXPECT_EQ(
+      Azure::Core::Http::Details::GetOperationKey(retried), key(blob + "?comp=list&timeout=30"));
+}
+
+TEST(Metrics, TransportPolicyRecordsRequests)
+{
+  std::vector<std::unique_ptr<HttpPolicy>> policies;
+  policies.emplace_back(std::make_unique<TransportPolicy>(std::make_shared<FakeTransport>()));
+  HttpPipeline pipeline(std::move(policies));
+
+  MetricLabels labels{{"operation", "GET metrics.blob.core.windows.net"}, {"status", "200"}};
+  auto requests = GetCounterValue("azure_core_http_requests_total", labels);
+  auto bytesReceived = GetCounterValue("azure_core_http_received_bytes_total");
+
+  Context context;
+  Request request(HttpMethod::Get, "http://metrics.blob.core.windows.net/container/blob");
+  pipeline.Send(context, request);
+
+  EXPECT_EQ(GetCounterValue("azure_core_http_requests_total", labels), requests + 1);
+  EXPECT_EQ(GetCounterValue("azure_core_http_received_bytes_total"), bytesReceived + 100);
+
+  // Another operation is counted on its own, the cached counter of the first one is reused.
+  MetricLabels listLabels{
+      {"operation", "GET metrics.blob.core.windows.net comp restype"}, {"status", "200"}};
+  auto listRequests = GetCounterValue("azure_core_http_requests_total", listLabels);
+  Request list(
+      HttpMethod::Get,
+      "http://metrics.blob.core.windows.net/container?restype=container&comp=list");
+  pipeline.Send(context, list);
+  Request again(HttpMethod::Get, "http://metrics.blob.core.windows.net/container/other");
+  pipeline.Send(context, again);
+  EXPECT_EQ(GetCounterValue("azure_core_http_requests_total", listLabels), listRequests + 1);
+  EXPECT_EQ(GetCounterValue("azure_core_http_requests_total", labels), requests + 2);
+}
+
+TEST(Metrics, TransportPolicyIgnoresMalformedContentLength)
+{
+  std::vector<std::unique_ptr<HttpPolicy>> policies;
+  policies.emplace_back(std::make_unique<TransportPolicy>(std::make_shared<FakeTransport>()));
+  HttpPipeline pipeline(std::move(policies));
+
+  // The body isn't read, the bytes received are the announced length.
+  Context context;
+  Request request(HttpMethod::Get, "http://metrics.blob.core.windows.net/container/blob", true);
+  auto bytesReceived = GetCounterValue("azure_core_http_received_bytes_total");
+  pipeline.Send(context, request);
+  EXPECT_EQ(GetCounterValue("azure_core_http_received_bytes_total"), bytesReceived + 100);
+
+  for (auto const& contentLength : {"abc", "12abc", "99999999999999999999", "-1", ""})
+  {
+    g_contentLength = contentLength;
+    EXPECT_NO_THROW(pipeline.Send(context, request));
+  }
+  g_contentLength = "100";
+  EXPECT_EQ(GetCounterValue("azure_core_http_received_bytes_total"), bytesReceived + 100);
+}
@@ -0,0 +1,134 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// SPDX-License-Identifier: MIT
+
+#include "gtest/gtest.h"
+#include <http/pipeline.hpp>
+#include <http/policy.hpp>
+#include <http/rate_limiter.hpp>
+
+#include <chrono>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+using namespace Azure::Core;
+using namespace Azure::Core::Http;
+
+namespace {
+
+// Reads the request body and answers with a body stream of 20KB.
+class EchoServerPolicy : public HttpPolicy {
+  std::shared_ptr<std::vector<uint8_t>> m_uploaded;
+
+public:
+  explicit EchoServerPolicy(std::shared_ptr<std::vector<uint8_t>> uploaded)
+      : m_uploaded(std::move(uploaded))
+  {
+  }
+
+  std::unique_ptr<RawResponse> Send(Context& context, Request& request, NextHttpPolicy policy)
+      const override
+  {
+    (void)policy;
+
+    *m_uploaded = BodyStream::ReadToEnd(context, *request.GetBodyStream());
+    static std::vector<uint8_t> responseBody(20 * 1024, 'x');
+    auto response = std::make_unique<RawResponse>(1, 1, HttpStatusCode::Ok, "OK");
+    response->SetBodyStream(std::make_unique<MemoryBodyStream>(responseBody));
+    return response;
+  }
+
+  std::unique_ptr<HttpPolicy> Clone() const override
+  {
+    return std::make_unique<EchoServerPolicy>(*this);
+  }
+};
+
+} // namespace
+
+TEST(RateLimiter, LongTermRate)
+{
+  RateLimiter limiter(1000, 100);
+  Context context;
+  auto start = std::chrono::steady_clock::now();
+  limiter.Acquire(context, 100);
+  limiter.Acquire(context, 200);
+  limiter.Acquire(context, 1);
+  EXPECT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(150));
+}
+
+TEST(RateLimiter, SetRate)
+{
+  RateLimiter limiter(1, 1);
+  Context context;
+  limiter.Acquire(context, 1000);
+
+  // No limit, the debt doesn't matter anymore.
+  limiter.SetRate(0);
+  EXPECT_EQ(limiter.GetRate(), 0);
+  auto start = std::chrono::steady_clock::now();
+  limiter.Acquire(context, 1);
+  EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(1));
+}
+
+TEST(RateLimiter, Canceled)
+{
+  RateLimiter limiter(1, 1);
+  Context context;
+  limiter.Acquire(context, 1000);
+  auto canceledContext = context.WithDeadline(std::chrono::system_clock::now());
+  EXPECT_THROW(limiter.Acquire(canceledContext, 1), OperationCanceledException);
+}
+
+TEST(RateLimitPolicy, LimitsBodies)
+{
+  RateLimitOptions options;
+  options.UploadRate = std::make_shared<RateLimiter>(100 * 1024, 1024);
+  options.DownloadRate = std::make_shared<RateLimiter>(100 * 1024, 1024);
+  auto uploaded = std::make_shared<std::vector<uint8_t>>();
+
+  std::vector<std::unique_ptr<HttpPolicy>> policies;
+  policies.emplace_back(std::make_unique<RateLimitPolicy>(options));
+  policies.emplace_back(std::make_unique<EchoServerPolicy>(uploaded));
+  HttpPipeline pipeline(std::move(policies));
+
+  std::vector<uint8_t> requestBody(20 * 1024, 'y');
+  MemoryBodyStream requestBodyStream(requestBody);
+  Request request(
+      HttpMethod::Put, "http://account.blob.core.windows.net/container/blob", &requestBodyStream);
+  Context context;
+
+  auto start = std::chrono::steady_clock::now();
+  auto response = pipeline.Send(context, request);
+  EXPECT_EQ(*uploaded, requestBody);
+  EXPECT_EQ(request.GetBodyStream(), &requestBodyStream);
+
+  auto responseBodyStream = response->GetBodyStream();
+  auto responseBody = BodyStream::ReadToEnd(context, *responseBodyStream);
+  EXPECT_EQ(responseBody.size(), 20U * 1024);
+  // Reads are capped to the burst of 1KB, so 19KB of each body wait for the rate of 100KB/s.
+  EXPECT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(150));
+}
+
+TEST(RateLimitPolicy, PriorityFromContext)
+{
+  RateLimitOptions options;
+  options.RequestRate = std::make_shared<RateLimiter>(1000, 1000);
+  auto uploaded = std::make_shared<std::vector<uint8_t>>();
+
+  std::vector<std::unique_ptr<HttpPolicy>> policies;
+  policies.emplace_back(std::make_unique<RateLimitPolicy>(options));
+  policies.emplace_back(std::make_unique<EchoServerPolicy>(uploaded));
+  HttpPipeline pipeline(std::move(policies));
+
+  Request request(HttpMethod::Get, "http://account.blob.core.windows.net/container/blob");
+  auto highPriority = Context().WithValue(
+      RateLimitPolicy::PriorityContextKey, static_cast<int>(RateLimitPriority::High));
+  EXPECT_EQ(pipeline.Send(highPriority, request)->GetStatusCode(), HttpStatusCode::Ok);
+
+  // Values that aren't a priority are rejected rather than aborting or indexing out of bounds.
+  auto wrongType = Context().WithValue(RateLimitPolicy::PriorityContextKey, std::string("High"));
+  EXPECT_THROW(pipeline.Send(wrongType, request), std::invalid_argument);
+  auto outOfRange = Context().WithValue(RateLimitPolicy::PriorityContextKey, 7);
+  EXPECT_THROW(pipeline.Send(outOfRange, request), std::invalid_argument);
+}
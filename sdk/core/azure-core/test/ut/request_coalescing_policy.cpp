@@ -0,0 +1,255 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// SPDX-License-Identifier: MIT
+
+#include "gtest/gtest.h"
+#include <http/pipeline.hpp>
+#include <http/policy.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace Azure::Core;
+using namespace Azure::Core::Http;
+
+namespace {
+
+struct FakeServerState
+{
+  std::atomic<int> Calls{0};
+  // Requests hang until this is set, or until they are canceled.
+  std::atomic<bool> Released{false};
+  bool Throw = false;
+};
+
+class FakeServerPolicy : public HttpPolicy {
+  std::shared_ptr<FakeServerState> m_state;
+
+public:
+  explicit FakeServerPolicy(std::shared_ptr<FakeServerState> state) : m_state(std::move(state)) {}
+
+  std::unique_ptr<RawResponse> Send(Context& context, Request& request, NextHttpPolicy policy)
+      const override
+  {
+    (void)policy;
+
+    auto call = m_state->Calls++;
+    while (!m_state->Released)
+    {
+      context.ThrowIfCanceled();
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    if (m_state->Throw)
+    {
+      throw TransportException("Failed to connect.");
+    }
+
+    auto response = std::make_unique<RawResponse>(1, 1, HttpStatusCode::Ok, "OK");
+    response->AddHeader("call", std::to_string(call));
+    auto const headers = request.GetHeaders();
+    auto clientRequestId = headers.find("x-ms-client-request-id");
+    if (clientRequestId != headers.end())
+    {
+      response->AddHeader(clientRequestId->first, clientRequestId->second);
+    }
+    auto body = std::make_shared<const std::vector<uint8_t>>(8, static_cast<uint8_t>('a'));
+    if (request.IsDownloadViaStream())
+    {
+      response->SetBodyStream(std::make_unique<SharedBodyStream>(body));
+    }
+    else
+    {
+      response->SetBody(*body);
+    }
+    return response;
+  }
+
+  std::unique_ptr<HttpPolicy> Clone() const override
+  {
+    return std::make_unique<FakeServerPolicy>(*this);
+  }
+};
+
+std::unique_ptr<HttpPipeline> CreatePipeline(
+    std::shared_ptr<FakeServerState> state,
+    RequestCoalescingOptions options = RequestCoalescingOptions())
+{
+  std::vector<std::unique_ptr<HttpPolicy>> policies;
+  policies.emplace_back(std::make_unique<RequestCoalescingPolicy>(std::move(options)));
+  policies.emplace_back(std::make_unique<FakeServerPolicy>(std::move(state)));
+  return std::make_unique<HttpPipeline>(std::move(policies));
+}
+
+const std::string c_BlobUrl = "http://account.blob.core.windows.net/container/blob";
+
+// Sends count identical requests at the same time, once the first one is in flight.
+std::vector<std::unique_ptr<RawResponse>> SendConcurrently(
+    HttpPipeline& pipeline,
+    FakeServerState& state,
+    int count,
+    std::vector<int>& failures)
+{
+  std::vector<std::unique_ptr<RawResponse>> responses(static_cast<std::size_t>(count));
+  failures.assign(static_cast<std::size_t>(count), 0);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < count; ++i)
+  {
+    threads.emplace_back([&, i]() {
+      Context context;
+      Request request(HttpMethod::Get, c_BlobUrl, i % 2 == 0);
+      request.AddHeader("x-ms-range", "bytes=0-7");
+      request.AddHeader("x-ms-client-request-id", std::to_string(i));
+      try
+      {
+        responses[static_cast<std::size_t>(i)] = pipeline.Send(context, request);
+      }
+      catch (TransportException const&)
+      {
+        failures[static_cast<std::size_t>(i)] = 1;
+      }
+    });
+    if (i == 0)
+    {
+      while (state.Calls == 0)
+      {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+    }
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  state.Released = true;
+  for (auto& thread : threads)
+  {
+    thread.join();
+  }
+  return responses;
+}
+
+} // namespace
+
+TEST(RequestCoalescingPolicy, IdenticalRequestsShareResponse)
+{
+  auto state = std::make_shared<FakeServerState>();
+  auto pipeline = CreatePipeline(state);
+
+  std::vector<int> failures;
+  auto responses = SendConcurrently(*pipeline, *state, 8, failures);
+  EXPECT_EQ(state->Calls, 1);
+  Context context;
+  for (std::size_t i = 0; i < responses.size(); ++i)
+  {
+    ASSERT_TRUE(responses[i]);
+    EXPECT_EQ(responses[i]->GetHeaders().at("call"), "0");
+    EXPECT_EQ(responses[i]->GetHeaders().at("x-ms-client-request-id"), std::to_string(i));
+    auto bodyStream = responses[i]->GetBodyStream();
+    // Even requests download via a stream, odd ones get a buffered body.
+    ASSERT_EQ(bodyStream != nullptr, i % 2 == 0);
+    auto body = bodyStream ? BodyStream::ReadToEnd(context, *bodyStream) : responses[i]->GetBody();
+    EXPECT_EQ(body, std::vector<uint8_t>(8, static_cast<uint8_t>('a')));
+  }
+
+  // Requests sent after the response aren't coalesced, nor are different ones.
+  Request request(HttpMethod::Get, c_BlobUrl);
+  pipeline->Send(context, request);
+  Request other(HttpMethod::Get, c_BlobUrl + "2");
+  pipeline->Send(context, other);
+  EXPECT_EQ(state->Calls, 3);
+}
+
+TEST(RequestCoalescingPolicy, LargeResponseIsNotShared)
+{
+  auto state = std::make_shared<FakeServerState>();
+  RequestCoalescingOptions options;
+  options.MaxBodySize = 4;
+  auto pipeline = CreatePipeline(state, options);
+
+  std::vector<int> failures;
+  auto responses = SendConcurrently(*pipeline, *state, 4, failures);
+  // The waiting requests were sent on their own once the first response arrived.
+  EXPECT_EQ(state->Calls, 4);
+  for (auto const& response : responses)
+  {
+    EXPECT_TRUE(response);
+  }
+}
+
+TEST(RequestCoalescingPolicy, ErrorIsShared)
+{
+  auto state = std::make_shared<FakeServerState>();
+  state->Throw = true;
+  auto pipeline = CreatePipeline(state);
+
+  std::vector<int> failures;
+  SendConcurrently(*pipeline, *state, 4, failures);
+  EXPECT_EQ(state->Calls, 1);
+  EXPECT_EQ(failures, std::vector<int>(4, 1));
+}
+
+TEST(RequestCoalescingPolicy, CanceledLeaderDoesNotFailOthers)
+{
+  auto state = std::make_shared<FakeServerState>();
+  auto pipeline = CreatePipeline(state);
+
+  Context leaderContext = Context().WithDeadline(std::chrono::system_clock::time_point::max());
+  std::thread leader([&]() {
+    Request request(HttpMethod::Head, c_BlobUrl);
+    EXPECT_THROW(pipeline->Send(leaderContext, request), OperationCanceledException);
+  });
+  while (state->Calls == 0)
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+
+  std::unique_ptr<RawResponse> response;
+  std::thread follower([&]() {
+    Context context;
+    Request request(HttpMethod::Head, c_BlobUrl);
+    response = pipeline->Send(context, request);
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  leaderContext.Cancel();
+  leader.join();
+  while (state->Calls < 2)
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  state->Released = true;
+  follower.join();
+  ASSERT_TRUE(response);
+  EXPECT_EQ(response->GetHeaders().at("call"), "1");
+}
+
+TEST(RequestCoalescingPolicy, CopiesDontShareFlights)
+{
+  // The copies given to two pipelines, as to two clients with different credentials.
+  auto state = std::make_shared<FakeServerState>();
+  std::vector<std::unique_ptr<HttpPolicy>> policies;
+  policies.emplace_back(std::make_unique<RequestCoalescingPolicy>(RequestCoalescingOptions()));
+  policies.emplace_back(std::make_unique<FakeServerPolicy>(state));
+  HttpPipeline first(policies);
+  HttpPipeline second(policies);
+
+  auto send = [](HttpPipeline& pipeline) {
+    Context context;
+    Request request(HttpMethod::Get, c_BlobUrl);
+    pipeline.Send(context, request);
+  };
+  std::thread firstThread([&]() { send(first); });
+  while (state->Calls == 0)
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  std::thread secondThread([&]() { send(second); });
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+  while (state->Calls < 2 && std::chrono::steady_clock::now() < deadline)
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  state->Released = true;
+  firstThread.join();
+  secondThread.join();
+  EXPECT_EQ(state->Calls, 2);
+}
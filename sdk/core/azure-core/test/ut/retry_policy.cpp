@@ -0,0 +1,175 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// SPDX-License-Identifier: MIT
+
+#include "gtest/gtest.h"
+#include <http/pipeline.hpp>
+#include <http/policy.hpp>
+
+#include <chrono>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace Azure::Core;
+using namespace Azure::Core::Http;
+
+namespace {
+
+struct ThrottledServerState
+{
+  int Calls = 0;
+  // Requests are answered with 200 OK once this many were throttled.
+  int ThrottledCalls = std::numeric_limits<int>::max();
+  std::string RetryAfterMs;
+};
+
+// Answers requests with 503 Server Busy.
+class ThrottledServerPolicy : public HttpPolicy {
+  std::shared_ptr<ThrottledServerState> m_state;
+
+public:
+  explicit ThrottledServerPolicy(std::shared_ptr<ThrottledServerState> state)
+      : m_state(std::move(state))
+  {
+  }
+
+  std::unique_ptr<RawResponse> Send(Context& context, Request& request, NextHttpPolicy policy)
+      const override
+  {
+    (void)context;
+    (void)request;
+    (void)policy;
+
+    if (m_state->Calls++ >= m_state->ThrottledCalls)
+    {
+      return std::make_unique<RawResponse>(1, 1, HttpStatusCode::Ok, "OK");
+    }
+    auto response = std::make_unique<RawResponse>(
+        1, 1, HttpStatusCode::ServiceUnavailable, "Server Busy");
+    if (!m_state->RetryAfterMs.empty())
+    {
+      response->AddHeader("retry-after-ms", m_state->RetryAfterMs);
+    }
+    return response;
+  }
+
+  std::unique_ptr<HttpPolicy> Clone() const override
+  {
+    return std::make_unique<ThrottledServerPolicy>(*this);
+  }
+};
+
+HttpPipeline CreatePipeline(RetryOptions options, std::shared_ptr<ThrottledServerState> state)
+{
+  std::vector<std::unique_ptr<HttpPolicy>> policies;
+  policies.emplace_back(std::make_unique<RetryPolicy>(std::move(options)));
+  policies.emplace_back(std::make_unique<ThrottledServerPolicy>(std::move(state)));
+  return HttpPipeline(std::move(policies));
+}
+
+} // namespace
+
+TEST(RetryPolicy, RetryBudgetLimitsRetries)
+{
+  RetryBudgetOptions budgetOptions;
+  budgetOptions.MaxRetries = 2;
+  budgetOptions.MinRetriesPerSecond = 0;
+
+  RetryOptions options;
+  options.RetryDelay = std::chrono::milliseconds(1);
+  options.Budget = std::make_shared<RetryBudget>(budgetOptions);
+  auto state = std::make_shared<ThrottledServerState>();
+  auto pipeline = CreatePipeline(options, state);
+
+  Context context;
+  Request request(HttpMethod::Get, "http://account.blob.core.windows.net/container/blob");
+  auto response = pipeline.Send(context, request);
+  EXPECT_EQ(response->GetStatusCode(), HttpStatusCode::ServiceUnavailable);
+  EXPECT_EQ(state->Calls, 3);
+
+  // The budget is exhausted, so the next request isn't retried at all.
+  state->Calls = 0;
+  Request secondRequest(HttpMethod::Get, "http://account.blob.core.windows.net/container/blob");
+  response = pipeline.Send(context, secondRequest);
+  EXPECT_EQ(state->Calls, 1);
+}
+
+TEST(RetryPolicy, RetriedRequestEarnsNoRetry)
+{
+  RetryBudgetOptions budgetOptions;
+  budgetOptions.MaxRetries = 1;
+  budgetOptions.MinRetriesPerSecond = 0;
+  budgetOptions.RetryRatio = 1;
+
+  RetryOptions options;
+  options.RetryDelay = std::chrono::milliseconds(1);
+  options.Budget = std::make_shared<RetryBudget>(budgetOptions);
+  auto state = std::make_shared<ThrottledServerState>();
+  state->ThrottledCalls = 1;
+  auto pipeline = CreatePipeline(options, state);
+
+  // The request succeeds after taking the only retry of the budget, it doesn't give it back.
+  Context context;
+  Request request(HttpMethod::Get, "http://account.blob.core.windows.net/container/blob");
+  EXPECT_EQ(pipeline.Send(context, request)->GetStatusCode(), HttpStatusCode::Ok);
+  EXPECT_EQ(state->Calls, 2);
+  EXPECT_FALSE(options.Budget->TryAcquireRetry());
+
+  // A request that succeeds right away earns one.
+  Request secondRequest(HttpMethod::Get, "http://account.blob.core.windows.net/container/blob");
+  pipeline.Send(context, secondRequest);
+  EXPECT_TRUE(options.Budget->TryAcquireRetry());
+}
+
+TEST(RetryPolicy, CanceledWhileBackingOff)
+{
+  RetryOptions options;
+  options.RetryDelay = std::chrono::minutes(1);
+  auto state = std::make_shared<ThrottledServerState>();
+  auto pipeline = CreatePipeline(options, state);
+
+  auto context = Context().WithDeadline(
+      std::chrono::system_clock::now() + std::chrono::milliseconds(50));
+  Request request(HttpMethod::Get, "http://account.blob.core.windows.net/container/blob");
+  auto start = std::chrono::steady_clock::now();
+  EXPECT_THROW(pipeline.Send(context, request), OperationCanceledException);
+  EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(10));
+  EXPECT_EQ(state->Calls, 1);
+}
+
+TEST(RetryPolicy, RetryAfterDelaysSharedPipelines)
+{
+  auto budget = std::make_shared<RetryBudget>();
+
+  RetryOptions options;
+  options.MaxRetries = 0;
+  options.Budget = budget;
+  auto state = std::make_shared<ThrottledServerState>();
+  state->RetryAfterMs = "200";
+  auto throttledPipeline = CreatePipeline(options, state);
+
+  Context context;
+  Request request(HttpMethod::Get, "http://account.blob.core.windows.net/container/blob");
+  throttledPipeline.Send(context, request);
+  EXPECT_GT(budget->GetBackOffUntil(), std::chrono::steady_clock::now());
+
+  // Another pipeline sharing the budget waits for the back off before sending its request.
+  auto otherState = std::make_shared<ThrottledServerState>();
+  auto otherPipeline = CreatePipeline(options, otherState);
+  auto start = std::chrono::steady_clock::now();
+  Request otherRequest(HttpMethod::Get, "http://account.blob.core.windows.net/container/blob");
+  otherPipeline.Send(context, otherRequest);
+  EXPECT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(150));
+  EXPECT_EQ(otherState->Calls, 1);
+}
+
+TEST(RetryPolicy, SharedRetryBudget)
+{
+  EXPECT_EQ(
+      RetryBudget::GetShared("account.blob.core.windows.net"),
+      RetryBudget::GetShared("account.blob.core.windows.net"));
+  EXPECT_NE(
+      RetryBudget::GetShared("account.blob.core.windows.net"),
+      RetryBudget::GetShared("other.blob.core.windows.net"));
+}
@@ -4,6 +4,7 @@
 #pragma once
 
 #include "blobs/append_blob_client.hpp"
+#include "blobs/blob_batch.hpp"
 #include "blobs/blob_client.hpp"
 #include "blobs/blob_container_client.hpp"
 #include "blobs/blob_service_client.hpp"
@@ -0,0 +1,133 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "blobs/blob_options.hpp"
+#include "common/storage_uri_builder.hpp"
+#include "http/pipeline.hpp"
+#include "http/policy.hpp"
+#include "protocol/blob_rest_client.hpp"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Azure { namespace Storage { namespace Details {
+
+  enum class BlobBatchOperationType
+  {
+    Delete,
+    SetAccessTier,
+  };
+
+  struct BlobBatchOperation
+  {
+    BlobBatchOperationType Type = BlobBatchOperationType::Delete;
+    std::string ContainerName;
+    std::string BlobName;
+    Blobs::BlobRestClient::Blob::DeleteOptions DeleteOptions;
+    Blobs::BlobRestClient::Blob::SetAccessTierOptions SetTierOptions;
+  };
+
+}}} // namespace Azure::Storage::Details
+
+namespace Azure { namespace Storage { namespace Blobs {
+
+  /**
+   * @brief A collection of sub-requests that are sent to the service together with
+   * BlobServiceClient::SubmitBatch or BlobContainerClient::SubmitBatch.
+   */
+  class BlobBatch {
+  public:
+    /**
+     * @brief Adds a delete blob sub-request to the batch.
+     *
+     * @param containerName The name of the container containing the blob to delete.
+     * @param blobName The name of the blob to delete.
+     * @param options Optional parameters to execute this sub-request. The Context member is
+     * ignored, the context passed to SubmitBatch is used instead.
+     * @return The index of the result in SubmitBlobBatchResult::DeleteBlobResults.
+     */
+    int32_t DeleteBlob(
+        const std::string& containerName,
+        const std::string& blobName,
+        const DeleteBlobOptions& options = DeleteBlobOptions());
+
+    /**
+     * @brief Adds a set blob access tier sub-request to the batch.
+     *
+     * @param containerName The name of the container containing the blob to set the tier of.
+     * @param blobName The name of the blob to set the tier of.
+     * @param tier Indicates the tier to be set on the blob.
+     * @param options Optional parameters to execute this sub-request. The Context member is
+     * ignored, the context passed to SubmitBatch is used instead.
+     * @return The index of the result in SubmitBlobBatchResult::SetBlobAccessTierResults.
+     */
+    int32_t SetBlobAccessTier(
+        const std::string& containerName,
+        const std::string& blobName,
+        AccessTier tier,
+        const SetAccessTierOptions& options = SetAccessTierOptions());
+
+  private:
+    std::vector<Details::BlobBatchOperation> m_operations;
+    int32_t m_numDeleteOperations = 0;
+    int32_t m_numSetAccessTierOperations = 0;
+
+    friend class BlobServiceClient;
+    friend class BlobContainerClient;
+  };
+
+  /**
+   * @brief The results of the sub-requests of a BlobBatch. A failed sub-request doesn't throw,
+   * the status code, headers and error body of each sub-request are available from its raw
+   * response.
+   */
+  struct SubmitBlobBatchResult
+  {
+    std::vector<Azure::Core::Response<DeleteBlobInfo>> DeleteBlobResults;
+    std::vector<Azure::Core::Response<SetBlobAccessTierInfo>> SetBlobAccessTierResults;
+  };
+
+}}} // namespace Azure::Storage::Blobs
+
+namespace Azure { namespace Storage { namespace Details {
+
+  constexpr static int32_t c_MaxBlobBatchSubRequests = 256;
+
+  /**
+   * @brief Creates the pipeline that authenticates and serializes batch sub-requests instead of
+   * sending them. authenticationPolicy may be null for clients authenticated with SAS.
+   */
+  std::shared_ptr<Azure::Core::Http::HttpPipeline> CreateBlobBatchSubRequestPipeline(
+      std::unique_ptr<Azure::Core::Http::HttpPolicy> authenticationPolicy);
+
+  /**
+   * @brief Serializes the sub-requests of a batch request into a multipart/mixed body, the
+   * Content-ID of each part is the index of its sub-request.
+   */
+  std::string CreateBlobBatchRequestBody(
+      const std::string& boundary,
+      const std::vector<std::vector<uint8_t>>& subRequests);
+
+  /**
+   * @brief Parses a multipart/mixed batch response into the responses of its sub-requests, in the
+   * order of the sub-requests. Throws std::runtime_error if the response is malformed or doesn't
+   * answer every sub-request.
+   */
+  std::vector<std::unique_ptr<Azure::Core::Http::RawResponse>> ParseBlobBatchResponse(
+      const std::string& contentType,
+      const std::vector<uint8_t>& body,
+      std::size_t numSubRequests);
+
+  Azure::Core::Response<Blobs::SubmitBlobBatchResult> SubmitBlobBatch(
+      Azure::Core::Http::HttpPipeline& pipeline,
+      Azure::Core::Http::HttpPipeline& subRequestPipeline,
+      const UriBuilder& serviceUrl,
+      const UriBuilder& batchUrl,
+      bool isContainerScoped,
+      const std::vector<BlobBatchOperation>& operations,
+      const Blobs::SubmitBlobBatchOptions& options);
+
+}}} // namespace Azure::Storage::Details
@@ -5,6 +5,7 @@
 
 #include "blob_options.hpp"
 #include "blob_responses.hpp"
+#include "common/random_access_reader.hpp"
 #include "common/storage_credential.hpp"
 #include "common/storage_uri_builder.hpp"
 #include "credentials/credentials.hpp"
@@ -13,6 +14,7 @@
 #include <map>
 #include <memory>
 #include <string>
+#include <vector>
 
 namespace Azure { namespace Storage { namespace Files { namespace DataLake {
   class DirectoryClient;
@@ -224,6 +226,46 @@ namespace Azure { namespace Storage { namespace Blobs {
     Azure::Core::Response<BlobDownloadResponse> Download(
         const DownloadBlobOptions& options = DownloadBlobOptions()) const;
 
+    /**
+     * @brief Downloads a blob or a blob range from the service as a stream read strictly in
+     * order, while the ranges after the one being read are downloaded in parallel.
+     *
+     * @param options Optional parameters to execute this function.
+     * @return A BlobDownloadResponse describing the downloaded blob.
+     * BlobDownloadResponse.BodyStream gives the blob's data, at most MaxChunksAhead + 1 chunks of
+     * ChunkSize bytes are held in memory.
+     * @remark The ranges are requested with the ETag of the first response, so the stream fails
+     * if the blob changes while it is read. Destroying the stream stops the downloads.
+     */
+    Azure::Core::Response<BlobDownloadResponse> OpenRead(
+        const OpenReadBlobOptions& options = OpenReadBlobOptions()) const;
+
+    /**
+     * @brief Opens a reader of the blob at arbitrary offsets, which caches the blocks it
+     * downloads and reads ahead once the reads are sequential.
+     *
+     * @param options Optional parameters to execute this function.
+     * @return A RandomAccessReader of the blob.
+     * @remark The blocks are requested with the ETag the blob has when the reader is opened, so
+     * the reads fail if the blob changes and the cache never mixes two versions of the blob.
+     */
+    std::unique_ptr<RandomAccessReader> OpenRandomAccessReader(
+        const OpenRandomAccessReaderOptions& options = OpenRandomAccessReaderOptions()) const;
+
+    /**
+     * @brief Downloads several ranges of a blob into their buffers. The ranges close to each
+     * other are merged into a single request, and the requests are issued in parallel.
+     *
+     * @param targets The ranges to download and their buffers.
+     * @param options Optional parameters to execute this function.
+     * @return A BlobDownloadInfo describing the downloaded blob.
+     * @remark The requests after the first one are made with the ETag of the first response, so
+     * the download fails if the blob changes meanwhile.
+     */
+    Azure::Core::Response<BlobDownloadInfo> DownloadRanges(
+        const std::vector<DownloadBlobRangeTarget>& targets,
+        const DownloadBlobRangesOptions& options = DownloadBlobRangesOptions()) const;
+
     /**
      * @brief Downloads a blob or a blob range from the service to a memory buffer using parallel
      * requests.
@@ -4,6 +4,7 @@
 #pragma once
 
 #include "blob_options.hpp"
+#include "blobs/blob_batch.hpp"
 #include "blobs/blob_client.hpp"
 #include "common/storage_credential.hpp"
 #include "common/storage_uri_builder.hpp"
@@ -203,14 +204,30 @@ namespace Azure { namespace Storage { namespace Blobs {
         const std::string& delimiter,
         const ListBlobsOptions& options = ListBlobsOptions()) const;
 
+    /**
+     * @brief Submits a batch of sub-requests to the service. Up to 256 sub-requests are packed
+     * into one multipart/mixed request, larger batches are split and sent in parallel.
+     *
+     * @param batch The batch of sub-requests to submit. All the sub-requests must target blobs in
+     * this container, std::invalid_argument is thrown before anything is sent otherwise.
+     * @param options Optional parameters to execute this function.
+     * @return A SubmitBlobBatchResult containing the result of each sub-request.
+     */
+    Azure::Core::Response<SubmitBlobBatchResult> SubmitBatch(
+        const BlobBatch& batch,
+        const SubmitBlobBatchOptions& options = SubmitBlobBatchOptions()) const;
+
   private:
     UriBuilder m_containerUrl;
     std::shared_ptr<Azure::Core::Http::HttpPipeline> m_pipeline;
+    std::shared_ptr<Azure::Core::Http::HttpPipeline> m_batchSubRequestPipeline;
 
     explicit BlobContainerClient(
         UriBuilder containerUri,
-        std::shared_ptr<Azure::Core::Http::HttpPipeline> pipeline)
-        : m_containerUrl(std::move(containerUri)), m_pipeline(std::move(pipeline))
+        std::shared_ptr<Azure::Core::Http::HttpPipeline> pipeline,
+        std::shared_ptr<Azure::Core::Http::HttpPipeline> batchSubRequestPipeline)
+        : m_containerUrl(std::move(containerUri)), m_pipeline(std::move(pipeline)),
+          m_batchSubRequestPipeline(std::move(batchSubRequestPipeline))
     {
     }
 
@@ -4,9 +4,13 @@
 #pragma once
 
 #include "common/access_conditions.hpp"
+#include "common/shared_block_cache.hpp"
+#include "common/transfer_tracer.hpp"
+#include "http/curl/curl.hpp"
 #include "protocol/blob_rest_client.hpp"
 
 #include <limits>
+#include <memory>
 #include <string>
 #include <utility>
 
@@ -87,6 +91,19 @@ namespace Azure { namespace Storage { namespace Blobs {
      * are applied to every retrial.
      */
     std::vector<std::unique_ptr<Azure::Core::Http::HttpPolicy>> PerRetryPolicies;
+
+    /**
+     * @brief Options of the retry policy. Unless a Budget is set, all the clients of the same
+     * account share one, so that their retries and back off are coordinated.
+     */
+    Azure::Core::Http::RetryOptions RetryOptions;
+
+    /**
+     * @brief The transport used to send requests. CurlHttp2Transport can be used to multiplex
+     * concurrent requests over a few HTTP/2 connections. Null uses a CurlTransport.
+     */
+    std::shared_ptr<Azure::Core::Http::HttpTransport> Transport
+        = std::make_shared<Azure::Core::Http::CurlTransport>();
   };
 
   /**
@@ -159,6 +176,24 @@ namespace Azure { namespace Storage { namespace Blobs {
     Azure::Core::Context Context;
   };
 
+  /**
+   * @brief Optional parameters for BlobServiceClient::SubmitBatch and
+   * BlobContainerClient::SubmitBatch.
+   */
+  struct SubmitBlobBatchOptions
+  {
+    /**
+     * @brief Context for cancelling long running operations.
+     */
+    Azure::Core::Context Context;
+
+    /**
+     * @brief The maximum number of batch requests that may be sent in parallel. A batch with more
+     * than 256 sub-requests is split into multiple batch requests.
+     */
+    int Concurrency = 1;
+  };
+
   /**
    * @brief Container client options used to initalize BlobContainerClient.
    */
@@ -175,6 +210,19 @@ namespace Azure { namespace Storage { namespace Blobs {
      * are applied to every retrial.
      */
     std::vector<std::unique_ptr<Azure::Core::Http::HttpPolicy>> PerRetryPolicies;
+
+    /**
+     * @brief Options of the retry policy. Unless a Budget is set, all the clients of the same
+     * account share one, so that their retries and back off are coordinated.
+     */
+    Azure::Core::Http::RetryOptions RetryOptions;
+
+    /**
+     * @brief The transport used to send requests. CurlHttp2Transport can be used to multiplex
+     * concurrent requests over a few HTTP/2 connections. Null uses a CurlTransport.
+     */
+    std::shared_ptr<Azure::Core::Http::HttpTransport> Transport
+        = std::make_shared<Azure::Core::Http::CurlTransport>();
   };
 
   /**
@@ -300,6 +348,19 @@ namespace Azure { namespace Storage { namespace Blobs {
      * are applied to every retrial.
      */
     std::vector<std::unique_ptr<Azure::Core::Http::HttpPolicy>> PerRetryPolicies;
+
+    /**
+     * @brief Options of the retry policy. Unless a Budget is set, all the clients of the same
+     * account share one, so that their retries and back off are coordinated.
+     */
+    Azure::Core::Http::RetryOptions RetryOptions;
+
+    /**
+     * @brief The transport used to send requests. CurlHttp2Transport can be used to multiplex
+     * concurrent requests over a few HTTP/2 connections. Null uses a CurlTransport.
+     */
+    std::shared_ptr<Azure::Core::Http::HttpTransport> Transport
+        = std::make_shared<Azure::Core::Http::CurlTransport>();
   };
 
   /**
@@ -511,6 +572,44 @@ namespace Azure { namespace Storage { namespace Blobs {
      * @brief The maximum number of threads that may be used in a parallel transfer.
      */
     int Concurrency = 1;
+
+    /**
+     * @brief The maximum number of downloaded bytes DownloadToFile queues for writing to the file
+     * in the background before the downloads wait for the disk. Null means two 4 MiB buffers per
+     * thread.
+     */
+    Azure::Core::Nullable<int64_t> MaxFileWriteBehind;
+
+    /**
+     * @brief If true, DownloadToFile allocates the whole file once the size of the blob is known,
+     * so that the chunks landing in any order don't fragment it.
+     */
+    bool PreallocateFile = false;
+
+    /**
+     * @brief If true, DownloadToFile writes the chunks bypassing the page cache, with O_DIRECT or
+     * FILE_FLAG_NO_BUFFERING, if the file system supports it.
+     */
+    bool DirectFileWrite = false;
+
+    /**
+     * @brief If true, DownloadToFile writes back the data landed in the file and evicts it from
+     * the page cache, so that large downloads don't push out the rest of the cache.
+     */
+    bool DropFileCache = false;
+
+    /**
+     * @brief Records the phases of each chunk of the transfer when set, see TransferTracer.
+     */
+    std::shared_ptr<TransferTracer> Tracer;
+
+    /**
+     * @brief Downloads the blob block by block through this cache when set, so that the
+     * processes of the host sharing it download the blocks of a version of the blob once while
+     * they stay cached. The requests are of the block size of the cache: InitialChunkSize,
+     * ChunkSize, DirectFileWrite, MaxFileWriteBehind and DropFileCache are ignored.
+     */
+    std::shared_ptr<SharedBlockCache> BlockCache;
   };
 
   /**
@@ -518,6 +617,135 @@ namespace Azure { namespace Storage { namespace Blobs {
    */
   using DownloadBlobToFileOptions = DownloadBlobToBufferOptions;
 
+  /**
+   * @brief Optional parameters for BlobClient::OpenRead.
+   */
+  struct OpenReadBlobOptions
+  {
+    /**
+     * @brief Context for cancelling long running operations.
+     */
+    Azure::Core::Context Context;
+
+    /**
+     * @brief Downloads only the bytes of the blob from this offset.
+     */
+    Azure::Core::Nullable<int64_t> Offset;
+
+    /**
+     * @brief Returns at most this number of bytes of the blob from the offset. Null means
+     * download until the end.
+     */
+    Azure::Core::Nullable<int64_t> Length;
+
+    /**
+     * @brief The number of bytes of each range request. Null means 4 MiB.
+     */
+    Azure::Core::Nullable<int64_t> ChunkSize;
+
+    /**
+     * @brief The maximum number of threads downloading the chunks after the one being read, no
+     * more than MaxChunksAhead are used.
+     */
+    int Concurrency = 1;
+
+    /**
+     * @brief The maximum number of chunks downloaded ahead of the one being read, at least 1,
+     * which bounds the memory used. Null means two per thread.
+     */
+    Azure::Core::Nullable<int> MaxChunksAhead;
+
+    /**
+     * @brief Optional conditions that must be met to perform this operation.
+     */
+    BlobAccessConditions AccessConditions;
+  };
+
+  /**
+   * @brief Optional parameters for BlobClient::OpenRandomAccessReader.
+   */
+  struct OpenRandomAccessReaderOptions
+  {
+    /**
+     * @brief Context for cancelling long running operations.
+     */
+    Azure::Core::Context Context;
+
+    /**
+     * @brief The number of bytes of the blocks requested and cached. Null means 1 MiB.
+     */
+    Azure::Core::Nullable<int64_t> BlockSize;
+
+    /**
+     * @brief The maximum number of blocks kept in the cache. Null means 64.
+     */
+    Azure::Core::Nullable<int> MaxCachedBlocks;
+
+    /**
+     * @brief The number of blocks downloaded in the background once the reads are sequential,
+     * 0 disables the read-ahead. Null means 4.
+     */
+    Azure::Core::Nullable<int> ReadAheadBlocks;
+
+    /**
+     * @brief Optional conditions that must be met to perform this operation.
+     */
+    BlobAccessConditions AccessConditions;
+  };
+
+  /**
+   * @brief A range of a blob and the buffer it is downloaded to, for BlobClient::DownloadRanges.
+   */
+  struct DownloadBlobRangeTarget
+  {
+    /**
+     * @brief Offset of the range in the blob.
+     */
+    int64_t Offset = 0;
+
+    /**
+     * @brief Length of the range, it must end within the blob.
+     */
+    int64_t Length = 0;
+
+    /**
+     * @brief Buffer of at least Length bytes the range is downloaded to.
+     */
+    uint8_t* Buffer = nullptr;
+  };
+
+  /**
+   * @brief Optional parameters for BlobClient::DownloadRanges.
+   */
+  struct DownloadBlobRangesOptions
+  {
+    /**
+     * @brief Context for cancelling long running operations.
+     */
+    Azure::Core::Context Context;
+
+    /**
+     * @brief Ranges separated by at most this number of bytes are downloaded with a single
+     * request, the bytes between them are discarded. Null means 256 KiB.
+     */
+    Azure::Core::Nullable<int64_t> MaxGapSize;
+
+    /**
+     * @brief Ranges are merged into requests of at most this number of bytes. Null means 16 MiB.
+     */
+    Azure::Core::Nullable<int64_t> MaxRequestSize;
+
+    /**
+     * @brief The maximum number of threads that may be used in a parallel transfer.
+     */
+    int Concurrency = 1;
+
+    /**
+     * @brief Optional conditions that must be met to perform this operation.
+     */
+    BlobAccessConditions AccessConditions;
+  };
+
   /**
    * @brief Optional parameters for BlobClient::CreateSnapshot.
    */
@@ -622,7 +850,8 @@ namespace Azure { namespace Storage { namespace Blobs {
   };
 
   /**
-   * @brief Optional parameters for BlockBlobClient::UploadFromBuffer.
+   * @brief Optional parameters for BlockBlobClient::UploadFromBuffer,
+   * BlockBlobClient::UploadFromFile and BlockBlobClient::UploadFromStream.
    */
   struct UploadBlobOptions
   {
@@ -648,6 +877,10 @@ namespace Azure { namespace Storage { namespace Blobs {
 
     /**
      * @brief The maximum number of bytes in a single request.
+     *
+     * @remark A blob has at most 50,000 blocks. Without a chunk size, uploads of a known length
+     * use blocks large enough, but a stream of unknown length is uploaded in 8 MiB blocks, at most
+     * about 390 GiB. UploadFromStream fails before staging a block past the limit.
      */
     Azure::Core::Nullable<int64_t> ChunkSize;
 
@@ -655,6 +888,24 @@ namespace Azure { namespace Storage { namespace Blobs {
      * @brief The maximum number of threads that may be used in a parallel transfer.
      */
     int Concurrency = 1;
+
+    /**
+     * @brief The number of blocks UploadFromFile reads from the file in the background ahead of
+     * the requests sending them. 0 sends the blocks straight from the file.
+     */
+    int FileReadAhead = 0;
+
+    /**
+     * @brief If true, UploadFromFile maps the file into memory and sends the blocks from the
+     * mapping, without reading them into buffers, asking the kernel to read ahead the blocks sent
+     * next. FileReadAhead is then ignored.
+     */
+    bool MapFile = false;
+
+    /**
+     * @brief Records the phases of each chunk of the transfer when set, see TransferTracer.
+     */
+    std::shared_ptr<TransferTracer> Tracer;
   };
 
   /**
@@ -4,6 +4,7 @@
 #pragma once
 
 #include "blob_options.hpp"
+#include "blobs/blob_batch.hpp"
 #include "blobs/blob_container_client.hpp"
 #include "common/storage_credential.hpp"
 #include "common/storage_uri_builder.hpp"
@@ -152,8 +153,22 @@ namespace Azure { namespace Storage { namespace Blobs {
     Azure::Core::Response<BlobServiceProperties> GetProperties(
         const GetBlobServicePropertiesOptions& options = GetBlobServicePropertiesOptions()) const;
 
+    /**
+     * @brief Submits a batch of sub-requests to the service. Up to 256 sub-requests are packed
+     * into one multipart/mixed request, larger batches are split and sent in parallel.
+     *
+     * @param batch The batch of sub-requests to submit. The sub-requests may target blobs in
+     * different containers.
+     * @param options Optional parameters to execute this function.
+     * @return A SubmitBlobBatchResult containing the result of each sub-request.
+     */
+    Azure::Core::Response<SubmitBlobBatchResult> SubmitBatch(
+        const BlobBatch& batch,
+        const SubmitBlobBatchOptions& options = SubmitBlobBatchOptions()) const;
+
   protected:
     UriBuilder m_serviceUrl;
     std::shared_ptr<Azure::Core::Http::HttpPipeline> m_pipeline;
+    std::shared_ptr<Azure::Core::Http::HttpPipeline> m_batchSubRequestPipeline;
   };
 }}} // namespace Azure::Storage::Blobs
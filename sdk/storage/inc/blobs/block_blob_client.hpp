@@ -144,6 +144,23 @@ namespace Azure { namespace Storage { namespace Blobs {
         const std::string& file,
         const UploadBlobOptions& options = UploadBlobOptions()) const;
 
+    /**
+     * @brief Creates a new block blob, or updates the content of an existing block blob. Updating
+     * an existing block blob overwrites any existing metadata on the blob.
+     *
+     * @param content A BodyStream containing the content to upload, read sequentially until its
+     * end. Its length doesn't need to be known, as for a pipe or data produced on the fly.
+     * @param options Optional parameters to execute this function.
+     * @return A BlobContentInfo describing the state of the updated block blob.
+     * @remark The stream is read into blocks of ChunkSize bytes, which are staged in parallel
+     * while the next ones are read, and committed at the end of the stream. At most Concurrency
+     * blocks are held in memory. A blob has at most 50000 blocks, so ChunkSize must be set for
+     * streams of unknown length larger than 50000 blocks of the default size of 8MB.
+     */
+    Azure::Core::Response<BlobContentInfo> UploadFromStream(
+        Azure::Core::Http::BodyStream* content,
+        const UploadBlobOptions& options = UploadBlobOptions()) const;
+
     /**
      * @brief Creates a new block as part of a block blob's staging area to be eventually
      * committed via the CommitBlockList operation.
@@ -851,6 +851,11 @@ namespace Azure { namespace Storage { namespace Blobs {
   {
   }; // struct SetServicePropertiesInfo
 
+  struct SubmitBlobBatchResultInternal
+  {
+    std::string ContentType;
+  }; // struct SubmitBlobBatchResultInternal
+
   struct UndeleteBlobInfo
   {
   }; // struct UndeleteBlobInfo
@@ -1238,6 +1243,44 @@ namespace Azure { namespace Storage { namespace Blobs {
             std::move(response), std::move(pHttpResponse));
       }
 
+      struct SubmitBatchOptions
+      {
+        Azure::Core::Nullable<int32_t> Timeout;
+        std::string ContentType;
+      }; // struct SubmitBatchOptions
+
+      static Azure::Core::Response<SubmitBlobBatchResultInternal> SubmitBatch(
+          Azure::Core::Context context,
+          Azure::Core::Http::HttpPipeline& pipeline,
+          const std::string& url,
+          Azure::Core::Http::BodyStream* requestBody,
+          const SubmitBatchOptions& options)
+      {
+        auto request
+            = Azure::Core::Http::Request(Azure::Core::Http::HttpMethod::Post, url, requestBody);
+        request.AddHeader("Content-Length", std::to_string(requestBody->Length()));
+        request.AddQueryParameter("comp", "batch");
+        request.AddHeader("x-ms-version", c_APIVersion);
+        if (options.Timeout.HasValue())
+        {
+          request.AddQueryParameter("timeout", std::to_string(options.Timeout.GetValue()));
+        }
+        request.AddHeader("Content-Type", options.ContentType);
+        auto pHttpResponse = pipeline.Send(context, request);
+        Azure::Core::Http::RawResponse& httpResponse = *pHttpResponse;
+        SubmitBlobBatchResultInternal response;
+        auto http_status_code
+            = static_cast<std::underlying_type<Azure::Core::Http::HttpStatusCode>::type>(
+                httpResponse.GetStatusCode());
+        if (!(http_status_code == 202))
+        {
+          throw StorageError::CreateFromResponse(context, std::move(pHttpResponse));
+        }
+        response.ContentType = httpResponse.GetHeaders().at("content-type");
+        return Azure::Core::Response<SubmitBlobBatchResultInternal>(
+            std::move(response), std::move(pHttpResponse));
+      }
+
     private:
       static BlobServiceProperties BlobServicePropertiesFromXml(XmlReader& reader)
       {
@@ -2686,6 +2729,45 @@ namespace Azure { namespace Storage { namespace Blobs {
             std::move(response), std::move(pHttpResponse));
       }
 
+      struct SubmitBatchOptions
+      {
+        Azure::Core::Nullable<int32_t> Timeout;
+        std::string ContentType;
+      }; // struct SubmitBatchOptions
+
+      static Azure::Core::Response<SubmitBlobBatchResultInternal> SubmitBatch(
+          Azure::Core::Context context,
+          Azure::Core::Http::HttpPipeline& pipeline,
+          const std::string& url,
+          Azure::Core::Http::BodyStream* requestBody,
+          const SubmitBatchOptions& options)
+      {
+        auto request
+            = Azure::Core::Http::Request(Azure::Core::Http::HttpMethod::Post, url, requestBody);
+        request.AddHeader("Content-Length", std::to_string(requestBody->Length()));
+        request.AddQueryParameter("restype", "container");
+        request.AddQueryParameter("comp", "batch");
+        request.AddHeader("x-ms-version", c_APIVersion);
+        if (options.Timeout.HasValue())
+        {
+          request.AddQueryParameter("timeout", std::to_string(options.Timeout.GetValue()));
+        }
+        request.AddHeader("Content-Type", options.ContentType);
+        auto pHttpResponse = pipeline.Send(context, request);
+        Azure::Core::Http::RawResponse& httpResponse = *pHttpResponse;
+        SubmitBlobBatchResultInternal response;
+        auto http_status_code
+            = static_cast<std::underlying_type<Azure::Core::Http::HttpStatusCode>::type>(
+                httpResponse.GetStatusCode());
+        if (!(http_status_code == 202))
+        {
+          throw StorageError::CreateFromResponse(context, std::move(pHttpResponse));
+        }
+        response.ContentType = httpResponse.GetHeaders().at("content-type");
+        return Azure::Core::Response<SubmitBlobBatchResultInternal>(
+            std::move(response), std::move(pHttpResponse));
+      }
+
     private:
       static BlobsFlatSegment BlobsFlatSegmentFromXml(XmlReader& reader)
       {
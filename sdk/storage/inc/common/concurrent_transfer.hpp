@@ -3,10 +3,22 @@
 
 #pragma once
 
+#include "common/transfer_tracer.hpp"
+#include "context.hpp"
+#include "http/body_stream.hpp"
+#include "http/buffer_pool.hpp"
+#include "metrics.hpp"
+
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <cstdlib>
+#include <deque>
+#include <exception>
 #include <functional>
 #include <future>
+#include <mutex>
+#include <vector>
 
 namespace Azure { namespace Storage { namespace Details {
 
@@ -16,13 +28,18 @@ namespace Azure { namespace Storage { namespace Details {
       int64_t chunkSize,
       int concurrency,
       // offset, length, chunk id, number of chunks
-      std::function<void(int64_t, int64_t, int64_t, int64_t)> transferFunc)
+      std::function<void(int64_t, int64_t, int64_t, int64_t)> transferFunc,
+      TransferTracer* tracer = nullptr)
   {
+    static auto& activeChunks = Azure::Core::Metrics::MetricsRegistry::GetDefault().GetGauge(
+        "azure_storage_transfer_active_chunks", "Number of chunks being transferred.");
+
     std::atomic<int> numWorkingThreads{concurrency};
     std::atomic<int> nextChunkId{0};
     std::atomic<bool> failed{false};
 
     const auto numChunks = (length + chunkSize - 1) / chunkSize;
+    const auto transferStart = std::chrono::steady_clock::now();
 
     auto threadFunc = [&]() {
       while (true)
@@ -34,12 +51,36 @@ namespace Azure { namespace Storage { namespace Details {
         }
         int64_t chunkOffset = offset + chunkSize * chunkId;
         int64_t chunkLength = std::min(length - chunkSize * chunkId, chunkSize);
+        activeChunks.Add(1);
+        auto chunkStart = std::chrono::steady_clock::now();
+        if (tracer)
+        {
+          tracer->RecordSpan(
+              TransferSpanKind::Queued,
+              chunkId,
+              chunkOffset,
+              chunkLength,
+              transferStart,
+              chunkStart);
+        }
         try
         {
           transferFunc(chunkOffset, chunkLength, chunkId, numChunks);
+          activeChunks.Subtract(1);
+          if (tracer)
+          {
+            tracer->RecordSpan(
+                TransferSpanKind::Chunk,
+                chunkId,
+                chunkOffset,
+                chunkLength,
+                chunkStart,
+                std::chrono::steady_clock::now());
+          }
         }
         catch (std::exception&)
         {
+          activeChunks.Subtract(1);
           if (failed.exchange(true) == false)
           {
             numWorkingThreads.fetch_sub(1);
@@ -67,4 +108,173 @@ namespace Azure { namespace Storage { namespace Details {
     }
   }
 
+  /**
+   * @brief Reads a stream of unknown length sequentially, chunk by chunk, into buffers of the
+   * default buffer pool, and hands each chunk to transferFunc on one of concurrency threads while
+   * the next ones are read. At most concurrency buffers exist at a time, the stream isn't read
+   * further while they are all in use. Returns the number of chunks, 0 for an empty stream.
+   */
+  inline int64_t ConcurrentStreamTransfer(
+      Azure::Core::Context& context,
+      Azure::Core::Http::BodyStream& stream,
+      int64_t chunkSize,
+      int concurrency,
+      // data, length, offset, chunk id
+      std::function<void(const uint8_t*, int64_t, int64_t, int64_t)> transferFunc,
+      TransferTracer* tracer = nullptr)
+  {
+    static auto& activeChunks = Azure::Core::Metrics::MetricsRegistry::GetDefault().GetGauge(
+        "azure_storage_transfer_active_chunks", "Number of chunks being transferred.");
+
+    struct Chunk
+    {
+      Azure::Core::Http::PooledBuffer Buffer;
+      int64_t Offset = 0;
+      int64_t Length = 0;
+      int64_t Id = 0;
+      std::chrono::steady_clock::time_point ReadAt;
+    };
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::deque<Chunk> readChunks;
+    int buffersInUse = 0;
+    bool endOfStream = false;
+    std::exception_ptr error;
+
+    auto threadFunc = [&]() {
+      while (true)
+      {
+        Chunk chunk;
+        {
+          std::unique_lock<std::mutex> lock(mutex);
+          cv.wait(lock, [&]() { return !readChunks.empty() || endOfStream || error; });
+          if (error || readChunks.empty())
+          {
+            return;
+          }
+          chunk = std::move(readChunks.front());
+          readChunks.pop_front();
+        }
+        activeChunks.Add(1);
+        auto chunkStart = std::chrono::steady_clock::now();
+        if (tracer)
+        {
+          tracer->RecordSpan(
+              TransferSpanKind::Queued,
+              chunk.Id,
+              chunk.Offset,
+              chunk.Length,
+              chunk.ReadAt,
+              chunkStart);
+        }
+        try
+        {
+          transferFunc(chunk.Buffer.Data(), chunk.Length, chunk.Offset, chunk.Id);
+        }
+        catch (std::exception&)
+        {
+          activeChunks.Subtract(1);
+          std::lock_guard<std::mutex> guard(mutex);
+          if (!error)
+          {
+            error = std::current_exception();
+          }
+          cv.notify_all();
+          return;
+        }
+        activeChunks.Subtract(1);
+        if (tracer)
+        {
+          tracer->RecordSpan(
+              TransferSpanKind::Chunk,
+              chunk.Id,
+              chunk.Offset,
+              chunk.Length,
+              chunkStart,
+              std::chrono::steady_clock::now());
+        }
+        chunk.Buffer.Reset();
+        {
+          std::lock_guard<std::mutex> guard(mutex);
+          --buffersInUse;
+        }
+        cv.notify_all();
+      }
+    };
+
+    std::vector<std::future<void>> threadHandles;
+    for (int i = 0; i < concurrency; ++i)
+    {
+      threadHandles.emplace_back(std::async(std::launch::async, threadFunc));
+    }
+
+    int64_t offset = 0;
+    int64_t numChunks = 0;
+    try
+    {
+      while (true)
+      {
+        {
+          std::unique_lock<std::mutex> lock(mutex);
+          cv.wait(lock, [&]() { return buffersInUse < concurrency || error; });
+          if (error)
+          {
+            break;
+          }
+          ++buffersInUse;
+        }
+        Chunk chunk;
+        chunk.Buffer
+            = Azure::Core::Http::BufferPool::GetDefault().AcquireWithinBudget(context, chunkSize);
+        chunk.Offset = offset;
+        chunk.Length = Azure::Core::Http::BodyStream::ReadToCount(
+            context, stream, chunk.Buffer.Data(), chunkSize);
+        chunk.Id = numChunks;
+        chunk.ReadAt = std::chrono::steady_clock::now();
+        if (chunk.Length == 0)
+        {
+          std::lock_guard<std::mutex> guard(mutex);
+          --buffersInUse;
+          break;
+        }
+        offset += chunk.Length;
+        ++numChunks;
+        bool lastChunk = chunk.Length < chunkSize;
+        {
+          std::lock_guard<std::mutex> guard(mutex);
+          readChunks.push_back(std::move(chunk));
+        }
+        cv.notify_all();
+        if (lastChunk)
+        {
+          break;
+        }
+      }
+    }
+    catch (std::exception&)
+    {
+      std::lock_guard<std::mutex> guard(mutex);
+      if (!error)
+      {
+        error = std::current_exception();
+      }
+    }
+
+    {
+      std::lock_guard<std::mutex> guard(mutex);
+      endOfStream = true;
+    }
+    cv.notify_all();
+    for (auto& handle : threadHandles)
+    {
+      handle.get();
+    }
+    if (error)
+    {
+      std::rethrow_exception(error);
+    }
+    return numChunks;
+  }
+
 }}} // namespace Azure::Storage::Details
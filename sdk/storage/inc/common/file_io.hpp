@@ -33,18 +33,72 @@ namespace Azure { namespace Storage { namespace Details {
     int64_t m_fileSize;
   };
 
+  /**
+   * @brief Maps a file read from into memory, so its content can be sent without copying it.
+   */
+  class FileMapping {
+  public:
+    explicit FileMapping(const FileReader& reader);
+
+    ~FileMapping();
+
+    const uint8_t* GetData() const { return m_data; }
+
+    int64_t GetSize() const { return m_size; }
+
+    /**
+     * @brief Hints the kernel that the range of the file will be read soon, so it reads it ahead.
+     */
+    void WillNeed(int64_t offset, int64_t length) const;
+
+  private:
+    const uint8_t* m_data = nullptr;
+    int64_t m_size;
+#ifdef _WIN32
+    HANDLE m_mapping = NULL;
+#endif
+  };
+
+  /**
+   * @brief Alignment of the offset, length and memory of direct writes.
+   */
+  constexpr int64_t c_directIoAlignment = 4096;
+
   class FileWriter {
   public:
-    FileWriter(const std::string& filename);
+    /**
+     * @brief Creates or truncates the file. With directIo, the writes aligned to
+     * c_directIoAlignment bypass the page cache if the file system supports it.
+     */
+    FileWriter(const std::string& filename, bool directIo = false);
 
     ~FileWriter();
 
     FileHandle GetHandle() const { return m_handle; }
 
+    /**
+     * @brief Returns the handle to write length bytes at offset from memory aligned to
+     * c_directIoAlignment, the direct handle if the write is aligned.
+     */
+    FileHandle GetHandle(int64_t offset, int64_t length) const;
+
     void Write(const uint8_t* buffer, int64_t length, int64_t offset);
 
+    /**
+     * @brief Allocates the blocks of the file up to size, so that writes at any offset don't
+     * fragment it and running out of space fails early.
+     */
+    void Preallocate(int64_t size);
+
   private:
     FileHandle m_handle;
+    FileHandle m_directHandle;
   };
 
+  /**
+   * @brief Writes back the range of the file and evicts it from the page cache, so that large
+   * writes don't push out the rest of the cache.
+   */
+  void DropFileCache(FileHandle handle, int64_t offset, int64_t length);
+
 }}} // namespace Azure::Storage::Details
@@ -0,0 +1,199 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "common/file_io.hpp"
+#include "context.hpp"
+#include "http/buffer_pool.hpp"
+
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace Azure { namespace Storage { namespace Details {
+
+  /**
+   * @brief Reads and writes files in the background, so the threads transferring chunks don't
+   * wait for the disk.
+   *
+   * @remark The engine owns a fixed number of buffers of the same size, which bounds the bytes
+   * being read or written. A buffer is acquired, queued for a read or a write, and released once
+   * the data read is consumed or when the write completes. Queued operations are handed to the
+   * kernel in a batch by Submit. On Linux the engine uses io_uring with the buffers registered,
+   * elsewhere or if io_uring isn't available, a pool of threads doing pread and pwrite. The
+   * buffers are aligned to c_directIoAlignment for direct writes, and taken from the default
+   * Azure::Core::Http::BufferPool within its budget.
+   */
+  class FileIoEngine {
+  public:
+    /**
+     * @brief Creates an engine with bufferCount buffers of bufferSize bytes, using io_uring if
+     * useIoUring is true and the kernel supports it. Waits for the budget of the buffer pool to
+     * allow the buffers, context cancels the wait.
+     */
+    static std::unique_ptr<FileIoEngine> Create(
+        int bufferCount,
+        int64_t bufferSize,
+        bool useIoUring = true,
+        Azure::Core::Context context = Azure::Core::Context());
+
+    virtual ~FileIoEngine();
+
+    virtual bool UsesIoUring() const = 0;
+
+    int64_t GetBufferSize() const { return m_bufferSize; }
+
+    /**
+     * @brief Waits for a free buffer. Throws if a write queued before failed.
+     */
+    uint8_t* AcquireBuffer();
+
+    /**
+     * @brief Acquires a free buffer if there is one, returns nullptr otherwise.
+     */
+    uint8_t* TryAcquireBuffer();
+
+    /**
+     * @brief Releases a buffer acquired or read into.
+     */
+    void ReleaseBuffer(uint8_t* buffer);
+
+    /**
+     * @brief Queues a read of length bytes of the file at offset into an acquired buffer, see
+     * WaitRead.
+     */
+    void QueueRead(FileHandle handle, uint8_t* buffer, int64_t length, int64_t offset);
+
+    /**
+     * @brief Queues a write of length bytes of an acquired buffer to the file at offset. The
+     * buffer is released when the write completes, after the range is written back and evicted
+     * from the page cache if dropCache is true, see DropFileCache.
+     */
+    void QueueWrite(
+        FileHandle handle,
+        uint8_t* buffer,
+        int64_t length,
+        int64_t offset,
+        bool dropCache = false);
+
+    /**
+     * @brief Starts the operations queued so far.
+     */
+    void Submit();
+
+    /**
+     * @brief Waits for the read into buffer and returns the number of bytes read, less than
+     * requested at the end of the file. The buffer stays acquired. Throws if the read failed.
+     */
+    int64_t WaitRead(uint8_t* buffer);
+
+    /**
+     * @brief Waits for the queued writes. Throws if one of them failed.
+     */
+    void Flush();
+
+  protected:
+    struct Operation
+    {
+      bool Write = false;
+      bool DropCache = false;
+      FileHandle Handle;
+      int BufferIndex = 0;
+      int64_t Offset = 0;
+      int64_t Length = 0;
+      // Bytes transferred so far, operations are resumed after short reads and writes.
+      int64_t Done = 0;
+    };
+
+    FileIoEngine(int bufferCount, int64_t bufferSize, Azure::Core::Context& context);
+
+    int GetBufferCount() const { return static_cast<int>(m_states.size()); }
+    uint8_t* GetBuffer(int index) const { return m_buffers + index * m_bufferStride; }
+
+    /**
+     * @brief Starts operations, called without the lock of the engine held.
+     */
+    virtual void Start(std::vector<Operation> operations) = 0;
+
+    /**
+     * @brief Called by the implementations when an operation completes, error is 0 on success.
+     */
+    void Complete(const Operation& operation, int error);
+
+    /**
+     * @brief Waits for all the operations started, for the destructors of the implementations.
+     */
+    void WaitIdle();
+
+  private:
+    enum class BufferState
+    {
+      Free,
+      Acquired,
+      Reading,
+      Read,
+      Writing,
+    };
+
+    int GetBufferIndex(uint8_t* buffer) const;
+    uint8_t* AcquireFreeBuffer();
+    void Queue(Operation operation, BufferState state);
+
+    int64_t m_bufferSize;
+    int64_t m_bufferStride;
+    Azure::Core::Http::PooledBuffer m_storage;
+    uint8_t* m_buffers;
+
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::vector<BufferState> m_states;
+    // Bytes read or error of the last read into each buffer.
+    std::vector<int64_t> m_readBytes;
+    std::vector<int> m_readErrors;
+    std::vector<Operation> m_queued;
+    int m_pendingOperations = 0;
+    int m_writeError = 0;
+  };
+
+  /**
+   * @brief Reads the chunks of a file ahead of the threads of a ConcurrentTransfer consuming
+   * them in order, the engine having a buffer of the chunk size for every thread and chunk read
+   * ahead.
+   */
+  class FileReadAhead {
+  public:
+    FileReadAhead(
+        FileIoEngine& engine,
+        FileHandle handle,
+        int64_t offset,
+        int64_t length,
+        int64_t chunkSize,
+        int readAhead);
+
+    ~FileReadAhead();
+
+    /**
+     * @brief Waits for the data of the chunk, queueing its read and the reads of the chunks after
+     * it if needed. The buffer must be given back to Release.
+     */
+    uint8_t* Acquire(int64_t chunkId);
+
+    void Release(uint8_t* buffer) { m_engine.ReleaseBuffer(buffer); }
+
+  private:
+    FileIoEngine& m_engine;
+    FileHandle m_handle;
+    int64_t m_offset;
+    int64_t m_length;
+    int64_t m_chunkSize;
+    int m_readAhead;
+
+    std::mutex m_mutex;
+    int64_t m_nextChunkId = 0;
+    std::vector<uint8_t*> m_chunkBuffers;
+  };
+
+}}} // namespace Azure::Storage::Details
@@ -0,0 +1,144 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "common/read_ahead_stream.hpp"
+#include "context.hpp"
+#include "http/buffer_pool.hpp"
+
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Azure { namespace Storage {
+
+  /**
+   * @brief Options used to construct a RandomAccessReader.
+   */
+  struct RandomAccessReaderOptions
+  {
+    /**
+     * @brief The number of bytes of the blocks requested and cached.
+     */
+    int64_t BlockSize = 1024 * 1024;
+
+    /**
+     * @brief The maximum number of blocks kept in the cache, which bounds the memory used to
+     * MaxCachedBlocks x BlockSize, plus the blocks being downloaded.
+     */
+    int MaxCachedBlocks = 64;
+
+    /**
+     * @brief The number of blocks downloaded in the background after a sequential read, 0
+     * disables the read-ahead.
+     */
+    int ReadAheadBlocks = 4;
+
+    /**
+     * @brief The number of reads in a row each starting where the previous one ended after
+     * which the reads are considered sequential and the next blocks are read ahead.
+     */
+    int SequentialReadsBeforeReadAhead = 2;
+  };
+
+  /**
+   * @brief Reads a resource at arbitrary offsets, like pread, through an LRU cache of fixed size
+   * blocks. It is made for the small reads at scattered offsets of the columnar formats, such as
+   * a footer followed by the column chunks.
+   *
+   * @remark The blocks missing for a read are requested together, the adjacent ones with a single
+   * range request. Concurrent reads of a block being downloaded wait for that download instead of
+   * requesting it again. Reads are thread-safe.
+   */
+  class RandomAccessReader {
+  public:
+    /**
+     * @brief Constructs a reader of a resource of size bytes.
+     *
+     * @param size Size of the resource.
+     * @param options Size of the blocks, of the cache and of the read-ahead.
+     * @param rangeGetter Gets the body of a range of the resource.
+     * @param context Context of the read-ahead requests, they are also canceled with it.
+     */
+    explicit RandomAccessReader(
+        int64_t size,
+        RandomAccessReaderOptions options,
+        Details::RangeGetter rangeGetter,
+        Azure::Core::Context context);
+
+    RandomAccessReader(const RandomAccessReader&) = delete;
+    RandomAccessReader& operator=(const RandomAccessReader&) = delete;
+    ~RandomAccessReader();
+
+    /**
+     * @brief Size of the resource.
+     */
+    int64_t GetSize() const { return m_size; }
+
+    /**
+     * @brief Reads at most count bytes from offset into buffer.
+     *
+     * @param context A context to cancel the read.
+     * @param offset Offset of the first byte read.
+     * @param buffer Buffer of at least count bytes.
+     * @param count Number of bytes to read.
+     * @return The number of bytes read, less than count only at the end of the resource.
+     */
+    int64_t ReadAt(Azure::Core::Context& context, int64_t offset, uint8_t* buffer, int64_t count);
+
+  private:
+    struct Block
+    {
+      Azure::Core::Http::PooledBuffer Buffer;
+      int64_t Length = 0;
+      bool Ready = false;
+      std::exception_ptr Error;
+      // Set with Ready if the reader downloading the block was canceled, the readers waiting for
+      // it request it again.
+      bool Canceled = false;
+    };
+
+    struct CacheEntry
+    {
+      std::shared_ptr<Block> Data;
+      std::list<int64_t>::iterator LruPosition;
+    };
+
+    // Inserts a block being downloaded, to be downloaded by the caller. The lock must be held.
+    std::shared_ptr<Block> InsertBlock(int64_t blockId);
+    // Returns the cached block, or inserts it, and whether the caller downloads it. The lock must
+    // be held.
+    std::shared_ptr<Block> GetBlock(int64_t blockId, bool& download);
+    // Downloads the blocks of the adjacent ids from firstBlockId with one range request.
+    void DownloadBlocks(
+        Azure::Core::Context& context,
+        int64_t firstBlockId,
+        const std::vector<std::shared_ptr<Block>>& blocks);
+    void ReadAhead();
+
+    int64_t m_size;
+    RandomAccessReaderOptions m_options;
+    Details::RangeGetter m_rangeGetter;
+    Azure::Core::Context m_context;
+
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::map<int64_t, CacheEntry> m_blocks;
+    // Ids of the cached blocks, the most recently used first.
+    std::list<int64_t> m_lru;
+    int64_t m_lastReadEnd = -1;
+    int m_sequentialReads = 0;
+    // Blocks to read ahead, already inserted in the cache.
+    std::map<int64_t, std::shared_ptr<Block>> m_readAheadQueue;
+    bool m_stopped = false;
+    std::thread m_readAheadThread;
+  };
+
+}} // namespace Azure::Storage
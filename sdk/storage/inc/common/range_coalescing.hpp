@@ -0,0 +1,36 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace Azure { namespace Storage { namespace Details {
+
+  /**
+   * @brief A range requested for one or more of the ranges given to CoalesceRanges.
+   */
+  struct CoalescedRange
+  {
+    int64_t Offset = 0;
+    int64_t Length = 0;
+    // Indices of the ranges covered, by offset.
+    std::vector<std::size_t> Ranges;
+    // Whether some of the ranges covered overlap.
+    bool Overlapping = false;
+  };
+
+  /**
+   * @brief Merges the (offset, length) ranges separated by at most maxGap bytes into ranges of at
+   * most maxLength bytes, in order of offset. A range longer than maxLength is requested alone,
+   * empty ranges are left out.
+   */
+  std::vector<CoalescedRange> CoalesceRanges(
+      const std::vector<std::pair<int64_t, int64_t>>& ranges,
+      int64_t maxGap,
+      int64_t maxLength);
+
+}}} // namespace Azure::Storage::Details
@@ -0,0 +1,120 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "context.hpp"
+#include "http/body_stream.hpp"
+#include "http/buffer_pool.hpp"
+
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Azure { namespace Storage { namespace Details {
+
+  /**
+   * @brief Function used by a ReadAheadStream to get a body stream of the length bytes of the
+   * resource at the given offset.
+   */
+  using RangeGetter = std::function<std::unique_ptr<Azure::Core::Http::BodyStream>(
+      Azure::Core::Context& context,
+      int64_t offset,
+      int64_t length)>;
+
+  /**
+   * @brief Options used to construct a ReadAheadStream.
+   */
+  struct ReadAheadStreamOptions
+  {
+    /**
+     * @brief The number of bytes of each range request.
+     */
+    int64_t ChunkSize = 4 * 1024 * 1024;
+
+    /**
+     * @brief The number of threads getting ranges in parallel. There are no more threads than
+     * MaxChunksAhead, the others would have no chunk to get.
+     */
+    int Concurrency = 1;
+
+    /**
+     * @brief The maximum number of chunks read ahead of the one being consumed, at least 1. The
+     * memory used is bounded by (MaxChunksAhead + 1) x ChunkSize, the chunk being consumed and
+     * the ones after it.
+     */
+    int MaxChunksAhead = 2;
+  };
+
+  /**
+   * @brief A BodyStream that gives the bytes of a range of a resource strictly in order, while
+   * the chunks after the one being read are downloaded in parallel into buffers of the default
+   * Azure::Core::Http::BufferPool.
+   *
+   * @remark The first chunk is read from the body of the response that started the download, as
+   * it arrives. The threads getting the other chunks are stopped, and their requests canceled,
+   * when the stream is destroyed.
+   */
+  class ReadAheadStream : public Azure::Core::Http::BodyStream {
+  public:
+    /**
+     * @brief Constructs a stream of the length bytes of the resource from offset.
+     *
+     * @param firstChunk The body of the first min(ChunkSize, length) bytes.
+     * @param offset Offset of the range in the resource.
+     * @param length Length of the range.
+     * @param options Size of the chunks and how many are read ahead.
+     * @param rangeGetter Gets the body of the other chunks.
+     * @param context Context of the range requests, they are also canceled with it.
+     */
+    explicit ReadAheadStream(
+        std::unique_ptr<Azure::Core::Http::BodyStream> firstChunk,
+        int64_t offset,
+        int64_t length,
+        ReadAheadStreamOptions options,
+        RangeGetter rangeGetter,
+        Azure::Core::Context context);
+
+    ~ReadAheadStream() override;
+
+    int64_t Length() const override { return m_length; }
+
+    int64_t Read(Azure::Core::Context& context, uint8_t* buffer, int64_t count) override;
+
+  private:
+    struct Chunk
+    {
+      Azure::Core::Http::PooledBuffer Buffer;
+      int64_t Length = 0;
+      bool Ready = false;
+      std::exception_ptr Error;
+    };
+
+    void FetchChunks();
+
+    std::unique_ptr<Azure::Core::Http::BodyStream> m_firstChunk;
+    int64_t m_offset;
+    int64_t m_length;
+    ReadAheadStreamOptions m_options;
+    RangeGetter m_rangeGetter;
+    Azure::Core::Context m_context;
+    int64_t m_numChunks;
+
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    // Bytes given to the reader so far.
+    int64_t m_position = 0;
+    // Chunks being downloaded or not consumed yet, by chunk id.
+    std::map<int64_t, Chunk> m_chunks;
+    int64_t m_nextChunkId = 1;
+    bool m_stopped = false;
+    std::vector<std::thread> m_threads;
+  };
+
+}}} // namespace Azure::Storage::Details
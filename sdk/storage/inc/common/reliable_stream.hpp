@@ -0,0 +1,72 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "http/body_stream.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+namespace Azure { namespace Storage { namespace Details {
+
+  /**
+   * @brief Function used by a ReliableStream to get a new body stream that continues from the
+   * given offset (the number of bytes already consumed from the original stream) after a read
+   * from the current stream failed.
+   */
+  using HttpGetter = std::function<std::unique_ptr<Azure::Core::Http::BodyStream>(
+      Azure::Core::Context& context,
+      int64_t offset)>;
+
+  /**
+   * @brief Options used to construct a ReliableStream.
+   */
+  struct ReliableStreamOptions
+  {
+    /**
+     * @brief The maximum number of times the stream is re-opened after a failed read, over the
+     * whole life of the stream. This budget is independent from the retries done by the
+     * RetryPolicy while getting the response.
+     */
+    int MaxRetryRequests = 3;
+
+    /**
+     * @brief Delay before the stream is re-opened the first time, doubled on each retry up to
+     * MaxRetryDelay.
+     */
+    std::chrono::milliseconds RetryDelay = std::chrono::milliseconds(200);
+    std::chrono::milliseconds MaxRetryDelay = std::chrono::seconds(4);
+  };
+
+  /**
+   * @brief A BodyStream that wraps a network stream and, when reading from it fails, transparently
+   * gets a new stream for the remaining bytes and keeps reading from there.
+   */
+  class ReliableStream : public Azure::Core::Http::BodyStream {
+  public:
+    explicit ReliableStream(
+        std::unique_ptr<Azure::Core::Http::BodyStream> inner,
+        ReliableStreamOptions options,
+        HttpGetter httpGetter)
+        : m_inner(std::move(inner)), m_length(m_inner->Length()), m_options(std::move(options)),
+          m_httpGetter(std::move(httpGetter))
+    {
+    }
+
+    int64_t Length() const override { return m_length; }
+
+    int64_t Read(Azure::Core::Context& context, uint8_t* buffer, int64_t count) override;
+
+  private:
+    std::unique_ptr<Azure::Core::Http::BodyStream> m_inner;
+    int64_t m_length;
+    ReliableStreamOptions m_options;
+    HttpGetter m_httpGetter;
+    int64_t m_offset = 0;
+    int m_retries = 0;
+  };
+
+}}} // namespace Azure::Storage::Details
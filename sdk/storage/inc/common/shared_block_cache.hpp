@@ -0,0 +1,101 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace Azure { namespace Storage {
+
+  /**
+   * @brief Options used to create a SharedBlockCache.
+   */
+  struct SharedBlockCacheOptions
+  {
+    /**
+     * @brief The number of bytes of each block.
+     */
+    int64_t BlockSize = 4 * 1024 * 1024;
+
+    /**
+     * @brief The number of blocks of the cache, its shared memory takes about BlockCount x
+     * BlockSize bytes.
+     */
+    int64_t BlockCount = 64;
+  };
+
+  /**
+   * @brief A cache of blob blocks in a named shared memory segment, so that the processes of a
+   * host reading the same blobs download each block once.
+   *
+   * @remark The blocks are keyed by the URL and the ETag of their blob and their index, a changed
+   * blob never hits the blocks of its previous version. The cache is 8-way set associative with
+   * CLOCK replacement in each set. Lookups don't take any lock: every slot has a sequence number,
+   * odd while the slot is written, and a lookup that raced with a write is a miss. The first
+   * process opening a name creates the segment with its options, the others use the geometry
+   * of the segment. On POSIX systems the segment lives until it is removed with Remove, even when
+   * no process has it open, on Windows until the last process closes it.
+   *
+   * A process dying while it writes a slot leaves the slot odd, it is taken over by the next
+   * insert into its set after 30 seconds; a process suspended that long in the middle of a write
+   * could then corrupt the block written by the other one. A process dying after creating the
+   * segment and before initializing it leaves a segment the next process opening the name
+   * replaces, after waiting 5 seconds for it.
+   */
+  class SharedBlockCache {
+  public:
+    /**
+     * @brief Opens the cache with the given name, creating it if it doesn't exist.
+     *
+     * @param name Name of the shared memory segment, made of letters, digits, '-' and '_'.
+     * @param options Geometry of the cache if it is created.
+     */
+    explicit SharedBlockCache(
+        const std::string& name,
+        const SharedBlockCacheOptions& options = SharedBlockCacheOptions());
+
+    SharedBlockCache(const SharedBlockCache&) = delete;
+    SharedBlockCache& operator=(const SharedBlockCache&) = delete;
+    ~SharedBlockCache();
+
+    /**
+     * @brief Removes the cache with the given name. The processes having it open keep using it,
+     * the next ones to open the name create a new one.
+     */
+    static void Remove(const std::string& name);
+
+    int64_t GetBlockSize() const { return m_blockSize; }
+
+    int64_t GetBlockCount() const { return m_blockCount; }
+
+    /**
+     * @brief Copies the block blockId of the blob with the given key to buffer if it is cached
+     * with length bytes.
+     *
+     * @return Whether the block was found.
+     */
+    bool Lookup(const std::string& key, int64_t blockId, uint8_t* buffer, int64_t length);
+
+    /**
+     * @brief Caches the length bytes of the block blockId of the blob with the given key, in
+     * place of a block not used recently. Does nothing if the block is cached already, or if
+     * the slot chosen is written by another process meanwhile.
+     */
+    void Insert(const std::string& key, int64_t blockId, const uint8_t* data, int64_t length);
+
+  private:
+    // Returns false, with nothing mapped, if an existing segment isn't initialized in time.
+    bool TryOpen(const std::string& segmentName, int64_t blockSize, int64_t blockCount);
+    void Unmap();
+
+    // The file mapping object on Windows.
+    void* m_handle = nullptr;
+    void* m_mapping = nullptr;
+    std::size_t m_mappingSize = 0;
+    int64_t m_blockSize = 0;
+    int64_t m_blockCount = 0;
+  };
+
+}} // namespace Azure::Storage
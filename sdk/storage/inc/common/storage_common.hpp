@@ -3,8 +3,23 @@
 
 #pragma once
 
+#include "http/policy.hpp"
+
+#include <memory>
+#include <string>
+
 namespace Azure { namespace Storage {
 
   template <class... T> void unused(T&&...) {}
 
+  namespace Details {
+    /**
+     * @brief Creates the retry policy of a storage client. Unless options has a Budget, the one
+     * shared by the blob and dfs endpoints of the account is used.
+     */
+    std::unique_ptr<Azure::Core::Http::HttpPolicy> CreateRetryPolicy(
+        Azure::Core::Http::RetryOptions options,
+        const std::string& host);
+  } // namespace Details
+
 }} // namespace Azure::Storage
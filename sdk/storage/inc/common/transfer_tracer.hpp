@@ -0,0 +1,132 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "http/http.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace Azure { namespace Storage {
+
+  /**
+   * @brief Phases of the transfer of a chunk recorded by a TransferTracer.
+   */
+  enum class TransferSpanKind
+  {
+    /**
+     * @brief From the start of the transfer to a worker thread picking the chunk up.
+     */
+    Queued,
+    /**
+     * @brief Whole transfer of the chunk by a worker thread.
+     */
+    Chunk,
+    /**
+     * @brief Failed attempts of the request of the chunk and the back off between them.
+     */
+    Retry,
+    /**
+     * @brief Name lookup, connect and TLS handshake of a new connection.
+     */
+    Connect,
+    /**
+     * @brief Sending the request, including its body for uploads.
+     */
+    RequestSend,
+    /**
+     * @brief From the end of the request to the first byte of the response.
+     */
+    TimeToFirstByte,
+    /**
+     * @brief Reading the body of the response.
+     */
+    Body,
+    /**
+     * @brief Waiting for the data downloaded to be written to the destination file.
+     */
+    FileWrite,
+    /**
+     * @brief Waiting for the data of an upload to be read from the source file.
+     */
+    FileRead,
+  };
+
+  /**
+   * @brief Records the phases of the chunks of parallel transfers and exports them as a Chrome
+   * trace, which chrome://tracing or Perfetto show as one timeline per worker thread.
+   *
+   * @remark Spans are written to a fixed size ring buffer without taking a lock, the oldest ones
+   * are overwritten once it is full. A tracer can be shared by several transfers.
+   */
+  class TransferTracer {
+  public:
+    /**
+     * @brief Construct a new TransferTracer.
+     *
+     * @param capacity Number of spans kept.
+     */
+    explicit TransferTracer(std::size_t capacity = 64 * 1024);
+
+    TransferTracer(const TransferTracer&) = delete;
+    TransferTracer& operator=(const TransferTracer&) = delete;
+
+    /**
+     * @brief Records a span of the chunk at offset. The initial request of a download, made
+     * before the chunks are transferred in parallel, has the chunk id -1.
+     */
+    void RecordSpan(
+        TransferSpanKind kind,
+        int64_t chunkId,
+        int64_t offset,
+        int64_t length,
+        std::chrono::steady_clock::time_point begin,
+        std::chrono::steady_clock::time_point end);
+
+    /**
+     * @brief Records the retry, connect, send and time to first byte spans of the request of a
+     * chunk from the timings of its response, received at headersReceived. The spans are
+     * approximate since the time spent in the other policies isn't measured.
+     */
+    void RecordResponse(
+        int64_t chunkId,
+        int64_t offset,
+        int64_t length,
+        Azure::Core::Http::RawResponse const& response,
+        std::chrono::steady_clock::time_point headersReceived);
+
+    /**
+     * @brief Returns the spans recorded as a Chrome trace in the JSON object format.
+     */
+    std::string ToChromeTrace() const;
+
+    /**
+     * @brief Writes the spans recorded as a Chrome trace to the file.
+     */
+    void WriteChromeTrace(const std::string& file) const;
+
+  private:
+    struct Span
+    {
+      // 2n + 1 while the n-th span is written to this slot, 2n + 2 once it is complete.
+      std::atomic<uint64_t> Sequence{0};
+      std::atomic<int> Kind{0};
+      std::atomic<int> ThreadId{0};
+      std::atomic<int64_t> ChunkId{0};
+      std::atomic<int64_t> Offset{0};
+      std::atomic<int64_t> Length{0};
+      std::atomic<int64_t> Begin{0};
+      std::atomic<int64_t> Duration{0};
+    };
+
+    std::chrono::steady_clock::time_point m_origin;
+    std::size_t m_capacity;
+    std::unique_ptr<Span[]> m_spans;
+    std::atomic<uint64_t> m_next{0};
+  };
+
+}} // namespace Azure::Storage
@@ -5,6 +5,7 @@
 
 #include "blobs/blob_options.hpp"
 #include "common/access_conditions.hpp"
+#include "http/curl/curl.hpp"
 #include "nullable.hpp"
 #include "protocol/datalake_rest_client.hpp"
 
@@ -25,6 +26,19 @@ namespace Azure { namespace Storage { namespace Files { namespace DataLake {
   {
     std::vector<std::unique_ptr<Azure::Core::Http::HttpPolicy>> PerOperationPolicies;
     std::vector<std::unique_ptr<Azure::Core::Http::HttpPolicy>> PerRetryPolicies;
+
+    /**
+     * @brief Options of the retry policy. Unless a Budget is set, all the clients of the same
+     * account share one, so that their retries and back off are coordinated.
+     */
+    Azure::Core::Http::RetryOptions RetryOptions;
+
+    /**
+     * @brief The transport used to send requests. CurlHttp2Transport can be used to multiplex
+     * concurrent requests over a few HTTP/2 connections. Null uses a CurlTransport.
+     */
+    std::shared_ptr<Azure::Core::Http::HttpTransport> Transport
+        = std::make_shared<Azure::Core::Http::CurlTransport>();
   };
 
   /**
@@ -34,6 +48,19 @@ namespace Azure { namespace Storage { namespace Files { namespace DataLake {
   {
     std::vector<std::unique_ptr<Azure::Core::Http::HttpPolicy>> PerOperationPolicies;
     std::vector<std::unique_ptr<Azure::Core::Http::HttpPolicy>> PerRetryPolicies;
+
+    /**
+     * @brief Options of the retry policy. Unless a Budget is set, all the clients of the same
+     * account share one, so that their retries and back off are coordinated.
+     */
+    Azure::Core::Http::RetryOptions RetryOptions;
+
+    /**
+     * @brief The transport used to send requests. CurlHttp2Transport can be used to multiplex
+     * concurrent requests over a few HTTP/2 connections. Null uses a CurlTransport.
+     */
+    std::shared_ptr<Azure::Core::Http::HttpTransport> Transport
+        = std::make_shared<Azure::Core::Http::CurlTransport>();
   };
 
   /**
@@ -43,6 +70,19 @@ namespace Azure { namespace Storage { namespace Files { namespace DataLake {
   {
     std::vector<std::unique_ptr<Azure::Core::Http::HttpPolicy>> PerOperationPolicies;
     std::vector<std::unique_ptr<Azure::Core::Http::HttpPolicy>> PerRetryPolicies;
+
+    /**
+     * @brief Options of the retry policy. Unless a Budget is set, all the clients of the same
+     * account share one, so that their retries and back off are coordinated.
+     */
+    Azure::Core::Http::RetryOptions RetryOptions;
+
+    /**
+     * @brief The transport used to send requests. CurlHttp2Transport can be used to multiplex
+     * concurrent requests over a few HTTP/2 connections. Null uses a CurlTransport.
+     */
+    std::shared_ptr<Azure::Core::Http::HttpTransport> Transport
+        = std::make_shared<Azure::Core::Http::CurlTransport>();
   };
 
   /**
@@ -651,7 +691,8 @@ namespace Azure { namespace Storage { namespace Files { namespace DataLake {
   using DirectoryCreateOptions = PathCreateOptions;
 
   /**
-   * @brief Optional parameters for FileClient::UploadFromBuffer and FileClient::UploadFromFile
+   * @brief Optional parameters for FileClient::UploadFromBuffer, FileClient::UploadFromFile and
+   * FileClient::UploadFromStream
    */
   struct UploadFileOptions
   {
@@ -679,6 +720,24 @@ namespace Azure { namespace Storage { namespace Files { namespace DataLake {
      * @brief The maximum number of threads that may be used in a parallel transfer.
      */
     int Concurrency = 1;
+
+    /**
+     * @brief The number of blocks UploadFromFile reads from the file in the background ahead of
+     * the requests sending them. 0 sends the blocks straight from the file.
+     */
+    int FileReadAhead = 0;
+
+    /**
+     * @brief If true, UploadFromFile maps the file into memory and sends the blocks from the
+     * mapping, without reading them into buffers, asking the kernel to read ahead the blocks sent
+     * next. FileReadAhead is then ignored.
+     */
+    bool MapFile = false;
+
+    /**
+     * @brief Records the phases of each chunk of the transfer when set, see TransferTracer.
+     */
+    std::shared_ptr<TransferTracer> Tracer;
   };
 
   /**
@@ -192,6 +192,20 @@ namespace Azure { namespace Storage { namespace Files { namespace DataLake {
         const std::string& file,
         const UploadFileOptions& options = UploadFileOptions()) const;
 
+    /**
+     * @brief Creates a new file, or updates the content of an existing file. Updating
+     * an existing file overwrites any existing metadata on the file.
+     * @param content A BodyStream containing the content to upload, read sequentially until its
+     * end. Its length doesn't need to be known.
+     * @param options Optional parameters to execute this function.
+     * @return Azure::Core::Response<FileContentInfo>
+     * @remark This request is sent to blob endpoint. At most Concurrency blocks of ChunkSize
+     * bytes are held in memory, see Blobs::BlockBlobClient::UploadFromStream.
+     */
+    Azure::Core::Response<FileContentInfo> UploadFromStream(
+        Azure::Core::Http::BodyStream* content,
+        const UploadFileOptions& options = UploadFileOptions()) const;
+
     /**
      * @brief Downloads a file or a file range from the service to a memory buffer using parallel
      * requests.
@@ -0,0 +1,406 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// SPDX-License-Identifier: MIT
+
+#include "blobs/blob_batch.hpp"
+
+#include "azure.hpp"
+#include "common/common_headers_request_policy.hpp"
+#include "common/concurrent_transfer.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <stdexcept>
+
+namespace Azure { namespace Storage { namespace Blobs {
+
+  int32_t BlobBatch::DeleteBlob(
+      const std::string& containerName,
+      const std::string& blobName,
+      const DeleteBlobOptions& options)
+  {
+    Details::BlobBatchOperation operation;
+    operation.Type = Details::BlobBatchOperationType::Delete;
+    operation.ContainerName = containerName;
+    operation.BlobName = blobName;
+    operation.DeleteOptions.DeleteSnapshots = options.DeleteSnapshots;
+    operation.DeleteOptions.LeaseId = options.AccessConditions.LeaseId;
+    operation.DeleteOptions.IfModifiedSince = options.AccessConditions.IfModifiedSince;
+    operation.DeleteOptions.IfUnmodifiedSince = options.AccessConditions.IfUnmodifiedSince;
+    operation.DeleteOptions.IfMatch = options.AccessConditions.IfMatch;
+    operation.DeleteOptions.IfNoneMatch = options.AccessConditions.IfNoneMatch;
+    m_operations.emplace_back(std::move(operation));
+    return m_numDeleteOperations++;
+  }
+
+  int32_t BlobBatch::SetBlobAccessTier(
+      const std::string& containerName,
+      const std::string& blobName,
+      AccessTier tier,
+      const SetAccessTierOptions& options)
+  {
+    Details::BlobBatchOperation operation;
+    operation.Type = Details::BlobBatchOperationType::SetAccessTier;
+    operation.ContainerName = containerName;
+    operation.BlobName = blobName;
+    operation.SetTierOptions.Tier = tier;
+    operation.SetTierOptions.RehydratePriority = options.RehydratePriority;
+    m_operations.emplace_back(std::move(operation));
+    return m_numSetAccessTierOperations++;
+  }
+
+}}} // namespace Azure::Storage::Blobs
+
+namespace Azure { namespace Storage { namespace Details {
+
+  namespace {
+    /*
+     * Last policy of the sub-request pipeline. Rather than sending the request, it returns a
+     * successful response whose body is the serialized, already authenticated, request.
+     */
+    class BlobBatchSubRequestPolicy : public Azure::Core::Http::HttpPolicy {
+    public:
+      ~BlobBatchSubRequestPolicy() override {}
+
+      std::unique_ptr<HttpPolicy> Clone() const override
+      {
+        return std::make_unique<BlobBatchSubRequestPolicy>(*this);
+      }
+
+      std::unique_ptr<Azure::Core::Http::RawResponse> Send(
+          Azure::Core::Context& ctx,
+          Azure::Core::Http::Request& request,
+          Azure::Core::Http::NextHttpPolicy nextHttpPolicy) const override
+      {
+        AZURE_UNREFERENCED_PARAMETER(ctx);
+        AZURE_UNREFERENCED_PARAMETER(nextHttpPolicy);
+        // Content-Length of 0 isn't part of the string to sign, so it's safe to add it after the
+        // sub-request was authenticated.
+        const auto& headers = request.GetHeaders();
+        if (headers.find("content-length") == headers.end())
+        {
+          request.AddHeader("Content-Length", "0");
+        }
+        std::string message = request.GetHTTPMessagePreBody();
+        auto response = std::make_unique<Azure::Core::Http::RawResponse>(
+            1, 1, Azure::Core::Http::HttpStatusCode::Accepted, "Accepted");
+        response->SetBody(std::vector<uint8_t>(message.begin(), message.end()));
+        return response;
+      }
+    };
+
+    std::string CreateBatchBoundary()
+    {
+      static thread_local std::mt19937_64 randomGenerator(std::random_device{}());
+      std::uniform_int_distribution<int> distribution(0, 15);
+      const char* hexDigits = "0123456789abcdef";
+      std::string boundary = "batch_";
+      for (int i = 0; i < 32; ++i)
+      {
+        if (i == 8 || i == 12 || i == 16 || i == 20)
+        {
+          boundary += '-';
+        }
+        boundary += hexDigits[distribution(randomGenerator)];
+      }
+      return boundary;
+    }
+
+    bool EqualsIgnoreCase(const std::string& lhs, const std::string& rhs)
+    {
+      return lhs.size() == rhs.size()
+          && std::equal(lhs.begin(), lhs.end(), rhs.begin(), [](char a, char b) {
+               return std::tolower(static_cast<unsigned char>(a))
+                   == std::tolower(static_cast<unsigned char>(b));
+             });
+    }
+
+    std::string GetBoundaryFromContentType(const std::string& contentType)
+    {
+      const std::string key = "boundary=";
+      auto pos = contentType.find(key);
+      if (pos == std::string::npos)
+      {
+        throw std::runtime_error("cannot find boundary in batch response content type");
+      }
+      pos += key.length();
+      auto end = contentType.find(';', pos);
+      std::string boundary = contentType.substr(
+          pos, end == std::string::npos ? std::string::npos : end - pos);
+      if (boundary.length() >= 2 && boundary.front() == '"' && boundary.back() == '"')
+      {
+        boundary = boundary.substr(1, boundary.length() - 2);
+      }
+      return boundary;
+    }
+
+    // Parses one part of a multipart/mixed batch response. Returns the Content-ID of the part, or
+    // -1 if the part doesn't have one.
+    int64_t ParseBatchResponsePart(
+        const std::string& part,
+        std::unique_ptr<Azure::Core::Http::RawResponse>& response)
+    {
+      const std::string lineBreak = "\r\n";
+      std::size_t pos = 0;
+      auto readLine = [&]() {
+        auto end = part.find(lineBreak, pos);
+        if (end == std::string::npos)
+        {
+          throw std::runtime_error("failed to parse batch response");
+        }
+        std::string line = part.substr(pos, end - pos);
+        pos = end + lineBreak.length();
+        return line;
+      };
+
+      // The part may start with the line break that ends the boundary line.
+      if (part.compare(0, lineBreak.length(), lineBreak) == 0)
+      {
+        pos = lineBreak.length();
+      }
+
+      int64_t contentId = -1;
+      for (std::string line = readLine(); !line.empty(); line = readLine())
+      {
+        auto colonPos = line.find(':');
+        if (colonPos != std::string::npos
+            && EqualsIgnoreCase(line.substr(0, colonPos), "Content-ID"))
+        {
+          auto value = line.substr(colonPos + 1);
+          const char* begin = value.c_str();
+          char* end = nullptr;
+          errno = 0;
+          contentId = std::strtoll(begin, &end, 10);
+          bool parsed = errno == 0 && end != begin && contentId >= 0;
+          if (!parsed || end[std::strspn(end, " \t")] != '\0')
+          {
+            throw std::runtime_error("failed to parse batch response Content-ID: " + value);
+          }
+        }
+      }
+
+      std::string statusLine = readLine();
+      int majorVersion = 0;
+      int minorVersion = 0;
+      int statusCode = 0;
+      int reasonPhraseOffset = 0;
+      if (std::sscanf(
+              statusLine.data(),
+              "HTTP/%d.%d %d %n",
+              &majorVersion,
+              &minorVersion,
+              &statusCode,
+              &reasonPhraseOffset)
+          < 3)
+      {
+        throw std::runtime_error("failed to parse batch response status line: " + statusLine);
+      }
+      response = std::make_unique<Azure::Core::Http::RawResponse>(
+          majorVersion,
+          minorVersion,
+          static_cast<Azure::Core::Http::HttpStatusCode>(statusCode),
+          statusLine.substr(reasonPhraseOffset));
+      for (std::string line = readLine(); !line.empty(); line = readLine())
+      {
+        response->AddHeader(line);
+      }
+
+      // The line break before the next boundary belongs to the boundary.
+      std::size_t bodyEnd = part.length();
+      if (bodyEnd >= pos + lineBreak.length()
+          && part.compare(bodyEnd - lineBreak.length(), lineBreak.length(), lineBreak) == 0)
+      {
+        bodyEnd -= lineBreak.length();
+      }
+      response->SetBody(std::vector<uint8_t>(part.begin() + pos, part.begin() + bodyEnd));
+      return contentId;
+    }
+  } // namespace
+
+  std::string CreateBlobBatchRequestBody(
+      const std::string& boundary,
+      const std::vector<std::vector<uint8_t>>& subRequests)
+  {
+    std::string body;
+    for (std::size_t i = 0; i < subRequests.size(); ++i)
+    {
+      body += "--" + boundary + "\r\n";
+      body += "Content-Type: application/http\r\n";
+      body += "Content-Transfer-Encoding: binary\r\n";
+      body += "Content-ID: " + std::to_string(i) + "\r\n";
+      body += "\r\n";
+      body.append(subRequests[i].begin(), subRequests[i].end());
+    }
+    body += "--" + boundary + "--\r\n";
+    return body;
+  }
+
+  std::vector<std::unique_ptr<Azure::Core::Http::RawResponse>> ParseBlobBatchResponse(
+      const std::string& contentType,
+      const std::vector<uint8_t>& body,
+      std::size_t numSubRequests)
+  {
+    std::vector<std::unique_ptr<Azure::Core::Http::RawResponse>> subResponses(numSubRequests);
+    const std::string responseString(body.begin(), body.end());
+    const std::string delimiter = "--" + GetBoundaryFromContentType(contentType);
+    std::size_t partIndex = 0;
+    auto pos = responseString.find(delimiter);
+    while (pos != std::string::npos)
+    {
+      pos += delimiter.length();
+      if (responseString.compare(pos, 2, "--") == 0)
+      {
+        break;
+      }
+      auto nextPos = responseString.find(delimiter, pos);
+      if (nextPos == std::string::npos)
+      {
+        throw std::runtime_error("failed to parse batch response");
+      }
+      std::unique_ptr<Azure::Core::Http::RawResponse> subResponse;
+      int64_t contentId
+          = ParseBatchResponsePart(responseString.substr(pos, nextPos - pos), subResponse);
+      auto index = contentId >= 0 ? static_cast<std::size_t>(contentId) : partIndex;
+      if (index >= numSubRequests)
+      {
+        throw std::runtime_error("unexpected Content-ID in batch response");
+      }
+      subResponses[index] = std::move(subResponse);
+      ++partIndex;
+      pos = nextPos;
+    }
+    for (const auto& subResponse : subResponses)
+    {
+      if (!subResponse)
+      {
+        throw std::runtime_error("batch response is missing sub-responses");
+      }
+    }
+    return subResponses;
+  }
+
+  std::shared_ptr<Azure::Core::Http::HttpPipeline> CreateBlobBatchSubRequestPipeline(
+      std::unique_ptr<Azure::Core::Http::HttpPolicy> authenticationPolicy)
+  {
+    std::vector<std::unique_ptr<Azure::Core::Http::HttpPolicy>> policies;
+    policies.emplace_back(std::make_unique<CommonHeadersRequestPolicy>());
+    if (authenticationPolicy)
+    {
+      policies.emplace_back(std::move(authenticationPolicy));
+    }
+    policies.emplace_back(std::make_unique<BlobBatchSubRequestPolicy>());
+    return std::make_shared<Azure::Core::Http::HttpPipeline>(std::move(policies));
+  }
+
+  Azure::Core::Response<Blobs::SubmitBlobBatchResult> SubmitBlobBatch(
+      Azure::Core::Http::HttpPipeline& pipeline,
+      Azure::Core::Http::HttpPipeline& subRequestPipeline,
+      const UriBuilder& serviceUrl,
+      const UriBuilder& batchUrl,
+      bool isContainerScoped,
+      const std::vector<BlobBatchOperation>& operations,
+      const Blobs::SubmitBlobBatchOptions& options)
+  {
+    if (operations.empty())
+    {
+      throw std::runtime_error("cannot submit an empty batch");
+    }
+
+    std::vector<std::unique_ptr<Azure::Core::Http::RawResponse>> subResponses(operations.size());
+    std::unique_ptr<Azure::Core::Http::RawResponse> firstBatchResponse;
+
+    auto submitFunc = [&](int64_t offset, int64_t length, int64_t chunkId, int64_t numChunks) {
+      AZURE_UNREFERENCED_PARAMETER(numChunks);
+      std::vector<std::vector<uint8_t>> subRequests;
+      subRequests.reserve(static_cast<std::size_t>(length));
+      for (int64_t i = 0; i < length; ++i)
+      {
+        const auto& operation = operations[static_cast<std::size_t>(offset + i)];
+        auto blobUrl = serviceUrl;
+        blobUrl.AppendPath(operation.ContainerName, true);
+        blobUrl.AppendPath(operation.BlobName, true);
+
+        std::unique_ptr<Azure::Core::Http::RawResponse> subRequest;
+        if (operation.Type == BlobBatchOperationType::Delete)
+        {
+          auto response = Blobs::BlobRestClient::Blob::Delete(
+              options.Context, subRequestPipeline, blobUrl.ToString(), operation.DeleteOptions);
+          subRequest = response.ExtractRawResponse();
+        }
+        else
+        {
+          auto response = Blobs::BlobRestClient::Blob::SetAccessTier(
+              options.Context, subRequestPipeline, blobUrl.ToString(), operation.SetTierOptions);
+          subRequest = response.ExtractRawResponse();
+        }
+        subRequests.emplace_back(std::move(subRequest->GetBody()));
+      }
+      const std::string boundary = CreateBatchBoundary();
+      const std::string body = CreateBlobBatchRequestBody(boundary, subRequests);
+
+      Azure::Core::Http::MemoryBodyStream bodyStream(
+          reinterpret_cast<const uint8_t*>(body.data()), body.length());
+      std::unique_ptr<Azure::Core::Http::RawResponse> batchResponse;
+      std::string contentType;
+      const std::string requestContentType = "multipart/mixed; boundary=" + boundary;
+      if (isContainerScoped)
+      {
+        Blobs::BlobRestClient::Container::SubmitBatchOptions protocolLayerOptions;
+        protocolLayerOptions.ContentType = requestContentType;
+        auto response = Blobs::BlobRestClient::Container::SubmitBatch(
+            options.Context, pipeline, batchUrl.ToString(), &bodyStream, protocolLayerOptions);
+        contentType = response->ContentType;
+        batchResponse = response.ExtractRawResponse();
+      }
+      else
+      {
+        Blobs::BlobRestClient::Service::SubmitBatchOptions protocolLayerOptions;
+        protocolLayerOptions.ContentType = requestContentType;
+        auto response = Blobs::BlobRestClient::Service::SubmitBatch(
+            options.Context, pipeline, batchUrl.ToString(), &bodyStream, protocolLayerOptions);
+        contentType = response->ContentType;
+        batchResponse = response.ExtractRawResponse();
+      }
+
+      auto batchSubResponses = ParseBlobBatchResponse(
+          contentType, batchResponse->GetBody(), static_cast<std::size_t>(length));
+      std::move(
+          batchSubResponses.begin(),
+          batchSubResponses.end(),
+          subResponses.begin() + static_cast<std::ptrdiff_t>(offset));
+
+      if (chunkId == 0)
+      {
+        firstBatchResponse = std::move(batchResponse);
+      }
+    };
+
+    ConcurrentTransfer(
+        0,
+        static_cast<int64_t>(operations.size()),
+        c_MaxBlobBatchSubRequests,
+        std::max(options.Concurrency, 1),
+        submitFunc);
+
+    Blobs::SubmitBlobBatchResult ret;
+    for (std::size_t i = 0; i < operations.size(); ++i)
+    {
+      if (operations[i].Type == BlobBatchOperationType::Delete)
+      {
+        ret.DeleteBlobResults.emplace_back(Blobs::DeleteBlobInfo(), std::move(subResponses[i]));
+      }
+      else
+      {
+        ret.SetBlobAccessTierResults.emplace_back(
+            Blobs::SetBlobAccessTierInfo(), std::move(subResponses[i]));
+      }
+    }
+    return Azure::Core::Response<Blobs::SubmitBlobBatchResult>(
+        std::move(ret), std::move(firstBatchResponse));
+  }
+
+}}} // namespace Azure::Storage::Details
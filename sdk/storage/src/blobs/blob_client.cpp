@@ -10,14 +10,121 @@
 #include "common/concurrent_transfer.hpp"
 #include "common/constants.hpp"
 #include "common/file_io.hpp"
+#include "common/file_io_engine.hpp"
+#include "common/range_coalescing.hpp"
+#include "common/read_ahead_stream.hpp"
+#include "common/reliable_stream.hpp"
 #include "common/shared_key_policy.hpp"
 #include "common/storage_common.hpp"
 #include "common/storage_version.hpp"
 #include "credentials/policy/policies.hpp"
 #include "http/curl/curl.hpp"
 
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <exception>
+#include <functional>
+#include <future>
+#include <limits>
+
 namespace Azure { namespace Storage { namespace Blobs {
 
+  namespace {
+    // Downloads the range of the blob given by options block by block through
+    // options.BlockCache, the blocks missing are downloaded and cached. The blob's properties
+    // give its ETag, which is part of the key of its blocks and pins their downloads.
+    // rangeSizeFunc gets the size of the range before any byte is given to writeFunc.
+    Azure::Core::Response<BlobDownloadInfo> DownloadThroughBlockCache(
+        const BlobClient& blobClient,
+        const DownloadBlobToBufferOptions& options,
+        const std::function<void(int64_t)>& rangeSizeFunc,
+        // data, length, offset in the range
+        const std::function<void(const uint8_t*, int64_t, int64_t)>& writeFunc)
+    {
+      auto& cache = *options.BlockCache;
+      GetBlobPropertiesOptions propertiesOptions;
+      propertiesOptions.Context = options.Context;
+      auto properties = blobClient.GetProperties(propertiesOptions);
+
+      int64_t blobSize = properties->ContentLength;
+      int64_t offset = options.Offset.HasValue() ? options.Offset.GetValue() : 0;
+      if (options.Offset.HasValue() && offset >= blobSize)
+      {
+        // Reported as the service reports it, without downloading anything.
+        StorageError error(
+            "416 The range specified is invalid for the current size of the resource.\n"
+            "InvalidRange");
+        error.StatusCode = Azure::Core::Http::HttpStatusCode::RangeNotSatisfiable;
+        error.ReasonPhrase = "The range specified is invalid for the current size of the resource.";
+        error.ErrorCode = "InvalidRange";
+        throw error;
+      }
+      int64_t rangeSize = blobSize - offset;
+      if (options.Length.HasValue())
+      {
+        rangeSize = std::min(rangeSize, options.Length.GetValue());
+      }
+      rangeSizeFunc(rangeSize);
+
+      auto uri = blobClient.GetUri();
+      auto key = uri.substr(0, uri.find('?')) + "\n" + properties->ETag;
+      DownloadBlobOptions blockOptions;
+      blockOptions.Context = options.Context;
+      blockOptions.AccessConditions.IfMatch = properties->ETag;
+      auto blockSize = cache.GetBlockSize();
+      auto firstBlockOffset = offset / blockSize * blockSize;
+      auto downloadBlockFunc = [&](int64_t blockOffset, int64_t blockLength, int64_t, int64_t) {
+        auto block = Azure::Core::Http::BufferPool::GetDefault().Acquire(blockLength);
+        auto blockId = blockOffset / blockSize;
+        if (!cache.Lookup(key, blockId, block.Data(), blockLength))
+        {
+          auto rangeOptions = blockOptions;
+          rangeOptions.Offset = blockOffset;
+          rangeOptions.Length = blockLength;
+          auto response = blobClient.Download(rangeOptions);
+          if (Azure::Core::Http::BodyStream::ReadToCount(
+                  rangeOptions.Context, *response->BodyStream, block.Data(), blockLength)
+              != blockLength)
+          {
+            throw std::runtime_error("error when reading body stream");
+          }
+          cache.Insert(key, blockId, block.Data(), blockLength);
+        }
+        auto begin = std::max(blockOffset, offset);
+        auto end = std::min(blockOffset + blockLength, offset + rangeSize);
+        writeFunc(block.Data() + (begin - blockOffset), end - begin, begin - offset);
+      };
+      // Every process splits a blob into the same blocks, the last one ending with the blob.
+      auto blocksEnd
+          = std::min(blobSize, (offset + rangeSize + blockSize - 1) / blockSize * blockSize);
+      if (rangeSize > 0)
+      {
+        Details::ConcurrentTransfer(
+            firstBlockOffset,
+            blocksEnd - firstBlockOffset,
+            blockSize,
+            options.Concurrency,
+            downloadBlockFunc,
+            options.Tracer.get());
+      }
+
+      BlobDownloadInfo ret;
+      ret.ETag = std::move(properties->ETag);
+      ret.LastModified = std::move(properties->LastModified);
+      ret.ContentLength = rangeSize;
+      ret.HttpHeaders = std::move(properties->HttpHeaders);
+      ret.Metadata = std::move(properties->Metadata);
+      ret.BlobType = properties->BlobType;
+      ret.ServerEncrypted = std::move(properties->ServerEncrypted);
+      ret.EncryptionKeySHA256 = std::move(properties->EncryptionKeySHA256);
+      return Azure::Core::Response<BlobDownloadInfo>(
+          std::move(ret),
+          std::make_unique<Azure::Core::Http::RawResponse>(
+              std::move(properties.GetRawResponse())));
+    }
+  } // namespace
+
   BlobClient BlobClient::CreateFromConnectionString(
       const std::string& connectionString,
       const std::string& containerName,
@@ -52,16 +159,14 @@ namespace Azure { namespace Storage { namespace Blobs {
     {
       policies.emplace_back(p->Clone());
     }
-    policies.emplace_back(
-        std::make_unique<Azure::Core::Http::RetryPolicy>(Azure::Core::Http::RetryOptions()));
+    policies.emplace_back(Details::CreateRetryPolicy(options.RetryOptions, m_blobUrl.GetHost()));
     for (const auto& p : options.PerRetryPolicies)
     {
       policies.emplace_back(p->Clone());
     }
     policies.emplace_back(std::make_unique<CommonHeadersRequestPolicy>());
     policies.emplace_back(std::make_unique<SharedKeyPolicy>(credential));
-    policies.emplace_back(std::make_unique<Azure::Core::Http::TransportPolicy>(
-        std::make_shared<Azure::Core::Http::CurlTransport>()));
+    policies.emplace_back(std::make_unique<Azure::Core::Http::TransportPolicy>(options.Transport));
     m_pipeline = std::make_shared<Azure::Core::Http::HttpPipeline>(policies);
   }
 
@@ -78,8 +183,7 @@ namespace Azure { namespace Storage { namespace Blobs {
     {
       policies.emplace_back(p->Clone());
     }
-    policies.emplace_back(
-        std::make_unique<Azure::Core::Http::RetryPolicy>(Azure::Core::Http::RetryOptions()));
+    policies.emplace_back(Details::CreateRetryPolicy(options.RetryOptions, m_blobUrl.GetHost()));
     for (const auto& p : options.PerRetryPolicies)
     {
       policies.emplace_back(p->Clone());
@@ -88,8 +192,7 @@ namespace Azure { namespace Storage { namespace Blobs {
     policies.emplace_back(
         std::make_unique<Core::Credentials::Policy::BearerTokenAuthenticationPolicy>(
             credential, Details::c_StorageScope));
-    policies.emplace_back(std::make_unique<Azure::Core::Http::TransportPolicy>(
-        std::make_shared<Azure::Core::Http::CurlTransport>()));
+    policies.emplace_back(std::make_unique<Azure::Core::Http::TransportPolicy>(options.Transport));
     m_pipeline = std::make_shared<Azure::Core::Http::HttpPipeline>(policies);
   }
 
@@ -103,15 +206,13 @@ namespace Azure { namespace Storage { namespace Blobs {
     {
       policies.emplace_back(p->Clone());
     }
-    policies.emplace_back(
-        std::make_unique<Azure::Core::Http::RetryPolicy>(Azure::Core::Http::RetryOptions()));
+    policies.emplace_back(Details::CreateRetryPolicy(options.RetryOptions, m_blobUrl.GetHost()));
     for (const auto& p : options.PerRetryPolicies)
     {
       policies.emplace_back(p->Clone());
     }
     policies.emplace_back(std::make_unique<CommonHeadersRequestPolicy>());
-    policies.emplace_back(std::make_unique<Azure::Core::Http::TransportPolicy>(
-        std::make_shared<Azure::Core::Http::CurlTransport>()));
+    policies.emplace_back(std::make_unique<Azure::Core::Http::TransportPolicy>(options.Transport));
     m_pipeline = std::make_shared<Azure::Core::Http::HttpPipeline>(policies);
   }
 
@@ -156,8 +257,314 @@ namespace Azure { namespace Storage { namespace Blobs {
     protocolLayerOptions.IfMatch = options.AccessConditions.IfMatch;
     protocolLayerOptions.IfNoneMatch = options.AccessConditions.IfNoneMatch;
 
-    return BlobRestClient::Blob::Download(
+    auto downloadResponse = BlobRestClient::Blob::Download(
         options.Context, *m_pipeline, m_blobUrl.ToString(), protocolLayerOptions);
+
+    // If reading the body fails half way, resume from where it stopped with a new ranged request
+    // pinned to the ETag of the first response, so that a blob changed in between is detected.
+    auto retryOptions = protocolLayerOptions;
+    retryOptions.IfMatch = downloadResponse->ETag;
+    auto httpGetter = [pipeline = m_pipeline,
+                       blobUrl = m_blobUrl.ToString(),
+                       retryOptions = std::move(retryOptions)](
+                          Azure::Core::Context& context,
+                          int64_t offset) -> std::unique_ptr<Azure::Core::Http::BodyStream> {
+      auto newOptions = retryOptions;
+      if (newOptions.Range.HasValue())
+      {
+        newOptions.Range = std::make_pair(
+            newOptions.Range.GetValue().first + offset, newOptions.Range.GetValue().second);
+      }
+      else
+      {
+        newOptions.Range = std::make_pair(offset, std::numeric_limits<int64_t>::max());
+      }
+      auto newResponse = BlobRestClient::Blob::Download(context, *pipeline, blobUrl, newOptions);
+      return std::move(newResponse->BodyStream);
+    };
+    downloadResponse->BodyStream = std::make_unique<Details::ReliableStream>(
+        std::move(downloadResponse->BodyStream), Details::ReliableStreamOptions(), httpGetter);
+    return downloadResponse;
+  }
+
+  Azure::Core::Response<BlobDownloadResponse> BlobClient::OpenRead(
+      const OpenReadBlobOptions& options) const
+  {
+    constexpr int64_t c_defaultChunkSize = 4 * 1024 * 1024;
+
+    Details::ReadAheadStreamOptions streamOptions;
+    streamOptions.ChunkSize
+        = options.ChunkSize.HasValue() ? options.ChunkSize.GetValue() : c_defaultChunkSize;
+    streamOptions.Concurrency = options.Concurrency;
+    streamOptions.MaxChunksAhead = options.MaxChunksAhead.HasValue()
+        ? options.MaxChunksAhead.GetValue()
+        : 2 * options.Concurrency;
+
+    // The first chunk tells the size of the blob and its ETag, the other chunks are pinned to it.
+    int64_t offset = options.Offset.HasValue() ? options.Offset.GetValue() : 0;
+    DownloadBlobOptions firstChunkOptions;
+    firstChunkOptions.Context = options.Context;
+    firstChunkOptions.Offset = offset;
+    firstChunkOptions.Length = options.Length.HasValue()
+        ? std::min(streamOptions.ChunkSize, options.Length.GetValue())
+        : streamOptions.ChunkSize;
+    firstChunkOptions.AccessConditions = options.AccessConditions;
+    std::unique_ptr<Azure::Core::Response<BlobDownloadResponse>> firstChunk;
+    try
+    {
+      firstChunk = std::make_unique<Azure::Core::Response<BlobDownloadResponse>>(
+          Download(firstChunkOptions));
+    }
+    catch (StorageError& e)
+    {
+      // An empty blob has no range to request.
+      if (e.StatusCode != Azure::Core::Http::HttpStatusCode::RangeNotSatisfiable
+          || options.Offset.HasValue())
+      {
+        throw;
+      }
+      firstChunkOptions.Offset.Reset();
+      firstChunkOptions.Length.Reset();
+      return Download(firstChunkOptions);
+    }
+    auto& response = *firstChunk;
+
+    const auto& contentRange = response->ContentRange.GetValue();
+    int64_t blobSize = std::stoll(contentRange.substr(contentRange.find('/') + 1));
+    int64_t length = blobSize - offset;
+    if (options.Length.HasValue())
+    {
+      length = std::min(length, options.Length.GetValue());
+    }
+
+    DownloadBlobOptions chunkOptions;
+    chunkOptions.AccessConditions.LeaseId = options.AccessConditions.LeaseId;
+    chunkOptions.AccessConditions.IfMatch = response->ETag;
+    auto rangeGetter = [blobClient = *this, chunkOptions](
+                           Azure::Core::Context& context,
+                           int64_t chunkOffset,
+                           int64_t chunkLength) {
+      auto rangeOptions = chunkOptions;
+      rangeOptions.Context = context;
+      rangeOptions.Offset = chunkOffset;
+      rangeOptions.Length = chunkLength;
+      return std::move(blobClient.Download(rangeOptions)->BodyStream);
+    };
+    response->BodyStream = std::make_unique<Details::ReadAheadStream>(
+        std::move(response->BodyStream),
+        offset,
+        length,
+        streamOptions,
+        rangeGetter,
+        options.Context);
+    if (options.Offset.HasValue())
+    {
+      response->ContentRange = "bytes " + std::to_string(offset) + "-"
+          + std::to_string(offset + length - 1) + "/" + std::to_string(blobSize);
+    }
+    else
+    {
+      response->ContentRange.Reset();
+    }
+    // The hashes are the ones of the first chunk.
+    response->ContentMD5.Reset();
+    response->ContentCRC64.Reset();
+    return std::move(response);
+  }
+
+  std::unique_ptr<RandomAccessReader> BlobClient::OpenRandomAccessReader(
+      const OpenRandomAccessReaderOptions& options) const
+  {
+    RandomAccessReaderOptions readerOptions;
+    if (options.BlockSize.HasValue())
+    {
+      readerOptions.BlockSize = options.BlockSize.GetValue();
+    }
+    if (options.MaxCachedBlocks.HasValue())
+    {
+      readerOptions.MaxCachedBlocks = options.MaxCachedBlocks.GetValue();
+    }
+    if (options.ReadAheadBlocks.HasValue())
+    {
+      readerOptions.ReadAheadBlocks = options.ReadAheadBlocks.GetValue();
+    }
+
+    GetBlobPropertiesOptions propertiesOptions;
+    propertiesOptions.Context = options.Context;
+    propertiesOptions.AccessConditions = options.AccessConditions;
+    auto properties = GetProperties(propertiesOptions);
+
+    DownloadBlobOptions blockOptions;
+    blockOptions.AccessConditions.LeaseId = options.AccessConditions.LeaseId;
+    blockOptions.AccessConditions.IfMatch = properties->ETag;
+    auto rangeGetter = [blobClient = *this, blockOptions](
+                           Azure::Core::Context& context, int64_t offset, int64_t length) {
+      auto rangeOptions = blockOptions;
+      rangeOptions.Context = context;
+      rangeOptions.Offset = offset;
+      rangeOptions.Length = length;
+      return std::move(blobClient.Download(rangeOptions)->BodyStream);
+    };
+    return std::make_unique<RandomAccessReader>(
+        properties->ContentLength, readerOptions, rangeGetter, options.Context);
+  }
+
+  Azure::Core::Response<BlobDownloadInfo> BlobClient::DownloadRanges(
+      const std::vector<DownloadBlobRangeTarget>& targets,
+      const DownloadBlobRangesOptions& options) const
+  {
+    constexpr int64_t c_defaultMaxGapSize = 256 * 1024;
+    constexpr int64_t c_defaultMaxRequestSize = 16 * 1024 * 1024;
+    constexpr int64_t c_gapBufferSize = 64 * 1024;
+
+    std::vector<std::pair<int64_t, int64_t>> ranges;
+    for (const auto& target : targets)
+    {
+      ranges.emplace_back(target.Offset, target.Length);
+    }
+    auto requests = Details::CoalesceRanges(
+        ranges,
+        options.MaxGapSize.HasValue() ? options.MaxGapSize.GetValue() : c_defaultMaxGapSize,
+        options.MaxRequestSize.HasValue() ? options.MaxRequestSize.GetValue()
+                                          : c_defaultMaxRequestSize);
+    if (requests.empty())
+    {
+      throw std::invalid_argument("no range to download");
+    }
+
+    auto downloadRequest = [&](const Details::CoalescedRange& request,
+                               DownloadBlobOptions requestOptions) {
+      requestOptions.Offset = request.Offset;
+      requestOptions.Length = request.Length;
+      auto response = Download(requestOptions);
+      auto& body = *response->BodyStream;
+      if (request.Overlapping)
+      {
+        auto buffer = Azure::Core::Http::BufferPool::GetDefault().Acquire(request.Length);
+        if (Azure::Core::Http::BodyStream::ReadToCount(
+                requestOptions.Context, body, buffer.Data(), request.Length)
+            != request.Length)
+        {
+          throw std::runtime_error("error when reading body stream");
+        }
+        for (auto i : request.Ranges)
+        {
+          std::memcpy(
+              targets[i].Buffer,
+              buffer.Data() + (targets[i].Offset - request.Offset),
+              static_cast<std::size_t>(targets[i].Length));
+        }
+        return response;
+      }
+
+      // The ranges are read straight into their buffers, the gaps between them are discarded.
+      Azure::Core::Http::PooledBuffer gapBuffer;
+      int64_t position = request.Offset;
+      for (auto i : request.Ranges)
+      {
+        while (position < targets[i].Offset)
+        {
+          if (!gapBuffer)
+          {
+            gapBuffer = Azure::Core::Http::BufferPool::GetDefault().Acquire(c_gapBufferSize);
+          }
+          auto gapBytesRead = Azure::Core::Http::BodyStream::ReadToCount(
+              requestOptions.Context,
+              body,
+              gapBuffer.Data(),
+              std::min(targets[i].Offset - position, c_gapBufferSize));
+          if (gapBytesRead == 0)
+          {
+            throw std::runtime_error("error when reading body stream");
+          }
+          position += gapBytesRead;
+        }
+        if (Azure::Core::Http::BodyStream::ReadToCount(
+                requestOptions.Context, body, targets[i].Buffer, targets[i].Length)
+            != targets[i].Length)
+        {
+          throw std::runtime_error("error when reading body stream");
+        }
+        position += targets[i].Length;
+      }
+      return response;
+    };
+
+    DownloadBlobOptions firstRequestOptions;
+    firstRequestOptions.Context = options.Context;
+    firstRequestOptions.AccessConditions = options.AccessConditions;
+    auto firstResponse = downloadRequest(requests[0], firstRequestOptions);
+    firstResponse->BodyStream.reset();
+
+    BlobDownloadInfo ret;
+    ret.ETag = std::move(firstResponse->ETag);
+    ret.LastModified = std::move(firstResponse->LastModified);
+    ret.HttpHeaders = std::move(firstResponse->HttpHeaders);
+    ret.Metadata = std::move(firstResponse->Metadata);
+    ret.BlobType = firstResponse->BlobType;
+    ret.ServerEncrypted = firstResponse->ServerEncrypted;
+    ret.EncryptionKeySHA256 = std::move(firstResponse->EncryptionKeySHA256);
+
+    // The other requests are pinned to the version of the blob of the first response.
+    DownloadBlobOptions requestOptions;
+    requestOptions.Context = options.Context;
+    requestOptions.AccessConditions.LeaseId = options.AccessConditions.LeaseId;
+    requestOptions.AccessConditions.IfMatch = ret.ETag;
+    // The other requests are taken in turn by the threads, the first failure stops them.
+    std::atomic<std::size_t> nextRequest{1};
+    std::atomic<bool> failed{false};
+    auto threadFunc = [&]() {
+      for (auto i = nextRequest++; i < requests.size() && !failed; i = nextRequest++)
+      {
+        try
+        {
+          downloadRequest(requests[i], requestOptions);
+        }
+        catch (std::exception&)
+        {
+          failed = true;
+          throw;
+        }
+      }
+    };
+    auto numThreads = std::min<std::size_t>(
+        static_cast<std::size_t>(std::max(options.Concurrency, 1)), requests.size() - 1);
+    std::vector<std::future<void>> threadHandles;
+    for (std::size_t i = 1; i < numThreads; ++i)
+    {
+      threadHandles.emplace_back(std::async(std::launch::async, threadFunc));
+    }
+    std::exception_ptr error;
+    try
+    {
+      threadFunc();
+    }
+    catch (std::exception&)
+    {
+      error = std::current_exception();
+    }
+    for (auto& handle : threadHandles)
+    {
+      try
+      {
+        handle.get();
+      }
+      catch (std::exception&)
+      {
+        if (!error)
+        {
+          error = std::current_exception();
+        }
+      }
+    }
+    if (error)
+    {
+      std::rethrow_exception(error);
+    }
+    return Azure::Core::Response<BlobDownloadInfo>(
+        std::move(ret),
+        std::make_unique<Azure::Core::Http::RawResponse>(
+            std::move(firstResponse.GetRawResponse())));
   }
 
   Azure::Core::Response<BlobDownloadInfo> BlobClient::DownloadToBuffer(
@@ -167,6 +574,23 @@ namespace Azure { namespace Storage { namespace Blobs {
   {
     constexpr int64_t c_defaultChunkSize = 4 * 1024 * 1024;
 
+    if (options.BlockCache)
+    {
+      return DownloadThroughBlockCache(
+          *this,
+          options,
+          [&](int64_t rangeSize) {
+            if (static_cast<std::size_t>(rangeSize) > bufferSize)
+            {
+              throw std::runtime_error(
+                  "buffer is not big enough, blob range size is " + std::to_string(rangeSize));
+            }
+          },
+          [&](const uint8_t* data, int64_t length, int64_t offset) {
+            std::memcpy(buffer + offset, data, static_cast<std::size_t>(length));
+          });
+    }
+
     // Just start downloading using an initial chunk. If it's a small blob, we'll get the whole
     // thing in one shot. If it's a large blob, we'll get its full size in Content-Range and can
     // keep downloading it in chunks.
@@ -189,7 +613,9 @@ namespace Azure { namespace Storage { namespace Blobs {
       firstChunkOptions.Length = firstChunkLength;
     }
 
+    auto firstChunkStart = std::chrono::steady_clock::now();
     auto firstChunk = Download(firstChunkOptions);
+    auto firstChunkHeadersReceived = std::chrono::steady_clock::now();
 
     int64_t blobSize;
     int64_t blobRangeSize;
@@ -223,6 +649,30 @@ namespace Azure { namespace Storage { namespace Blobs {
       throw std::runtime_error("error when reading body stream");
     }
     firstChunk->BodyStream.reset();
+    if (options.Tracer)
+    {
+      auto firstChunkEnd = std::chrono::steady_clock::now();
+      options.Tracer->RecordResponse(
+          -1,
+          firstChunkOffset,
+          firstChunkLength,
+          firstChunk.GetRawResponse(),
+          firstChunkHeadersReceived);
+      options.Tracer->RecordSpan(
+          TransferSpanKind::Body,
+          -1,
+          firstChunkOffset,
+          firstChunkLength,
+          firstChunkHeadersReceived,
+          firstChunkEnd);
+      options.Tracer->RecordSpan(
+          TransferSpanKind::Chunk,
+          -1,
+          firstChunkOffset,
+          firstChunkLength,
+          firstChunkStart,
+          firstChunkEnd);
+    }
 
     auto returnTypeConverter = [](Azure::Core::Response<BlobDownloadResponse>& response) {
       BlobDownloadInfo ret;
@@ -247,6 +697,7 @@ namespace Azure { namespace Storage { namespace Blobs {
             chunkOptions.Offset = offset;
             chunkOptions.Length = length;
             auto chunk = Download(chunkOptions);
+            auto headersReceived = std::chrono::steady_clock::now();
             int64_t bytesRead = Azure::Core::Http::BodyStream::ReadToCount(
                 chunkOptions.Context,
                 *(chunk->BodyStream),
@@ -256,6 +707,18 @@ namespace Azure { namespace Storage { namespace Blobs {
             {
               throw std::runtime_error("error when reading body stream");
             }
+            if (options.Tracer)
+            {
+              options.Tracer->RecordResponse(
+                  chunkId, offset, length, chunk.GetRawResponse(), headersReceived);
+              options.Tracer->RecordSpan(
+                  TransferSpanKind::Body,
+                  chunkId,
+                  offset,
+                  length,
+                  headersReceived,
+                  std::chrono::steady_clock::now());
+            }
 
             if (chunkId == numChunks - 1)
             {
@@ -279,7 +742,12 @@ namespace Azure { namespace Storage { namespace Blobs {
     }
 
     Details::ConcurrentTransfer(
-        remainingOffset, remainingSize, chunkSize, options.Concurrency, downloadChunkFunc);
+        remainingOffset,
+        remainingSize,
+        chunkSize,
+        options.Concurrency,
+        downloadChunkFunc,
+        options.Tracer.get());
     ret->ContentLength = blobRangeSize;
     return ret;
   }
@@ -290,6 +758,23 @@ namespace Azure { namespace Storage { namespace Blobs {
   {
     constexpr int64_t c_defaultChunkSize = 4 * 1024 * 1024;
 
+    if (options.BlockCache)
+    {
+      Details::FileWriter fileWriter(file);
+      return DownloadThroughBlockCache(
+          *this,
+          options,
+          [&](int64_t rangeSize) {
+            if (options.PreallocateFile)
+            {
+              fileWriter.Preallocate(rangeSize);
+            }
+          },
+          [&](const uint8_t* data, int64_t length, int64_t offset) {
+            fileWriter.Write(data, length, offset);
+          });
+    }
+
     // Just start downloading using an initial chunk. If it's a small blob, we'll get the whole
     // thing in one shot. If it's a large blob, we'll get its full size in Content-Range and can
     // keep downloading it in chunks.
@@ -312,9 +797,26 @@ namespace Azure { namespace Storage { namespace Blobs {
       firstChunkOptions.Length = firstChunkLength;
     }
 
-    Details::FileWriter fileWriter(file);
+    Details::FileWriter fileWriter(file, options.DirectFileWrite);
+
+    // Downloaded data is written to the file in the background, with at most MaxFileWriteBehind
+    // bytes queued, so the downloads only wait for the disk when it falls behind.
+    constexpr int64_t c_maxWriteBufferSize = 4 * 1024 * 1024;
+    int64_t writeBehind = options.MaxFileWriteBehind.HasValue()
+        ? options.MaxFileWriteBehind.GetValue()
+        : 2 * options.Concurrency * c_maxWriteBufferSize;
+    int64_t writeBufferSize
+        = std::min(std::max(writeBehind, int64_t(64 * 1024)), c_maxWriteBufferSize)
+        / Details::c_directIoAlignment * Details::c_directIoAlignment;
+    auto fileIoEngine = Details::FileIoEngine::Create(
+        static_cast<int>(std::max(writeBehind / writeBufferSize, int64_t(1))),
+        writeBufferSize,
+        true,
+        options.Context);
 
+    auto firstChunkStart = std::chrono::steady_clock::now();
     auto firstChunk = Download(firstChunkOptions);
+    auto firstChunkHeadersReceived = std::chrono::steady_clock::now();
 
     int64_t blobSize;
     int64_t blobRangeSize;
@@ -334,32 +836,85 @@ namespace Azure { namespace Storage { namespace Blobs {
       blobRangeSize = blobSize;
     }
     firstChunkLength = std::min(firstChunkLength, blobRangeSize);
+    if (options.PreallocateFile)
+    {
+      fileWriter.Preallocate(blobRangeSize);
+    }
 
-    auto bodyStreamToFile = [](Azure::Core::Http::BodyStream& stream,
-                               Details::FileWriter& fileWriter,
-                               int64_t offset,
-                               int64_t length,
-                               Azure::Core::Context& context) {
-      constexpr std::size_t bufferSize = 4 * 1024 * 1024;
-      std::vector<uint8_t> buffer(bufferSize);
+    auto bodyStreamToFile = [&options, &fileIoEngine, firstChunkOffset](
+                                Azure::Core::Http::BodyStream& stream,
+                                Details::FileWriter& fileWriter,
+                                int64_t offset,
+                                int64_t length,
+                                Azure::Core::Context& context,
+                                int64_t chunkId) {
       while (length > 0)
       {
-        int64_t readSize = std::min(static_cast<int64_t>(bufferSize), length);
-        int64_t bytesRead
-            = Azure::Core::Http::BodyStream::ReadToCount(context, stream, buffer.data(), readSize);
+        // The file write span is the wait for a buffer whose data is written to the file.
+        auto writeStart = std::chrono::steady_clock::now();
+        uint8_t* buffer = fileIoEngine->AcquireBuffer();
+        auto readStart = std::chrono::steady_clock::now();
+        int64_t readSize = std::min(fileIoEngine->GetBufferSize(), length);
+        int64_t bytesRead;
+        try
+        {
+          bytesRead = Azure::Core::Http::BodyStream::ReadToCount(context, stream, buffer, readSize);
+        }
+        catch (std::exception&)
+        {
+          fileIoEngine->ReleaseBuffer(buffer);
+          throw;
+        }
         if (bytesRead != readSize)
         {
+          fileIoEngine->ReleaseBuffer(buffer);
           throw std::runtime_error("error when reading body stream");
         }
-        fileWriter.Write(buffer.data(), bytesRead, offset);
+        fileIoEngine->QueueWrite(
+            fileWriter.GetHandle(offset, bytesRead),
+            buffer,
+            bytesRead,
+            offset,
+            options.DropFileCache);
+        fileIoEngine->Submit();
+        if (options.Tracer)
+        {
+          // The spans have the offset in the blob, like the other spans of the chunk.
+          auto blobOffset = firstChunkOffset + offset;
+          options.Tracer->RecordSpan(
+              TransferSpanKind::FileWrite, chunkId, blobOffset, bytesRead, writeStart, readStart);
+          options.Tracer->RecordSpan(
+              TransferSpanKind::Body,
+              chunkId,
+              blobOffset,
+              bytesRead,
+              readStart,
+              std::chrono::steady_clock::now());
+        }
         length -= bytesRead;
         offset += bytesRead;
       }
     };
 
     bodyStreamToFile(
-        *(firstChunk->BodyStream), fileWriter, 0, firstChunkLength, firstChunkOptions.Context);
+        *(firstChunk->BodyStream), fileWriter, 0, firstChunkLength, firstChunkOptions.Context, -1);
     firstChunk->BodyStream.reset();
+    if (options.Tracer)
+    {
+      options.Tracer->RecordResponse(
+          -1,
+          firstChunkOffset,
+          firstChunkLength,
+          firstChunk.GetRawResponse(),
+          firstChunkHeadersReceived);
+      options.Tracer->RecordSpan(
+          TransferSpanKind::Chunk,
+          -1,
+          firstChunkOffset,
+          firstChunkLength,
+          firstChunkStart,
+          std::chrono::steady_clock::now());
+    }
 
     auto returnTypeConverter = [](Azure::Core::Response<BlobDownloadResponse>& response) {
       BlobDownloadInfo ret;
@@ -384,12 +939,22 @@ namespace Azure { namespace Storage { namespace Blobs {
             chunkOptions.Offset = offset;
             chunkOptions.Length = length;
             auto chunk = Download(chunkOptions);
+            if (options.Tracer)
+            {
+              options.Tracer->RecordResponse(
+                  chunkId,
+                  offset,
+                  length,
+                  chunk.GetRawResponse(),
+                  std::chrono::steady_clock::now());
+            }
             bodyStreamToFile(
                 *(chunk->BodyStream),
                 fileWriter,
                 offset - firstChunkOffset,
                 chunkOptions.Length.GetValue(),
-                chunkOptions.Context);
+                chunkOptions.Context,
+                chunkId);
 
             if (chunkId == numChunks - 1)
             {
@@ -413,7 +978,13 @@ namespace Azure { namespace Storage { namespace Blobs {
     }
 
     Details::ConcurrentTransfer(
-        remainingOffset, remainingSize, chunkSize, options.Concurrency, downloadChunkFunc);
+        remainingOffset,
+        remainingSize,
+        chunkSize,
+        options.Concurrency,
+        downloadChunkFunc,
+        options.Tracer.get());
+    fileIoEngine->Flush();
     ret->ContentLength = blobRangeSize;
     return ret;
   }
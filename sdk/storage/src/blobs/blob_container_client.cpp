@@ -14,6 +14,8 @@
 #include "credentials/policy/policies.hpp"
 #include "http/curl/curl.hpp"
 
+#include <stdexcept>
+
 namespace Azure { namespace Storage { namespace Blobs {
 
   BlobContainerClient BlobContainerClient::CreateFromConnectionString(
@@ -50,16 +52,17 @@ namespace Azure { namespace Storage { namespace Blobs {
       policies.emplace_back(p->Clone());
     }
     policies.emplace_back(
-        std::make_unique<Azure::Core::Http::RetryPolicy>(Azure::Core::Http::RetryOptions()));
+        Details::CreateRetryPolicy(options.RetryOptions, m_containerUrl.GetHost()));
     for (const auto& p : options.PerRetryPolicies)
     {
       policies.emplace_back(p->Clone());
     }
     policies.emplace_back(std::make_unique<CommonHeadersRequestPolicy>());
     policies.emplace_back(std::make_unique<SharedKeyPolicy>(credential));
-    policies.emplace_back(std::make_unique<Azure::Core::Http::TransportPolicy>(
-        std::make_shared<Azure::Core::Http::CurlTransport>()));
+    policies.emplace_back(std::make_unique<Azure::Core::Http::TransportPolicy>(options.Transport));
     m_pipeline = std::make_shared<Azure::Core::Http::HttpPipeline>(policies);
+    m_batchSubRequestPipeline
+        = Details::CreateBlobBatchSubRequestPipeline(std::make_unique<SharedKeyPolicy>(credential));
   }
 
   BlobContainerClient::BlobContainerClient(
@@ -76,7 +79,7 @@ namespace Azure { namespace Storage { namespace Blobs {
       policies.emplace_back(p->Clone());
     }
     policies.emplace_back(
-        std::make_unique<Azure::Core::Http::RetryPolicy>(Azure::Core::Http::RetryOptions()));
+        Details::CreateRetryPolicy(options.RetryOptions, m_containerUrl.GetHost()));
     for (const auto& p : options.PerRetryPolicies)
     {
       policies.emplace_back(p->Clone());
@@ -85,9 +88,11 @@ namespace Azure { namespace Storage { namespace Blobs {
     policies.emplace_back(
         std::make_unique<Core::Credentials::Policy::BearerTokenAuthenticationPolicy>(
             credential, Details::c_StorageScope));
-    policies.emplace_back(std::make_unique<Azure::Core::Http::TransportPolicy>(
-        std::make_shared<Azure::Core::Http::CurlTransport>()));
+    policies.emplace_back(std::make_unique<Azure::Core::Http::TransportPolicy>(options.Transport));
     m_pipeline = std::make_shared<Azure::Core::Http::HttpPipeline>(policies);
+    m_batchSubRequestPipeline = Details::CreateBlobBatchSubRequestPipeline(
+        std::make_unique<Core::Credentials::Policy::BearerTokenAuthenticationPolicy>(
+            credential, Details::c_StorageScope));
   }
 
   BlobContainerClient::BlobContainerClient(
@@ -103,15 +108,15 @@ namespace Azure { namespace Storage { namespace Blobs {
       policies.emplace_back(p->Clone());
     }
     policies.emplace_back(
-        std::make_unique<Azure::Core::Http::RetryPolicy>(Azure::Core::Http::RetryOptions()));
+        Details::CreateRetryPolicy(options.RetryOptions, m_containerUrl.GetHost()));
     for (const auto& p : options.PerRetryPolicies)
     {
       policies.emplace_back(p->Clone());
     }
     policies.emplace_back(std::make_unique<CommonHeadersRequestPolicy>());
-    policies.emplace_back(std::make_unique<Azure::Core::Http::TransportPolicy>(
-        std::make_shared<Azure::Core::Http::CurlTransport>()));
+    policies.emplace_back(std::make_unique<Azure::Core::Http::TransportPolicy>(options.Transport));
     m_pipeline = std::make_shared<Azure::Core::Http::HttpPipeline>(policies);
+    m_batchSubRequestPipeline = Details::CreateBlobBatchSubRequestPipeline(nullptr);
   }
 
   BlobClient BlobContainerClient::GetBlobClient(const std::string& blobName) const
@@ -204,4 +209,39 @@ namespace Azure { namespace Storage { namespace Blobs {
         options.Context, *m_pipeline, m_containerUrl.ToString(), protocolLayerOptions);
   }
 
+  Azure::Core::Response<SubmitBlobBatchResult> BlobContainerClient::SubmitBatch(
+      const BlobBatch& batch,
+      const SubmitBlobBatchOptions& options) const
+  {
+    // Sub-request URLs are built from the service URL, which is the container URL without the
+    // container name.
+    auto serviceUrl = m_containerUrl;
+    const auto& containerPath = m_containerUrl.GetPath();
+    auto lastSlashPos = containerPath.find_last_of('/');
+    serviceUrl.SetPath(
+        lastSlashPos == std::string::npos ? std::string() : containerPath.substr(0, lastSlashPos));
+
+    // The service rejects the whole batch if a sub-request targets another container.
+    const auto containerName = lastSlashPos == std::string::npos
+        ? containerPath
+        : containerPath.substr(lastSlashPos + 1);
+    for (const auto& operation : batch.m_operations)
+    {
+      if (operation.ContainerName != containerName)
+      {
+        throw std::invalid_argument(
+            "sub-request targets container " + operation.ContainerName + " instead of "
+            + containerName);
+      }
+    }
+    return Details::SubmitBlobBatch(
+        *m_pipeline,
+        *m_batchSubRequestPipeline,
+        serviceUrl,
+        m_containerUrl,
+        true,
+        batch.m_operations,
+        options);
+  }
+
 }}} // namespace Azure::Storage::Blobs
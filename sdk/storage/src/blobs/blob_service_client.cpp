@@ -44,17 +44,17 @@ namespace Azure { namespace Storage { namespace Blobs {
     {
       policies.emplace_back(p->Clone());
     }
-    policies.emplace_back(
-        std::make_unique<Azure::Core::Http::RetryPolicy>(Azure::Core::Http::RetryOptions()));
+    policies.emplace_back(Details::CreateRetryPolicy(options.RetryOptions, m_serviceUrl.GetHost()));
     for (const auto& p : options.PerRetryPolicies)
     {
       policies.emplace_back(p->Clone());
     }
     policies.emplace_back(std::make_unique<CommonHeadersRequestPolicy>());
     policies.emplace_back(std::make_unique<SharedKeyPolicy>(credential));
-    policies.emplace_back(std::make_unique<Azure::Core::Http::TransportPolicy>(
-        std::make_shared<Azure::Core::Http::CurlTransport>()));
+    policies.emplace_back(std::make_unique<Azure::Core::Http::TransportPolicy>(options.Transport));
     m_pipeline = std::make_shared<Azure::Core::Http::HttpPipeline>(policies);
+    m_batchSubRequestPipeline
+        = Details::CreateBlobBatchSubRequestPipeline(std::make_unique<SharedKeyPolicy>(credential));
   }
 
   BlobServiceClient::BlobServiceClient(
@@ -70,8 +70,7 @@ namespace Azure { namespace Storage { namespace Blobs {
     {
       policies.emplace_back(p->Clone());
     }
-    policies.emplace_back(
-        std::make_unique<Azure::Core::Http::RetryPolicy>(Azure::Core::Http::RetryOptions()));
+    policies.emplace_back(Details::CreateRetryPolicy(options.RetryOptions, m_serviceUrl.GetHost()));
     for (const auto& p : options.PerRetryPolicies)
     {
       policies.emplace_back(p->Clone());
@@ -80,9 +79,11 @@ namespace Azure { namespace Storage { namespace Blobs {
     policies.emplace_back(
         std::make_unique<Core::Credentials::Policy::BearerTokenAuthenticationPolicy>(
             credential, Details::c_StorageScope));
-    policies.emplace_back(std::make_unique<Azure::Core::Http::TransportPolicy>(
-        std::make_shared<Azure::Core::Http::CurlTransport>()));
+    policies.emplace_back(std::make_unique<Azure::Core::Http::TransportPolicy>(options.Transport));
     m_pipeline = std::make_shared<Azure::Core::Http::HttpPipeline>(policies);
+    m_batchSubRequestPipeline = Details::CreateBlobBatchSubRequestPipeline(
+        std::make_unique<Core::Credentials::Policy::BearerTokenAuthenticationPolicy>(
+            credential, Details::c_StorageScope));
   }
 
   BlobServiceClient::BlobServiceClient(
@@ -97,16 +98,15 @@ namespace Azure { namespace Storage { namespace Blobs {
     {
       policies.emplace_back(p->Clone());
     }
-    policies.emplace_back(
-        std::make_unique<Azure::Core::Http::RetryPolicy>(Azure::Core::Http::RetryOptions()));
+    policies.emplace_back(Details::CreateRetryPolicy(options.RetryOptions, m_serviceUrl.GetHost()));
     for (const auto& p : options.PerRetryPolicies)
     {
       policies.emplace_back(p->Clone());
     }
     policies.emplace_back(std::make_unique<CommonHeadersRequestPolicy>());
-    policies.emplace_back(std::make_unique<Azure::Core::Http::TransportPolicy>(
-        std::make_shared<Azure::Core::Http::CurlTransport>()));
+    policies.emplace_back(std::make_unique<Azure::Core::Http::TransportPolicy>(options.Transport));
     m_pipeline = std::make_shared<Azure::Core::Http::HttpPipeline>(policies);
+    m_batchSubRequestPipeline = Details::CreateBlobBatchSubRequestPipeline(nullptr);
   }
 
   BlobContainerClient BlobServiceClient::GetBlobContainerClient(
@@ -114,7 +114,7 @@ namespace Azure { namespace Storage { namespace Blobs {
   {
     auto containerUri = m_serviceUrl;
     containerUri.AppendPath(containerName);
-    return BlobContainerClient(std::move(containerUri), m_pipeline);
+    return BlobContainerClient(std::move(containerUri), m_pipeline, m_batchSubRequestPipeline);
   }
 
   Azure::Core::Response<ListContainersSegment> BlobServiceClient::ListBlobContainersSegment(
@@ -159,4 +159,18 @@ namespace Azure { namespace Storage { namespace Blobs {
         options.Context, *m_pipeline, m_serviceUrl.ToString(), protocolLayerOptions);
   }
 
+  Azure::Core::Response<SubmitBlobBatchResult> BlobServiceClient::SubmitBatch(
+      const BlobBatch& batch,
+      const SubmitBlobBatchOptions& options) const
+  {
+    return Details::SubmitBlobBatch(
+        *m_pipeline,
+        *m_batchSubRequestPipeline,
+        m_serviceUrl,
+        m_serviceUrl,
+        false,
+        batch.m_operations,
+        options);
+  }
+
 }}} // namespace Azure::Storage::Blobs
@@ -7,8 +7,13 @@
 #include "common/constants.hpp"
 #include "common/crypt.hpp"
 #include "common/file_io.hpp"
+#include "common/file_io_engine.hpp"
 #include "common/storage_common.hpp"
 
+#include <chrono>
+#include <stdexcept>
+#include <string>
+
 namespace Azure { namespace Storage { namespace Blobs {
 
   BlockBlobClient BlockBlobClient::CreateFromConnectionString(
@@ -114,13 +119,20 @@ namespace Azure { namespace Storage { namespace Blobs {
       StageBlockOptions chunkOptions;
       chunkOptions.Context = options.Context;
       auto blockInfo = StageBlock(getBlockId(chunkId), &contentStream, chunkOptions);
+      if (options.Tracer)
+      {
+        // The body is sent with the request, so the request sent span covers the upload.
+        options.Tracer->RecordResponse(
+            chunkId, offset, length, blockInfo.GetRawResponse(), std::chrono::steady_clock::now());
+      }
       if (chunkId == numChunks - 1)
       {
         blockIds.resize(static_cast<std::size_t>(numChunks));
       }
     };
 
-    Details::ConcurrentTransfer(0, bufferSize, chunkSize, options.Concurrency, uploadBlockFunc);
+    Details::ConcurrentTransfer(
+        0, bufferSize, chunkSize, options.Concurrency, uploadBlockFunc, options.Tracer.get());
 
     for (std::size_t i = 0; i < blockIds.size(); ++i)
     {
@@ -138,6 +150,76 @@ namespace Azure { namespace Storage { namespace Blobs {
     return commitBlockListResponse;
   }
 
+  Azure::Core::Response<BlobContentInfo> BlockBlobClient::UploadFromStream(
+      Azure::Core::Http::BodyStream* content,
+      const UploadBlobOptions& options) const
+  {
+    constexpr int64_t c_defaultBlockSize = 8 * 1024 * 1024;
+    constexpr int64_t c_maximumNumberBlocks = 50000;
+    constexpr int64_t c_grainSize = 4 * 1024;
+
+    int64_t chunkSize = c_defaultBlockSize;
+    if (options.ChunkSize.HasValue())
+    {
+      chunkSize = options.ChunkSize.GetValue();
+    }
+    else if (content->Length() > 0)
+    {
+      int64_t minBlockSize
+          = (content->Length() + c_maximumNumberBlocks - 1) / c_maximumNumberBlocks;
+      chunkSize = std::max(chunkSize, minBlockSize);
+      chunkSize = (chunkSize + c_grainSize - 1) / c_grainSize * c_grainSize;
+    }
+
+    auto getBlockId = [](int64_t id) {
+      constexpr std::size_t c_blockIdLength = 64;
+      std::string blockId = std::to_string(id);
+      blockId = std::string(c_blockIdLength - blockId.length(), '0') + blockId;
+      return Base64Encode(blockId);
+    };
+
+    auto uploadBlockFunc = [&](const uint8_t* data,
+                               int64_t length,
+                               int64_t offset,
+                               int64_t chunkId) {
+      // The block list can't be committed with more blocks, fail before staging them.
+      if (chunkId >= c_maximumNumberBlocks)
+      {
+        throw std::runtime_error(
+            "stream needs more than " + std::to_string(c_maximumNumberBlocks)
+            + " blocks, use a larger chunk size");
+      }
+      Azure::Core::Http::MemoryBodyStream contentStream(data, length);
+      StageBlockOptions chunkOptions;
+      chunkOptions.Context = options.Context;
+      auto blockInfo = StageBlock(getBlockId(chunkId), &contentStream, chunkOptions);
+      if (options.Tracer)
+      {
+        options.Tracer->RecordResponse(
+            chunkId, offset, length, blockInfo.GetRawResponse(), std::chrono::steady_clock::now());
+      }
+    };
+
+    auto context = options.Context;
+    auto numChunks = Details::ConcurrentStreamTransfer(
+        context, *content, chunkSize, options.Concurrency, uploadBlockFunc, options.Tracer.get());
+
+    std::vector<std::pair<BlockType, std::string>> blockIds;
+    for (int64_t i = 0; i < numChunks; ++i)
+    {
+      blockIds.emplace_back(BlockType::Uncommitted, getBlockId(i));
+    }
+    CommitBlockListOptions commitBlockListOptions;
+    commitBlockListOptions.Context = options.Context;
+    commitBlockListOptions.HttpHeaders = options.HttpHeaders;
+    commitBlockListOptions.Metadata = options.Metadata;
+    commitBlockListOptions.Tier = options.Tier;
+    auto commitBlockListResponse = CommitBlockList(blockIds, commitBlockListOptions);
+    commitBlockListResponse->ContentCRC64.Reset();
+    commitBlockListResponse->ContentMD5.Reset();
+    return commitBlockListResponse;
+  }
+
   Azure::Core::Response<BlobContentInfo> BlockBlobClient::UploadFromFile(
       const std::string& file,
       const UploadBlobOptions& options) const
@@ -169,11 +251,84 @@ namespace Azure { namespace Storage { namespace Blobs {
       return Base64Encode(blockId);
     };
 
+    // With read-ahead, the blocks are read from the file in the background into buffers the
+    // requests are sent from, instead of each request reading the file as it sends it.
+    // With a mapping, the blocks are sent from the page cache without reading them at all.
+    std::unique_ptr<Details::FileMapping> fileMapping;
+    std::unique_ptr<Details::FileIoEngine> fileIoEngine;
+    std::unique_ptr<Details::FileReadAhead> fileReadAhead;
+    if (options.MapFile)
+    {
+      fileMapping = std::make_unique<Details::FileMapping>(fileReader);
+      fileMapping->WillNeed(0, chunkSize * options.Concurrency);
+    }
+    else if (options.FileReadAhead > 0 && fileReader.GetFileSize() > 0)
+    {
+      fileIoEngine = Details::FileIoEngine::Create(
+          options.Concurrency + options.FileReadAhead,
+          std::min(chunkSize, fileReader.GetFileSize()),
+          true,
+          options.Context);
+      fileReadAhead = std::make_unique<Details::FileReadAhead>(
+          *fileIoEngine,
+          fileReader.GetHandle(),
+          0,
+          fileReader.GetFileSize(),
+          chunkSize,
+          options.FileReadAhead);
+    }
+
     auto uploadBlockFunc = [&](int64_t offset, int64_t length, int64_t chunkId, int64_t numChunks) {
-      Azure::Core::Http::FileBodyStream contentStream(fileReader.GetHandle(), offset, length);
       StageBlockOptions chunkOptions;
       chunkOptions.Context = options.Context;
-      auto blockInfo = StageBlock(getBlockId(chunkId), &contentStream, chunkOptions);
+      Azure::Core::Response<BlockInfo> blockInfo = [&]() {
+        if (fileMapping)
+        {
+          // The threads take the blocks in order, the next block of this thread comes after the
+          // blocks being sent by the others.
+          fileMapping->WillNeed(offset + chunkSize * options.Concurrency, chunkSize);
+          Azure::Core::Http::MemoryBodyStream contentStream(
+              fileMapping->GetData() + offset, length);
+          return StageBlock(getBlockId(chunkId), &contentStream, chunkOptions);
+        }
+        if (!fileReadAhead)
+        {
+          Azure::Core::Http::FileBodyStream contentStream(fileReader.GetHandle(), offset, length);
+          return StageBlock(getBlockId(chunkId), &contentStream, chunkOptions);
+        }
+        auto readStart = std::chrono::steady_clock::now();
+        uint8_t* buffer = fileReadAhead->Acquire(chunkId);
+        if (options.Tracer)
+        {
+          // The time the request waited for the block to be read from the file.
+          options.Tracer->RecordSpan(
+              TransferSpanKind::FileRead,
+              chunkId,
+              offset,
+              length,
+              readStart,
+              std::chrono::steady_clock::now());
+        }
+        try
+        {
+          Azure::Core::Http::MemoryBodyStream contentStream(
+              buffer, static_cast<std::size_t>(length));
+          auto response = StageBlock(getBlockId(chunkId), &contentStream, chunkOptions);
+          fileReadAhead->Release(buffer);
+          return response;
+        }
+        catch (std::exception&)
+        {
+          fileReadAhead->Release(buffer);
+          throw;
+        }
+      }();
+      if (options.Tracer)
+      {
+        // The body is sent with the request, so the request sent span covers the upload.
+        options.Tracer->RecordResponse(
+            chunkId, offset, length, blockInfo.GetRawResponse(), std::chrono::steady_clock::now());
+      }
       if (chunkId == numChunks - 1)
       {
         blockIds.resize(static_cast<std::size_t>(numChunks));
@@ -181,7 +336,12 @@ namespace Azure { namespace Storage { namespace Blobs {
     };
 
     Details::ConcurrentTransfer(
-        0, fileReader.GetFileSize(), chunkSize, options.Concurrency, uploadBlockFunc);
+        0,
+        fileReader.GetFileSize(),
+        chunkSize,
+        options.Concurrency,
+        uploadBlockFunc,
+        options.Tracer.get());
 
     for (std::size_t i = 0; i < blockIds.size(); ++i)
     {
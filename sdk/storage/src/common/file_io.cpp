@@ -4,12 +4,16 @@
 #include "common/file_io.hpp"
 
 #ifndef _WIN32
+#include <cerrno>
 #include <fcntl.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
 #endif
 
+#include <algorithm>
+#include <cstring>
 #include <limits>
 #include <stdexcept>
 
@@ -43,7 +47,43 @@ namespace Azure { namespace Storage { namespace Details {
 
   FileReader::~FileReader() { CloseHandle(m_handle); }
 
-  FileWriter::FileWriter(const std::string& filename)
+  FileMapping::FileMapping(const FileReader& reader) : m_size(reader.GetFileSize())
+  {
+    // Empty files can't be mapped, and have no data anyway.
+    if (m_size == 0)
+    {
+      return;
+    }
+    m_mapping = CreateFileMapping(reader.GetHandle(), nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (m_mapping == NULL)
+    {
+      throw std::runtime_error("failed to map file");
+    }
+    m_data = static_cast<const uint8_t*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+    if (m_data == nullptr)
+    {
+      CloseHandle(m_mapping);
+      throw std::runtime_error("failed to map file");
+    }
+  }
+
+  FileMapping::~FileMapping()
+  {
+    if (m_data != nullptr)
+    {
+      UnmapViewOfFile(m_data);
+      CloseHandle(m_mapping);
+    }
+  }
+
+  void FileMapping::WillNeed(int64_t offset, int64_t length) const
+  {
+    // The pages are read in as the mapping is sent.
+    (void)offset;
+    (void)length;
+  }
+
+  FileWriter::FileWriter(const std::string& filename, bool directIo)
   {
     m_handle = CreateFile(
         filename.data(),
@@ -57,9 +97,38 @@ namespace Azure { namespace Storage { namespace Details {
     {
       throw std::runtime_error("failed to open file");
     }
+    m_directHandle = INVALID_HANDLE_VALUE;
+    if (directIo)
+    {
+      m_directHandle = CreateFile(
+          filename.data(),
+          GENERIC_WRITE,
+          FILE_SHARE_READ | FILE_SHARE_WRITE,
+          nullptr,
+          OPEN_EXISTING,
+          FILE_FLAG_NO_BUFFERING,
+          NULL);
+    }
   }
 
-  FileWriter::~FileWriter() { CloseHandle(m_handle); }
+  FileWriter::~FileWriter()
+  {
+    if (m_directHandle != INVALID_HANDLE_VALUE)
+    {
+      CloseHandle(m_directHandle);
+    }
+    CloseHandle(m_handle);
+  }
+
+  FileHandle FileWriter::GetHandle(int64_t offset, int64_t length) const
+  {
+    if (m_directHandle != INVALID_HANDLE_VALUE && offset % c_directIoAlignment == 0
+        && length % c_directIoAlignment == 0)
+    {
+      return m_directHandle;
+    }
+    return m_handle;
+  }
 
   void FileWriter::Write(const uint8_t* buffer, int64_t length, int64_t offset)
   {
@@ -80,6 +149,26 @@ namespace Azure { namespace Storage { namespace Details {
       throw std::runtime_error("failed to write file");
     }
   }
+
+  void FileWriter::Preallocate(int64_t size)
+  {
+    FILE_ALLOCATION_INFO allocationInfo;
+    allocationInfo.AllocationSize.QuadPart = size;
+    if (!SetFileInformationByHandle(
+            m_handle, FileAllocationInfo, &allocationInfo, sizeof(allocationInfo)))
+    {
+      throw std::runtime_error("failed to allocate file");
+    }
+  }
+
+  void DropFileCache(FileHandle handle, int64_t offset, int64_t length)
+  {
+    // Windows has no eviction of a range of a file, writes with FILE_FLAG_NO_BUFFERING bypass
+    // the cache instead.
+    (void)handle;
+    (void)offset;
+    (void)length;
+  }
 #else
   FileReader::FileReader(const std::string& filename)
   {
@@ -98,7 +187,54 @@ namespace Azure { namespace Storage { namespace Details {
 
   FileReader::~FileReader() { close(m_handle); }
 
-  FileWriter::FileWriter(const std::string& filename)
+  FileMapping::FileMapping(const FileReader& reader) : m_size(reader.GetFileSize())
+  {
+    // Empty files can't be mapped, and have no data anyway.
+    if (m_size == 0)
+    {
+      return;
+    }
+    if (static_cast<uint64_t>(m_size) > std::numeric_limits<size_t>::max())
+    {
+      throw std::runtime_error("failed to map file");
+    }
+    void* data
+        = mmap(nullptr, static_cast<size_t>(m_size), PROT_READ, MAP_SHARED, reader.GetHandle(), 0);
+    if (data == MAP_FAILED)
+    {
+      throw std::runtime_error("failed to map file");
+    }
+    m_data = static_cast<const uint8_t*>(data);
+    // Blocks are mostly sent in order, pages behind them can be dropped early.
+    madvise(data, static_cast<size_t>(m_size), MADV_SEQUENTIAL);
+  }
+
+  FileMapping::~FileMapping()
+  {
+    if (m_data != nullptr)
+    {
+      munmap(const_cast<uint8_t*>(m_data), static_cast<size_t>(m_size));
+    }
+  }
+
+  void FileMapping::WillNeed(int64_t offset, int64_t length) const
+  {
+    static const int64_t pageSize = sysconf(_SC_PAGESIZE);
+    offset = std::max(offset, int64_t(0));
+    length = std::min(length, m_size - offset);
+    if (m_data == nullptr || length <= 0)
+    {
+      return;
+    }
+    // madvise takes ranges starting on a page.
+    auto pageOffset = offset / pageSize * pageSize;
+    madvise(
+        const_cast<uint8_t*>(m_data) + pageOffset,
+        static_cast<size_t>(length + offset - pageOffset),
+        MADV_WILLNEED);
+  }
+
+  FileWriter::FileWriter(const std::string& filename, bool directIo)
   {
     m_handle = open(
         filename.data(), O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
@@ -106,9 +242,37 @@ namespace Azure { namespace Storage { namespace Details {
     {
       throw std::runtime_error("failed to open file");
     }
+    // Opening with O_DIRECT fails on file systems that don't support it, the writes then go
+    // through the page cache.
+    m_directHandle = -1;
+#ifdef O_DIRECT
+    if (directIo)
+    {
+      m_directHandle = open(filename.data(), O_WRONLY | O_DIRECT);
+    }
+#else
+    (void)directIo;
+#endif
+  }
+
+  FileWriter::~FileWriter()
+  {
+    if (m_directHandle != -1)
+    {
+      close(m_directHandle);
+    }
+    close(m_handle);
   }
 
-  FileWriter::~FileWriter() { close(m_handle); }
+  FileHandle FileWriter::GetHandle(int64_t offset, int64_t length) const
+  {
+    if (m_directHandle != -1 && offset % c_directIoAlignment == 0
+        && length % c_directIoAlignment == 0)
+    {
+      return m_directHandle;
+    }
+    return m_handle;
+  }
 
   void FileWriter::Write(const uint8_t* buffer, int64_t length, int64_t offset)
   {
@@ -124,6 +288,39 @@ namespace Azure { namespace Storage { namespace Details {
       throw std::runtime_error("failed to write file");
     }
   }
+
+  void FileWriter::Preallocate(int64_t size)
+  {
+#ifdef __linux__
+    // File systems without fallocate are written as usual.
+    if (size > 0 && fallocate(m_handle, 0, 0, static_cast<off_t>(size)) != 0 && errno != EOPNOTSUPP)
+    {
+      throw std::runtime_error("failed to allocate file");
+    }
+#else
+    (void)size;
+#endif
+  }
+
+  void DropFileCache(FileHandle handle, int64_t offset, int64_t length)
+  {
+#ifdef __linux__
+    // Only clean pages can be evicted, so the range is written back first.
+    sync_file_range(
+        handle,
+        static_cast<off_t>(offset),
+        static_cast<off_t>(length),
+        SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE | SYNC_FILE_RANGE_WAIT_AFTER);
+#endif
+#ifdef POSIX_FADV_DONTNEED
+    posix_fadvise(
+        handle, static_cast<off_t>(offset), static_cast<off_t>(length), POSIX_FADV_DONTNEED);
+#else
+    (void)handle;
+    (void)offset;
+    (void)length;
+#endif
+  }
 #endif
 
 }}} // namespace Azure::Storage::Details
@@ -0,0 +1,904 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// SPDX-License-Identifier: MIT
+
+#include "common/file_io_engine.hpp"
+
+#ifndef _WIN32
+#include <sys/types.h>
+#include <unistd.h>
+#endif
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+// The opcodes are enumerators, the header is checked with the macros that came with them:
+// IOSQE_IO_LINK after IORING_OP_SYNC_FILE_RANGE in 5.3, IO_URING_OP_SUPPORTED with the probe,
+// IORING_OP_READ, IORING_OP_WRITE and IORING_OP_FADVISE in 5.6. Whether the running kernel
+// supports them is probed when the ring is set up.
+#if defined(IOSQE_IO_LINK) && defined(IORING_FEAT_SINGLE_MMAP) && defined(IO_URING_OP_SUPPORTED) \
+    && defined(__NR_io_uring_setup)
+#define AZURE_STORAGE_IO_URING
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#endif
+#endif
+#endif
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <deque>
+#include <limits>
+#include <stdexcept>
+#include <thread>
+
+namespace Azure { namespace Storage { namespace Details {
+
+  namespace {
+    // Largest transfer of a single read or write, longer operations are resumed.
+    constexpr int64_t c_maxTransferSize = 1024 * 1024 * 1024;
+
+    class ThreadPoolFileIoEngine : public FileIoEngine {
+    public:
+      ThreadPoolFileIoEngine(int bufferCount, int64_t bufferSize, Azure::Core::Context& context)
+          : FileIoEngine(bufferCount, bufferSize, context)
+      {
+        int threadCount = std::min(bufferCount, 4);
+        for (int i = 0; i < threadCount; ++i)
+        {
+          m_threads.emplace_back([this]() { Run(); });
+        }
+      }
+
+      ~ThreadPoolFileIoEngine() override
+      {
+        WaitIdle();
+        {
+          std::lock_guard<std::mutex> guard(m_mutex);
+          m_stop = true;
+        }
+        m_cv.notify_all();
+        for (auto& thread : m_threads)
+        {
+          thread.join();
+        }
+      }
+
+      bool UsesIoUring() const override { return false; }
+
+    protected:
+      void Start(std::vector<Operation> operations) override
+      {
+        {
+          std::lock_guard<std::mutex> guard(m_mutex);
+          m_operations.insert(m_operations.end(), operations.begin(), operations.end());
+        }
+        m_cv.notify_all();
+      }
+
+    private:
+      void Run()
+      {
+        while (true)
+        {
+          Operation operation;
+          {
+            std::unique_lock<std::mutex> guard(m_mutex);
+            m_cv.wait(guard, [this]() { return m_stop || !m_operations.empty(); });
+            if (m_operations.empty())
+            {
+              return;
+            }
+            operation = m_operations.front();
+            m_operations.pop_front();
+          }
+          int error = Transfer(operation);
+          if (error == 0 && operation.DropCache)
+          {
+            DropFileCache(operation.Handle, operation.Offset, operation.Length);
+          }
+          Complete(operation, error);
+        }
+      }
+
+      int Transfer(Operation& operation)
+      {
+        while (operation.Done < operation.Length)
+        {
+          uint8_t* data = GetBuffer(operation.BufferIndex) + operation.Done;
+          int64_t offset = operation.Offset + operation.Done;
+          int64_t length = std::min(operation.Length - operation.Done, c_maxTransferSize);
+#ifdef _WIN32
+          OVERLAPPED overlapped;
+          std::memset(&overlapped, 0, sizeof(overlapped));
+          overlapped.Offset = static_cast<DWORD>(static_cast<uint64_t>(offset));
+          overlapped.OffsetHigh = static_cast<DWORD>(static_cast<uint64_t>(offset) >> 32);
+          DWORD transferred = 0;
+          BOOL ret = operation.Write
+              ? WriteFile(
+                  operation.Handle, data, static_cast<DWORD>(length), &transferred, &overlapped)
+              : ReadFile(
+                  operation.Handle, data, static_cast<DWORD>(length), &transferred, &overlapped);
+          if (!ret)
+          {
+            if (!operation.Write && GetLastError() == ERROR_HANDLE_EOF)
+            {
+              return 0;
+            }
+            return static_cast<int>(GetLastError());
+          }
+#else
+          auto size = static_cast<size_t>(length);
+          ssize_t transferred = operation.Write
+              ? pwrite(operation.Handle, data, size, static_cast<off_t>(offset))
+              : pread(operation.Handle, data, size, static_cast<off_t>(offset));
+          if (transferred < 0)
+          {
+            if (errno == EINTR)
+            {
+              continue;
+            }
+            return errno;
+          }
+#endif
+          if (transferred == 0)
+          {
+            // End of the file for reads, a write that can't make progress otherwise.
+            return operation.Write ? EIO : 0;
+          }
+          operation.Done += static_cast<int64_t>(transferred);
+        }
+        return 0;
+      }
+
+      std::mutex m_mutex;
+      std::condition_variable m_cv;
+      std::deque<Operation> m_operations;
+      bool m_stop = false;
+      std::vector<std::thread> m_threads;
+    };
+
+#ifdef AZURE_STORAGE_IO_URING
+    class IoUringFileIoEngine : public FileIoEngine {
+    public:
+      IoUringFileIoEngine(int bufferCount, int64_t bufferSize, Azure::Core::Context& context)
+          : FileIoEngine(bufferCount, bufferSize, context),
+            m_operations(static_cast<std::size_t>(bufferCount)),
+            m_droppingCache(static_cast<std::size_t>(bufferCount), false)
+      {
+        io_uring_params params;
+        std::memset(&params, 0, sizeof(params));
+        // Two entries per buffer, which has at most one write or a write back and eviction at a
+        // time, one to wake up the submitting thread and one to stop it.
+        m_ringFd = static_cast<int>(
+            syscall(__NR_io_uring_setup, static_cast<unsigned>(2 * bufferCount + 2), &params));
+        if (m_ringFd < 0)
+        {
+          return;
+        }
+
+        m_sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        m_cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        bool singleMmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (singleMmap)
+        {
+          m_sqRingSize = m_cqRingSize = std::max(m_sqRingSize, m_cqRingSize);
+        }
+        m_sqRing = Map(m_sqRingSize, IORING_OFF_SQ_RING);
+        m_cqRing = singleMmap ? m_sqRing : Map(m_cqRingSize, IORING_OFF_CQ_RING);
+        m_sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+        m_sqes = static_cast<io_uring_sqe*>(Map(m_sqesSize, IORING_OFF_SQES));
+        if (m_sqRing == nullptr || m_cqRing == nullptr || m_sqes == nullptr)
+        {
+          Close();
+          return;
+        }
+
+        auto sqRing = static_cast<uint8_t*>(m_sqRing);
+        m_sqHead = reinterpret_cast<unsigned*>(sqRing + params.sq_off.head);
+        m_sqTail = reinterpret_cast<unsigned*>(sqRing + params.sq_off.tail);
+        m_sqEntries = params.sq_entries;
+        m_sqMask = *reinterpret_cast<unsigned*>(sqRing + params.sq_off.ring_mask);
+        m_sqArray = reinterpret_cast<unsigned*>(sqRing + params.sq_off.array);
+        auto cqRing = static_cast<uint8_t*>(m_cqRing);
+        m_cqHead = reinterpret_cast<unsigned*>(cqRing + params.cq_off.head);
+        m_cqTail = reinterpret_cast<unsigned*>(cqRing + params.cq_off.tail);
+        m_cqMask = *reinterpret_cast<unsigned*>(cqRing + params.cq_off.ring_mask);
+        m_cqes = reinterpret_cast<io_uring_cqe*>(cqRing + params.cq_off.cqes);
+
+        // Kernels older than 5.6 can't be probed, they lack some of the operations used anyway.
+        std::vector<uint8_t> probe(
+            sizeof(io_uring_probe) + c_probedOperations * sizeof(io_uring_probe_op));
+        if (syscall(
+                __NR_io_uring_register,
+                m_ringFd,
+                IORING_REGISTER_PROBE,
+                probe.data(),
+                static_cast<unsigned>(c_probedOperations))
+            != 0)
+        {
+          Close();
+          return;
+        }
+        auto const& probed = *reinterpret_cast<io_uring_probe const*>(probe.data());
+        for (unsigned op = 0; op <= probed.last_op && op < c_probedOperations; ++op)
+        {
+          m_supported[op] = (probed.ops[op].flags & IO_URING_OP_SUPPORTED) != 0;
+        }
+
+        // Registered buffers spare the kernel mapping them for every operation, plain reads and
+        // writes are used if they can't be locked in memory.
+        std::vector<iovec> buffers(static_cast<std::size_t>(bufferCount));
+        for (int i = 0; i < bufferCount; ++i)
+        {
+          buffers[static_cast<std::size_t>(i)].iov_base = GetBuffer(i);
+          buffers[static_cast<std::size_t>(i)].iov_len = static_cast<std::size_t>(bufferSize);
+        }
+        m_fixedBuffers = IsSupported(IORING_OP_READ_FIXED) && IsSupported(IORING_OP_WRITE_FIXED)
+            && bufferSize <= std::numeric_limits<unsigned>::max()
+            && syscall(
+                   __NR_io_uring_register,
+                   m_ringFd,
+                   IORING_REGISTER_BUFFERS,
+                   buffers.data(),
+                   static_cast<unsigned>(bufferCount))
+                == 0;
+
+        // The thread pool is used when an operation can't be submitted to the ring.
+        if (!(m_fixedBuffers || (IsSupported(IORING_OP_READ) && IsSupported(IORING_OP_WRITE)))
+            || !IsSupported(IORING_OP_NOP) || !IsSupported(IORING_OP_SYNC_FILE_RANGE)
+            || !IsSupported(IORING_OP_FADVISE))
+        {
+          Close();
+          return;
+        }
+
+        m_reaper = std::thread([this]() { Reap(); });
+      }
+
+      ~IoUringFileIoEngine() override
+      {
+        if (m_reaper.joinable())
+        {
+          WaitIdle();
+          m_stopping = true;
+          {
+            std::lock_guard<std::mutex> guard(m_submitMutex);
+            if (Reserve(1) == 0)
+            {
+              NextSqe()->user_data = c_stopUserData;
+              Submit();
+            }
+          }
+          m_reaper.join();
+        }
+        Close();
+      }
+
+      bool IsReady() const { return m_reaper.joinable(); }
+
+      bool UsesIoUring() const override { return true; }
+
+    protected:
+      void Start(std::vector<Operation> operations) override
+      {
+        if (std::this_thread::get_id() == m_reaper.get_id())
+        {
+          SubmitOperations(operations);
+          return;
+        }
+
+        // The kernel cancels the reads and writes of a thread when it exits, and the threads
+        // transferring the chunks don't outlive the transfer, so the operations are submitted by
+        // the thread reaping the completions, woken up by a no-op.
+        {
+          std::lock_guard<std::mutex> guard(m_pendingMutex);
+          m_pending.insert(m_pending.end(), operations.begin(), operations.end());
+          if (m_wakePending)
+          {
+            return;
+          }
+          m_wakePending = true;
+        }
+        std::lock_guard<std::mutex> guard(m_submitMutex);
+        if (Reserve(1) == 0)
+        {
+          NextSqe()->user_data = c_wakeUserData;
+          Submit();
+        }
+      }
+
+    private:
+      static constexpr uint64_t c_stopUserData = std::numeric_limits<uint64_t>::max();
+      static constexpr uint64_t c_wakeUserData = c_stopUserData - 1;
+      static constexpr uint64_t c_ignoredUserData = c_stopUserData - 2;
+      static constexpr unsigned c_probedOperations = 256;
+
+      bool IsSupported(unsigned op) const { return op < c_probedOperations && m_supported[op]; }
+
+      void SubmitOperations(std::vector<Operation> const& operations)
+      {
+        std::lock_guard<std::mutex> guard(m_submitMutex);
+        std::vector<Operation> queued;
+        queued.reserve(operations.size());
+        for (auto const& operation : operations)
+        {
+          int reserveError = Reserve(1);
+          if (reserveError != 0)
+          {
+            Complete(operation, reserveError);
+            continue;
+          }
+          queued.push_back(operation);
+          m_operations[static_cast<std::size_t>(operation.BufferIndex)] = operation;
+          auto sqe = NextSqe();
+          int64_t length = std::min(operation.Length - operation.Done, c_maxTransferSize);
+          if (m_fixedBuffers)
+          {
+            sqe->opcode = operation.Write ? IORING_OP_WRITE_FIXED : IORING_OP_READ_FIXED;
+            sqe->buf_index = static_cast<uint16_t>(operation.BufferIndex);
+          }
+          else
+          {
+            sqe->opcode = operation.Write ? IORING_OP_WRITE : IORING_OP_READ;
+          }
+          sqe->fd = operation.Handle;
+          sqe->off = static_cast<uint64_t>(operation.Offset + operation.Done);
+          sqe->addr = reinterpret_cast<uint64_t>(GetBuffer(operation.BufferIndex) + operation.Done);
+          sqe->len = static_cast<unsigned>(length);
+          sqe->user_data = static_cast<uint64_t>(operation.BufferIndex);
+        }
+        int error = Submit();
+        if (error != 0)
+        {
+          for (auto const& operation : queued)
+          {
+            Complete(operation, error);
+          }
+        }
+      }
+
+      void* Map(std::size_t size, off_t offset)
+      {
+        void* address = mmap(
+            nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ringFd, offset);
+        return address == MAP_FAILED ? nullptr : address;
+      }
+
+      void Close()
+      {
+        if (m_sqes != nullptr)
+        {
+          munmap(m_sqes, m_sqesSize);
+        }
+        if (m_cqRing != nullptr && m_cqRing != m_sqRing)
+        {
+          munmap(m_cqRing, m_cqRingSize);
+        }
+        if (m_sqRing != nullptr)
+        {
+          munmap(m_sqRing, m_sqRingSize);
+        }
+        if (m_ringFd >= 0)
+        {
+          close(m_ringFd);
+        }
+        m_sqes = nullptr;
+        m_cqRing = m_sqRing = nullptr;
+        m_ringFd = -1;
+      }
+
+      // Called with m_submitMutex held, makes room for count entries in the submission queue by
+      // submitting the ones queued if it is full. Returns an errno if they can't be submitted.
+      int Reserve(unsigned count)
+      {
+        while (*m_sqTail - __atomic_load_n(m_sqHead, __ATOMIC_ACQUIRE) + count > m_sqEntries)
+        {
+          if (m_unsubmitted == 0)
+          {
+            return EBUSY;
+          }
+          int error = Submit();
+          if (error != 0)
+          {
+            return error;
+          }
+        }
+        return 0;
+      }
+
+      // Called with m_submitMutex held, after Reserve, returns a no-op entry to fill in.
+      io_uring_sqe* NextSqe()
+      {
+        unsigned tail = *m_sqTail;
+        unsigned index = tail & m_sqMask;
+        io_uring_sqe* sqe = &m_sqes[index];
+        std::memset(sqe, 0, sizeof(*sqe));
+        m_sqArray[index] = index;
+        __atomic_store_n(m_sqTail, tail + 1, __ATOMIC_RELEASE);
+        ++m_unsubmitted;
+        return sqe;
+      }
+
+      // Called with m_submitMutex held, submits the entries queued by NextSqe.
+      int Submit()
+      {
+        auto count = m_unsubmitted;
+        m_unsubmitted = 0;
+        return Enter(count);
+      }
+
+      // Writes back the ranges written and evicts them from the page cache, like DropFileCache.
+      void SubmitDropCache(std::vector<Operation> const& operations)
+      {
+        std::lock_guard<std::mutex> guard(m_submitMutex);
+        std::vector<Operation> queued;
+        queued.reserve(operations.size());
+        for (auto const& operation : operations)
+        {
+          // The two linked entries are queued together, evicting the range is advisory.
+          if (Reserve(2) != 0)
+          {
+            Complete(operation, 0);
+            continue;
+          }
+          queued.push_back(operation);
+          m_droppingCache[static_cast<std::size_t>(operation.BufferIndex)] = true;
+          auto sync = NextSqe();
+          sync->opcode = IORING_OP_SYNC_FILE_RANGE;
+          sync->flags = IOSQE_IO_LINK;
+          sync->fd = operation.Handle;
+          sync->off = static_cast<uint64_t>(operation.Offset);
+          sync->len = static_cast<unsigned>(operation.Length);
+          sync->sync_range_flags
+              = SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE | SYNC_FILE_RANGE_WAIT_AFTER;
+          sync->user_data = c_ignoredUserData;
+          auto fadvise = NextSqe();
+          fadvise->opcode = IORING_OP_FADVISE;
+          fadvise->fd = operation.Handle;
+          fadvise->off = static_cast<uint64_t>(operation.Offset);
+          fadvise->len = static_cast<unsigned>(operation.Length);
+          fadvise->fadvise_advice = POSIX_FADV_DONTNEED;
+          fadvise->user_data = static_cast<uint64_t>(operation.BufferIndex);
+        }
+        int error = Submit();
+        if (error != 0)
+        {
+          for (auto const& operation : queued)
+          {
+            m_droppingCache[static_cast<std::size_t>(operation.BufferIndex)] = false;
+            Complete(operation, 0);
+          }
+        }
+      }
+
+      int Enter(unsigned count)
+      {
+        while (count > 0)
+        {
+          long submitted = syscall(__NR_io_uring_enter, m_ringFd, count, 0, 0, nullptr, 0);
+          if (submitted < 0)
+          {
+            if (errno == EINTR || errno == EAGAIN || errno == EBUSY)
+            {
+              std::this_thread::yield();
+              continue;
+            }
+            return errno;
+          }
+          count -= static_cast<unsigned>(submitted);
+        }
+        return 0;
+      }
+
+      void Reap()
+      {
+        bool stop = false;
+        while (!stop)
+        {
+          if (syscall(__NR_io_uring_enter, m_ringFd, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0) < 0
+              && errno != EINTR)
+          {
+            // The ring is broken, the stop entry may not have been submitted either.
+            if (m_stopping)
+            {
+              return;
+            }
+            std::this_thread::yield();
+          }
+
+          std::vector<Operation> resumed;
+          std::vector<Operation> droppingCache;
+          unsigned head = *m_cqHead;
+          unsigned tail = __atomic_load_n(m_cqTail, __ATOMIC_ACQUIRE);
+          for (; head != tail; ++head)
+          {
+            io_uring_cqe const& cqe = m_cqes[head & m_cqMask];
+            if (cqe.user_data == c_stopUserData)
+            {
+              stop = true;
+              continue;
+            }
+            if (cqe.user_data == c_wakeUserData || cqe.user_data == c_ignoredUserData)
+            {
+              continue;
+            }
+            auto& operation = m_operations[static_cast<std::size_t>(cqe.user_data)];
+            if (m_droppingCache[static_cast<std::size_t>(cqe.user_data)])
+            {
+              // Evicting the written range is advisory, its failures are ignored.
+              m_droppingCache[static_cast<std::size_t>(cqe.user_data)] = false;
+              Complete(operation, 0);
+            }
+            else if (cqe.res == -EINTR || cqe.res == -EAGAIN)
+            {
+              resumed.push_back(operation);
+            }
+            else if (cqe.res < 0)
+            {
+              Complete(operation, -cqe.res);
+            }
+            else if (cqe.res == 0)
+            {
+              // End of the file for reads, a write that can't make progress otherwise.
+              Complete(operation, operation.Write ? EIO : 0);
+            }
+            else
+            {
+              operation.Done += cqe.res;
+              if (operation.Done < operation.Length)
+              {
+                resumed.push_back(operation);
+              }
+              else if (operation.DropCache)
+              {
+                droppingCache.push_back(operation);
+              }
+              else
+              {
+                Complete(operation, 0);
+              }
+            }
+          }
+          __atomic_store_n(m_cqHead, head, __ATOMIC_RELEASE);
+
+          {
+            std::lock_guard<std::mutex> guard(m_pendingMutex);
+            resumed.insert(resumed.end(), m_pending.begin(), m_pending.end());
+            m_pending.clear();
+            m_wakePending = false;
+          }
+          if (!resumed.empty())
+          {
+            SubmitOperations(resumed);
+          }
+          if (!droppingCache.empty())
+          {
+            SubmitDropCache(droppingCache);
+          }
+        }
+      }
+
+      int m_ringFd = -1;
+      void* m_sqRing = nullptr;
+      std::size_t m_sqRingSize = 0;
+      void* m_cqRing = nullptr;
+      std::size_t m_cqRingSize = 0;
+      io_uring_sqe* m_sqes = nullptr;
+      std::size_t m_sqesSize = 0;
+      unsigned* m_sqHead = nullptr;
+      unsigned* m_sqTail = nullptr;
+      unsigned m_sqEntries = 0;
+      unsigned m_unsubmitted = 0;
+      unsigned m_sqMask = 0;
+      unsigned* m_sqArray = nullptr;
+      unsigned* m_cqHead = nullptr;
+      unsigned* m_cqTail = nullptr;
+      unsigned m_cqMask = 0;
+      io_uring_cqe* m_cqes = nullptr;
+      bool m_fixedBuffers = false;
+      std::array<bool, c_probedOperations> m_supported{};
+      std::atomic<bool> m_stopping{false};
+
+      std::mutex m_pendingMutex;
+      std::vector<Operation> m_pending;
+      bool m_wakePending = false;
+
+      std::mutex m_submitMutex;
+      // Operation in flight on each buffer, by buffer index, and whether its written range is
+      // being evicted from the page cache.
+      std::vector<Operation> m_operations;
+      std::vector<bool> m_droppingCache;
+      std::thread m_reaper;
+    };
+#endif
+  } // namespace
+
+  std::unique_ptr<FileIoEngine> FileIoEngine::Create(
+      int bufferCount,
+      int64_t bufferSize,
+      bool useIoUring,
+      Azure::Core::Context context)
+  {
+    if (bufferCount <= 0 || bufferSize <= 0)
+    {
+      throw std::invalid_argument("invalid file I/O buffers");
+    }
+#ifdef AZURE_STORAGE_IO_URING
+    if (useIoUring)
+    {
+      auto engine = std::make_unique<IoUringFileIoEngine>(bufferCount, bufferSize, context);
+      if (engine->IsReady())
+      {
+        return engine;
+      }
+    }
+#else
+    (void)useIoUring;
+#endif
+    return std::make_unique<ThreadPoolFileIoEngine>(bufferCount, bufferSize, context);
+  }
+
+  FileIoEngine::FileIoEngine(int bufferCount, int64_t bufferSize, Azure::Core::Context& context)
+      : m_bufferSize(bufferSize),
+        m_bufferStride(
+            (bufferSize + c_directIoAlignment - 1) / c_directIoAlignment * c_directIoAlignment),
+        // The buffers of the pool are aligned to 4096 bytes, c_directIoAlignment.
+        m_storage(Azure::Core::Http::BufferPool::GetDefault().AcquireWithinBudget(
+            context, bufferCount * m_bufferStride)),
+        m_buffers(m_storage.Data()),
+        m_states(static_cast<std::size_t>(bufferCount), BufferState::Free),
+        m_readBytes(static_cast<std::size_t>(bufferCount), 0),
+        m_readErrors(static_cast<std::size_t>(bufferCount), 0)
+  {
+  }
+
+  FileIoEngine::~FileIoEngine() {}
+
+  int FileIoEngine::GetBufferIndex(uint8_t* buffer) const
+  {
+    auto index = (buffer - m_buffers) / m_bufferStride;
+    if (buffer < m_buffers || index >= GetBufferCount())
+    {
+      throw std::invalid_argument("buffer not owned by the engine");
+    }
+    return static_cast<int>(index);
+  }
+
+  uint8_t* FileIoEngine::AcquireFreeBuffer()
+  {
+    auto free = std::find(m_states.begin(), m_states.end(), BufferState::Free);
+    if (free == m_states.end())
+    {
+      return nullptr;
+    }
+    *free = BufferState::Acquired;
+    return GetBuffer(static_cast<int>(free - m_states.begin()));
+  }
+
+  uint8_t* FileIoEngine::AcquireBuffer()
+  {
+    std::unique_lock<std::mutex> guard(m_mutex);
+    while (true)
+    {
+      if (m_writeError != 0)
+      {
+        throw std::runtime_error("failed to write file");
+      }
+      auto buffer = AcquireFreeBuffer();
+      if (buffer != nullptr)
+      {
+        return buffer;
+      }
+      m_cv.wait(guard);
+    }
+  }
+
+  uint8_t* FileIoEngine::TryAcquireBuffer()
+  {
+    std::lock_guard<std::mutex> guard(m_mutex);
+    return AcquireFreeBuffer();
+  }
+
+  void FileIoEngine::ReleaseBuffer(uint8_t* buffer)
+  {
+    auto index = static_cast<std::size_t>(GetBufferIndex(buffer));
+    {
+      std::lock_guard<std::mutex> guard(m_mutex);
+      m_states[index] = BufferState::Free;
+    }
+    m_cv.notify_all();
+  }
+
+  void FileIoEngine::Queue(Operation operation, BufferState state)
+  {
+    if (operation.Length < 0 || operation.Length > m_bufferSize)
+    {
+      throw std::invalid_argument("invalid file I/O length");
+    }
+    std::lock_guard<std::mutex> guard(m_mutex);
+    m_states[static_cast<std::size_t>(operation.BufferIndex)] = state;
+    m_queued.push_back(operation);
+  }
+
+  void FileIoEngine::QueueRead(FileHandle handle, uint8_t* buffer, int64_t length, int64_t offset)
+  {
+    Operation operation;
+    operation.Handle = handle;
+    operation.BufferIndex = GetBufferIndex(buffer);
+    operation.Offset = offset;
+    operation.Length = length;
+    Queue(operation, BufferState::Reading);
+  }
+
+  void FileIoEngine::QueueWrite(
+      FileHandle handle,
+      uint8_t* buffer,
+      int64_t length,
+      int64_t offset,
+      bool dropCache)
+  {
+    Operation operation;
+    operation.Write = true;
+    operation.DropCache = dropCache;
+    operation.Handle = handle;
+    operation.BufferIndex = GetBufferIndex(buffer);
+    operation.Offset = offset;
+    operation.Length = length;
+    Queue(operation, BufferState::Writing);
+  }
+
+  void FileIoEngine::Submit()
+  {
+    std::vector<Operation> operations;
+    {
+      std::lock_guard<std::mutex> guard(m_mutex);
+      operations.swap(m_queued);
+      m_pendingOperations += static_cast<int>(operations.size());
+    }
+    if (!operations.empty())
+    {
+      Start(std::move(operations));
+    }
+  }
+
+  int64_t FileIoEngine::WaitRead(uint8_t* buffer)
+  {
+    auto index = static_cast<std::size_t>(GetBufferIndex(buffer));
+    std::unique_lock<std::mutex> guard(m_mutex);
+    m_cv.wait(guard, [this, index]() { return m_states[index] != BufferState::Reading; });
+    m_states[index] = BufferState::Acquired;
+    if (m_readErrors[index] != 0)
+    {
+      throw std::runtime_error("failed to read file");
+    }
+    return m_readBytes[index];
+  }
+
+  void FileIoEngine::Flush()
+  {
+    Submit();
+    std::unique_lock<std::mutex> guard(m_mutex);
+    m_cv.wait(guard, [this]() { return m_pendingOperations == 0; });
+    if (m_writeError != 0)
+    {
+      throw std::runtime_error("failed to write file");
+    }
+  }
+
+  void FileIoEngine::Complete(const Operation& operation, int error)
+  {
+    auto index = static_cast<std::size_t>(operation.BufferIndex);
+    {
+      std::lock_guard<std::mutex> guard(m_mutex);
+      if (operation.Write)
+      {
+        if (error != 0)
+        {
+          m_writeError = error;
+        }
+        m_states[index] = BufferState::Free;
+      }
+      else
+      {
+        m_readBytes[index] = operation.Done;
+        m_readErrors[index] = error;
+        m_states[index] = BufferState::Read;
+      }
+      --m_pendingOperations;
+    }
+    m_cv.notify_all();
+  }
+
+  void FileIoEngine::WaitIdle()
+  {
+    std::unique_lock<std::mutex> guard(m_mutex);
+    m_cv.wait(guard, [this]() { return m_pendingOperations == 0; });
+  }
+
+  FileReadAhead::FileReadAhead(
+      FileIoEngine& engine,
+      FileHandle handle,
+      int64_t offset,
+      int64_t length,
+      int64_t chunkSize,
+      int readAhead)
+      : m_engine(engine), m_handle(handle), m_offset(offset), m_length(length),
+        m_chunkSize(chunkSize), m_readAhead(readAhead),
+        m_chunkBuffers(static_cast<std::size_t>((length + chunkSize - 1) / chunkSize), nullptr)
+  {
+    if (chunkSize > engine.GetBufferSize())
+    {
+      throw std::invalid_argument("chunks larger than the file I/O buffers");
+    }
+  }
+
+  FileReadAhead::~FileReadAhead()
+  {
+    // Chunks read ahead that weren't transferred, after a failure.
+    for (auto buffer : m_chunkBuffers)
+    {
+      if (buffer != nullptr)
+      {
+        try
+        {
+          m_engine.WaitRead(buffer);
+        }
+        catch (std::exception&)
+        {
+        }
+        m_engine.ReleaseBuffer(buffer);
+      }
+    }
+  }
+
+  uint8_t* FileReadAhead::Acquire(int64_t chunkId)
+  {
+    uint8_t* buffer;
+    {
+      std::lock_guard<std::mutex> guard(m_mutex);
+      auto numChunks = static_cast<int64_t>(m_chunkBuffers.size());
+      // The threads take the chunks in order, the chunks before this one that still hold a
+      // buffer are being transferred by the other threads, so a buffer is free for this one.
+      auto lastChunkId = std::min(chunkId + m_readAhead, numChunks - 1);
+      for (; m_nextChunkId <= lastChunkId; ++m_nextChunkId)
+      {
+        auto chunkBuffer
+            = m_nextChunkId <= chunkId ? m_engine.AcquireBuffer() : m_engine.TryAcquireBuffer();
+        if (chunkBuffer == nullptr)
+        {
+          break;
+        }
+        m_engine.QueueRead(
+            m_handle,
+            chunkBuffer,
+            std::min(m_chunkSize, m_length - m_chunkSize * m_nextChunkId),
+            m_offset + m_chunkSize * m_nextChunkId);
+        m_chunkBuffers[static_cast<std::size_t>(m_nextChunkId)] = chunkBuffer;
+      }
+      m_engine.Submit();
+      buffer = m_chunkBuffers[static_cast<std::size_t>(chunkId)];
+      m_chunkBuffers[static_cast<std::size_t>(chunkId)] = nullptr;
+    }
+
+    auto expected = std::min(m_chunkSize, m_length - m_chunkSize * chunkId);
+    try
+    {
+      if (m_engine.WaitRead(buffer) != expected)
+      {
+        throw std::runtime_error("failed to read file");
+      }
+    }
+    catch (std::exception&)
+    {
+      m_engine.ReleaseBuffer(buffer);
+      throw;
+    }
+    return buffer;
+  }
+
+}}} // namespace Azure::Storage::Details
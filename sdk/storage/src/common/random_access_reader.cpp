@@ -0,0 +1,286 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// SPDX-License-Identifier: MIT
+
+#include "common/random_access_reader.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+namespace Azure { namespace Storage {
+
+  namespace {
+    // Readers waiting for a block wake up at least this often to notice cancellation.
+    constexpr auto c_maxBlockWait = std::chrono::milliseconds(50);
+  } // namespace
+
+  RandomAccessReader::RandomAccessReader(
+      int64_t size,
+      RandomAccessReaderOptions options,
+      Details::RangeGetter rangeGetter,
+      Azure::Core::Context context)
+      : m_size(size), m_options(std::move(options)), m_rangeGetter(std::move(rangeGetter)),
+        m_context(context.WithDeadline(Azure::Core::Context::time_point::max()))
+  {
+    if (m_size < 0 || m_options.BlockSize <= 0 || m_options.MaxCachedBlocks <= 0
+        || m_options.ReadAheadBlocks < 0)
+    {
+      throw std::invalid_argument("invalid random access reader options");
+    }
+  }
+
+  RandomAccessReader::~RandomAccessReader()
+  {
+    {
+      std::lock_guard<std::mutex> guard(m_mutex);
+      m_stopped = true;
+    }
+    m_context.Cancel();
+    m_cv.notify_all();
+    if (m_readAheadThread.joinable())
+    {
+      m_readAheadThread.join();
+    }
+  }
+
+  std::shared_ptr<RandomAccessReader::Block> RandomAccessReader::InsertBlock(int64_t blockId)
+  {
+    auto block = std::make_shared<Block>();
+    block->Length = std::min(m_options.BlockSize, m_size - blockId * m_options.BlockSize);
+    m_lru.push_front(blockId);
+    m_blocks[blockId] = CacheEntry{block, m_lru.begin()};
+
+    // Evict the least recently used blocks, except the ones being downloaded.
+    auto position = m_lru.end();
+    while (m_blocks.size() > static_cast<std::size_t>(m_options.MaxCachedBlocks)
+           && position != m_lru.begin())
+    {
+      --position;
+      auto entry = m_blocks.find(*position);
+      if (entry->second.Data->Ready)
+      {
+        m_blocks.erase(entry);
+        position = m_lru.erase(position);
+      }
+    }
+    return block;
+  }
+
+  std::shared_ptr<RandomAccessReader::Block> RandomAccessReader::GetBlock(
+      int64_t blockId,
+      bool& download)
+  {
+    auto entry = m_blocks.find(blockId);
+    if (entry == m_blocks.end())
+    {
+      download = true;
+      return InsertBlock(blockId);
+    }
+    m_lru.splice(m_lru.begin(), m_lru, entry->second.LruPosition);
+    // Don't wait for the read-ahead to reach a block it hasn't started yet.
+    download = m_readAheadQueue.erase(blockId) != 0;
+    return entry->second.Data;
+  }
+
+  void RandomAccessReader::DownloadBlocks(
+      Azure::Core::Context& context,
+      int64_t firstBlockId,
+      const std::vector<std::shared_ptr<Block>>& blocks)
+  {
+    std::exception_ptr error;
+    bool canceled = false;
+    try
+    {
+      int64_t length = 0;
+      for (const auto& block : blocks)
+      {
+        block->Buffer = Azure::Core::Http::BufferPool::GetDefault().Acquire(block->Length);
+        length += block->Length;
+      }
+      auto body = m_rangeGetter(context, firstBlockId * m_options.BlockSize, length);
+      for (const auto& block : blocks)
+      {
+        if (Azure::Core::Http::BodyStream::ReadToCount(
+                context, *body, block->Buffer.Data(), block->Length)
+            != block->Length)
+        {
+          throw std::runtime_error("error when reading body stream");
+        }
+      }
+    }
+    catch (std::exception&)
+    {
+      // The caller's cancellation isn't an error of the blocks, other readers may still want them.
+      canceled = context.CancelWhen() < std::chrono::system_clock::now();
+      if (!canceled)
+      {
+        error = std::current_exception();
+      }
+    }
+
+    {
+      std::lock_guard<std::mutex> guard(m_mutex);
+      for (std::size_t i = 0; i < blocks.size(); ++i)
+      {
+        blocks[i]->Ready = true;
+        blocks[i]->Error = error;
+        blocks[i]->Canceled = canceled;
+        // A failed block is requested again by the next read.
+        auto entry = m_blocks.find(firstBlockId + static_cast<int64_t>(i));
+        if ((error || canceled) && entry != m_blocks.end() && entry->second.Data == blocks[i])
+        {
+          m_lru.erase(entry->second.LruPosition);
+          m_blocks.erase(entry);
+        }
+      }
+    }
+    m_cv.notify_all();
+  }
+
+  void RandomAccessReader::ReadAhead()
+  {
+    while (true)
+    {
+      int64_t firstBlockId;
+      std::vector<std::shared_ptr<Block>> blocks;
+      {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_cv.wait(lock, [&]() { return m_stopped || !m_readAheadQueue.empty(); });
+        if (m_stopped)
+        {
+          return;
+        }
+        firstBlockId = m_readAheadQueue.begin()->first;
+        auto next = m_readAheadQueue.begin();
+        while (next != m_readAheadQueue.end()
+               && next->first == firstBlockId + static_cast<int64_t>(blocks.size()))
+        {
+          blocks.push_back(std::move(next->second));
+          next = m_readAheadQueue.erase(next);
+        }
+      }
+      DownloadBlocks(m_context, firstBlockId, blocks);
+    }
+  }
+
+  int64_t RandomAccessReader::ReadAt(
+      Azure::Core::Context& context,
+      int64_t offset,
+      uint8_t* buffer,
+      int64_t count)
+  {
+    if (offset < 0 || count < 0)
+    {
+      throw std::invalid_argument("invalid range");
+    }
+    context.ThrowIfCanceled();
+    if (offset >= m_size || count == 0)
+    {
+      return 0;
+    }
+    count = std::min(count, m_size - offset);
+    auto firstBlockId = offset / m_options.BlockSize;
+    auto lastBlockId = (offset + count - 1) / m_options.BlockSize;
+
+    std::vector<std::shared_ptr<Block>> blocks;
+    // Runs of adjacent blocks this read downloads, by id of their first block.
+    std::vector<std::pair<int64_t, std::vector<std::shared_ptr<Block>>>> downloads;
+    bool readAhead = false;
+    {
+      std::lock_guard<std::mutex> guard(m_mutex);
+      for (auto blockId = firstBlockId; blockId <= lastBlockId; ++blockId)
+      {
+        bool download = false;
+        auto block = GetBlock(blockId, download);
+        if (download)
+        {
+          if (downloads.empty()
+              || downloads.back().first + static_cast<int64_t>(downloads.back().second.size())
+                  != blockId)
+          {
+            downloads.emplace_back(blockId, std::vector<std::shared_ptr<Block>>());
+          }
+          downloads.back().second.push_back(block);
+        }
+        blocks.push_back(std::move(block));
+      }
+
+      m_sequentialReads = offset == m_lastReadEnd ? m_sequentialReads + 1 : 0;
+      m_lastReadEnd = offset + count;
+      if (m_options.ReadAheadBlocks > 0
+          && m_sequentialReads >= m_options.SequentialReadsBeforeReadAhead)
+      {
+        auto numBlocks = (m_size + m_options.BlockSize - 1) / m_options.BlockSize;
+        auto lastReadAheadId = std::min(lastBlockId + m_options.ReadAheadBlocks, numBlocks - 1);
+        for (auto blockId = lastBlockId + 1; blockId <= lastReadAheadId; ++blockId)
+        {
+          if (m_blocks.find(blockId) == m_blocks.end())
+          {
+            m_readAheadQueue[blockId] = InsertBlock(blockId);
+            readAhead = true;
+          }
+        }
+        if (readAhead && !m_readAheadThread.joinable())
+        {
+          m_readAheadThread = std::thread([this]() { ReadAhead(); });
+        }
+      }
+    }
+    if (readAhead)
+    {
+      m_cv.notify_all();
+    }
+
+    for (const auto& run : downloads)
+    {
+      DownloadBlocks(context, run.first, run.second);
+    }
+
+    int64_t bytesRead = 0;
+    for (std::size_t i = 0; i < blocks.size(); ++i)
+    {
+      auto blockId = firstBlockId + static_cast<int64_t>(i);
+      auto block = blocks[i];
+      while (true)
+      {
+        {
+          std::unique_lock<std::mutex> lock(m_mutex);
+          while (!block->Ready)
+          {
+            context.ThrowIfCanceled();
+            m_cv.wait_for(lock, c_maxBlockWait);
+          }
+        }
+        if (!block->Canceled)
+        {
+          break;
+        }
+        // The reader downloading the block was canceled, this one gets it again.
+        context.ThrowIfCanceled();
+        bool download = false;
+        {
+          std::lock_guard<std::mutex> guard(m_mutex);
+          block = GetBlock(blockId, download);
+        }
+        if (download)
+        {
+          DownloadBlocks(context, blockId, {block});
+        }
+      }
+      if (block->Error)
+      {
+        std::rethrow_exception(block->Error);
+      }
+      auto blockOffset = blockId * m_options.BlockSize;
+      auto begin = std::max(offset, blockOffset) - blockOffset;
+      auto end = std::min(offset + count, blockOffset + block->Length) - blockOffset;
+      std::memcpy(
+          buffer + bytesRead, block->Buffer.Data() + begin, static_cast<std::size_t>(end - begin));
+      bytesRead += end - begin;
+    }
+    return bytesRead;
+  }
+
+}} // namespace Azure::Storage
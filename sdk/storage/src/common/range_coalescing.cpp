@@ -0,0 +1,53 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// SPDX-License-Identifier: MIT
+
+#include "common/range_coalescing.hpp"
+
+#include <algorithm>
+
+namespace Azure { namespace Storage { namespace Details {
+
+  std::vector<CoalescedRange> CoalesceRanges(
+      const std::vector<std::pair<int64_t, int64_t>>& ranges,
+      int64_t maxGap,
+      int64_t maxLength)
+  {
+    std::vector<std::size_t> order;
+    for (std::size_t i = 0; i < ranges.size(); ++i)
+    {
+      if (ranges[i].second > 0)
+      {
+        order.push_back(i);
+      }
+    }
+    std::stable_sort(order.begin(), order.end(), [&](std::size_t lhs, std::size_t rhs) {
+      return ranges[lhs].first < ranges[rhs].first;
+    });
+
+    std::vector<CoalescedRange> coalesced;
+    for (auto i : order)
+    {
+      auto offset = ranges[i].first;
+      auto end = offset + ranges[i].second;
+      if (!coalesced.empty())
+      {
+        auto& last = coalesced.back();
+        auto lastEnd = last.Offset + last.Length;
+        if (offset - lastEnd <= maxGap && std::max(end, lastEnd) - last.Offset <= maxLength)
+        {
+          last.Overlapping = last.Overlapping || offset < lastEnd;
+          last.Length = std::max(end, lastEnd) - last.Offset;
+          last.Ranges.push_back(i);
+          continue;
+        }
+      }
+      CoalescedRange range;
+      range.Offset = offset;
+      range.Length = end - offset;
+      range.Ranges.push_back(i);
+      coalesced.push_back(std::move(range));
+    }
+    return coalesced;
+  }
+
+}}} // namespace Azure::Storage::Details
@@ -0,0 +1,166 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// SPDX-License-Identifier: MIT
+
+#include "common/read_ahead_stream.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+
+namespace Azure { namespace Storage { namespace Details {
+
+  namespace {
+    // Readers waiting for a chunk wake up at least this often to notice cancellation.
+    constexpr auto c_maxChunkWait = std::chrono::milliseconds(50);
+  } // namespace
+
+  ReadAheadStream::ReadAheadStream(
+      std::unique_ptr<Azure::Core::Http::BodyStream> firstChunk,
+      int64_t offset,
+      int64_t length,
+      ReadAheadStreamOptions options,
+      RangeGetter rangeGetter,
+      Azure::Core::Context context)
+      : m_firstChunk(std::move(firstChunk)), m_offset(offset), m_length(length),
+        m_options(std::move(options)), m_rangeGetter(std::move(rangeGetter)),
+        m_context(context.WithDeadline(Azure::Core::Context::time_point::max())),
+        m_numChunks((length + m_options.ChunkSize - 1) / m_options.ChunkSize)
+  {
+    if (m_options.ChunkSize <= 0 || m_options.Concurrency <= 0 || m_options.MaxChunksAhead <= 0)
+    {
+      throw std::invalid_argument("invalid read-ahead options");
+    }
+    auto threadCount = std::min(
+        {static_cast<int64_t>(m_options.Concurrency),
+         static_cast<int64_t>(m_options.MaxChunksAhead),
+         m_numChunks - 1});
+    for (int64_t i = 0; i < threadCount; ++i)
+    {
+      m_threads.emplace_back([this]() { FetchChunks(); });
+    }
+  }
+
+  ReadAheadStream::~ReadAheadStream()
+  {
+    {
+      std::lock_guard<std::mutex> guard(m_mutex);
+      m_stopped = true;
+    }
+    m_context.Cancel();
+    m_cv.notify_all();
+    for (auto& thread : m_threads)
+    {
+      thread.join();
+    }
+  }
+
+  void ReadAheadStream::FetchChunks()
+  {
+    while (true)
+    {
+      int64_t chunkId;
+      {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_cv.wait(lock, [&]() {
+          return m_stopped || m_nextChunkId >= m_numChunks
+              || m_nextChunkId <= m_position / m_options.ChunkSize + m_options.MaxChunksAhead;
+        });
+        if (m_stopped || m_nextChunkId >= m_numChunks)
+        {
+          return;
+        }
+        chunkId = m_nextChunkId++;
+        m_chunks[chunkId];
+      }
+
+      Chunk chunk;
+      try
+      {
+        auto chunkOffset = chunkId * m_options.ChunkSize;
+        chunk.Length = std::min(m_options.ChunkSize, m_length - chunkOffset);
+        chunk.Buffer = Azure::Core::Http::BufferPool::GetDefault().AcquireWithinBudget(
+            m_context, chunk.Length);
+        auto body = m_rangeGetter(m_context, m_offset + chunkOffset, chunk.Length);
+        if (Azure::Core::Http::BodyStream::ReadToCount(
+                m_context, *body, chunk.Buffer.Data(), chunk.Length)
+            != chunk.Length)
+        {
+          throw std::runtime_error("error when reading body stream");
+        }
+      }
+      catch (std::exception&)
+      {
+        chunk.Error = std::current_exception();
+      }
+      chunk.Ready = true;
+      {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        m_chunks[chunkId] = std::move(chunk);
+      }
+      m_cv.notify_all();
+    }
+  }
+
+  int64_t ReadAheadStream::Read(Azure::Core::Context& context, uint8_t* buffer, int64_t count)
+  {
+    context.ThrowIfCanceled();
+    if (m_position >= m_length || count <= 0)
+    {
+      return 0;
+    }
+    auto chunkId = m_position / m_options.ChunkSize;
+    auto offsetInChunk = m_position % m_options.ChunkSize;
+
+    if (chunkId == 0)
+    {
+      auto firstChunkLength = std::min(m_options.ChunkSize, m_length);
+      auto bytesRead
+          = m_firstChunk->Read(context, buffer, std::min(count, firstChunkLength - offsetInChunk));
+      if (bytesRead == 0)
+      {
+        throw std::runtime_error("error when reading body stream");
+      }
+      {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        m_position += bytesRead;
+      }
+      if (m_position == firstChunkLength)
+      {
+        m_firstChunk.reset();
+        m_cv.notify_all();
+      }
+      return bytesRead;
+    }
+
+    Chunk* chunk;
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      chunk = &m_chunks[chunkId];
+      while (!chunk->Ready)
+      {
+        context.ThrowIfCanceled();
+        m_cv.wait_for(lock, c_maxChunkWait);
+      }
+    }
+    if (chunk->Error)
+    {
+      std::rethrow_exception(chunk->Error);
+    }
+
+    // The chunk is only changed by this thread once it is ready, and map nodes don't move.
+    auto bytesRead = std::min(count, chunk->Length - offsetInChunk);
+    std::memcpy(buffer, chunk->Buffer.Data() + offsetInChunk, static_cast<std::size_t>(bytesRead));
+    {
+      std::lock_guard<std::mutex> guard(m_mutex);
+      m_position += bytesRead;
+      if (offsetInChunk + bytesRead == chunk->Length)
+      {
+        m_chunks.erase(chunkId);
+      }
+    }
+    m_cv.notify_all();
+    return bytesRead;
+  }
+
+}}} // namespace Azure::Storage::Details
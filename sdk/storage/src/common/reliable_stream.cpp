@@ -0,0 +1,71 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// SPDX-License-Identifier: MIT
+
+#include "common/reliable_stream.hpp"
+
+#include "http/http.hpp"
+
+#include <algorithm>
+#include <thread>
+
+namespace Azure { namespace Storage { namespace Details {
+
+  namespace {
+    // Sleeps in slices so that a cancellation of the context is noticed while backing off.
+    void BackOff(Azure::Core::Context& context, std::chrono::milliseconds delay)
+    {
+      constexpr auto c_slice = std::chrono::milliseconds(10);
+      auto until = std::chrono::steady_clock::now() + delay;
+      for (auto now = std::chrono::steady_clock::now(); now < until;
+           now = std::chrono::steady_clock::now())
+      {
+        context.ThrowIfCanceled();
+        std::this_thread::sleep_for(
+            std::min<std::chrono::steady_clock::duration>(c_slice, until - now));
+      }
+      context.ThrowIfCanceled();
+    }
+  } // namespace
+
+  int64_t ReliableStream::Read(Azure::Core::Context& context, uint8_t* buffer, int64_t count)
+  {
+    while (true)
+    {
+      try
+      {
+        if (!m_inner)
+        {
+          m_inner = m_httpGetter(context, m_offset);
+        }
+        int64_t bytesRead = m_inner->Read(context, buffer, count);
+        if (bytesRead == 0 && count > 0 && m_length >= 0 && m_offset < m_length)
+        {
+          // Connection was closed before all the content arrived.
+          throw Azure::Core::Http::TransportException("Unexpected end of body stream");
+        }
+        m_offset += bytesRead;
+        return bytesRead;
+      }
+      catch (Azure::Core::Http::TransportException const&)
+      {
+        if (m_retries >= m_options.MaxRetryRequests)
+        {
+          throw;
+        }
+      }
+      catch (Azure::Core::Http::CouldNotResolveHostException const&)
+      {
+        if (m_retries >= m_options.MaxRetryRequests)
+        {
+          throw;
+        }
+      }
+      // Release the broken connection, a new one is requested on next iteration.
+      m_inner.reset();
+      auto delay = m_options.RetryDelay * (1 << std::min(m_retries, 16));
+      ++m_retries;
+      BackOff(context, std::min(delay, m_options.MaxRetryDelay));
+    }
+  }
+
+}}} // namespace Azure::Storage::Details
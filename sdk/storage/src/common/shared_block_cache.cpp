@@ -0,0 +1,480 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// SPDX-License-Identifier: MIT
+
+#include "common/shared_block_cache.hpp"
+
+#include "metrics.hpp"
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+
+static_assert(
+    ATOMIC_INT_LOCK_FREE == 2 && ATOMIC_LONG_LOCK_FREE == 2 && ATOMIC_LLONG_LOCK_FREE == 2,
+    "the shared block cache needs address-free atomics");
+
+namespace Azure { namespace Storage {
+
+  namespace {
+    constexpr uint64_t c_magic = 0x32434b4c42524853ULL; // "SHRBLKC2"
+    constexpr int64_t c_pageSize = 4096;
+    constexpr int64_t c_ways = 8;
+    // How long a process opening a cache waits for the process creating it to initialize it.
+    constexpr auto c_maxInitializationWait = std::chrono::seconds(5);
+    // How long a slot may stay odd before it is considered abandoned by a writer that died.
+    constexpr auto c_maxWriteDuration = std::chrono::seconds(30);
+
+    // The segment starts with a page holding the header, followed by the CLOCK hand of each set
+    // and the slots, then the blocks, aligned to a page. A new segment is zero-filled, which is
+    // the initial state of all of these.
+    struct SegmentHeader
+    {
+      std::atomic<uint64_t> Magic;
+      int64_t BlockSize;
+      int64_t BlockCount;
+    };
+
+    struct Slot
+    {
+      // Odd while the slot is written.
+      std::atomic<uint64_t> Sequence;
+      std::atomic<uint64_t> KeyHash;
+      std::atomic<uint64_t> KeyCheck;
+      std::atomic<int64_t> BlockId;
+      // 0 for an empty slot.
+      std::atomic<int64_t> Length;
+      std::atomic<uint32_t> Referenced;
+      // When the last write started, on the steady clock shared by the processes of the host.
+      std::atomic<int64_t> WriteStartedAt;
+    };
+
+    int64_t GetTimestamp()
+    {
+      return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                 std::chrono::steady_clock::now().time_since_epoch())
+          .count();
+    }
+
+    bool IsAbandoned(const Slot& slot)
+    {
+      return GetTimestamp() - slot.WriteStartedAt.load(std::memory_order_relaxed)
+          > std::chrono::duration_cast<std::chrono::nanoseconds>(c_maxWriteDuration).count();
+    }
+
+    int64_t GetSetCount(int64_t blockCount) { return (blockCount + c_ways - 1) / c_ways; }
+
+    int64_t GetSlotsOffset(int64_t blockCount)
+    {
+      auto handsSize
+          = GetSetCount(blockCount) * static_cast<int64_t>(sizeof(std::atomic<uint32_t>));
+      auto alignment = static_cast<int64_t>(alignof(Slot));
+      return c_pageSize + (handsSize + alignment - 1) / alignment * alignment;
+    }
+
+    int64_t GetBlocksOffset(int64_t blockCount)
+    {
+      auto slotsEnd
+          = GetSlotsOffset(blockCount) + blockCount * static_cast<int64_t>(sizeof(Slot));
+      return (slotsEnd + c_pageSize - 1) / c_pageSize * c_pageSize;
+    }
+
+    int64_t GetSegmentSize(int64_t blockSize, int64_t blockCount)
+    {
+      return GetBlocksOffset(blockCount) + blockSize * blockCount;
+    }
+
+    std::atomic<uint32_t>* GetHands(void* mapping)
+    {
+      return reinterpret_cast<std::atomic<uint32_t>*>(
+          static_cast<uint8_t*>(mapping) + c_pageSize);
+    }
+
+    Slot* GetSlots(void* mapping, int64_t blockCount)
+    {
+      return reinterpret_cast<Slot*>(
+          static_cast<uint8_t*>(mapping) + GetSlotsOffset(blockCount));
+    }
+
+    uint8_t* GetBlock(void* mapping, int64_t blockSize, int64_t blockCount, int64_t slot)
+    {
+      return static_cast<uint8_t*>(mapping) + GetBlocksOffset(blockCount) + slot * blockSize;
+    }
+
+    // FNV-1a of the key and the block id from the given basis, finished with the splitmix64
+    // mixer so that the low bits used to pick a set are well distributed.
+    uint64_t Hash(const std::string& key, int64_t blockId, uint64_t basis)
+    {
+      uint64_t hash = basis;
+      auto mix = [&](uint8_t byte) {
+        hash ^= byte;
+        hash *= 0x100000001b3ULL;
+      };
+      for (auto c : key)
+      {
+        mix(static_cast<uint8_t>(c));
+      }
+      for (int i = 0; i < 8; ++i)
+      {
+        mix(static_cast<uint8_t>(static_cast<uint64_t>(blockId) >> (8 * i)));
+      }
+      hash ^= hash >> 30;
+      hash *= 0xbf58476d1ce4e5b9ULL;
+      hash ^= hash >> 27;
+      hash *= 0x94d049bb133111ebULL;
+      hash ^= hash >> 31;
+      return hash;
+    }
+
+    std::string GetSegmentName(const std::string& name)
+    {
+      if (name.empty()
+          || std::find_if(
+                 name.begin(),
+                 name.end(),
+                 [](char c) {
+                   return !((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z')
+                            || (c >= '0' && c <= '9') || c == '-' || c == '_');
+                 })
+              != name.end())
+      {
+        throw std::invalid_argument("invalid shared block cache name");
+      }
+#ifdef _WIN32
+      return "Local\\azure-storage-" + name;
+#else
+      return "/azure-storage-" + name;
+#endif
+    }
+
+    // Waits for the process creating the segment to initialize its header, returns false if it
+    // didn't in time.
+    bool WaitForInitialization(const SegmentHeader* header)
+    {
+      auto deadline = std::chrono::steady_clock::now() + c_maxInitializationWait;
+      while (header->Magic.load(std::memory_order_acquire) != c_magic)
+      {
+        if (std::chrono::steady_clock::now() > deadline)
+        {
+          return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+      return true;
+    }
+
+    Azure::Core::Metrics::Counter& LookupsCounter(bool hit)
+    {
+      static auto& hits = Azure::Core::Metrics::MetricsRegistry::GetDefault().GetCounter(
+          "azure_storage_shared_block_cache_hits_total",
+          "Number of blocks found in the shared block cache.");
+      static auto& misses = Azure::Core::Metrics::MetricsRegistry::GetDefault().GetCounter(
+          "azure_storage_shared_block_cache_misses_total",
+          "Number of blocks looked up and not found in the shared block cache.");
+      return hit ? hits : misses;
+    }
+  } // namespace
+
+  SharedBlockCache::SharedBlockCache(
+      const std::string& name,
+      const SharedBlockCacheOptions& options)
+  {
+    if (options.BlockSize <= 0 || options.BlockCount <= 0)
+    {
+      throw std::invalid_argument("invalid shared block cache options");
+    }
+    auto segmentName = GetSegmentName(name);
+    // The sets are full, so that no slot is left out.
+    auto blockCount = GetSetCount(options.BlockCount) * c_ways;
+    auto blockSize = (options.BlockSize + c_pageSize - 1) / c_pageSize * c_pageSize;
+    // The first attempt removes a segment whose creator died before initializing it, the second
+    // one creates a new segment.
+    if (!TryOpen(segmentName, blockSize, blockCount)
+        && !TryOpen(segmentName, blockSize, blockCount))
+    {
+      throw std::runtime_error("shared block cache isn't initialized");
+    }
+    auto header = static_cast<SegmentHeader*>(m_mapping);
+    m_blockSize = header->BlockSize;
+    m_blockCount = header->BlockCount;
+  }
+
+  bool SharedBlockCache::TryOpen(
+      const std::string& segmentName,
+      int64_t blockSize,
+      int64_t blockCount)
+  {
+    auto segmentSize = static_cast<uint64_t>(GetSegmentSize(blockSize, blockCount));
+
+#ifdef _WIN32
+    m_handle = CreateFileMappingA(
+        INVALID_HANDLE_VALUE,
+        nullptr,
+        PAGE_READWRITE,
+        static_cast<DWORD>(segmentSize >> 32),
+        static_cast<DWORD>(segmentSize),
+        segmentName.data());
+    if (m_handle == NULL)
+    {
+      throw std::runtime_error("failed to open shared block cache");
+    }
+    bool created = GetLastError() != ERROR_ALREADY_EXISTS;
+    m_mapping = MapViewOfFile(m_handle, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+    if (m_mapping == NULL)
+    {
+      CloseHandle(m_handle);
+      m_mapping = nullptr;
+      throw std::runtime_error("failed to map shared block cache");
+    }
+    MEMORY_BASIC_INFORMATION info;
+    VirtualQuery(m_mapping, &info, sizeof(info));
+    m_mappingSize = info.RegionSize;
+    // The segment of a creator that died goes away once the processes waiting for it close it.
+    auto abandon = [this]() { Unmap(); };
+#else
+    bool created = true;
+    int fd = shm_open(segmentName.data(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd == -1 && errno == EEXIST)
+    {
+      created = false;
+      fd = shm_open(segmentName.data(), O_RDWR, 0);
+    }
+    if (fd == -1)
+    {
+      throw std::runtime_error("failed to open shared block cache");
+    }
+    // The segment of a creator that died is removed, unless it was replaced meanwhile.
+    auto abandon = [this, &segmentName, fd]() {
+      Unmap();
+      struct stat abandonedStat;
+      struct stat currentStat;
+      int current = shm_open(segmentName.data(), O_RDWR, 0);
+      if (current != -1)
+      {
+        if (fstat(fd, &abandonedStat) == 0 && fstat(current, &currentStat) == 0
+            && abandonedStat.st_dev == currentStat.st_dev
+            && abandonedStat.st_ino == currentStat.st_ino)
+        {
+          shm_unlink(segmentName.data());
+        }
+        close(current);
+      }
+      close(fd);
+    };
+    if (created)
+    {
+      if (ftruncate(fd, static_cast<off_t>(segmentSize)) != 0)
+      {
+        close(fd);
+        shm_unlink(segmentName.data());
+        throw std::runtime_error("failed to allocate shared block cache");
+      }
+    }
+    else
+    {
+      // Wait for the creator to size the segment, the header then tells its geometry.
+      auto deadline = std::chrono::steady_clock::now() + c_maxInitializationWait;
+      struct stat fileStat;
+      while (fstat(fd, &fileStat) == 0 && fileStat.st_size < c_pageSize)
+      {
+        if (std::chrono::steady_clock::now() > deadline)
+        {
+          abandon();
+          return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+      segmentSize = static_cast<uint64_t>(fileStat.st_size);
+    }
+    m_mappingSize = static_cast<std::size_t>(segmentSize);
+    m_mapping = mmap(nullptr, m_mappingSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (m_mapping == MAP_FAILED)
+    {
+      m_mapping = nullptr;
+      close(fd);
+      throw std::runtime_error("failed to map shared block cache");
+    }
+#endif
+
+    auto header = static_cast<SegmentHeader*>(m_mapping);
+    if (created)
+    {
+      header->BlockSize = blockSize;
+      header->BlockCount = blockCount;
+      header->Magic.store(c_magic, std::memory_order_release);
+    }
+    if (!WaitForInitialization(header))
+    {
+      abandon();
+      return false;
+    }
+#ifndef _WIN32
+    close(fd);
+#endif
+    if (header->BlockSize <= 0 || header->BlockCount <= 0
+        || static_cast<uint64_t>(GetSegmentSize(header->BlockSize, header->BlockCount))
+            > m_mappingSize)
+    {
+      Unmap();
+      throw std::runtime_error("invalid shared block cache");
+    }
+    return true;
+  }
+
+  SharedBlockCache::~SharedBlockCache() { Unmap(); }
+
+  void SharedBlockCache::Unmap()
+  {
+    if (m_mapping == nullptr)
+    {
+      return;
+    }
+#ifdef _WIN32
+    UnmapViewOfFile(m_mapping);
+    CloseHandle(m_handle);
+#else
+    munmap(m_mapping, m_mappingSize);
+#endif
+    m_mapping = nullptr;
+  }
+
+  void SharedBlockCache::Remove(const std::string& name)
+  {
+#ifdef _WIN32
+    (void)GetSegmentName(name);
+#else
+    shm_unlink(GetSegmentName(name).data());
+#endif
+  }
+
+  bool SharedBlockCache::Lookup(
+      const std::string& key,
+      int64_t blockId,
+      uint8_t* buffer,
+      int64_t length)
+  {
+    auto keyHash = Hash(key, blockId, 0xcbf29ce484222325ULL);
+    auto keyCheck = Hash(key, blockId, 0x84222325cbf29ce4ULL);
+    auto set = static_cast<int64_t>(keyHash % static_cast<uint64_t>(m_blockCount / c_ways));
+    auto slots = GetSlots(m_mapping, m_blockCount);
+    for (auto i = set * c_ways; i < (set + 1) * c_ways; ++i)
+    {
+      auto& slot = slots[i];
+      auto sequence = slot.Sequence.load(std::memory_order_acquire);
+      if (sequence % 2 != 0 || slot.KeyHash.load(std::memory_order_relaxed) != keyHash
+          || slot.KeyCheck.load(std::memory_order_relaxed) != keyCheck
+          || slot.BlockId.load(std::memory_order_relaxed) != blockId
+          || slot.Length.load(std::memory_order_relaxed) != length || length > m_blockSize)
+      {
+        continue;
+      }
+      std::memcpy(
+          buffer,
+          GetBlock(m_mapping, m_blockSize, m_blockCount, i),
+          static_cast<std::size_t>(length));
+      // The copy is only valid if no write of the slot started meanwhile.
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (slot.Sequence.load(std::memory_order_relaxed) != sequence)
+      {
+        continue;
+      }
+      slot.Referenced.store(1, std::memory_order_relaxed);
+      LookupsCounter(true).Increment();
+      return true;
+    }
+    LookupsCounter(false).Increment();
+    return false;
+  }
+
+  void SharedBlockCache::Insert(
+      const std::string& key,
+      int64_t blockId,
+      const uint8_t* data,
+      int64_t length)
+  {
+    if (length <= 0 || length > m_blockSize)
+    {
+      return;
+    }
+    auto keyHash = Hash(key, blockId, 0xcbf29ce484222325ULL);
+    auto keyCheck = Hash(key, blockId, 0x84222325cbf29ce4ULL);
+    auto set = static_cast<int64_t>(keyHash % static_cast<uint64_t>(m_blockCount / c_ways));
+    auto slots = GetSlots(m_mapping, m_blockCount);
+    for (auto i = set * c_ways; i < (set + 1) * c_ways; ++i)
+    {
+      auto& slot = slots[i];
+      if (slot.KeyHash.load(std::memory_order_relaxed) == keyHash
+          && slot.KeyCheck.load(std::memory_order_relaxed) == keyCheck
+          && slot.BlockId.load(std::memory_order_relaxed) == blockId)
+      {
+        // Cached already, or being cached by another process.
+        return;
+      }
+    }
+
+    auto& hand = GetHands(m_mapping)[set];
+    // CLOCK: skip the slots referenced since the hand last passed them, clearing their bit, and
+    // take the first other one. Two turns always find one. A slot left odd by a writer that died
+    // is taken over.
+    Slot* victim = nullptr;
+    uint64_t sequence = 0;
+    for (int64_t step = 0; step < 2 * c_ways && victim == nullptr; ++step)
+    {
+      auto& slot = slots[set * c_ways + hand.fetch_add(1, std::memory_order_relaxed) % c_ways];
+      sequence = slot.Sequence.load(std::memory_order_acquire);
+      if (sequence % 2 != 0)
+      {
+        if (IsAbandoned(slot))
+        {
+          victim = &slot;
+        }
+        continue;
+      }
+      if (slot.Length.load(std::memory_order_relaxed) != 0
+          && slot.Referenced.exchange(0, std::memory_order_relaxed) != 0)
+      {
+        continue;
+      }
+      victim = &slot;
+    }
+    if (victim == nullptr)
+    {
+      return;
+    }
+    // The start of the write is published with the odd sequence number, the processes that see
+    // it don't take the slot over.
+    auto writing = sequence % 2 != 0 ? sequence + 2 : sequence + 1;
+    victim->WriteStartedAt.store(GetTimestamp(), std::memory_order_relaxed);
+    if (!victim->Sequence.compare_exchange_strong(
+            sequence, writing, std::memory_order_acq_rel))
+    {
+      return;
+    }
+    std::atomic_thread_fence(std::memory_order_release);
+    victim->KeyHash.store(keyHash, std::memory_order_relaxed);
+    victim->KeyCheck.store(keyCheck, std::memory_order_relaxed);
+    victim->BlockId.store(blockId, std::memory_order_relaxed);
+    victim->Length.store(length, std::memory_order_relaxed);
+    victim->Referenced.store(1, std::memory_order_relaxed);
+    std::memcpy(
+        GetBlock(m_mapping, m_blockSize, m_blockCount, victim - slots),
+        data,
+        static_cast<std::size_t>(length));
+    // Unless the write took so long that another process took the slot over.
+    victim->Sequence.compare_exchange_strong(writing, writing + 1, std::memory_order_release);
+  }
+
+}} // namespace Azure::Storage
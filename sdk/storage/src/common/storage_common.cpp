@@ -0,0 +1,27 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// SPDX-License-Identifier: MIT
+
+#include "common/storage_common.hpp"
+
+namespace Azure { namespace Storage { namespace Details {
+
+  std::unique_ptr<Azure::Core::Http::HttpPolicy> CreateRetryPolicy(
+      Azure::Core::Http::RetryOptions options,
+      const std::string& host)
+  {
+    if (!options.Budget)
+    {
+      // Blob and dfs endpoints of an account are throttled together.
+      std::string accountHost = host;
+      const std::string dfsEndpoint = ".dfs.";
+      auto pos = accountHost.find(dfsEndpoint);
+      if (pos != std::string::npos)
+      {
+        accountHost.replace(pos, dfsEndpoint.length(), ".blob.");
+      }
+      options.Budget = Azure::Core::Http::RetryBudget::GetShared(accountHost);
+    }
+    return std::make_unique<Azure::Core::Http::RetryPolicy>(std::move(options));
+  }
+
+}}} // namespace Azure::Storage::Details
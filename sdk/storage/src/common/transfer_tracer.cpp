@@ -0,0 +1,195 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// SPDX-License-Identifier: MIT
+
+#include "common/transfer_tracer.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+namespace Azure { namespace Storage {
+
+  namespace {
+    int GetThreadId()
+    {
+      static std::atomic<int> nextThreadId{1};
+      thread_local int threadId = nextThreadId.fetch_add(1, std::memory_order_relaxed);
+      return threadId;
+    }
+
+    const char* GetSpanName(TransferSpanKind kind)
+    {
+      switch (kind)
+      {
+        case TransferSpanKind::Queued:
+          return "queued";
+        case TransferSpanKind::Chunk:
+          return "chunk";
+        case TransferSpanKind::Retry:
+          return "retry";
+        case TransferSpanKind::Connect:
+          return "connect";
+        case TransferSpanKind::RequestSend:
+          return "request sent";
+        case TransferSpanKind::TimeToFirstByte:
+          return "first byte";
+        case TransferSpanKind::Body:
+          return "body";
+        case TransferSpanKind::FileRead:
+          return "file read";
+        default:
+          return "file write";
+      }
+    }
+
+    struct SpanSnapshot
+    {
+      int Kind;
+      int ThreadId;
+      int64_t ChunkId;
+      int64_t Offset;
+      int64_t Length;
+      int64_t Begin;
+      int64_t Duration;
+    };
+  } // namespace
+
+  TransferTracer::TransferTracer(std::size_t capacity)
+      : m_origin(std::chrono::steady_clock::now()), m_capacity(std::max<std::size_t>(capacity, 1)),
+        m_spans(new Span[m_capacity])
+  {
+  }
+
+  void TransferTracer::RecordSpan(
+      TransferSpanKind kind,
+      int64_t chunkId,
+      int64_t offset,
+      int64_t length,
+      std::chrono::steady_clock::time_point begin,
+      std::chrono::steady_clock::time_point end)
+  {
+    using std::chrono::duration_cast;
+    using std::chrono::microseconds;
+
+    auto index = m_next.fetch_add(1, std::memory_order_relaxed);
+    auto& span = m_spans[static_cast<std::size_t>(index % m_capacity)];
+    span.Sequence.store(2 * index + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    span.Kind.store(static_cast<int>(kind), std::memory_order_relaxed);
+    span.ThreadId.store(GetThreadId(), std::memory_order_relaxed);
+    span.ChunkId.store(chunkId, std::memory_order_relaxed);
+    span.Offset.store(offset, std::memory_order_relaxed);
+    span.Length.store(length, std::memory_order_relaxed);
+    span.Begin.store(
+        duration_cast<microseconds>(begin - m_origin).count(), std::memory_order_relaxed);
+    span.Duration.store(
+        std::max<int64_t>(duration_cast<microseconds>(end - begin).count(), 0),
+        std::memory_order_relaxed);
+    span.Sequence.store(2 * index + 2, std::memory_order_release);
+  }
+
+  void TransferTracer::RecordResponse(
+      int64_t chunkId,
+      int64_t offset,
+      int64_t length,
+      Azure::Core::Http::RawResponse const& response,
+      std::chrono::steady_clock::time_point headersReceived)
+  {
+    // The timings are durations, the spans are laid out backwards from the end of the headers.
+    auto const& timings = response.GetTimings();
+    auto firstByteBegin = headersReceived - timings.TimeToFirstByte;
+    RecordSpan(
+        TransferSpanKind::TimeToFirstByte,
+        chunkId,
+        offset,
+        length,
+        firstByteBegin,
+        headersReceived);
+    auto sendBegin = firstByteBegin - timings.RequestSend;
+    RecordSpan(TransferSpanKind::RequestSend, chunkId, offset, length, sendBegin, firstByteBegin);
+    auto connectBegin = sendBegin - timings.NameLookup - timings.Connect - timings.TlsHandshake;
+    if (connectBegin != sendBegin)
+    {
+      RecordSpan(TransferSpanKind::Connect, chunkId, offset, length, connectBegin, sendBegin);
+    }
+    if (timings.Retries > 0)
+    {
+      RecordSpan(
+          TransferSpanKind::Retry,
+          chunkId,
+          offset,
+          length,
+          connectBegin - timings.FailedAttempts - timings.RetryBackOff,
+          connectBegin);
+    }
+  }
+
+  std::string TransferTracer::ToChromeTrace() const
+  {
+    std::vector<SpanSnapshot> spans;
+    spans.reserve(m_capacity);
+    for (std::size_t i = 0; i < m_capacity; ++i)
+    {
+      auto const& span = m_spans[i];
+      auto sequence = span.Sequence.load(std::memory_order_acquire);
+      if (sequence == 0 || sequence % 2 == 1)
+      {
+        continue;
+      }
+      SpanSnapshot snapshot;
+      snapshot.Kind = span.Kind.load(std::memory_order_relaxed);
+      snapshot.ThreadId = span.ThreadId.load(std::memory_order_relaxed);
+      snapshot.ChunkId = span.ChunkId.load(std::memory_order_relaxed);
+      snapshot.Offset = span.Offset.load(std::memory_order_relaxed);
+      snapshot.Length = span.Length.load(std::memory_order_relaxed);
+      snapshot.Begin = span.Begin.load(std::memory_order_relaxed);
+      snapshot.Duration = span.Duration.load(std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_acquire);
+      // Skip the span if it was overwritten while it was copied.
+      if (span.Sequence.load(std::memory_order_relaxed) == sequence)
+      {
+        spans.push_back(snapshot);
+      }
+    }
+    std::sort(spans.begin(), spans.end(), [](const SpanSnapshot& lhs, const SpanSnapshot& rhs) {
+      return lhs.Begin < rhs.Begin;
+    });
+
+    std::string trace = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+    for (const auto& span : spans)
+    {
+      if (!first)
+      {
+        trace += ",";
+      }
+      first = false;
+      trace += "\n{\"name\":\"";
+      trace += GetSpanName(static_cast<TransferSpanKind>(span.Kind));
+      trace += "\",\"cat\":\"transfer\",\"ph\":\"X\",\"pid\":1,\"tid\":"
+          + std::to_string(span.ThreadId) + ",\"ts\":" + std::to_string(span.Begin)
+          + ",\"dur\":" + std::to_string(span.Duration)
+          + ",\"args\":{\"chunk\":" + std::to_string(span.ChunkId)
+          + ",\"offset\":" + std::to_string(span.Offset)
+          + ",\"length\":" + std::to_string(span.Length) + "}}";
+    }
+    trace += "\n]}\n";
+    return trace;
+  }
+
+  void TransferTracer::WriteChromeTrace(const std::string& file) const
+  {
+    std::ofstream stream(file, std::ios::binary | std::ios::trunc);
+    if (!stream)
+    {
+      throw std::runtime_error("failed to open file");
+    }
+    stream << ToChromeTrace();
+    if (!stream)
+    {
+      throw std::runtime_error("failed to write file");
+    }
+  }
+
+}} // namespace Azure::Storage
@@ -133,15 +133,14 @@ namespace Azure { namespace Storage { namespace Files { namespace DataLake {
       policies.emplace_back(p->Clone());
     }
     policies.emplace_back(
-        std::make_unique<Azure::Core::Http::RetryPolicy>(Azure::Core::Http::RetryOptions()));
+        Storage::Details::CreateRetryPolicy(options.RetryOptions, m_dfsUri.GetHost()));
     for (const auto& p : options.PerRetryPolicies)
     {
       policies.emplace_back(p->Clone());
     }
     policies.emplace_back(std::make_unique<CommonHeadersRequestPolicy>());
     policies.emplace_back(std::make_unique<SharedKeyPolicy>(credential));
-    policies.emplace_back(std::make_unique<Azure::Core::Http::TransportPolicy>(
-        std::make_shared<Azure::Core::Http::CurlTransport>()));
+    policies.emplace_back(std::make_unique<Azure::Core::Http::TransportPolicy>(options.Transport));
     m_pipeline = std::make_shared<Azure::Core::Http::HttpPipeline>(policies);
   }
 
@@ -160,7 +159,7 @@ namespace Azure { namespace Storage { namespace Files { namespace DataLake {
       policies.emplace_back(p->Clone());
     }
     policies.emplace_back(
-        std::make_unique<Azure::Core::Http::RetryPolicy>(Azure::Core::Http::RetryOptions()));
+        Storage::Details::CreateRetryPolicy(options.RetryOptions, m_dfsUri.GetHost()));
     for (const auto& p : options.PerRetryPolicies)
     {
       policies.emplace_back(p->Clone());
@@ -169,8 +168,7 @@ namespace Azure { namespace Storage { namespace Files { namespace DataLake {
     policies.emplace_back(
         std::make_unique<Core::Credentials::Policy::BearerTokenAuthenticationPolicy>(
             credential, Azure::Storage::Details::c_StorageScope));
-    policies.emplace_back(std::make_unique<Azure::Core::Http::TransportPolicy>(
-        std::make_shared<Azure::Core::Http::CurlTransport>()));
+    policies.emplace_back(std::make_unique<Azure::Core::Http::TransportPolicy>(options.Transport));
     m_pipeline = std::make_shared<Azure::Core::Http::HttpPipeline>(policies);
   }
 
@@ -185,14 +183,13 @@ namespace Azure { namespace Storage { namespace Files { namespace DataLake {
       policies.emplace_back(p->Clone());
     }
     policies.emplace_back(
-        std::make_unique<Azure::Core::Http::RetryPolicy>(Azure::Core::Http::RetryOptions()));
+        Storage::Details::CreateRetryPolicy(options.RetryOptions, m_dfsUri.GetHost()));
     for (const auto& p : options.PerRetryPolicies)
     {
       policies.emplace_back(p->Clone());
     }
     policies.emplace_back(std::make_unique<CommonHeadersRequestPolicy>());
-    policies.emplace_back(std::make_unique<Azure::Core::Http::TransportPolicy>(
-        std::make_shared<Azure::Core::Http::CurlTransport>()));
+    policies.emplace_back(std::make_unique<Azure::Core::Http::TransportPolicy>(options.Transport));
     m_pipeline = std::make_shared<Azure::Core::Http::HttpPipeline>(policies);
   }
 
@@ -333,9 +330,26 @@ namespace Azure { namespace Storage { namespace Files { namespace DataLake {
     blobOptions.HttpHeaders = FromDataLakeHttpHeaders(options.HttpHeaders);
     blobOptions.Metadata = options.Metadata;
     blobOptions.Concurrency = options.Concurrency;
+    blobOptions.FileReadAhead = options.FileReadAhead;
+    blobOptions.MapFile = options.MapFile;
+    blobOptions.Tracer = options.Tracer;
     return m_blockBlobClient.UploadFromFile(file, blobOptions);
   }
 
+  Azure::Core::Response<FileContentInfo> FileClient::UploadFromStream(
+      Azure::Core::Http::BodyStream* content,
+      const UploadFileOptions& options) const
+  {
+    Blobs::UploadBlobOptions blobOptions;
+    blobOptions.Context = options.Context;
+    blobOptions.ChunkSize = options.ChunkSize;
+    blobOptions.HttpHeaders = FromDataLakeHttpHeaders(options.HttpHeaders);
+    blobOptions.Metadata = options.Metadata;
+    blobOptions.Concurrency = options.Concurrency;
+    blobOptions.Tracer = options.Tracer;
+    return m_blockBlobClient.UploadFromStream(content, blobOptions);
+  }
+
   Azure::Core::Response<FileContentInfo> FileClient::UploadFromBuffer(
       const uint8_t* buffer,
       std::size_t bufferSize,
@@ -347,6 +361,7 @@ namespace Azure { namespace Storage { namespace Files { namespace DataLake {
     blobOptions.HttpHeaders = FromDataLakeHttpHeaders(options.HttpHeaders);
     blobOptions.Metadata = options.Metadata;
     blobOptions.Concurrency = options.Concurrency;
+    blobOptions.Tracer = options.Tracer;
     return m_blockBlobClient.UploadFromBuffer(buffer, bufferSize, blobOptions);
   }
 
@@ -0,0 +1,147 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// SPDX-License-Identifier: MIT
+
+#include "blobs/blob_batch.hpp"
+#include "test_base.hpp"
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace Azure { namespace Storage { namespace Test {
+
+  namespace {
+    std::vector<uint8_t> ToBytes(const std::string& value)
+    {
+      return std::vector<uint8_t>(value.begin(), value.end());
+    }
+
+    std::string ToString(const std::vector<uint8_t>& value)
+    {
+      return std::string(value.begin(), value.end());
+    }
+  } // namespace
+
+  TEST(BlobBatchTest, CreateRequestBody)
+  {
+    std::vector<std::vector<uint8_t>> subRequests;
+    subRequests.emplace_back(ToBytes("DELETE /container/a HTTP/1.1\r\nContent-Length: 0\r\n\r\n"));
+    subRequests.emplace_back(
+        ToBytes("PUT /container/b?comp=tier HTTP/1.1\r\nx-ms-access-tier: Cool\r\n\r\n"));
+
+    auto body = Details::CreateBlobBatchRequestBody("batch_1234", subRequests);
+    EXPECT_EQ(
+        body,
+        "--batch_1234\r\n"
+        "Content-Type: application/http\r\n"
+        "Content-Transfer-Encoding: binary\r\n"
+        "Content-ID: 0\r\n"
+        "\r\n"
+        "DELETE /container/a HTTP/1.1\r\nContent-Length: 0\r\n\r\n"
+        "--batch_1234\r\n"
+        "Content-Type: application/http\r\n"
+        "Content-Transfer-Encoding: binary\r\n"
+        "Content-ID: 1\r\n"
+        "\r\n"
+        "PUT /container/b?comp=tier HTTP/1.1\r\nx-ms-access-tier: Cool\r\n\r\n"
+        "--batch_1234--\r\n");
+  }
+
+  TEST(BlobBatchTest, ParseMixedResponse)
+  {
+    // The parts are out of order and the second one failed with an error body.
+    const std::string body = "--batchresponse_1\r\n"
+                             "Content-Type: application/http\r\n"
+                             "Content-ID: 1\r\n"
+                             "\r\n"
+                             "HTTP/1.1 404 The specified blob does not exist.\r\n"
+                             "x-ms-error-code: BlobNotFound\r\n"
+                             "Content-Type: application/xml\r\n"
+                             "\r\n"
+                             "<Error><Code>BlobNotFound</Code></Error>\r\n"
+                             "--batchresponse_1\r\n"
+                             "Content-Type: application/http\r\n"
+                             "Content-ID: 0\r\n"
+                             "\r\n"
+                             "HTTP/1.1 202 Accepted\r\n"
+                             "x-ms-delete-type-permanent: true\r\n"
+                             "\r\n"
+                             "--batchresponse_1--\r\n";
+
+    auto responses = Details::ParseBlobBatchResponse(
+        "multipart/mixed; boundary=batchresponse_1", ToBytes(body), 2);
+    ASSERT_EQ(responses.size(), 2U);
+    EXPECT_EQ(responses[0]->GetStatusCode(), Azure::Core::Http::HttpStatusCode::Accepted);
+    EXPECT_EQ(responses[0]->GetReasonPhrase(), "Accepted");
+    EXPECT_EQ(responses[0]->GetHeaders().at("x-ms-delete-type-permanent"), "true");
+    EXPECT_TRUE(responses[0]->GetBody().empty());
+    EXPECT_EQ(responses[1]->GetStatusCode(), Azure::Core::Http::HttpStatusCode::NotFound);
+    EXPECT_EQ(responses[1]->GetReasonPhrase(), "The specified blob does not exist.");
+    EXPECT_EQ(responses[1]->GetHeaders().at("x-ms-error-code"), "BlobNotFound");
+    EXPECT_EQ(ToString(responses[1]->GetBody()), "<Error><Code>BlobNotFound</Code></Error>");
+  }
+
+  TEST(BlobBatchTest, ParseQuotedBoundary)
+  {
+    // Without Content-ID, the parts answer the sub-requests in order.
+    const std::string body = "--batch:1\r\n"
+                             "Content-Type: application/http\r\n"
+                             "\r\n"
+                             "HTTP/1.1 200 OK\r\n"
+                             "\r\n"
+                             "--batch:1\r\n"
+                             "Content-Type: application/http\r\n"
+                             "\r\n"
+                             "HTTP/1.1 409 Conflict\r\n"
+                             "\r\n"
+                             "--batch:1--\r\n";
+
+    auto responses = Details::ParseBlobBatchResponse(
+        "multipart/mixed; boundary=\"batch:1\"; charset=utf-8", ToBytes(body), 2);
+    ASSERT_EQ(responses.size(), 2U);
+    EXPECT_EQ(responses[0]->GetStatusCode(), Azure::Core::Http::HttpStatusCode::Ok);
+    EXPECT_EQ(responses[1]->GetStatusCode(), Azure::Core::Http::HttpStatusCode::Conflict);
+  }
+
+  TEST(BlobBatchTest, ParseMalformedResponse)
+  {
+    const std::string contentType = "multipart/mixed; boundary=b";
+    const std::string goodPart = "--b\r\nContent-ID: 0\r\n\r\nHTTP/1.1 202 Accepted\r\n\r\n";
+
+    // A part without a status line.
+    EXPECT_THROW(
+        Details::ParseBlobBatchResponse(
+            contentType, ToBytes("--b\r\nContent-ID: 0\r\n\r\nnot a status\r\n\r\n--b--\r\n"), 1),
+        std::runtime_error);
+    // A part that isn't terminated by a boundary.
+    EXPECT_THROW(
+        Details::ParseBlobBatchResponse(contentType, ToBytes(goodPart), 1), std::runtime_error);
+    // A part answering a sub-request that wasn't sent, and a missing answer.
+    EXPECT_THROW(
+        Details::ParseBlobBatchResponse(
+            contentType,
+            ToBytes("--b\r\nContent-ID: 5\r\n\r\nHTTP/1.1 202 Accepted\r\n\r\n--b--\r\n"),
+            1),
+        std::runtime_error);
+    EXPECT_THROW(
+        Details::ParseBlobBatchResponse(contentType, ToBytes(goodPart + "--b--\r\n"), 2),
+        std::runtime_error);
+    // A Content-ID that isn't a number.
+    for (const std::string contentId : {"abc", "", "1x", "-1", "99999999999999999999"})
+    {
+      EXPECT_THROW(
+          Details::ParseBlobBatchResponse(
+              contentType,
+              ToBytes(
+                  "--b\r\nContent-ID: " + contentId
+                  + "\r\n\r\nHTTP/1.1 202 Accepted\r\n\r\n--b--\r\n"),
+              1),
+          std::runtime_error);
+    }
+    // No boundary at all.
+    EXPECT_THROW(
+        Details::ParseBlobBatchResponse("multipart/mixed", ToBytes(goodPart + "--b--\r\n"), 1),
+        std::runtime_error);
+  }
+
+}}} // namespace Azure::Storage::Test
@@ -225,4 +225,64 @@ namespace Azure { namespace Storage { namespace Test {
     EXPECT_EQ(items, blobs);
   }
 
+  TEST_F(BlobContainerClientTest, SubmitBatch)
+  {
+    const std::string prefix = "batch-" + LowercaseRandomString() + "-";
+    const int numBlobs = 300;
+    for (int i = 0; i < numBlobs; ++i)
+    {
+      auto blobClient = m_blobContainerClient->GetBlockBlobClient(prefix + std::to_string(i));
+      auto emptyContent = Azure::Core::Http::MemoryBodyStream(nullptr, 0);
+      blobClient.Upload(&emptyContent);
+    }
+
+    Blobs::BlobBatch batch;
+    for (int i = 0; i < numBlobs; ++i)
+    {
+      if (i % 2 == 0)
+      {
+        batch.DeleteBlob(m_containerName, prefix + std::to_string(i));
+      }
+      else
+      {
+        batch.SetBlobAccessTier(
+            m_containerName, prefix + std::to_string(i), Blobs::AccessTier::Cool);
+      }
+    }
+    int32_t notFoundIndex = batch.DeleteBlob(m_containerName, prefix + "notexist");
+
+    Blobs::SubmitBlobBatchOptions options;
+    options.Concurrency = 2;
+    auto res = m_blobContainerClient->SubmitBatch(batch, options);
+    ASSERT_EQ(res->DeleteBlobResults.size(), static_cast<std::size_t>(numBlobs / 2 + 1));
+    ASSERT_EQ(res->SetBlobAccessTierResults.size(), static_cast<std::size_t>(numBlobs / 2));
+    for (int32_t i = 0; i < notFoundIndex; ++i)
+    {
+      EXPECT_EQ(
+          res->DeleteBlobResults[i].GetRawResponse().GetStatusCode(),
+          Azure::Core::Http::HttpStatusCode::Accepted);
+    }
+    EXPECT_EQ(
+        res->DeleteBlobResults[notFoundIndex].GetRawResponse().GetStatusCode(),
+        Azure::Core::Http::HttpStatusCode::NotFound);
+    for (auto& result : res->SetBlobAccessTierResults)
+    {
+      EXPECT_EQ(result.GetRawResponse().GetStatusCode(), Azure::Core::Http::HttpStatusCode::Ok);
+    }
+
+    auto serviceClient = Blobs::BlobServiceClient::CreateFromConnectionString(
+        StandardStorageConnectionString());
+    Blobs::BlobBatch cleanupBatch;
+    for (int i = 1; i < numBlobs; i += 2)
+    {
+      cleanupBatch.DeleteBlob(m_containerName, prefix + std::to_string(i));
+    }
+    auto cleanupRes = serviceClient.SubmitBatch(cleanupBatch);
+    for (auto& result : cleanupRes->DeleteBlobResults)
+    {
+      EXPECT_EQ(
+          result.GetRawResponse().GetStatusCode(), Azure::Core::Http::HttpStatusCode::Accepted);
+    }
+  }
+
 }}} // namespace Azure::Storage::Test
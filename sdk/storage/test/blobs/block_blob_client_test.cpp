@@ -5,6 +5,7 @@
 
 #include "common/crypt.hpp"
 #include "common/file_io.hpp"
+#include "http/in_memory_transport.hpp"
 
 #include <future>
 #include <random>
@@ -503,6 +504,133 @@ namespace Azure { namespace Storage { namespace Test {
     }
   }
 
+  TEST_F(BlockBlobClientTest, OpenRead)
+  {
+    Azure::Storage::Blobs::OpenReadBlobOptions options;
+    options.ChunkSize = 1_MB;
+    options.Concurrency = 3;
+    for (int64_t offset : {int64_t(0), int64_t(1), int64_t(3_MB + 5)})
+    {
+      options.Offset = offset;
+      auto res = m_blockBlobClient->OpenRead(options);
+      EXPECT_EQ(res->BodyStream->Length(), static_cast<int64_t>(m_blobContent.size()) - offset);
+      EXPECT_EQ(res->HttpHeaders, m_blobUploadOptions.HttpHeaders);
+      EXPECT_EQ(
+          ReadBodyStream(res->BodyStream),
+          std::vector<uint8_t>(
+              m_blobContent.begin() + static_cast<std::ptrdiff_t>(offset), m_blobContent.end()));
+    }
+
+    auto emptyBlobClient = Azure::Storage::Blobs::BlockBlobClient::CreateFromConnectionString(
+        StandardStorageConnectionString(), m_containerName, RandomString());
+    emptyBlobClient.UploadFromBuffer(nullptr, 0);
+    auto res = emptyBlobClient.OpenRead();
+    EXPECT_TRUE(ReadBodyStream(res->BodyStream).empty());
+  }
+
+  TEST_F(BlockBlobClientTest, OpenRandomAccessReader)
+  {
+    auto blockBlobClient = Azure::Storage::Blobs::BlockBlobClient::CreateFromConnectionString(
+        StandardStorageConnectionString(), m_containerName, RandomString());
+    blockBlobClient.UploadFromBuffer(m_blobContent.data(), m_blobContent.size());
+    Azure::Storage::Blobs::OpenRandomAccessReaderOptions options;
+    options.BlockSize = 256_KB;
+    auto reader = blockBlobClient.OpenRandomAccessReader(options);
+    auto blobSize = static_cast<int64_t>(m_blobContent.size());
+    EXPECT_EQ(reader->GetSize(), blobSize);
+
+    Azure::Core::Context context;
+    for (auto range : {std::make_pair(blobSize - 8, int64_t(8)),
+                       std::make_pair(int64_t(0), int64_t(100)),
+                       std::make_pair(int64_t(1_MB - 3), int64_t(700_KB)),
+                       std::make_pair(blobSize - 10, int64_t(100))})
+    {
+      std::vector<uint8_t> buffer(static_cast<std::size_t>(range.second));
+      buffer.resize(static_cast<std::size_t>(
+          reader->ReadAt(context, range.first, buffer.data(), range.second)));
+      EXPECT_EQ(
+          buffer,
+          std::vector<uint8_t>(
+              m_blobContent.begin() + static_cast<std::ptrdiff_t>(range.first),
+              m_blobContent.begin()
+                  + static_cast<std::ptrdiff_t>(std::min(range.first + range.second, blobSize))));
+    }
+
+    // The blocks are pinned to the version of the blob the reader was opened on.
+    blockBlobClient.UploadFromBuffer(m_blobContent.data(), m_blobContent.size());
+    std::vector<uint8_t> buffer(static_cast<std::size_t>(10));
+    EXPECT_THROW(
+        reader->ReadAt(context, 3_MB, buffer.data(), static_cast<int64_t>(buffer.size())),
+        StorageError);
+  }
+
+  TEST_F(BlockBlobClientTest, DownloadRanges)
+  {
+    std::vector<std::pair<int64_t, int64_t>> ranges
+        = {{3_MB, 100}, {0, 10}, {20, 1_KB}, {500, 1_KB}, {2_MB, 1_MB}, {5_MB, 0}, {7_MB, 1_MB}};
+    std::vector<std::vector<uint8_t>> buffers;
+    std::vector<Azure::Storage::Blobs::DownloadBlobRangeTarget> targets;
+    for (const auto& range : ranges)
+    {
+      buffers.emplace_back(static_cast<std::size_t>(range.second));
+      Azure::Storage::Blobs::DownloadBlobRangeTarget target;
+      target.Offset = range.first;
+      target.Length = range.second;
+      target.Buffer = buffers.back().data();
+      targets.push_back(target);
+    }
+
+    Azure::Storage::Blobs::DownloadBlobRangesOptions options;
+    options.MaxGapSize = 1_KB;
+    options.MaxRequestSize = 4_MB;
+    options.Concurrency = 2;
+    auto res = m_blockBlobClient->DownloadRanges(targets, options);
+    EXPECT_FALSE(res->ETag.empty());
+    EXPECT_EQ(res->HttpHeaders, m_blobUploadOptions.HttpHeaders);
+    for (std::size_t i = 0; i < ranges.size(); ++i)
+    {
+      EXPECT_EQ(
+          buffers[i],
+          std::vector<uint8_t>(
+              m_blobContent.begin() + static_cast<std::ptrdiff_t>(ranges[i].first),
+              m_blobContent.begin()
+                  + static_cast<std::ptrdiff_t>(ranges[i].first + ranges[i].second)));
+    }
+  }
+
+  TEST_F(BlockBlobClientTest, DownloadThroughBlockCache)
+  {
+    auto cacheName = RandomString();
+    Azure::Storage::SharedBlockCacheOptions cacheOptions;
+    cacheOptions.BlockSize = 1_MB;
+    cacheOptions.BlockCount = 32;
+    Azure::Storage::Blobs::DownloadBlobToBufferOptions options;
+    options.Concurrency = 2;
+    options.BlockCache
+        = std::make_shared<Azure::Storage::SharedBlockCache>(cacheName, cacheOptions);
+
+    std::vector<uint8_t> buffer(m_blobContent.size());
+    for (int i = 0; i < 2; ++i)
+    {
+      auto res = m_blockBlobClient->DownloadToBuffer(buffer.data(), buffer.size(), options);
+      EXPECT_EQ(res->ContentLength, static_cast<int64_t>(m_blobContent.size()));
+      EXPECT_EQ(res->HttpHeaders, m_blobUploadOptions.HttpHeaders);
+      EXPECT_EQ(buffer, m_blobContent);
+    }
+
+    options.Offset = 1_MB + 3;
+    options.Length = 2_MB;
+    std::string tempFilename = RandomString();
+    m_blockBlobClient->DownloadToFile(tempFilename, options);
+    EXPECT_EQ(
+        ReadFile(tempFilename),
+        std::vector<uint8_t>(
+            m_blobContent.begin() + static_cast<std::ptrdiff_t>(1_MB + 3),
+            m_blobContent.begin() + static_cast<std::ptrdiff_t>(3_MB + 3)));
+    DeleteFile(tempFilename);
+    Azure::Storage::SharedBlockCache::Remove(cacheName);
+  }
+
   TEST_F(BlockBlobClientTest, ConcurrentUpload)
   {
     std::string tempFilename = RandomString();
@@ -543,6 +671,26 @@ namespace Azure { namespace Storage { namespace Test {
               std::vector<uint8_t>(
                   m_blobContent.begin(), m_blobContent.begin() + static_cast<std::size_t>(length)));
         }
+        {
+          Azure::Core::Http::MemoryBodyStream contentStream(
+              m_blobContent.data(), static_cast<std::size_t>(length));
+          auto res = blockBlobClient.UploadFromStream(&contentStream, options);
+          EXPECT_FALSE(res->ETag.empty());
+          EXPECT_FALSE(res->ContentCRC64.HasValue());
+          EXPECT_FALSE(res->ContentMD5.HasValue());
+          auto properties = *blockBlobClient.GetProperties();
+          EXPECT_EQ(properties.ContentLength, length);
+          EXPECT_EQ(properties.HttpHeaders, options.HttpHeaders);
+          EXPECT_EQ(properties.Metadata, options.Metadata);
+          EXPECT_EQ(properties.ETag, res->ETag);
+          std::vector<uint8_t> downloadContent(static_cast<std::size_t>(length), '\x00');
+          blockBlobClient.DownloadToBuffer(
+              downloadContent.data(), static_cast<std::size_t>(length));
+          EXPECT_EQ(
+              downloadContent,
+              std::vector<uint8_t>(
+                  m_blobContent.begin(), m_blobContent.begin() + static_cast<std::size_t>(length)));
+        }
         {
           {
             Azure::Storage::Details::FileWriter fileWriter(tempFilename);
@@ -596,4 +744,26 @@ namespace Azure { namespace Storage { namespace Test {
     EXPECT_TRUE(exceptionCaught);
   }
 
+  TEST(BlockBlobClientUploadTest, UploadFromStreamBlockLimit)
+  {
+    Azure::Core::Http::InMemoryResponse response;
+    response.StatusCode = Azure::Core::Http::HttpStatusCode::Created;
+    auto transport = std::make_shared<Azure::Core::Http::InMemoryTransport>();
+    transport->AddResponse(
+        Azure::Core::Http::HttpMethod::Put, "/container/blob?comp=block", response);
+    Blobs::BlockBlobClientOptions clientOptions;
+    clientOptions.Transport = transport;
+    Blobs::BlockBlobClient blob(
+        "https://account.blob.core.windows.net/container/blob", clientOptions);
+
+    // One byte past 50,000 blocks of a byte each, the block list isn't committed.
+    std::vector<uint8_t> content(50001, 'a');
+    Azure::Core::Http::MemoryBodyStream stream(content.data(), content.size());
+    Blobs::UploadBlobOptions options;
+    options.ChunkSize = 1;
+    options.Concurrency = 16;
+    EXPECT_THROW(blob.UploadFromStream(&stream, options), std::runtime_error);
+    EXPECT_EQ(transport->GetRequestCount(), 50000U);
+  }
+
 }}} // namespace Azure::Storage::Test
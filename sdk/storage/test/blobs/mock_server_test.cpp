@@ -0,0 +1,343 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// SPDX-License-Identifier: MIT
+
+#include "blobs/blob.hpp"
+#include "perf/mock_storage_server.hpp"
+#include "test_base.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(AZ_CORE_WITH_CURL_HTTP2)
+#include "http/curl/curl_http2.hpp"
+#include <curl/curl.h>
+#endif
+
+namespace Azure { namespace Storage { namespace Test {
+
+  namespace {
+    std::unique_ptr<MockStorageServer> StartMockServer()
+    {
+      auto server = std::make_unique<MockStorageServer>();
+      server->Start();
+      return server;
+    }
+  } // namespace
+
+  TEST(MockServerTest, UploadDownloadList)
+  {
+    auto server = StartMockServer();
+    auto containerName = LowercaseRandomString();
+    auto container = Blobs::BlobContainerClient::CreateFromConnectionString(
+        server->GetConnectionString(), containerName);
+    container.Create();
+
+    auto content = RandomBuffer(static_cast<std::size_t>(1_MB + 123));
+    auto blob = container.GetBlockBlobClient("dir/blob");
+    Blobs::UploadBlobOptions uploadOptions;
+    uploadOptions.ChunkSize = 256_KB;
+    uploadOptions.Concurrency = 4;
+    blob.UploadFromBuffer(content.data(), content.size(), uploadOptions);
+
+    std::vector<uint8_t> downloaded(content.size());
+    Blobs::DownloadBlobToBufferOptions downloadOptions;
+    downloadOptions.InitialChunkSize = 100_KB;
+    downloadOptions.ChunkSize = 200_KB;
+    downloadOptions.Concurrency = 4;
+    auto downloadInfo
+        = blob.DownloadToBuffer(downloaded.data(), downloaded.size(), downloadOptions);
+    EXPECT_EQ(downloaded, content);
+    EXPECT_EQ(downloadInfo->ContentLength, static_cast<int64_t>(content.size()));
+
+    Blobs::DownloadBlobOptions rangeOptions;
+    rangeOptions.Offset = 1_MB;
+    rangeOptions.Length = 1000;
+    auto rangeResponse = blob.Download(rangeOptions);
+    EXPECT_EQ(
+        ReadBodyStream(rangeResponse->BodyStream),
+        std::vector<uint8_t>(content.begin() + 1_MB, content.end()));
+
+    auto segment = container.ListBlobsFlat();
+    ASSERT_EQ(segment->Items.size(), 1U);
+    EXPECT_EQ(segment->Items[0].Name, "dir/blob");
+
+    blob.Delete();
+    EXPECT_TRUE(container.ListBlobsFlat()->Items.empty());
+    EXPECT_THROW(blob.GetProperties(), StorageError);
+    EXPECT_GT(server->GetRequestCount(), 10U);
+  }
+
+#if defined(AZ_CORE_WITH_CURL_HTTP2)
+  TEST(MockServerTest, Http2PriorKnowledge)
+  {
+    auto server = StartMockServer();
+    Azure::Core::Http::CurlHttp2TransportOptions transportOptions;
+    transportOptions.Http2PriorKnowledge = true;
+    // Small enough for the body of a download to pause the transfer.
+    transportOptions.MaxBufferedBodySize = 64_KB;
+    Blobs::BlobContainerClientOptions options;
+    options.Transport = std::make_shared<Azure::Core::Http::CurlHttp2Transport>(transportOptions);
+    auto containerName = LowercaseRandomString();
+    auto container = Blobs::BlobContainerClient::CreateFromConnectionString(
+        server->GetConnectionString(), containerName, options);
+    container.Create();
+
+    // The blocks are uploaded, and the chunks downloaded, as concurrent streams.
+    auto content = RandomBuffer(static_cast<std::size_t>(1_MB + 123));
+    auto blob = container.GetBlockBlobClient("dir/blob");
+    Blobs::UploadBlobOptions uploadOptions;
+    uploadOptions.ChunkSize = 128_KB;
+    uploadOptions.Concurrency = 4;
+    blob.UploadFromBuffer(content.data(), content.size(), uploadOptions);
+
+    std::vector<uint8_t> downloaded(content.size());
+    Blobs::DownloadBlobToBufferOptions downloadOptions;
+    downloadOptions.InitialChunkSize = 100_KB;
+    downloadOptions.ChunkSize = 200_KB;
+    downloadOptions.Concurrency = 4;
+    blob.DownloadToBuffer(downloaded.data(), downloaded.size(), downloadOptions);
+    EXPECT_EQ(downloaded, content);
+
+    auto properties = blob.GetProperties();
+    EXPECT_EQ(properties->ContentLength, static_cast<int64_t>(content.size()));
+    ASSERT_EQ(container.ListBlobsFlat()->Items.size(), 1U);
+    blob.Delete();
+    EXPECT_THROW(blob.GetProperties(), StorageError);
+  }
+
+  TEST(MockServerTest, Http2RequestsShareConnection)
+  {
+    auto server = StartMockServer();
+    Azure::Core::Http::CurlHttp2TransportOptions transportOptions;
+    transportOptions.Http2PriorKnowledge = true;
+    Blobs::BlobContainerClientOptions options;
+    options.Transport = std::make_shared<Azure::Core::Http::CurlHttp2Transport>(transportOptions);
+    auto container = Blobs::BlobContainerClient::CreateFromConnectionString(
+        server->GetConnectionString(), LowercaseRandomString(), options);
+    container.Create();
+    auto content = RandomBuffer(static_cast<std::size_t>(1_KB));
+    auto blob = container.GetBlockBlobClient("blob");
+    blob.UploadFromBuffer(content.data(), content.size());
+
+    // The requests sent at once are streams of the idle connection.
+    std::vector<std::thread> threads;
+    std::atomic<int> failures{0};
+    for (int i = 0; i < 8; ++i)
+    {
+      threads.emplace_back([&]() {
+        try
+        {
+          blob.GetProperties();
+        }
+        catch (std::exception&)
+        {
+          ++failures;
+        }
+      });
+    }
+    for (auto& thread : threads)
+    {
+      thread.join();
+    }
+    EXPECT_EQ(failures, 0);
+    blob.GetProperties();
+    if ((curl_version_info(CURLVERSION_NOW)->version_num >> 8) == 0x0758)
+    {
+      // libcurl 7.88 can't reuse a connection opened with prior knowledge.
+      GTEST_SKIP();
+    }
+    EXPECT_EQ(server->GetConnectionCount(), 1U);
+  }
+#endif
+
+  TEST(MockServerTest, NullTransportUsesDefault)
+  {
+    auto server = StartMockServer();
+    Blobs::BlobContainerClientOptions options;
+    options.Transport = nullptr;
+    auto container = Blobs::BlobContainerClient::CreateFromConnectionString(
+        server->GetConnectionString(), LowercaseRandomString(), options);
+    container.Create();
+    EXPECT_TRUE(container.ListBlobsFlat()->Items.empty());
+  }
+
+  TEST(MockServerTest, DownloadRanges)
+  {
+    auto server = StartMockServer();
+    auto container = Blobs::BlobContainerClient::CreateFromConnectionString(
+        server->GetConnectionString(), LowercaseRandomString());
+    container.Create();
+    auto content = RandomBuffer(static_cast<std::size_t>(1_MB));
+    auto blob = container.GetBlockBlobClient("blob");
+    blob.UploadFromBuffer(content.data(), content.size());
+
+    // Ranges far apart are downloaded with a request each, by several threads.
+    std::vector<std::vector<uint8_t>> buffers;
+    std::vector<Blobs::DownloadBlobRangeTarget> targets;
+    for (int64_t offset = 0; offset < static_cast<int64_t>(1_MB); offset += 100_KB)
+    {
+      buffers.emplace_back(static_cast<std::size_t>(1_KB));
+      Blobs::DownloadBlobRangeTarget target;
+      target.Offset = offset;
+      target.Length = 1_KB;
+      target.Buffer = buffers.back().data();
+      targets.push_back(target);
+    }
+    Blobs::DownloadBlobRangesOptions options;
+    options.MaxGapSize = 1_KB;
+    options.Concurrency = 4;
+    auto requestCount = server->GetRequestCount();
+    blob.DownloadRanges(targets, options);
+    EXPECT_EQ(server->GetRequestCount(), requestCount + targets.size());
+    for (std::size_t i = 0; i < targets.size(); ++i)
+    {
+      auto begin = content.begin() + static_cast<std::ptrdiff_t>(targets[i].Offset);
+      EXPECT_EQ(buffers[i], std::vector<uint8_t>(begin, begin + 1_KB));
+    }
+
+    // A range past the end of the blob fails the download.
+    targets.back().Offset = 2_MB;
+    EXPECT_THROW(blob.DownloadRanges(targets, options), StorageError);
+  }
+
+  TEST(MockServerTest, DownloadThroughBlockCache)
+  {
+    auto server = StartMockServer();
+    auto container = Blobs::BlobContainerClient::CreateFromConnectionString(
+        server->GetConnectionString(), LowercaseRandomString());
+    container.Create();
+    auto content = RandomBuffer(static_cast<std::size_t>(100_KB));
+    auto blob = container.GetBlockBlobClient("blob");
+    blob.UploadFromBuffer(content.data(), content.size());
+
+    auto cacheName = LowercaseRandomString();
+    SharedBlockCacheOptions cacheOptions;
+    cacheOptions.BlockSize = 16_KB;
+    cacheOptions.BlockCount = 16;
+    Blobs::DownloadBlobToBufferOptions options;
+    options.BlockCache = std::make_shared<SharedBlockCache>(cacheName, cacheOptions);
+    std::vector<uint8_t> downloaded(content.size());
+    blob.DownloadToBuffer(downloaded.data(), downloaded.size(), options);
+    EXPECT_EQ(downloaded, content);
+
+    // An offset past the end is reported without being downloaded.
+    options.Offset = static_cast<int64_t>(content.size());
+    auto requestCount = server->GetRequestCount();
+    try
+    {
+      blob.DownloadToBuffer(downloaded.data(), downloaded.size(), options);
+      ADD_FAILURE();
+    }
+    catch (StorageError& e)
+    {
+      EXPECT_EQ(e.StatusCode, Azure::Core::Http::HttpStatusCode::RangeNotSatisfiable);
+      EXPECT_EQ(e.ErrorCode, "InvalidRange");
+    }
+    EXPECT_EQ(server->GetRequestCount(), requestCount + 1);
+    SharedBlockCache::Remove(cacheName);
+  }
+
+  TEST(MockServerTest, CanceledWhileWaitingForResponse)
+  {
+    MockStorageServerOptions serverOptions;
+    serverOptions.Latency = std::chrono::seconds(2);
+    MockStorageServer server(serverOptions);
+    server.Start();
+    auto blob = Blobs::BlobClient::CreateFromConnectionString(
+        server.GetConnectionString(), LowercaseRandomString(), "blob");
+
+    // The transport stops waiting for the response once the context is canceled.
+    Blobs::GetBlobPropertiesOptions options;
+    options.Context = Azure::Core::Context().WithDeadline(
+        std::chrono::system_clock::now() + std::chrono::milliseconds(100));
+    auto start = std::chrono::steady_clock::now();
+    EXPECT_THROW(blob.GetProperties(options), Azure::Core::OperationCanceledException);
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(1));
+  }
+
+#if defined(AZ_CORE_WITH_CURL_HTTP2)
+  TEST(MockServerTest, Http2CanceledWhileWaitingForResponse)
+  {
+    MockStorageServerOptions serverOptions;
+    serverOptions.Latency = std::chrono::seconds(2);
+    MockStorageServer server(serverOptions);
+    server.Start();
+    Azure::Core::Http::CurlHttp2TransportOptions transportOptions;
+    transportOptions.Http2PriorKnowledge = true;
+    Blobs::BlobClientOptions clientOptions;
+    clientOptions.Transport
+        = std::make_shared<Azure::Core::Http::CurlHttp2Transport>(transportOptions);
+    auto blob = Blobs::BlobClient::CreateFromConnectionString(
+        server.GetConnectionString(), LowercaseRandomString(), "blob", clientOptions);
+
+    // A cancellation isn't a transport error, the request isn't retried.
+    Blobs::GetBlobPropertiesOptions options;
+    options.Context = Azure::Core::Context().WithDeadline(
+        std::chrono::system_clock::now() + std::chrono::milliseconds(100));
+    auto start = std::chrono::steady_clock::now();
+    EXPECT_THROW(blob.GetProperties(options), Azure::Core::OperationCanceledException);
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(1));
+    EXPECT_EQ(server.GetRequestCount(), 1U);
+  }
+#endif
+
+  TEST(MockServerTest, SubmitBatch)
+  {
+    auto server = StartMockServer();
+    auto containerName = LowercaseRandomString();
+    auto serviceClient
+        = Blobs::BlobServiceClient::CreateFromConnectionString(server->GetConnectionString());
+    auto container = serviceClient.GetBlobContainerClient(containerName);
+    container.Create();
+    auto content = RandomBuffer(100);
+    for (int i = 0; i < 3; ++i)
+    {
+      container.GetBlockBlobClient("blob" + std::to_string(i))
+          .UploadFromBuffer(content.data(), content.size());
+    }
+
+    // The second delete fails, the other sub-requests succeed.
+    Blobs::BlobBatch batch;
+    batch.DeleteBlob(containerName, "blob0");
+    batch.DeleteBlob(containerName, "missing");
+    batch.SetBlobAccessTier(containerName, "blob1", Blobs::AccessTier::Cool);
+    auto result = serviceClient.SubmitBatch(batch);
+    ASSERT_EQ(result->DeleteBlobResults.size(), 2U);
+    ASSERT_EQ(result->SetBlobAccessTierResults.size(), 1U);
+    EXPECT_EQ(
+        result->DeleteBlobResults[0].GetRawResponse().GetStatusCode(),
+        Azure::Core::Http::HttpStatusCode::Accepted);
+    EXPECT_EQ(
+        result->DeleteBlobResults[1].GetRawResponse().GetStatusCode(),
+        Azure::Core::Http::HttpStatusCode::NotFound);
+    EXPECT_EQ(
+        result->SetBlobAccessTierResults[0].GetRawResponse().GetStatusCode(),
+        Azure::Core::Http::HttpStatusCode::Ok);
+
+    Blobs::BlobBatch containerBatch;
+    containerBatch.DeleteBlob(containerName, "blob1");
+    containerBatch.DeleteBlob(containerName, "blob2");
+    auto containerResult = container.SubmitBatch(containerBatch);
+    for (auto& deleteResult : containerResult->DeleteBlobResults)
+    {
+      EXPECT_EQ(
+          deleteResult.GetRawResponse().GetStatusCode(),
+          Azure::Core::Http::HttpStatusCode::Accepted);
+    }
+    EXPECT_TRUE(container.ListBlobsFlat()->Items.empty());
+
+    // A container client doesn't send sub-requests targeting another container.
+    auto requestCount = server->GetRequestCount();
+    Blobs::BlobBatch otherContainerBatch;
+    otherContainerBatch.DeleteBlob(containerName, "blob0");
+    otherContainerBatch.DeleteBlob(containerName + "other", "blob0");
+    EXPECT_THROW(container.SubmitBatch(otherContainerBatch), std::invalid_argument);
+    EXPECT_EQ(server->GetRequestCount(), requestCount);
+  }
+
+}}} // namespace Azure::Storage::Test
@@ -0,0 +1,97 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// SPDX-License-Identifier: MIT
+
+#include "common/concurrent_transfer.hpp"
+#include "test_base.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+namespace Azure { namespace Storage { namespace Test {
+
+  namespace {
+    // Produces its content in small reads without knowing its length, like a pipe.
+    class GeneratorBodyStream : public Azure::Core::Http::BodyStream {
+    public:
+      explicit GeneratorBodyStream(const std::vector<uint8_t>& content) : m_content(content) {}
+
+      int64_t Length() const override { return -1; }
+
+      int64_t Read(Azure::Core::Context& context, uint8_t* buffer, int64_t count) override
+      {
+        context.ThrowIfCanceled();
+        auto readBytes = std::min(
+            {count, int64_t(3000), static_cast<int64_t>(m_content.size()) - m_offset});
+        std::memcpy(
+            buffer,
+            m_content.data() + static_cast<std::size_t>(m_offset),
+            static_cast<std::size_t>(readBytes));
+        m_offset += readBytes;
+        return readBytes;
+      }
+
+    private:
+      const std::vector<uint8_t>& m_content;
+      int64_t m_offset = 0;
+    };
+  } // namespace
+
+  TEST(ConcurrentTransferTest, StreamTransfer)
+  {
+    for (std::size_t size : {std::size_t(0), std::size_t(64_KB), std::size_t(1_MB + 5)})
+    {
+      auto content = RandomBuffer(size);
+      std::vector<uint8_t> transferred(size);
+      std::atomic<int> running{0};
+      std::atomic<int> maxRunning{0};
+
+      GeneratorBodyStream stream(content);
+      Azure::Core::Context context;
+      auto numChunks = Details::ConcurrentStreamTransfer(
+          context,
+          stream,
+          64_KB,
+          3,
+          [&](const uint8_t* data, int64_t length, int64_t offset, int64_t chunkId) {
+            auto nowRunning = ++running;
+            int expected = maxRunning;
+            while (nowRunning > expected && !maxRunning.compare_exchange_weak(expected, nowRunning))
+            {
+            }
+            EXPECT_EQ(offset, chunkId * static_cast<int64_t>(64_KB));
+            std::memcpy(
+                transferred.data() + static_cast<std::size_t>(offset),
+                data,
+                static_cast<std::size_t>(length));
+            --running;
+          });
+      EXPECT_EQ(numChunks, static_cast<int64_t>((size + 64_KB - 1) / 64_KB));
+      EXPECT_LE(maxRunning, 3);
+      EXPECT_EQ(transferred, content);
+    }
+  }
+
+  TEST(ConcurrentTransferTest, StreamTransferFails)
+  {
+    auto content = RandomBuffer(static_cast<std::size_t>(1_MB));
+    GeneratorBodyStream stream(content);
+    Azure::Core::Context context;
+    EXPECT_THROW(
+        Details::ConcurrentStreamTransfer(
+            context,
+            stream,
+            64_KB,
+            2,
+            [](const uint8_t*, int64_t, int64_t, int64_t chunkId) {
+              if (chunkId == 3)
+              {
+                throw std::runtime_error("failed to stage block");
+              }
+            }),
+        std::runtime_error);
+  }
+
+}}} // namespace Azure::Storage::Test
@@ -0,0 +1,173 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// SPDX-License-Identifier: MIT
+
+#include "common/concurrent_transfer.hpp"
+#include "common/file_io.hpp"
+#include "common/file_io_engine.hpp"
+#include "test_base.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace Azure { namespace Storage { namespace Test {
+
+  namespace {
+    // Writes the content in chunks of the buffer size through the engine, from several threads.
+    void WriteBehind(
+        Details::FileIoEngine& engine,
+        const std::string& filename,
+        const std::vector<uint8_t>& content)
+    {
+      Details::FileWriter fileWriter(filename);
+      Details::ConcurrentTransfer(
+          0,
+          static_cast<int64_t>(content.size()),
+          engine.GetBufferSize(),
+          4,
+          [&](int64_t offset, int64_t length, int64_t, int64_t) {
+            uint8_t* buffer = engine.AcquireBuffer();
+            std::memcpy(
+                buffer,
+                content.data() + static_cast<std::size_t>(offset),
+                static_cast<std::size_t>(length));
+            engine.QueueWrite(fileWriter.GetHandle(), buffer, length, offset);
+            engine.Submit();
+          });
+      engine.Flush();
+    }
+
+    // Reads the file back in chunks with read-ahead, from several threads.
+    std::vector<uint8_t> ReadAhead(
+        Details::FileIoEngine& engine,
+        const std::string& filename,
+        int64_t chunkSize,
+        int readAhead)
+    {
+      Details::FileReader fileReader(filename);
+      std::vector<uint8_t> content(static_cast<std::size_t>(fileReader.GetFileSize()));
+      Details::FileReadAhead fileReadAhead(
+          engine, fileReader.GetHandle(), 0, fileReader.GetFileSize(), chunkSize, readAhead);
+      Details::ConcurrentTransfer(
+          0,
+          fileReader.GetFileSize(),
+          chunkSize,
+          3,
+          [&](int64_t offset, int64_t length, int64_t chunkId, int64_t) {
+            uint8_t* buffer = fileReadAhead.Acquire(chunkId);
+            std::memcpy(
+                content.data() + static_cast<std::size_t>(offset),
+                buffer,
+                static_cast<std::size_t>(length));
+            fileReadAhead.Release(buffer);
+          });
+      return content;
+    }
+  } // namespace
+
+  TEST(FileIoEngineTest, WriteBehindAndReadAhead)
+  {
+    for (bool useIoUring : {true, false})
+    {
+      auto content = RandomBuffer(static_cast<std::size_t>(3_MB + 123));
+      std::string filename = RandomString();
+
+      auto writeEngine = Details::FileIoEngine::Create(3, 256_KB, useIoUring);
+      if (!useIoUring)
+      {
+        EXPECT_FALSE(writeEngine->UsesIoUring());
+      }
+      WriteBehind(*writeEngine, filename, content);
+      EXPECT_EQ(ReadFile(filename), content);
+
+      auto readEngine = Details::FileIoEngine::Create(3 + 2, 512_KB, useIoUring);
+      EXPECT_EQ(ReadAhead(*readEngine, filename, 512_KB, 2), content);
+      DeleteFile(filename);
+    }
+  }
+
+  TEST(FileIoEngineTest, DirectWritesDroppedFromCache)
+  {
+    for (bool useIoUring : {true, false})
+    {
+      // The tail isn't aligned and is written through the page cache.
+      auto content = RandomBuffer(static_cast<std::size_t>(1_MB + 1000));
+      std::string filename = RandomString();
+      {
+        Details::FileWriter fileWriter(filename, true);
+        fileWriter.Preallocate(static_cast<int64_t>(content.size()));
+        auto engine = Details::FileIoEngine::Create(2, 256_KB, useIoUring);
+        for (int64_t offset = 0; offset < static_cast<int64_t>(content.size());
+             offset += engine->GetBufferSize())
+        {
+          auto length
+              = std::min(engine->GetBufferSize(), static_cast<int64_t>(content.size()) - offset);
+          uint8_t* buffer = engine->AcquireBuffer();
+          EXPECT_EQ(reinterpret_cast<uintptr_t>(buffer) % Details::c_directIoAlignment, 0U);
+          std::memcpy(
+              buffer,
+              content.data() + static_cast<std::size_t>(offset),
+              static_cast<std::size_t>(length));
+          engine->QueueWrite(fileWriter.GetHandle(offset, length), buffer, length, offset, true);
+          engine->Submit();
+        }
+        engine->Flush();
+      }
+      EXPECT_EQ(ReadFile(filename), content);
+      DeleteFile(filename);
+    }
+  }
+
+  TEST(FileIoEngineTest, BuffersWithinPoolBudget)
+  {
+    auto& pool = Azure::Core::Http::BufferPool::GetDefault();
+    auto bytesInUse = pool.GetBytesInUse();
+    pool.SetBudget(bytesInUse + 1_MB);
+    {
+      auto engine = Details::FileIoEngine::Create(4, 256_KB);
+      EXPECT_EQ(pool.GetBytesInUse(), bytesInUse + 1_MB);
+
+      // The budget is exhausted until the first engine is destroyed.
+      auto context = Azure::Core::Context().WithDeadline(
+          std::chrono::system_clock::now() + std::chrono::milliseconds(100));
+      EXPECT_THROW(
+          Details::FileIoEngine::Create(1, 64_KB, true, context),
+          Azure::Core::OperationCanceledException);
+    }
+    auto engine = Details::FileIoEngine::Create(1, 64_KB);
+    EXPECT_NE(engine->AcquireBuffer(), nullptr);
+    pool.SetBudget(0);
+  }
+
+  TEST(FileIoEngineTest, ShortReadFails)
+  {
+    auto content = RandomBuffer(static_cast<std::size_t>(100_KB));
+    std::string filename = RandomString();
+    {
+      Details::FileWriter fileWriter(filename);
+      fileWriter.Write(content.data(), static_cast<int64_t>(content.size()), 0);
+    }
+
+    auto engine = Details::FileIoEngine::Create(2, 64_KB);
+    {
+      Details::FileReader fileReader(filename);
+      uint8_t* buffer = engine->AcquireBuffer();
+      engine->QueueRead(fileReader.GetHandle(), buffer, 64_KB, 64_KB);
+      engine->Submit();
+      EXPECT_EQ(engine->WaitRead(buffer), static_cast<int64_t>(36_KB));
+      EXPECT_EQ(std::memcmp(buffer, content.data() + 64_KB, 36_KB), 0);
+      engine->ReleaseBuffer(buffer);
+
+      // A file shorter than the length read ahead.
+      Details::FileReadAhead fileReadAhead(*engine, fileReader.GetHandle(), 0, 200_KB, 64_KB, 1);
+      fileReadAhead.Release(fileReadAhead.Acquire(0));
+      EXPECT_THROW(fileReadAhead.Acquire(1), std::runtime_error);
+    }
+    DeleteFile(filename);
+  }
+
+}}} // namespace Azure::Storage::Test
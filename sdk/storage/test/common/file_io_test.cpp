@@ -0,0 +1,45 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// SPDX-License-Identifier: MIT
+
+#include "common/file_io.hpp"
+#include "test_base.hpp"
+
+#include <string>
+#include <vector>
+
+namespace Azure { namespace Storage { namespace Test {
+
+  TEST(FileIoTest, FileMapping)
+  {
+    auto content = RandomBuffer(static_cast<std::size_t>(1_MB + 17));
+    std::string filename = RandomString();
+    {
+      Details::FileWriter fileWriter(filename);
+      fileWriter.Write(content.data(), static_cast<int64_t>(content.size()), 0);
+    }
+    {
+      Details::FileReader fileReader(filename);
+      Details::FileMapping fileMapping(fileReader);
+      ASSERT_EQ(fileMapping.GetSize(), static_cast<int64_t>(content.size()));
+      fileMapping.WillNeed(4_KB + 1, 512_KB);
+      fileMapping.WillNeed(1_MB, 1_MB);
+      EXPECT_EQ(
+          std::vector<uint8_t>(fileMapping.GetData(), fileMapping.GetData() + content.size()),
+          content);
+    }
+
+    std::string emptyFilename = RandomString();
+    {
+      Details::FileWriter fileWriter(emptyFilename);
+    }
+    {
+      Details::FileReader fileReader(emptyFilename);
+      Details::FileMapping fileMapping(fileReader);
+      EXPECT_EQ(fileMapping.GetSize(), 0);
+      fileMapping.WillNeed(0, 4_KB);
+    }
+    DeleteFile(filename);
+    DeleteFile(emptyFilename);
+  }
+
+}}} // namespace Azure::Storage::Test
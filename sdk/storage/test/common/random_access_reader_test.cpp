@@ -0,0 +1,215 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// SPDX-License-Identifier: MIT
+
+#include "common/random_access_reader.hpp"
+#include "test_base.hpp"
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace Azure { namespace Storage { namespace Test {
+
+  namespace {
+    struct RangeRequests
+    {
+      std::mutex Mutex;
+      std::vector<std::pair<int64_t, int64_t>> Ranges;
+      int64_t FailingOffset = -1;
+      std::chrono::milliseconds Delay{0};
+
+      std::vector<std::pair<int64_t, int64_t>> Take()
+      {
+        std::lock_guard<std::mutex> guard(Mutex);
+        return std::move(Ranges);
+      }
+    };
+
+    std::unique_ptr<RandomAccessReader> MakeReader(
+        const std::vector<uint8_t>& content,
+        RandomAccessReaderOptions options,
+        RangeRequests& requests)
+    {
+      auto rangeGetter = [&content, &requests](
+                             Azure::Core::Context&, int64_t offset, int64_t length)
+          -> std::unique_ptr<Azure::Core::Http::BodyStream> {
+        std::this_thread::sleep_for(requests.Delay);
+        {
+          std::lock_guard<std::mutex> guard(requests.Mutex);
+          requests.Ranges.emplace_back(offset, length);
+          if (offset == requests.FailingOffset)
+          {
+            requests.FailingOffset = -1;
+            throw std::runtime_error("failed to get range");
+          }
+        }
+        return std::make_unique<Azure::Core::Http::MemoryBodyStream>(
+            content.data() + offset, static_cast<std::size_t>(length));
+      };
+      return std::make_unique<RandomAccessReader>(
+          static_cast<int64_t>(content.size()), options, rangeGetter, Azure::Core::Context());
+    }
+
+    std::vector<uint8_t> ReadAt(RandomAccessReader& reader, int64_t offset, int64_t count)
+    {
+      Azure::Core::Context context;
+      std::vector<uint8_t> buffer(static_cast<std::size_t>(count));
+      buffer.resize(static_cast<std::size_t>(reader.ReadAt(context, offset, buffer.data(), count)));
+      return buffer;
+    }
+
+    std::vector<uint8_t> Slice(const std::vector<uint8_t>& content, int64_t offset, int64_t count)
+    {
+      return std::vector<uint8_t>(
+          content.begin() + static_cast<std::ptrdiff_t>(offset),
+          content.begin() + static_cast<std::ptrdiff_t>(offset + count));
+    }
+  } // namespace
+
+  TEST(RandomAccessReaderTest, CachesBlocks)
+  {
+    auto content = RandomBuffer(static_cast<std::size_t>(1_MB + 123));
+    auto size = static_cast<int64_t>(content.size());
+    RandomAccessReaderOptions options;
+    options.BlockSize = 64_KB;
+    options.MaxCachedBlocks = 4;
+    options.ReadAheadBlocks = 0;
+    RangeRequests requests;
+    auto reader = MakeReader(content, options, requests);
+    EXPECT_EQ(reader->GetSize(), size);
+
+    // The footer, then a read of the same block.
+    EXPECT_EQ(ReadAt(*reader, size - 8, 8), Slice(content, size - 8, 8));
+    EXPECT_EQ(ReadAt(*reader, size - 100, 50), Slice(content, size - 100, 50));
+    auto lastBlockOffset = 16 * 64_KB;
+    EXPECT_EQ(
+        requests.Take(),
+        (std::vector<std::pair<int64_t, int64_t>>{{lastBlockOffset, size - lastBlockOffset}}));
+
+    // The adjacent blocks missing are requested together.
+    EXPECT_EQ(ReadAt(*reader, 64_KB + 10, 3 * 64_KB), Slice(content, 64_KB + 10, 3 * 64_KB));
+    EXPECT_EQ(
+        requests.Take(), (std::vector<std::pair<int64_t, int64_t>>{{64_KB, 4 * 64_KB}}));
+    EXPECT_EQ(ReadAt(*reader, 4 * 64_KB, 2 * 64_KB), Slice(content, 4 * 64_KB, 2 * 64_KB));
+    EXPECT_EQ(requests.Take(), (std::vector<std::pair<int64_t, int64_t>>{{5 * 64_KB, 64_KB}}));
+
+    // The least recently used block was evicted.
+    EXPECT_EQ(ReadAt(*reader, size - 1, 1), Slice(content, size - 1, 1));
+    EXPECT_EQ(requests.Take().size(), 1U);
+
+    EXPECT_EQ(ReadAt(*reader, size - 5, 100), Slice(content, size - 5, 5));
+    EXPECT_TRUE(ReadAt(*reader, size, 100).empty());
+    EXPECT_TRUE(requests.Take().empty());
+  }
+
+  TEST(RandomAccessReaderTest, ReadsAheadWhenSequential)
+  {
+    auto content = RandomBuffer(static_cast<std::size_t>(5 * 64_KB));
+    RandomAccessReaderOptions options;
+    options.BlockSize = 64_KB;
+    options.ReadAheadBlocks = 2;
+    options.SequentialReadsBeforeReadAhead = 2;
+    RangeRequests requests;
+    auto reader = MakeReader(content, options, requests);
+
+    EXPECT_EQ(ReadAt(*reader, 0, 16_KB), Slice(content, 0, 16_KB));
+    EXPECT_EQ(ReadAt(*reader, 16_KB, 16_KB), Slice(content, 16_KB, 16_KB));
+    EXPECT_EQ(requests.Take().size(), 1U);
+
+    // The second read in a row reads the next blocks ahead.
+    EXPECT_EQ(ReadAt(*reader, 32_KB, 16_KB), Slice(content, 32_KB, 16_KB));
+    std::vector<std::pair<int64_t, int64_t>> ranges;
+    for (int i = 0; i < 100 && ranges.empty(); ++i)
+    {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      ranges = requests.Take();
+    }
+    EXPECT_EQ(ranges, (std::vector<std::pair<int64_t, int64_t>>{{64_KB, 2 * 64_KB}}));
+
+    EXPECT_EQ(ReadAt(*reader, 48_KB, 64_KB), Slice(content, 48_KB, 64_KB));
+    EXPECT_EQ(ReadAt(*reader, 112_KB, 208_KB), Slice(content, 112_KB, 208_KB));
+    reader.reset();
+    // Each block is requested once.
+    int64_t requested = 0;
+    for (const auto& range : requests.Take())
+    {
+      EXPECT_EQ(range.first % 64_KB, 0);
+      requested += range.second;
+    }
+    EXPECT_EQ(requested, 2 * 64_KB);
+  }
+
+  TEST(RandomAccessReaderTest, ConcurrentReadsShareDownloads)
+  {
+    auto content = RandomBuffer(static_cast<std::size_t>(256_KB));
+    RandomAccessReaderOptions options;
+    options.BlockSize = 64_KB;
+    options.ReadAheadBlocks = 0;
+    RangeRequests requests;
+    requests.Delay = std::chrono::milliseconds(100);
+    auto reader = MakeReader(content, options, requests);
+
+    std::vector<std::thread> threads;
+    std::vector<std::vector<uint8_t>> reads(4);
+    for (std::size_t i = 0; i < reads.size(); ++i)
+    {
+      threads.emplace_back([&, i]() {
+        reads[i] = ReadAt(*reader, 64_KB + static_cast<int64_t>(i) * 100, 100);
+      });
+    }
+    for (auto& thread : threads)
+    {
+      thread.join();
+    }
+    for (std::size_t i = 0; i < reads.size(); ++i)
+    {
+      EXPECT_EQ(reads[i], Slice(content, 64_KB + static_cast<int64_t>(i) * 100, 100));
+    }
+    EXPECT_EQ(requests.Take().size(), 1U);
+  }
+
+  TEST(RandomAccessReaderTest, FailedBlockIsRequestedAgain)
+  {
+    auto content = RandomBuffer(static_cast<std::size_t>(256_KB));
+    RandomAccessReaderOptions options;
+    options.BlockSize = 64_KB;
+    RangeRequests requests;
+    requests.FailingOffset = 128_KB;
+    auto reader = MakeReader(content, options, requests);
+
+    EXPECT_THROW(ReadAt(*reader, 128_KB + 1, 10), std::runtime_error);
+    EXPECT_EQ(ReadAt(*reader, 128_KB + 1, 10), Slice(content, 128_KB + 1, 10));
+    EXPECT_EQ(requests.Take().size(), 2U);
+  }
+
+  TEST(RandomAccessReaderTest, CanceledReadDoesNotFailOthers)
+  {
+    auto content = RandomBuffer(static_cast<std::size_t>(256_KB));
+    RandomAccessReaderOptions options;
+    options.BlockSize = 64_KB;
+    options.ReadAheadBlocks = 0;
+    RangeRequests requests;
+    requests.Delay = std::chrono::milliseconds(200);
+    auto reader = MakeReader(content, options, requests);
+
+    // The second read waits for the block the first one downloads, then the first is canceled.
+    std::thread canceled([&]() {
+      auto context = Azure::Core::Context().WithDeadline(
+          std::chrono::system_clock::now() + std::chrono::milliseconds(50));
+      std::vector<uint8_t> buffer(10);
+      EXPECT_THROW(
+          reader->ReadAt(context, 1, buffer.data(), 10), Azure::Core::OperationCanceledException);
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    std::vector<uint8_t> read;
+    EXPECT_NO_THROW(read = ReadAt(*reader, 100, 10));
+    canceled.join();
+    EXPECT_EQ(read, Slice(content, 100, 10));
+    EXPECT_EQ(requests.Take().size(), 2U);
+  }
+
+}}} // namespace Azure::Storage::Test
@@ -0,0 +1,51 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// SPDX-License-Identifier: MIT
+
+#include "common/range_coalescing.hpp"
+#include "test_base.hpp"
+
+#include <vector>
+
+namespace Azure { namespace Storage { namespace Test {
+
+  TEST(RangeCoalescingTest, CoalesceRanges)
+  {
+    std::vector<std::pair<int64_t, int64_t>> ranges = {
+        {1000, 100}, // 0
+        {0, 10}, // 1
+        {20, 10}, // 2
+        {1050, 100}, // 3, overlaps 0
+        {500, 0}, // 4, empty
+        {40, 5}, // 5, 10 bytes after 2
+        {3000, 5000}, // 6, longer than maxLength
+        {8000, 1}, // 7, adjacent to 6 but too long
+    };
+    auto coalesced = Details::CoalesceRanges(ranges, 10, 1000);
+    ASSERT_EQ(coalesced.size(), 4U);
+
+    EXPECT_EQ(coalesced[0].Offset, 0);
+    EXPECT_EQ(coalesced[0].Length, 45);
+    EXPECT_EQ(coalesced[0].Ranges, (std::vector<std::size_t>{1, 2, 5}));
+    EXPECT_FALSE(coalesced[0].Overlapping);
+
+    EXPECT_EQ(coalesced[1].Offset, 1000);
+    EXPECT_EQ(coalesced[1].Length, 150);
+    EXPECT_EQ(coalesced[1].Ranges, (std::vector<std::size_t>{0, 3}));
+    EXPECT_TRUE(coalesced[1].Overlapping);
+
+    EXPECT_EQ(coalesced[2].Offset, 3000);
+    EXPECT_EQ(coalesced[2].Length, 5000);
+    EXPECT_EQ(coalesced[2].Ranges, (std::vector<std::size_t>{6}));
+
+    EXPECT_EQ(coalesced[3].Offset, 8000);
+    EXPECT_EQ(coalesced[3].Length, 1);
+    EXPECT_EQ(coalesced[3].Ranges, (std::vector<std::size_t>{7}));
+
+    // Without a gap allowed only the adjacent ranges are merged.
+    coalesced = Details::CoalesceRanges({{0, 10}, {10, 10}, {21, 10}}, 0, 1000);
+    ASSERT_EQ(coalesced.size(), 2U);
+    EXPECT_EQ(coalesced[0].Length, 20);
+    EXPECT_TRUE(Details::CoalesceRanges({}, 10, 1000).empty());
+  }
+
+}}} // namespace Azure::Storage::Test
@@ -0,0 +1,132 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// SPDX-License-Identifier: MIT
+
+#include "common/read_ahead_stream.hpp"
+#include "test_base.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace Azure { namespace Storage { namespace Test {
+
+  namespace {
+    std::unique_ptr<Details::ReadAheadStream> MakeStream(
+        const std::vector<uint8_t>& content,
+        int64_t offset,
+        int64_t length,
+        Details::ReadAheadStreamOptions options,
+        std::atomic<int64_t>& maxChunkAhead,
+        int64_t failingOffset = -1)
+    {
+      auto firstChunk = std::make_unique<Azure::Core::Http::MemoryBodyStream>(
+          content.data() + offset,
+          static_cast<std::size_t>(std::min(options.ChunkSize, length)));
+      auto chunkSize = options.ChunkSize;
+      auto rangeGetter = [&content, &maxChunkAhead, offset, chunkSize, failingOffset](
+                             Azure::Core::Context&, int64_t rangeOffset, int64_t rangeLength)
+          -> std::unique_ptr<Azure::Core::Http::BodyStream> {
+        if (rangeOffset == failingOffset)
+        {
+          throw std::runtime_error("failed to get range");
+        }
+        auto chunkId = (rangeOffset - offset) / chunkSize;
+        int64_t previous = maxChunkAhead;
+        while (chunkId > previous && !maxChunkAhead.compare_exchange_weak(previous, chunkId))
+        {
+        }
+        return std::make_unique<Azure::Core::Http::MemoryBodyStream>(
+            content.data() + rangeOffset, static_cast<std::size_t>(rangeLength));
+      };
+      return std::make_unique<Details::ReadAheadStream>(
+          std::move(firstChunk),
+          offset,
+          length,
+          options,
+          rangeGetter,
+          Azure::Core::Context());
+    }
+  } // namespace
+
+  TEST(ReadAheadStreamTest, ReadsInOrder)
+  {
+    auto content = RandomBuffer(static_cast<std::size_t>(1_MB + 123));
+    Details::ReadAheadStreamOptions options;
+    options.ChunkSize = 64_KB;
+    options.Concurrency = 3;
+    options.MaxChunksAhead = 4;
+
+    for (int64_t offset : {int64_t(0), int64_t(1000)})
+    {
+      auto length = static_cast<int64_t>(content.size()) - offset - 7;
+      std::atomic<int64_t> maxChunkAhead{0};
+      auto stream = MakeStream(content, offset, length, options, maxChunkAhead);
+      EXPECT_EQ(stream->Length(), length);
+
+      // Nothing is read past the window while the first chunk isn't consumed.
+      std::this_thread::sleep_for(std::chrono::milliseconds(50));
+      EXPECT_LE(maxChunkAhead, options.MaxChunksAhead);
+
+      Azure::Core::Context context;
+      auto read = Azure::Core::Http::BodyStream::ReadToEnd(context, *stream);
+      EXPECT_EQ(
+          read,
+          std::vector<uint8_t>(
+              content.begin() + static_cast<std::ptrdiff_t>(offset),
+              content.begin() + static_cast<std::ptrdiff_t>(offset + length)));
+    }
+  }
+
+  TEST(ReadAheadStreamTest, OneChunkAhead)
+  {
+    auto content = RandomBuffer(static_cast<std::size_t>(512_KB));
+    Details::ReadAheadStreamOptions options;
+    options.ChunkSize = 64_KB;
+    options.Concurrency = 4;
+    options.MaxChunksAhead = 1;
+    std::atomic<int64_t> maxChunkAhead{0};
+    auto stream = MakeStream(
+        content, 0, static_cast<int64_t>(content.size()), options, maxChunkAhead);
+
+    // The chunk after the one being consumed is downloaded, not the ones after it.
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_EQ(maxChunkAhead, 1);
+
+    Azure::Core::Context context;
+    EXPECT_EQ(Azure::Core::Http::BodyStream::ReadToEnd(context, *stream), content);
+
+    options.MaxChunksAhead = 0;
+    EXPECT_THROW(
+        MakeStream(content, 0, static_cast<int64_t>(content.size()), options, maxChunkAhead),
+        std::invalid_argument);
+  }
+
+  TEST(ReadAheadStreamTest, FailedRangeIsThrownInOrder)
+  {
+    auto content = RandomBuffer(static_cast<std::size_t>(512_KB));
+    Details::ReadAheadStreamOptions options;
+    options.ChunkSize = 64_KB;
+    options.Concurrency = 2;
+    std::atomic<int64_t> maxChunkAhead{0};
+    auto stream = MakeStream(
+        content, 0, static_cast<int64_t>(content.size()), options, maxChunkAhead, 3 * 64_KB);
+
+    Azure::Core::Context context;
+    std::vector<uint8_t> buffer(static_cast<std::size_t>(3 * 64_KB));
+    EXPECT_EQ(
+        Azure::Core::Http::BodyStream::ReadToCount(
+            context, *stream, buffer.data(), static_cast<int64_t>(buffer.size())),
+        static_cast<int64_t>(buffer.size()));
+    EXPECT_THROW(stream->Read(context, buffer.data(), 1), std::runtime_error);
+
+    // A stream dropped before its end stops its downloads.
+    auto unread = MakeStream(
+        content, 0, static_cast<int64_t>(content.size()), options, maxChunkAhead);
+    unread.reset();
+  }
+
+}}} // namespace Azure::Storage::Test
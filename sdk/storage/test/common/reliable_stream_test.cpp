@@ -0,0 +1,124 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// SPDX-License-Identifier: MIT
+
+#include "common/reliable_stream.hpp"
+#include "http/http.hpp"
+#include "test_base.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <vector>
+
+namespace Azure { namespace Storage { namespace Test {
+
+  namespace {
+    // Serves content from an offset and fails after failAfter bytes.
+    class FailingBodyStream : public Azure::Core::Http::BodyStream {
+    public:
+      FailingBodyStream(const std::vector<uint8_t>& content, int64_t offset, int64_t failAfter)
+          : m_content(content), m_offset(offset), m_failAfter(failAfter)
+      {
+      }
+
+      int64_t Length() const override
+      {
+        return static_cast<int64_t>(m_content.size()) - m_offset;
+      }
+
+      int64_t Read(Azure::Core::Context&, uint8_t* buffer, int64_t count) override
+      {
+        if (m_failAfter == 0)
+        {
+          throw Azure::Core::Http::TransportException("connection reset");
+        }
+        auto copied = std::min(
+            {count, static_cast<int64_t>(m_content.size()) - m_offset, m_failAfter});
+        std::copy(
+            m_content.begin() + static_cast<std::ptrdiff_t>(m_offset),
+            m_content.begin() + static_cast<std::ptrdiff_t>(m_offset + copied),
+            buffer);
+        m_offset += copied;
+        m_failAfter -= copied;
+        return copied;
+      }
+
+    private:
+      const std::vector<uint8_t>& m_content;
+      int64_t m_offset;
+      int64_t m_failAfter;
+    };
+
+    Details::ReliableStreamOptions FastRetries(int maxRetryRequests)
+    {
+      Details::ReliableStreamOptions options;
+      options.MaxRetryRequests = maxRetryRequests;
+      options.RetryDelay = std::chrono::milliseconds(1);
+      options.MaxRetryDelay = std::chrono::milliseconds(2);
+      return options;
+    }
+  } // namespace
+
+  TEST(ReliableStreamTest, ResumesAtOffset)
+  {
+    auto content = RandomBuffer(static_cast<std::size_t>(10_KB));
+    std::vector<int64_t> offsets;
+    auto httpGetter = [&](Azure::Core::Context&, int64_t offset) {
+      offsets.push_back(offset);
+      return std::make_unique<FailingBodyStream>(content, offset, 3_KB);
+    };
+    Details::ReliableStream stream(
+        std::make_unique<FailingBodyStream>(content, 0, 3_KB), FastRetries(3), httpGetter);
+    EXPECT_EQ(stream.Length(), 10_KB);
+
+    Azure::Core::Context context;
+    auto body = Azure::Core::Http::BodyStream::ReadToEnd(context, stream);
+    EXPECT_EQ(body, content);
+    EXPECT_EQ(offsets, (std::vector<int64_t>{3_KB, 6_KB, 9_KB}));
+  }
+
+  TEST(ReliableStreamTest, RetryBudgetIsShared)
+  {
+    auto content = RandomBuffer(static_cast<std::size_t>(10_KB));
+    int requests = 0;
+    auto httpGetter = [&](Azure::Core::Context&, int64_t offset) {
+      ++requests;
+      return std::make_unique<FailingBodyStream>(content, offset, 1_KB);
+    };
+    Details::ReliableStream stream(
+        std::make_unique<FailingBodyStream>(content, 0, 1_KB), FastRetries(2), httpGetter);
+
+    // Every read gets 1KB before failing, the budget runs out over several reads.
+    Azure::Core::Context context;
+    std::vector<uint8_t> buffer(static_cast<std::size_t>(1_KB));
+    EXPECT_EQ(stream.Read(context, buffer.data(), 1_KB), 1_KB);
+    EXPECT_EQ(stream.Read(context, buffer.data(), 1_KB), 1_KB);
+    EXPECT_EQ(stream.Read(context, buffer.data(), 1_KB), 1_KB);
+    EXPECT_THROW(
+        stream.Read(context, buffer.data(), 1_KB), Azure::Core::Http::TransportException);
+    EXPECT_EQ(requests, 2);
+  }
+
+  TEST(ReliableStreamTest, CanceledWhileBackingOff)
+  {
+    auto content = RandomBuffer(static_cast<std::size_t>(1_KB));
+    auto options = FastRetries(1);
+    options.RetryDelay = std::chrono::minutes(1);
+    options.MaxRetryDelay = std::chrono::minutes(1);
+    Details::ReliableStream stream(
+        std::make_unique<FailingBodyStream>(content, 0, 0),
+        options,
+        [&](Azure::Core::Context&, int64_t offset) {
+          return std::make_unique<FailingBodyStream>(content, offset, 1_KB);
+        });
+
+    auto context = Azure::Core::Context().WithDeadline(
+        std::chrono::system_clock::now() + std::chrono::milliseconds(50));
+    std::vector<uint8_t> buffer(static_cast<std::size_t>(1_KB));
+    auto start = std::chrono::steady_clock::now();
+    EXPECT_THROW(
+        stream.Read(context, buffer.data(), 1_KB), Azure::Core::OperationCanceledException);
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(10));
+  }
+
+}}} // namespace Azure::Storage::Test
@@ -0,0 +1,114 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// SPDX-License-Identifier: MIT
+
+#include "common/shared_block_cache.hpp"
+#include "test_base.hpp"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include <string>
+#include <vector>
+
+namespace Azure { namespace Storage { namespace Test {
+
+  TEST(SharedBlockCacheTest, LookupAndInsert)
+  {
+    auto name = RandomString();
+    SharedBlockCacheOptions options;
+    options.BlockSize = 64_KB;
+    options.BlockCount = 16;
+    SharedBlockCache cache(name, options);
+    EXPECT_EQ(cache.GetBlockSize(), 64_KB);
+    EXPECT_EQ(cache.GetBlockCount(), 16);
+
+    // Another instance of the same name, as opened by another process, shares the blocks and
+    // uses the geometry of the cache created first.
+    SharedBlockCache other(name, SharedBlockCacheOptions());
+    EXPECT_EQ(other.GetBlockSize(), 64_KB);
+    EXPECT_EQ(other.GetBlockCount(), 16);
+
+    auto block = RandomBuffer(static_cast<std::size_t>(64_KB));
+    std::vector<uint8_t> buffer(block.size());
+    EXPECT_FALSE(other.Lookup("blob\netag", 3, buffer.data(), 64_KB));
+    cache.Insert("blob\netag", 3, block.data(), 64_KB);
+    EXPECT_TRUE(other.Lookup("blob\netag", 3, buffer.data(), 64_KB));
+    EXPECT_EQ(buffer, block);
+    EXPECT_FALSE(other.Lookup("blob\netag", 3, buffer.data(), 1_KB));
+    EXPECT_FALSE(other.Lookup("blob\netag", 2, buffer.data(), 64_KB));
+    EXPECT_FALSE(other.Lookup("blob\nnewetag", 3, buffer.data(), 64_KB));
+
+    // Inserting more blocks than the cache holds evicts some, never the last one.
+    int64_t hits = 0;
+    for (int64_t blockId = 0; blockId < 64; ++blockId)
+    {
+      block[0] = static_cast<uint8_t>(blockId);
+      cache.Insert("other", blockId, block.data(), 1_KB);
+      ASSERT_TRUE(cache.Lookup("other", blockId, buffer.data(), 1_KB));
+      EXPECT_EQ(buffer[0], static_cast<uint8_t>(blockId));
+    }
+    for (int64_t blockId = 0; blockId < 64; ++blockId)
+    {
+      hits += cache.Lookup("other", blockId, buffer.data(), 1_KB) ? 1 : 0;
+    }
+    EXPECT_LE(hits, 16);
+
+    SharedBlockCache::Remove(name);
+    EXPECT_THROW(SharedBlockCache("not/a/name"), std::invalid_argument);
+  }
+
+#ifndef _WIN32
+  TEST(SharedBlockCacheTest, SharedAcrossProcesses)
+  {
+    auto name = RandomString();
+    auto block = RandomBuffer(static_cast<std::size_t>(4_KB + 1));
+    auto length = static_cast<int64_t>(block.size());
+
+    pid_t pid = fork();
+    ASSERT_NE(pid, -1);
+    if (pid == 0)
+    {
+      SharedBlockCache cache(name);
+      cache.Insert("blob\netag", 0, block.data(), length);
+      _exit(0);
+    }
+    int status = 0;
+    ASSERT_EQ(waitpid(pid, &status, 0), pid);
+    ASSERT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+    SharedBlockCache cache(name);
+    std::vector<uint8_t> buffer(block.size());
+    EXPECT_TRUE(cache.Lookup("blob\netag", 0, buffer.data(), length));
+    EXPECT_EQ(buffer, block);
+    SharedBlockCache::Remove(name);
+  }
+
+  TEST(SharedBlockCacheTest, AbandonedSegmentIsReplaced)
+  {
+    // A segment sized by a creator that died before initializing it.
+    auto name = RandomString();
+    auto segmentName = "/azure-storage-" + name;
+    int fd = shm_open(segmentName.data(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    ASSERT_NE(fd, -1);
+    ASSERT_EQ(ftruncate(fd, static_cast<off_t>(1_MB)), 0);
+    close(fd);
+
+    SharedBlockCacheOptions options;
+    options.BlockSize = 4_KB;
+    options.BlockCount = 8;
+    SharedBlockCache cache(name, options);
+    EXPECT_EQ(cache.GetBlockSize(), 4_KB);
+    auto block = RandomBuffer(static_cast<std::size_t>(4_KB));
+    std::vector<uint8_t> buffer(block.size());
+    cache.Insert("blob\netag", 0, block.data(), 4_KB);
+    EXPECT_TRUE(SharedBlockCache(name).Lookup("blob\netag", 0, buffer.data(), 4_KB));
+    SharedBlockCache::Remove(name);
+  }
+#endif
+
+}}} // namespace Azure::Storage::Test
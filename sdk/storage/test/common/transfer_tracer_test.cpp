@@ -0,0 +1,60 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// SPDX-License-Identifier: MIT
+
+#include "common/concurrent_transfer.hpp"
+#include "common/transfer_tracer.hpp"
+#include "test_base.hpp"
+
+#include <chrono>
+#include <string>
+
+namespace Azure { namespace Storage { namespace Test {
+
+  namespace {
+    std::size_t CountOccurrences(const std::string& text, const std::string& pattern)
+    {
+      std::size_t count = 0;
+      for (auto position = text.find(pattern); position != std::string::npos;
+           position = text.find(pattern, position + 1))
+      {
+        ++count;
+      }
+      return count;
+    }
+  } // namespace
+
+  TEST(TransferTracerTest, ConcurrentTransferRecordsChunks)
+  {
+    TransferTracer tracer;
+    Details::ConcurrentTransfer(
+        0,
+        10,
+        4,
+        2,
+        [](int64_t, int64_t, int64_t, int64_t) {},
+        &tracer);
+
+    auto trace = tracer.ToChromeTrace();
+    EXPECT_EQ(trace.find("{\"displayTimeUnit\":\"ms\",\"traceEvents\":["), 0U);
+    EXPECT_EQ(CountOccurrences(trace, "\"name\":\"queued\""), 3U);
+    EXPECT_EQ(CountOccurrences(trace, "\"name\":\"chunk\""), 3U);
+    EXPECT_NE(trace.find("\"args\":{\"chunk\":2,\"offset\":8,\"length\":2}"), std::string::npos);
+  }
+
+  TEST(TransferTracerTest, OldestSpansAreOverwritten)
+  {
+    TransferTracer tracer(4);
+    auto now = std::chrono::steady_clock::now();
+    for (int64_t i = 0; i < 10; ++i)
+    {
+      tracer.RecordSpan(TransferSpanKind::Body, i, i * 100, 100, now, now);
+    }
+
+    auto trace = tracer.ToChromeTrace();
+    EXPECT_EQ(CountOccurrences(trace, "\"name\":\"body\""), 4U);
+    EXPECT_EQ(trace.find("\"chunk\":5,"), std::string::npos);
+    EXPECT_NE(trace.find("\"chunk\":6,"), std::string::npos);
+    EXPECT_NE(trace.find("\"chunk\":9,"), std::string::npos);
+  }
+
+}}} // namespace Azure::Storage::Test
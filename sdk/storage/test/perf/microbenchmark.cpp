@@ -0,0 +1,256 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// SPDX-License-Identifier: MIT
+
+// Google Benchmark microbenchmarks of the code that runs on every request, to get the ns/op
+// baselines optimizations are measured against.
+
+#include "common/common_headers_request_policy.hpp"
+#include "common/crypt.hpp"
+#include "common/shared_key_policy.hpp"
+#include "common/storage_common.hpp"
+#include "common/storage_credential.hpp"
+#include "common/storage_uri_builder.hpp"
+#include "common/xml_wrapper.hpp"
+#include "http/curl/curl.hpp"
+#include "http/http.hpp"
+#include "http/in_memory_transport.hpp"
+#include "http/pipeline.hpp"
+#include "http/policy.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+
+  using namespace Azure::Core::Http;
+
+  constexpr const char* c_AccountName = "benchmarkaccount";
+  constexpr const char* c_AccountKey
+      = "Eby8vdM02xNOcqFlqUwJPLlmEtlCDXJ1OUzFT50uSRZ6IFsuFq2UVErCz4I6tq/K1SZFPTOtr/KBHBeksoGMGw==";
+  constexpr const char* c_BlobUrl
+      = "https://benchmarkaccount.blob.core.windows.net/container/directory/blob%20name.bin";
+
+  // The response of a Get Blob Properties request, as sent by the service.
+  const std::string c_ResponseHead = "HTTP/1.1 200 OK\r\n"
+                                     "Content-Length: 1048576\r\n"
+                                     "Content-Type: application/octet-stream\r\n"
+                                     "Last-Modified: Tue, 13 Oct 2020 08:12:44 GMT\r\n"
+                                     "Accept-Ranges: bytes\r\n"
+                                     "ETag: \"0x8D86F4D3C1FE6A4\"\r\n"
+                                     "Server: Windows-Azure-Blob/1.0 Microsoft-HTTPAPI/2.0\r\n"
+                                     "x-ms-request-id: 3a1b5c2e-801e-0057-2a3c-a1e7b8000000\r\n"
+                                     "x-ms-client-request-id: "
+                                     "0f6a1f0e-5d6b-4f6e-9a8e-1b2c3d4e5f60\r\n"
+                                     "x-ms-version: 2019-12-12\r\n"
+                                     "x-ms-creation-time: Tue, 13 Oct 2020 08:12:44 GMT\r\n"
+                                     "x-ms-lease-status: unlocked\r\n"
+                                     "x-ms-lease-state: available\r\n"
+                                     "x-ms-blob-type: BlockBlob\r\n"
+                                     "x-ms-server-encrypted: true\r\n"
+                                     "x-ms-access-tier: Hot\r\n"
+                                     "x-ms-access-tier-inferred: true\r\n"
+                                     "Date: Tue, 13 Oct 2020 08:15:02 GMT\r\n"
+                                     "\r\n";
+
+  std::string ListBlobsPayload(int blobs)
+  {
+    std::string xml = "<?xml version=\"1.0\" encoding=\"utf-8\"?><EnumerationResults "
+                      "ServiceEndpoint=\"https://benchmarkaccount.blob.core.windows.net/\" "
+                      "ContainerName=\"container\"><Prefix>directory/</Prefix><MaxResults>5000"
+                      "</MaxResults><Blobs>";
+    for (int i = 0; i < blobs; ++i)
+    {
+      xml += "<Blob><Name>directory/blob" + std::to_string(i)
+          + ".bin</Name><Properties><Creation-Time>Tue, 13 Oct 2020 08:12:44 GMT</Creation-Time>"
+            "<Last-Modified>Tue, 13 Oct 2020 08:12:44 GMT</Last-Modified><Etag>0x8D86F4D3C1FE6A4"
+            "</Etag><Content-Length>1048576</Content-Length><Content-Type>"
+            "application/octet-stream</Content-Type><Content-Encoding /><Content-Language />"
+            "<Content-MD5>1B2M2Y8AsgTpgAmY7PhCfg==</Content-MD5><Cache-Control />"
+            "<BlobType>BlockBlob</BlobType><AccessTier>Hot</AccessTier><AccessTierInferred>true"
+            "</AccessTierInferred><LeaseStatus>unlocked</LeaseStatus><LeaseState>available"
+            "</LeaseState><ServerEncrypted>true</ServerEncrypted></Properties></Blob>";
+    }
+    xml += "</Blobs><NextMarker /></EnumerationResults>";
+    return xml;
+  }
+
+  Request MakeRequest()
+  {
+    Request request(HttpMethod::Get, c_BlobUrl);
+    request.AddHeader("x-ms-version", "2019-12-12");
+    request.AddHeader("x-ms-client-request-id", "0f6a1f0e-5d6b-4f6e-9a8e-1b2c3d4e5f60");
+    request.AddHeader("x-ms-range", "bytes=0-4194303");
+    request.AddHeader("x-ms-date", "Tue, 13 Oct 2020 08:15:02 GMT");
+    request.AddHeader("User-Agent", "azsdk-cpp-storage-blob/1.0.0 (Linux)");
+    return request;
+  }
+
+  // Answers every request with the same response, without any I/O.
+  std::shared_ptr<InMemoryTransport> CreateTransport()
+  {
+    InMemoryResponse response;
+    response.Headers["etag"] = "\"0x8D86F4D3C1FE6A4\"";
+    response.Headers["last-modified"] = "Tue, 13 Oct 2020 08:12:44 GMT";
+    response.Headers["x-ms-request-id"] = "3a1b5c2e-801e-0057-2a3c-a1e7b8000000";
+    response.Headers["x-ms-version"] = "2019-12-12";
+    auto transport = std::make_shared<InMemoryTransport>();
+    transport->AddResponse(HttpMethod::Get, "/", response);
+    transport->AddResponse(HttpMethod::Head, "/", response);
+    return transport;
+  }
+
+  void SharedKeySignature(benchmark::State& state)
+  {
+    // GetSignature is private, it's measured through the policy with an in-memory transport.
+    std::vector<std::unique_ptr<HttpPolicy>> policies;
+    policies.emplace_back(std::make_unique<Azure::Storage::SharedKeyPolicy>(
+        std::make_shared<Azure::Storage::SharedKeyCredential>(c_AccountName, c_AccountKey)));
+    policies.emplace_back(std::make_unique<TransportPolicy>(CreateTransport()));
+    HttpPipeline pipeline(std::move(policies));
+    auto context = Azure::Core::GetApplicationContext();
+    for (auto _ : state)
+    {
+      auto request = MakeRequest();
+      benchmark::DoNotOptimize(pipeline.Send(context, request));
+    }
+  }
+  BENCHMARK(SharedKeySignature);
+
+  void GetHttpMessagePreBody(benchmark::State& state)
+  {
+    auto request = MakeRequest();
+    for (auto _ : state)
+    {
+      benchmark::DoNotOptimize(request.GetHTTPMessagePreBody());
+    }
+  }
+  BENCHMARK(GetHttpMessagePreBody);
+
+  void ResponseBufferParse(benchmark::State& state)
+  {
+    auto buffer = reinterpret_cast<const uint8_t*>(c_ResponseHead.data());
+    auto size = static_cast<int64_t>(c_ResponseHead.size());
+    // The size of the reads from the socket, the parser is called once per read.
+    auto readSize = state.range(0);
+    for (auto _ : state)
+    {
+      benchmark::DoNotOptimize(
+          Azure::Core::Http::Details::ParseResponseHead(buffer, size, readSize));
+    }
+    state.SetBytesProcessed(state.iterations() * size);
+  }
+  BENCHMARK(ResponseBufferParse)->Arg(16)->Arg(1024);
+
+  void RawResponseAddHeader(benchmark::State& state)
+  {
+    for (auto _ : state)
+    {
+      RawResponse response(1, 1, HttpStatusCode::Ok, "OK");
+      response.AddHeader("Content-Length: 1048576\r\n");
+      response.AddHeader("Last-Modified: Tue, 13 Oct 2020 08:12:44 GMT\r\n");
+      response.AddHeader("ETag: \"0x8D86F4D3C1FE6A4\"\r\n");
+      response.AddHeader("x-ms-request-id: 3a1b5c2e-801e-0057-2a3c-a1e7b8000000\r\n");
+      response.AddHeader("x-ms-version", "2019-12-12");
+      response.AddHeader("x-ms-blob-type", "BlockBlob");
+      benchmark::DoNotOptimize(response.GetHeaders());
+    }
+    state.SetItemsProcessed(state.iterations() * 6);
+  }
+  BENCHMARK(RawResponseAddHeader);
+
+  void XmlReaderListBlobs(benchmark::State& state)
+  {
+    auto xml = ListBlobsPayload(static_cast<int>(state.range(0)));
+    for (auto _ : state)
+    {
+      Azure::Storage::XmlReader reader(xml.data(), xml.size());
+      int64_t nodes = 0;
+      while (reader.Read().Type != Azure::Storage::XmlNodeType::End)
+      {
+        ++nodes;
+      }
+      benchmark::DoNotOptimize(nodes);
+    }
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(xml.size()));
+  }
+  BENCHMARK(XmlReaderListBlobs)->Arg(100)->Arg(5000);
+
+  void Base64Encode(benchmark::State& state)
+  {
+    std::string data(static_cast<std::size_t>(state.range(0)), '\x5a');
+    for (auto _ : state)
+    {
+      benchmark::DoNotOptimize(Azure::Storage::Base64Encode(data));
+    }
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+  }
+  BENCHMARK(Base64Encode)->Arg(32)->Arg(64 * 1024);
+
+  void Base64Decode(benchmark::State& state)
+  {
+    auto encoded
+        = Azure::Storage::Base64Encode(std::string(static_cast<std::size_t>(state.range(0)), 'Z'));
+    for (auto _ : state)
+    {
+      benchmark::DoNotOptimize(Azure::Storage::Base64Decode(encoded));
+    }
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+  }
+  BENCHMARK(Base64Decode)->Arg(32)->Arg(64 * 1024);
+
+  void UriBuilderToString(benchmark::State& state)
+  {
+    Azure::Storage::UriBuilder builder(c_BlobUrl);
+    builder.AppendQuery("comp", "block");
+    builder.AppendQuery("blockid", "YmxvY2stMDAwMDAwMDAwMQ%3D%3D");
+    builder.AppendQuery("timeout", "30");
+    for (auto _ : state)
+    {
+      benchmark::DoNotOptimize(builder.ToString());
+    }
+  }
+  BENCHMARK(UriBuilderToString);
+
+  void UriBuilderEncoding(benchmark::State& state)
+  {
+    for (auto _ : state)
+    {
+      Azure::Storage::UriBuilder builder;
+      builder.SetScheme("https");
+      builder.SetHost("benchmarkaccount.blob.core.windows.net");
+      builder.SetPath("container/directory with spaces/blob name+%.bin", true);
+      builder.AppendQuery("blockid", "YmxvY2stMDAwMDAwMDAwMQ==", true);
+      builder.AppendQuery("prefix", "directory with spaces/", true);
+      benchmark::DoNotOptimize(builder.ToString());
+    }
+  }
+  BENCHMARK(UriBuilderEncoding);
+
+  void PipelineSend(benchmark::State& state)
+  {
+    // The policies of a blob client authenticated with a shared key.
+    std::vector<std::unique_ptr<HttpPolicy>> policies;
+    policies.emplace_back(std::make_unique<TelemetryPolicy>("storage-blob", "1.0.0"));
+    policies.emplace_back(Azure::Storage::Details::CreateRetryPolicy(
+        RetryOptions(), "benchmarkaccount.blob.core.windows.net"));
+    policies.emplace_back(std::make_unique<Azure::Storage::CommonHeadersRequestPolicy>());
+    policies.emplace_back(std::make_unique<Azure::Storage::SharedKeyPolicy>(
+        std::make_shared<Azure::Storage::SharedKeyCredential>(c_AccountName, c_AccountKey)));
+    policies.emplace_back(std::make_unique<TransportPolicy>(CreateTransport()));
+    HttpPipeline pipeline(std::move(policies));
+    auto context = Azure::Core::GetApplicationContext();
+    for (auto _ : state)
+    {
+      Request request(HttpMethod::Head, c_BlobUrl);
+      request.AddHeader("x-ms-version", "2019-12-12");
+      benchmark::DoNotOptimize(pipeline.Send(context, request));
+    }
+  }
+  BENCHMARK(PipelineSend);
+
+} // namespace
+
+BENCHMARK_MAIN();
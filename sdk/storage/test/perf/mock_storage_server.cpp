@@ -0,0 +1,1589 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// SPDX-License-Identifier: MIT
+
+#include "mock_storage_server.hpp"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <deque>
+#include <stdexcept>
+
+namespace Azure { namespace Storage { namespace Test {
+
+  namespace {
+    constexpr std::size_t c_ioChunkSize = 64 * 1024;
+
+    // Well known key of the storage emulator account, the server doesn't check signatures.
+    constexpr const char* c_accountKey
+        = "Eby8vdM02xNOcqFlqUwJPLlmEtlCDXJ1OUzFT50uSRZ6IFsuFq2UVErCz4I6tq/K1SZFPTOtr/"
+          "KBHBeksoGMGw==";
+
+    std::string ToLower(std::string value)
+    {
+      std::transform(value.begin(), value.end(), value.begin(), [](char c) {
+        return static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+      });
+      return value;
+    }
+
+    std::string Trim(const std::string& value)
+    {
+      auto begin = value.find_first_not_of(" \t");
+      if (begin == std::string::npos)
+      {
+        return std::string();
+      }
+      auto end = value.find_last_not_of(" \t\r\n");
+      return value.substr(begin, end - begin + 1);
+    }
+
+    std::string PercentDecode(const std::string& value)
+    {
+      std::string decoded;
+      decoded.reserve(value.size());
+      for (std::size_t i = 0; i < value.size(); ++i)
+      {
+        if (value[i] == '%' && i + 2 < value.size()
+            && std::isxdigit(static_cast<unsigned char>(value[i + 1]))
+            && std::isxdigit(static_cast<unsigned char>(value[i + 2])))
+        {
+          decoded += static_cast<char>(std::stoi(value.substr(i + 1, 2), nullptr, 16));
+          i += 2;
+        }
+        else
+        {
+          decoded += value[i];
+        }
+      }
+      return decoded;
+    }
+
+    std::string XmlEscape(const std::string& value)
+    {
+      std::string escaped;
+      for (auto c : value)
+      {
+        switch (c)
+        {
+          case '&':
+            escaped += "&amp;";
+            break;
+          case '<':
+            escaped += "&lt;";
+            break;
+          case '>':
+            escaped += "&gt;";
+            break;
+          case '"':
+            escaped += "&quot;";
+            break;
+          default:
+            escaped += c;
+        }
+      }
+      return escaped;
+    }
+
+    std::string HttpDate()
+    {
+      auto now = std::time(nullptr);
+      std::tm tm;
+      gmtime_r(&now, &tm);
+      char buffer[64];
+      std::strftime(buffer, sizeof(buffer), "%a, %d %b %Y %H:%M:%S GMT", &tm);
+      return buffer;
+    }
+
+    bool SendAll(int socket, const uint8_t* data, std::size_t length)
+    {
+      while (length > 0)
+      {
+        auto sent = send(socket, data, length, MSG_NOSIGNAL);
+        if (sent <= 0)
+        {
+          return false;
+        }
+        data += sent;
+        length -= static_cast<std::size_t>(sent);
+      }
+      return true;
+    }
+
+    // Parses a "bytes=first-last" range, last is -1 when open ended.
+    bool ParseRange(const std::string& range, int64_t& first, int64_t& last)
+    {
+      long long parsedFirst = 0;
+      long long parsedLast = -1;
+      if (std::sscanf(range.data(), "bytes=%lld-%lld", &parsedFirst, &parsedLast) < 1)
+      {
+        return false;
+      }
+      first = parsedFirst;
+      last = parsedLast;
+      return true;
+    }
+
+    std::string GetHeader(
+        const std::map<std::string, std::string>& headers,
+        const std::string& name,
+        const std::string& defaultValue = std::string())
+    {
+      auto ite = headers.find(name);
+      return ite == headers.end() ? defaultValue : ite->second;
+    }
+
+    // HPACK (RFC 7541), enough of it to decode the request headers sent by libcurl and to encode
+    // responses as literals.
+    struct HuffmanCode
+    {
+      uint32_t Code;
+      uint8_t Length;
+    };
+
+    constexpr HuffmanCode c_huffmanCodes[256] = {
+      {0x1ff8, 13}, {0x7fffd8, 23}, {0xfffffe2, 28}, {0xfffffe3, 28}, {0xfffffe4, 28},
+      {0xfffffe5, 28}, {0xfffffe6, 28}, {0xfffffe7, 28}, {0xfffffe8, 28}, {0xffffea, 24},
+      {0x3ffffffc, 30}, {0xfffffe9, 28}, {0xfffffea, 28}, {0x3ffffffd, 30}, {0xfffffeb, 28},
+      {0xfffffec, 28}, {0xfffffed, 28}, {0xfffffee, 28}, {0xfffffef, 28}, {0xffffff0, 28},
+      {0xffffff1, 28}, {0xffffff2, 28}, {0x3ffffffe, 30}, {0xffffff3, 28}, {0xffffff4, 28},
+      {0xffffff5, 28}, {0xffffff6, 28}, {0xffffff7, 28}, {0xffffff8, 28}, {0xffffff9, 28},
+      {0xffffffa, 28}, {0xffffffb, 28}, {0x14, 6}, {0x3f8, 10}, {0x3f9, 10}, {0xffa, 12},
+      {0x1ff9, 13}, {0x15, 6}, {0xf8, 8}, {0x7fa, 11}, {0x3fa, 10}, {0x3fb, 10}, {0xf9, 8},
+      {0x7fb, 11}, {0xfa, 8}, {0x16, 6}, {0x17, 6}, {0x18, 6}, {0x0, 5}, {0x1, 5}, {0x2, 5},
+      {0x19, 6}, {0x1a, 6}, {0x1b, 6}, {0x1c, 6}, {0x1d, 6}, {0x1e, 6}, {0x1f, 6}, {0x5c, 7},
+      {0xfb, 8}, {0x7ffc, 15}, {0x20, 6}, {0xffb, 12}, {0x3fc, 10}, {0x1ffa, 13}, {0x21, 6},
+      {0x5d, 7}, {0x5e, 7}, {0x5f, 7}, {0x60, 7}, {0x61, 7}, {0x62, 7}, {0x63, 7}, {0x64, 7},
+      {0x65, 7}, {0x66, 7}, {0x67, 7}, {0x68, 7}, {0x69, 7}, {0x6a, 7}, {0x6b, 7}, {0x6c, 7},
+      {0x6d, 7}, {0x6e, 7}, {0x6f, 7}, {0x70, 7}, {0x71, 7}, {0x72, 7}, {0xfc, 8}, {0x73, 7},
+      {0xfd, 8}, {0x1ffb, 13}, {0x7fff0, 19}, {0x1ffc, 13}, {0x3ffc, 14}, {0x22, 6}, {0x7ffd, 15},
+      {0x3, 5}, {0x23, 6}, {0x4, 5}, {0x24, 6}, {0x5, 5}, {0x25, 6}, {0x26, 6}, {0x27, 6}, {0x6, 5},
+      {0x74, 7}, {0x75, 7}, {0x28, 6}, {0x29, 6}, {0x2a, 6}, {0x7, 5}, {0x2b, 6}, {0x76, 7},
+      {0x2c, 6}, {0x8, 5}, {0x9, 5}, {0x2d, 6}, {0x77, 7}, {0x78, 7}, {0x79, 7}, {0x7a, 7},
+      {0x7b, 7}, {0x7ffe, 15}, {0x7fc, 11}, {0x3ffd, 14}, {0x1ffd, 13}, {0xffffffc, 28},
+      {0xfffe6, 20}, {0x3fffd2, 22}, {0xfffe7, 20}, {0xfffe8, 20}, {0x3fffd3, 22}, {0x3fffd4, 22},
+      {0x3fffd5, 22}, {0x7fffd9, 23}, {0x3fffd6, 22}, {0x7fffda, 23}, {0x7fffdb, 23},
+      {0x7fffdc, 23}, {0x7fffdd, 23}, {0x7fffde, 23}, {0xffffeb, 24}, {0x7fffdf, 23},
+      {0xffffec, 24}, {0xffffed, 24}, {0x3fffd7, 22}, {0x7fffe0, 23}, {0xffffee, 24},
+      {0x7fffe1, 23}, {0x7fffe2, 23}, {0x7fffe3, 23}, {0x7fffe4, 23}, {0x1fffdc, 21},
+      {0x3fffd8, 22}, {0x7fffe5, 23}, {0x3fffd9, 22}, {0x7fffe6, 23}, {0x7fffe7, 23},
+      {0xffffef, 24}, {0x3fffda, 22}, {0x1fffdd, 21}, {0xfffe9, 20}, {0x3fffdb, 22}, {0x3fffdc, 22},
+      {0x7fffe8, 23}, {0x7fffe9, 23}, {0x1fffde, 21}, {0x7fffea, 23}, {0x3fffdd, 22},
+      {0x3fffde, 22}, {0xfffff0, 24}, {0x1fffdf, 21}, {0x3fffdf, 22}, {0x7fffeb, 23},
+      {0x7fffec, 23}, {0x1fffe0, 21}, {0x1fffe1, 21}, {0x3fffe0, 22}, {0x1fffe2, 21},
+      {0x7fffed, 23}, {0x3fffe1, 22}, {0x7fffee, 23}, {0x7fffef, 23}, {0xfffea, 20}, {0x3fffe2, 22},
+      {0x3fffe3, 22}, {0x3fffe4, 22}, {0x7ffff0, 23}, {0x3fffe5, 22}, {0x3fffe6, 22},
+      {0x7ffff1, 23}, {0x3ffffe0, 26}, {0x3ffffe1, 26}, {0xfffeb, 20}, {0x7fff1, 19},
+      {0x3fffe7, 22}, {0x7ffff2, 23}, {0x3fffe8, 22}, {0x1ffffec, 25}, {0x3ffffe2, 26},
+      {0x3ffffe3, 26}, {0x3ffffe4, 26}, {0x7ffffde, 27}, {0x7ffffdf, 27}, {0x3ffffe5, 26},
+      {0xfffff1, 24}, {0x1ffffed, 25}, {0x7fff2, 19}, {0x1fffe3, 21}, {0x3ffffe6, 26},
+      {0x7ffffe0, 27}, {0x7ffffe1, 27}, {0x3ffffe7, 26}, {0x7ffffe2, 27}, {0xfffff2, 24},
+      {0x1fffe4, 21}, {0x1fffe5, 21}, {0x3ffffe8, 26}, {0x3ffffe9, 26}, {0xffffffd, 28},
+      {0x7ffffe3, 27}, {0x7ffffe4, 27}, {0x7ffffe5, 27}, {0xfffec, 20}, {0xfffff3, 24},
+      {0xfffed, 20}, {0x1fffe6, 21}, {0x3fffe9, 22}, {0x1fffe7, 21}, {0x1fffe8, 21}, {0x7ffff3, 23},
+      {0x3fffea, 22}, {0x3fffeb, 22}, {0x1ffffee, 25}, {0x1ffffef, 25}, {0xfffff4, 24},
+      {0xfffff5, 24}, {0x3ffffea, 26}, {0x7ffff4, 23}, {0x3ffffeb, 26}, {0x7ffffe6, 27},
+      {0x3ffffec, 26}, {0x3ffffed, 26}, {0x7ffffe7, 27}, {0x7ffffe8, 27}, {0x7ffffe9, 27},
+      {0x7ffffea, 27}, {0x7ffffeb, 27}, {0xffffffe, 28}, {0x7ffffec, 27}, {0x7ffffed, 27},
+      {0x7ffffee, 27}, {0x7ffffef, 27}, {0x7fffff0, 27}, {0x3ffffee, 26},
+    };
+
+    constexpr std::pair<const char*, const char*> c_hpackStaticTable[61] = {
+      {":authority", ""}, {":method", "GET"}, {":method", "POST"}, {":path", "/"},
+      {":path", "/index.html"}, {":scheme", "http"}, {":scheme", "https"}, {":status", "200"},
+      {":status", "204"}, {":status", "206"}, {":status", "304"}, {":status", "400"},
+      {":status", "404"}, {":status", "500"}, {"accept-charset", ""},
+      {"accept-encoding", "gzip, deflate"}, {"accept-language", ""}, {"accept-ranges", ""},
+      {"accept", ""}, {"access-control-allow-origin", ""}, {"age", ""}, {"allow", ""},
+      {"authorization", ""}, {"cache-control", ""}, {"content-disposition", ""},
+      {"content-encoding", ""}, {"content-language", ""}, {"content-length", ""},
+      {"content-location", ""}, {"content-range", ""}, {"content-type", ""}, {"cookie", ""},
+      {"date", ""}, {"etag", ""}, {"expect", ""}, {"expires", ""}, {"from", ""}, {"host", ""},
+      {"if-match", ""}, {"if-modified-since", ""}, {"if-none-match", ""}, {"if-range", ""},
+      {"if-unmodified-since", ""}, {"last-modified", ""}, {"link", ""}, {"location", ""},
+      {"max-forwards", ""}, {"proxy-authenticate", ""}, {"proxy-authorization", ""}, {"range", ""},
+      {"referer", ""}, {"refresh", ""}, {"retry-after", ""}, {"server", ""}, {"set-cookie", ""},
+      {"strict-transport-security", ""}, {"transfer-encoding", ""}, {"user-agent", ""},
+      {"vary", ""}, {"via", ""}, {"www-authenticate", ""},
+    };
+
+    bool ReadHpackInteger(
+        const std::string& block,
+        std::size_t& position,
+        int prefixBits,
+        uint64_t& value)
+    {
+      const uint8_t mask = static_cast<uint8_t>((1 << prefixBits) - 1);
+      value = static_cast<uint8_t>(block[position++]) & mask;
+      if (value < mask)
+      {
+        return true;
+      }
+      for (int shift = 0; shift < 56; shift += 7)
+      {
+        if (position >= block.size())
+        {
+          return false;
+        }
+        auto byte = static_cast<uint8_t>(block[position++]);
+        value += static_cast<uint64_t>(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0)
+        {
+          return true;
+        }
+      }
+      return false;
+    }
+
+    bool HuffmanDecode(const std::string& encoded, std::string& decoded)
+    {
+      static const std::map<std::pair<uint8_t, uint32_t>, char> symbols = []() {
+        std::map<std::pair<uint8_t, uint32_t>, char> codes;
+        for (int i = 0; i < 256; ++i)
+        {
+          codes[{c_huffmanCodes[i].Length, c_huffmanCodes[i].Code}] = static_cast<char>(i);
+        }
+        return codes;
+      }();
+
+      uint32_t code = 0;
+      uint8_t length = 0;
+      for (auto byte : encoded)
+      {
+        for (int bit = 7; bit >= 0; --bit)
+        {
+          code = (code << 1) | ((static_cast<uint8_t>(byte) >> bit) & 1);
+          if (++length > 30)
+          {
+            return false;
+          }
+          auto ite = symbols.find({length, code});
+          if (ite != symbols.end())
+          {
+            decoded += ite->second;
+            code = 0;
+            length = 0;
+          }
+        }
+      }
+      // The padding is the most significant bits of the end of string code, all ones.
+      return length < 8 && code == (1U << length) - 1;
+    }
+
+    bool ReadHpackString(const std::string& block, std::size_t& position, std::string& value)
+    {
+      bool huffman = (static_cast<uint8_t>(block[position]) & 0x80) != 0;
+      uint64_t length = 0;
+      if (!ReadHpackInteger(block, position, 7, length) || length > block.size() - position)
+      {
+        return false;
+      }
+      auto raw = block.substr(position, static_cast<std::size_t>(length));
+      position += static_cast<std::size_t>(length);
+      if (!huffman)
+      {
+        value = std::move(raw);
+        return true;
+      }
+      value.clear();
+      return HuffmanDecode(raw, value);
+    }
+
+    void AppendHpackInteger(std::string& block, uint8_t prefix, int prefixBits, uint64_t value)
+    {
+      const uint8_t mask = static_cast<uint8_t>((1 << prefixBits) - 1);
+      if (value < mask)
+      {
+        block += static_cast<char>(prefix | value);
+        return;
+      }
+      block += static_cast<char>(prefix | mask);
+      value -= mask;
+      while (value >= 0x80)
+      {
+        block += static_cast<char>((value & 0x7f) | 0x80);
+        value >>= 7;
+      }
+      block += static_cast<char>(value);
+    }
+
+    // Literal header field without indexing, with a new name and no Huffman coding.
+    void AppendHpackLiteral(std::string& block, const std::string& name, const std::string& value)
+    {
+      block += '\0';
+      AppendHpackInteger(block, 0, 7, name.size());
+      block += name;
+      AppendHpackInteger(block, 0, 7, value.size());
+      block += value;
+    }
+
+    class HpackDecoder {
+    public:
+      bool Decode(
+          const std::string& block,
+          std::vector<std::pair<std::string, std::string>>& headers)
+      {
+        std::size_t position = 0;
+        while (position < block.size())
+        {
+          auto first = static_cast<uint8_t>(block[position]);
+          uint64_t index = 0;
+          std::string name;
+          std::string value;
+          if ((first & 0x80) != 0)
+          {
+            if (!ReadHpackInteger(block, position, 7, index) || !Lookup(index, name, value))
+            {
+              return false;
+            }
+            headers.emplace_back(std::move(name), std::move(value));
+            continue;
+          }
+          if ((first & 0xe0) == 0x20)
+          {
+            uint64_t maxSize = 0;
+            if (!ReadHpackInteger(block, position, 5, maxSize))
+            {
+              return false;
+            }
+            m_maxSize = static_cast<std::size_t>(maxSize);
+            Evict(0);
+            continue;
+          }
+
+          // With incremental indexing, without indexing or never indexed.
+          bool indexing = (first & 0xc0) == 0x40;
+          if (!ReadHpackInteger(block, position, indexing ? 6 : 4, index)
+              || (index == 0 ? !ReadHpackString(block, position, name)
+                             : !Lookup(index, name, value))
+              || position >= block.size() || !ReadHpackString(block, position, value))
+          {
+            return false;
+          }
+          if (indexing)
+          {
+            Evict(name.size() + value.size() + 32);
+            if (name.size() + value.size() + 32 <= m_maxSize)
+            {
+              m_size += name.size() + value.size() + 32;
+              m_dynamicTable.emplace_front(name, value);
+            }
+          }
+          headers.emplace_back(std::move(name), std::move(value));
+        }
+        return true;
+      }
+
+    private:
+      // Newest entry first, each entry takes the length of its name and value plus 32 bytes.
+      std::deque<std::pair<std::string, std::string>> m_dynamicTable;
+      std::size_t m_size = 0;
+      std::size_t m_maxSize = 4096;
+
+      bool Lookup(uint64_t index, std::string& name, std::string& value) const
+      {
+        if (index >= 1 && index <= 61)
+        {
+          name = c_hpackStaticTable[index - 1].first;
+          value = c_hpackStaticTable[index - 1].second;
+          return true;
+        }
+        if (index > 61 && index - 62 < m_dynamicTable.size())
+        {
+          name = m_dynamicTable[static_cast<std::size_t>(index - 62)].first;
+          value = m_dynamicTable[static_cast<std::size_t>(index - 62)].second;
+          return true;
+        }
+        return false;
+      }
+
+      // Evicts the oldest entries until an entry of the given size fits.
+      void Evict(std::size_t entrySize)
+      {
+        while (!m_dynamicTable.empty() && m_size + entrySize > m_maxSize)
+        {
+          m_size -= m_dynamicTable.back().first.size() + m_dynamicTable.back().second.size() + 32;
+          m_dynamicTable.pop_back();
+        }
+      }
+    };
+
+    // HTTP/2 frame types and flags (RFC 7540).
+    constexpr uint8_t c_http2Data = 0x0;
+    constexpr uint8_t c_http2Headers = 0x1;
+    constexpr uint8_t c_http2RstStream = 0x3;
+    constexpr uint8_t c_http2Settings = 0x4;
+    constexpr uint8_t c_http2Ping = 0x6;
+    constexpr uint8_t c_http2GoAway = 0x7;
+    constexpr uint8_t c_http2WindowUpdate = 0x8;
+    constexpr uint8_t c_http2Continuation = 0x9;
+    constexpr uint8_t c_http2EndStream = 0x1;
+    constexpr uint8_t c_http2Ack = 0x1;
+    constexpr uint8_t c_http2EndHeaders = 0x4;
+    constexpr uint8_t c_http2Padded = 0x8;
+    constexpr uint8_t c_http2Priority = 0x20;
+
+    uint32_t ReadUint32(const std::string& data, std::size_t position)
+    {
+      return static_cast<uint32_t>(static_cast<uint8_t>(data[position])) << 24
+          | static_cast<uint32_t>(static_cast<uint8_t>(data[position + 1])) << 16
+          | static_cast<uint32_t>(static_cast<uint8_t>(data[position + 2])) << 8
+          | static_cast<uint32_t>(static_cast<uint8_t>(data[position + 3]));
+    }
+
+    void AppendUint32(std::string& data, uint32_t value)
+    {
+      data += static_cast<char>(value >> 24);
+      data += static_cast<char>(value >> 16);
+      data += static_cast<char>(value >> 8);
+      data += static_cast<char>(value);
+    }
+
+    bool SendHttp2Frame(
+        int socket,
+        uint8_t type,
+        uint8_t flags,
+        uint32_t streamId,
+        const std::string& payload)
+    {
+      std::string frame;
+      frame += static_cast<char>(payload.size() >> 16);
+      frame += static_cast<char>(payload.size() >> 8);
+      frame += static_cast<char>(payload.size());
+      frame += static_cast<char>(type);
+      frame += static_cast<char>(flags);
+      AppendUint32(frame, streamId);
+      frame += payload;
+      return SendAll(socket, reinterpret_cast<const uint8_t*>(frame.data()), frame.size());
+    }
+
+    // Removes the padding, and the priority of a HEADERS frame, from the payload of a frame.
+    bool RemovePadding(uint8_t flags, std::size_t priorityLength, std::string& payload)
+    {
+      std::size_t start = 0;
+      std::size_t padding = 0;
+      if ((flags & c_http2Padded) != 0)
+      {
+        if (payload.empty())
+        {
+          return false;
+        }
+        padding = static_cast<uint8_t>(payload[0]);
+        start = 1;
+      }
+      if ((flags & c_http2Priority) != 0)
+      {
+        start += priorityLength;
+      }
+      if (start + padding > payload.size())
+      {
+        return false;
+      }
+      payload = payload.substr(start, payload.size() - start - padding);
+      return true;
+    }
+  } // namespace
+
+  MockStorageServer::MockStorageServer(MockStorageServerOptions options)
+      : m_options(std::move(options)), m_random(std::random_device()())
+  {
+  }
+
+  MockStorageServer::~MockStorageServer() { Stop(); }
+
+  void MockStorageServer::Start()
+  {
+    m_listenSocket = socket(AF_INET, SOCK_STREAM, 0);
+    if (m_listenSocket < 0)
+    {
+      throw std::runtime_error("failed to create socket");
+    }
+    int enable = 1;
+    setsockopt(m_listenSocket, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(m_options.Port);
+    if (bind(m_listenSocket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0
+        || listen(m_listenSocket, SOMAXCONN) != 0)
+    {
+      close(m_listenSocket);
+      m_listenSocket = -1;
+      throw std::runtime_error("failed to listen on port " + std::to_string(m_options.Port));
+    }
+    socklen_t addressLength = sizeof(address);
+    getsockname(m_listenSocket, reinterpret_cast<sockaddr*>(&address), &addressLength);
+    m_port = ntohs(address.sin_port);
+
+    m_stopping = false;
+    m_acceptThread = std::thread([this]() { AcceptConnections(); });
+  }
+
+  void MockStorageServer::Stop()
+  {
+    if (m_listenSocket < 0)
+    {
+      return;
+    }
+    m_stopping = true;
+    shutdown(m_listenSocket, SHUT_RDWR);
+    m_acceptThread.join();
+    close(m_listenSocket);
+    m_listenSocket = -1;
+
+    std::unique_lock<std::mutex> lock(m_connectionsMutex);
+    for (auto connection : m_connections)
+    {
+      shutdown(connection, SHUT_RDWR);
+    }
+    m_connectionsCv.wait(lock, [this]() { return m_connections.empty(); });
+  }
+
+  std::string MockStorageServer::GetConnectionString() const
+  {
+    auto endpoint = "http://127.0.0.1:" + std::to_string(m_port) + "/" + m_options.AccountName;
+    return "DefaultEndpointsProtocol=http;AccountName=" + m_options.AccountName
+        + ";AccountKey=" + c_accountKey + ";BlobEndpoint=" + endpoint + ";DfsEndpoint=" + endpoint
+        + ";";
+  }
+
+  void MockStorageServer::AcceptConnections()
+  {
+    while (!m_stopping)
+    {
+      int connection = accept(m_listenSocket, nullptr, nullptr);
+      if (connection < 0)
+      {
+        if (m_stopping)
+        {
+          break;
+        }
+        continue;
+      }
+      ++m_connectionCount;
+      int enable = 1;
+      setsockopt(connection, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+      {
+        std::lock_guard<std::mutex> guard(m_connectionsMutex);
+        m_connections.push_back(connection);
+      }
+      std::thread([this, connection]() {
+        ServeConnection(connection);
+        std::lock_guard<std::mutex> guard(m_connectionsMutex);
+        m_connections.erase(std::find(m_connections.begin(), m_connections.end(), connection));
+        // Closed under the lock so that Stop doesn't shut down a reused descriptor.
+        close(connection);
+        m_connectionsCv.notify_all();
+      }).detach();
+    }
+  }
+
+  void MockStorageServer::ServeConnection(int socket)
+  {
+    static const std::string c_http2Preface = "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n";
+    std::string buffer;
+    char chunk[c_ioChunkSize];
+    while (buffer.size() < c_http2Preface.size()
+           && c_http2Preface.compare(0, buffer.size(), buffer) == 0)
+    {
+      auto received = recv(socket, chunk, c_http2Preface.size() - buffer.size(), 0);
+      if (received <= 0)
+      {
+        return;
+      }
+      buffer.append(chunk, static_cast<std::size_t>(received));
+    }
+    if (buffer == c_http2Preface)
+    {
+      ServeHttp2Connection(socket);
+      return;
+    }
+
+    HttpRequest request;
+    while (!m_stopping && ReadRequest(socket, buffer, request))
+    {
+      auto response = Respond(request);
+      WriteResponse(socket, request, response);
+      request = HttpRequest();
+    }
+  }
+
+  MockStorageServer::HttpResponse MockStorageServer::Respond(HttpRequest& request)
+  {
+    ++m_requestCount;
+    if (m_options.Latency.count() > 0)
+    {
+      std::this_thread::sleep_for(m_options.Latency);
+    }
+
+    bool injectError = false;
+    if (m_options.ErrorRate > 0.0)
+    {
+      std::lock_guard<std::mutex> guard(m_storeMutex);
+      injectError
+          = std::uniform_real_distribution<double>(0.0, 1.0)(m_random) < m_options.ErrorRate;
+    }
+    return injectError ? Error(503, "Server Busy", "ServerBusy") : Handle(request);
+  }
+
+  void MockStorageServer::ServeHttp2Connection(int socket)
+  {
+    struct Stream
+    {
+      std::string HeaderBlock;
+      bool EndStream = false;
+      HttpRequest Request;
+      // Set once the request was answered, the body is sent as the flow control windows allow.
+      bool Responding = false;
+      std::vector<uint8_t> ResponseBody;
+      std::size_t ResponseSent = 0;
+      int64_t SendWindow = 0;
+    };
+
+    HpackDecoder decoder;
+    std::map<uint32_t, Stream> streams;
+    uint32_t continuedStreamId = 0;
+    int64_t connectionWindow = 65535;
+    int64_t initialWindow = 65535;
+    std::size_t maxFrameSize = 16384;
+
+    auto goAway = [socket](uint32_t errorCode) {
+      std::string payload;
+      AppendUint32(payload, 0);
+      AppendUint32(payload, errorCode);
+      SendHttp2Frame(socket, c_http2GoAway, 0, 0, payload);
+    };
+
+    // Sends the response bodies until they are done or a window is exhausted.
+    auto sendBodies = [&]() {
+      for (auto ite = streams.begin(); ite != streams.end();)
+      {
+        auto& stream = ite->second;
+        while (stream.Responding && stream.ResponseSent < stream.ResponseBody.size()
+               && stream.SendWindow > 0 && connectionWindow > 0)
+        {
+          auto length = std::min<int64_t>(
+              {static_cast<int64_t>(stream.ResponseBody.size() - stream.ResponseSent),
+               static_cast<int64_t>(maxFrameSize),
+               stream.SendWindow,
+               connectionWindow});
+          auto data = stream.ResponseBody.data() + stream.ResponseSent;
+          stream.ResponseSent += static_cast<std::size_t>(length);
+          stream.SendWindow -= length;
+          connectionWindow -= length;
+          SendHttp2Frame(
+              socket,
+              c_http2Data,
+              stream.ResponseSent == stream.ResponseBody.size() ? c_http2EndStream : 0,
+              ite->first,
+              std::string(reinterpret_cast<const char*>(data), static_cast<std::size_t>(length)));
+        }
+        if (stream.Responding && stream.ResponseSent == stream.ResponseBody.size())
+        {
+          ite = streams.erase(ite);
+        }
+        else
+        {
+          ++ite;
+        }
+      }
+    };
+
+    auto respond = [&](uint32_t streamId, Stream& stream) {
+      auto response = Respond(stream.Request);
+      std::string block;
+      AppendHpackLiteral(block, ":status", std::to_string(response.StatusCode));
+      for (const auto& header : GetResponseHeaders(stream.Request, response))
+      {
+        AppendHpackLiteral(block, ToLower(header.first), header.second);
+      }
+      if (stream.Request.Method == "HEAD")
+      {
+        response.Body.clear();
+      }
+
+      // The header block is split into a HEADERS frame and CONTINUATION frames if needed.
+      for (std::size_t offset = 0; offset == 0 || offset < block.size(); offset += maxFrameSize)
+      {
+        auto last = offset + maxFrameSize >= block.size();
+        uint8_t flags = last ? c_http2EndHeaders : 0;
+        if (offset == 0 && response.Body.empty())
+        {
+          flags |= c_http2EndStream;
+        }
+        SendHttp2Frame(
+            socket,
+            offset == 0 ? c_http2Headers : c_http2Continuation,
+            flags,
+            streamId,
+            block.substr(offset, maxFrameSize));
+      }
+      stream.Responding = true;
+      stream.ResponseBody = std::move(response.Body);
+    };
+
+    // Parses the request line and headers out of the decoded header block.
+    auto parseHeaders = [&](Stream& stream) {
+      std::vector<std::pair<std::string, std::string>> headers;
+      if (!decoder.Decode(stream.HeaderBlock, headers))
+      {
+        return false;
+      }
+      stream.HeaderBlock.clear();
+      std::string method;
+      std::string path;
+      std::string head;
+      for (const auto& header : headers)
+      {
+        if (header.first == ":method")
+        {
+          method = header.second;
+        }
+        else if (header.first == ":path")
+        {
+          path = header.second;
+        }
+        else if (header.first[0] != ':')
+        {
+          head += header.first + ": " + header.second + "\r\n";
+        }
+      }
+      return ParseRequestHead(method + " " + path + " HTTP/2\r\n" + head, stream.Request);
+    };
+
+    // An empty SETTINGS frame keeps the defaults.
+    SendHttp2Frame(socket, c_http2Settings, 0, 0, std::string());
+
+    std::string buffer;
+    char chunk[c_ioChunkSize];
+    while (!m_stopping)
+    {
+      sendBodies();
+
+      while (buffer.size() < 9 || buffer.size() < 9 + (ReadUint32(buffer, 0) >> 8))
+      {
+        auto received = recv(socket, chunk, sizeof(chunk), 0);
+        if (received <= 0)
+        {
+          return;
+        }
+        buffer.append(chunk, static_cast<std::size_t>(received));
+      }
+      const std::size_t length = ReadUint32(buffer, 0) >> 8;
+      const auto type = static_cast<uint8_t>(buffer[3]);
+      const auto flags = static_cast<uint8_t>(buffer[4]);
+      const uint32_t streamId = ReadUint32(buffer, 5) & 0x7fffffff;
+      std::string payload = buffer.substr(9, length);
+      buffer.erase(0, 9 + length);
+
+      // A header block can't be interleaved with other frames.
+      if (continuedStreamId != 0 && (type != c_http2Continuation || streamId != continuedStreamId))
+      {
+        goAway(1);
+        return;
+      }
+
+      if (type == c_http2Settings && (flags & c_http2Ack) == 0)
+      {
+        for (std::size_t position = 0; position + 6 <= payload.size(); position += 6)
+        {
+          auto id = static_cast<uint16_t>(
+              static_cast<uint8_t>(payload[position]) << 8
+              | static_cast<uint8_t>(payload[position + 1]));
+          auto value = ReadUint32(payload, position + 2);
+          if (id == 0x4)
+          {
+            for (auto& stream : streams)
+            {
+              stream.second.SendWindow += static_cast<int64_t>(value) - initialWindow;
+            }
+            initialWindow = value;
+          }
+          else if (id == 0x5)
+          {
+            maxFrameSize = value;
+          }
+        }
+        SendHttp2Frame(socket, c_http2Settings, c_http2Ack, 0, std::string());
+      }
+      else if (type == c_http2Ping && (flags & c_http2Ack) == 0)
+      {
+        SendHttp2Frame(socket, c_http2Ping, c_http2Ack, 0, payload);
+      }
+      else if (type == c_http2WindowUpdate && payload.size() == 4)
+      {
+        auto increment = ReadUint32(payload, 0) & 0x7fffffff;
+        if (streamId == 0)
+        {
+          connectionWindow += increment;
+        }
+        else if (streams.count(streamId) != 0)
+        {
+          streams[streamId].SendWindow += increment;
+        }
+      }
+      else if (type == c_http2Headers || type == c_http2Continuation)
+      {
+        if (type == c_http2Headers)
+        {
+          if (!RemovePadding(flags, 5, payload))
+          {
+            goAway(1);
+            return;
+          }
+          streams[streamId].SendWindow = initialWindow;
+          streams[streamId].EndStream = (flags & c_http2EndStream) != 0;
+        }
+        auto& stream = streams[streamId];
+        stream.HeaderBlock += payload;
+        continuedStreamId = (flags & c_http2EndHeaders) != 0 ? 0 : streamId;
+        if (continuedStreamId == 0)
+        {
+          if (!parseHeaders(stream))
+          {
+            // COMPRESSION_ERROR, the decoder state can't be trusted anymore.
+            goAway(9);
+            return;
+          }
+          if (stream.EndStream)
+          {
+            respond(streamId, stream);
+          }
+        }
+      }
+      else if (type == c_http2Data)
+      {
+        if (!RemovePadding(flags, 0, payload))
+        {
+          goAway(1);
+          return;
+        }
+        // The whole frame, padding included, counts against the windows. They are opened again
+        // right away, the request bodies are buffered.
+        if (length > 0)
+        {
+          std::string increment;
+          AppendUint32(increment, static_cast<uint32_t>(length));
+          SendHttp2Frame(socket, c_http2WindowUpdate, 0, 0, increment);
+          if ((flags & c_http2EndStream) == 0)
+          {
+            SendHttp2Frame(socket, c_http2WindowUpdate, 0, streamId, increment);
+          }
+        }
+        auto ite = streams.find(streamId);
+        if (ite != streams.end() && !ite->second.Responding)
+        {
+          auto& body = ite->second.Request.Body;
+          body.insert(body.end(), payload.begin(), payload.end());
+          if ((flags & c_http2EndStream) != 0)
+          {
+            respond(streamId, ite->second);
+          }
+        }
+      }
+      else if (type == c_http2RstStream)
+      {
+        streams.erase(streamId);
+      }
+      else if (type == c_http2GoAway)
+      {
+        return;
+      }
+    }
+  }
+
+  bool MockStorageServer::ReadRequest(int socket, std::string& buffer, HttpRequest& request)
+  {
+    char chunk[c_ioChunkSize];
+    std::size_t headersEnd;
+    while ((headersEnd = buffer.find("\r\n\r\n")) == std::string::npos)
+    {
+      auto received = recv(socket, chunk, sizeof(chunk), 0);
+      if (received <= 0)
+      {
+        return false;
+      }
+      buffer.append(chunk, static_cast<std::size_t>(received));
+    }
+
+    if (!ParseRequestHead(buffer.substr(0, headersEnd + 2), request))
+    {
+      return false;
+    }
+    buffer.erase(0, headersEnd + 4);
+
+    auto contentLength
+        = static_cast<std::size_t>(std::stoll(GetHeader(request.Headers, "content-length", "0")));
+    if (contentLength > 0 && buffer.size() < contentLength
+        && ToLower(GetHeader(request.Headers, "expect")) == "100-continue")
+    {
+      static const std::string c_continue = "HTTP/1.1 100 Continue\r\n\r\n";
+      SendAll(socket, reinterpret_cast<const uint8_t*>(c_continue.data()), c_continue.size());
+    }
+
+    request.Body.reserve(contentLength);
+    auto bodyStart = std::chrono::steady_clock::now();
+    while (request.Body.size() < contentLength)
+    {
+      if (buffer.empty())
+      {
+        auto toReceive = std::min(sizeof(chunk), contentLength - request.Body.size());
+        auto received = recv(socket, chunk, toReceive, 0);
+        if (received <= 0)
+        {
+          return false;
+        }
+        buffer.append(chunk, static_cast<std::size_t>(received));
+      }
+      auto taken = std::min(buffer.size(), contentLength - request.Body.size());
+      request.Body.insert(request.Body.end(), buffer.begin(), buffer.begin() + taken);
+      buffer.erase(0, taken);
+      Throttle(bodyStart, static_cast<int64_t>(request.Body.size()));
+    }
+    return true;
+  }
+
+  bool MockStorageServer::ParseRequestHead(const std::string& head, HttpRequest& request)
+  {
+    auto lineEnd = head.find("\r\n");
+    auto requestLine = head.substr(0, lineEnd);
+    auto methodEnd = requestLine.find(' ');
+    auto targetEnd = requestLine.find(' ', methodEnd + 1);
+    if (methodEnd == std::string::npos || targetEnd == std::string::npos)
+    {
+      return false;
+    }
+    request.Method = requestLine.substr(0, methodEnd);
+    auto target = requestLine.substr(methodEnd + 1, targetEnd - methodEnd - 1);
+    auto queryStart = target.find('?');
+    request.Path = PercentDecode(target.substr(0, queryStart));
+    if (queryStart != std::string::npos)
+    {
+      auto query = target.substr(queryStart + 1);
+      std::size_t position = 0;
+      while (position < query.size())
+      {
+        auto end = query.find('&', position);
+        if (end == std::string::npos)
+        {
+          end = query.size();
+        }
+        auto parameter = query.substr(position, end - position);
+        auto equal = parameter.find('=');
+        auto value
+            = equal == std::string::npos ? std::string() : parameter.substr(equal + 1);
+        request.Query[ToLower(PercentDecode(parameter.substr(0, equal)))] = PercentDecode(value);
+        position = end + 1;
+      }
+    }
+
+    auto position = lineEnd + 2;
+    while (position < head.size())
+    {
+      auto end = head.find("\r\n", position);
+      auto line = head.substr(position, end - position);
+      auto colon = line.find(':');
+      if (colon != std::string::npos)
+      {
+        request.Headers[ToLower(line.substr(0, colon))] = Trim(line.substr(colon + 1));
+      }
+      position = end + 2;
+    }
+    return true;
+  }
+
+  std::vector<std::pair<std::string, std::string>> MockStorageServer::GetResponseHeaders(
+      const HttpRequest& request,
+      const HttpResponse& response) const
+  {
+    bool isHead = request.Method == "HEAD";
+    auto contentLength = isHead && response.HeadContentLength >= 0
+        ? response.HeadContentLength
+        : static_cast<int64_t>(response.Body.size());
+
+    std::vector<std::pair<std::string, std::string>> headers;
+    for (const auto& header : response.Headers)
+    {
+      // Like the service, an error answering a HEAD request only has the x-ms-error-code header.
+      if (isHead && response.StatusCode >= 400 && header.first == "Content-Type")
+      {
+        continue;
+      }
+      headers.emplace_back(header);
+    }
+    headers.emplace_back("Content-Length", std::to_string(contentLength));
+    headers.emplace_back("Date", HttpDate());
+    headers.emplace_back("x-ms-request-id", std::to_string(m_requestCount.load()));
+    headers.emplace_back(
+        "x-ms-version", GetHeader(request.Headers, "x-ms-version", "2019-12-12"));
+    return headers;
+  }
+
+  void MockStorageServer::WriteResponse(
+      int socket,
+      const HttpRequest& request,
+      const HttpResponse& response)
+  {
+    bool isHead = request.Method == "HEAD";
+    std::string head = "HTTP/1.1 " + std::to_string(response.StatusCode) + " "
+        + response.ReasonPhrase + "\r\n";
+    for (const auto& header : GetResponseHeaders(request, response))
+    {
+      head += header.first + ": " + header.second + "\r\n";
+    }
+    head += "\r\n";
+    if (!SendAll(socket, reinterpret_cast<const uint8_t*>(head.data()), head.size()) || isHead)
+    {
+      return;
+    }
+
+    auto bodyStart = std::chrono::steady_clock::now();
+    std::size_t sent = 0;
+    while (sent < response.Body.size())
+    {
+      auto toSend = std::min(c_ioChunkSize, response.Body.size() - sent);
+      if (!SendAll(socket, response.Body.data() + sent, toSend))
+      {
+        return;
+      }
+      sent += toSend;
+      Throttle(bodyStart, static_cast<int64_t>(sent));
+    }
+  }
+
+  void MockStorageServer::Throttle(std::chrono::steady_clock::time_point start, int64_t bytes)
+      const
+  {
+    if (m_options.BandwidthBytesPerSecond <= 0)
+    {
+      return;
+    }
+    auto due = start
+        + std::chrono::microseconds(bytes * 1000000 / m_options.BandwidthBytesPerSecond);
+    std::this_thread::sleep_until(due);
+  }
+
+  MockStorageServer::HttpResponse MockStorageServer::Handle(HttpRequest& request)
+  {
+    // The path is /account/container/blob, where the blob name may contain slashes.
+    auto accountPrefix = "/" + m_options.AccountName;
+    if (request.Path.compare(0, accountPrefix.size(), accountPrefix) != 0)
+    {
+      return Error(400, "Bad Request", "InvalidUri");
+    }
+    auto path = request.Path.substr(accountPrefix.size());
+    if (!path.empty() && path[0] == '/')
+    {
+      path.erase(0, 1);
+    }
+    auto slash = path.find('/');
+    if (request.Method == "POST" && GetHeader(request.Query, "comp") == "batch"
+        && (path.empty() || slash == std::string::npos))
+    {
+      return HandleBatch(request);
+    }
+    if (path.empty())
+    {
+      return Error(400, "Bad Request", "UnsupportedOperation");
+    }
+    if (slash == std::string::npos || slash + 1 == path.size())
+    {
+      return HandleContainer(request, path.substr(0, slash));
+    }
+    return HandleBlob(request, path.substr(0, slash), path.substr(slash + 1));
+  }
+
+  MockStorageServer::HttpResponse MockStorageServer::HandleBatch(const HttpRequest& request)
+  {
+    // Each part of the multipart/mixed body is a serialized sub-request without a body, answered
+    // by a part holding the serialized sub-response with the same Content-ID.
+    auto contentType = GetHeader(request.Headers, "content-type");
+    auto boundaryStart = contentType.find("boundary=");
+    if (boundaryStart == std::string::npos)
+    {
+      return Error(400, "Bad Request", "InvalidInput");
+    }
+    const auto delimiter = "--" + contentType.substr(boundaryStart + 9);
+    const std::string body(request.Body.begin(), request.Body.end());
+    const auto responseBoundary = "batchresponse_" + std::to_string(m_requestCount.load());
+
+    std::string responseBody;
+    auto position = body.find(delimiter);
+    while (position != std::string::npos)
+    {
+      position += delimiter.size();
+      if (body.compare(position, 2, "--") == 0)
+      {
+        break;
+      }
+      auto partEnd = body.find(delimiter, position);
+      auto partHeadersEnd = body.find("\r\n\r\n", position);
+      if (partEnd == std::string::npos || partHeadersEnd == std::string::npos
+          || partHeadersEnd > partEnd)
+      {
+        return Error(400, "Bad Request", "InvalidInput");
+      }
+      std::string contentId;
+      auto partHeaders = body.substr(position, partHeadersEnd - position + 2);
+      auto contentIdStart = ToLower(partHeaders).find("content-id:");
+      if (contentIdStart != std::string::npos)
+      {
+        contentIdStart += 11;
+        contentId = Trim(partHeaders.substr(
+            contentIdStart, partHeaders.find("\r\n", contentIdStart) - contentIdStart));
+      }
+
+      HttpRequest subRequest;
+      auto subRequestHead = body.substr(partHeadersEnd + 4, partEnd - partHeadersEnd - 4);
+      auto subRequestHeadEnd = subRequestHead.find("\r\n\r\n");
+      auto subResponse = subRequestHeadEnd == std::string::npos
+              || !ParseRequestHead(subRequestHead.substr(0, subRequestHeadEnd + 2), subRequest)
+          ? Error(400, "Bad Request", "InvalidInput")
+          : Handle(subRequest);
+
+      responseBody += "--" + responseBoundary + "\r\n";
+      responseBody += "Content-Type: application/http\r\n";
+      if (!contentId.empty())
+      {
+        responseBody += "Content-ID: " + contentId + "\r\n";
+      }
+      responseBody += "\r\nHTTP/1.1 " + std::to_string(subResponse.StatusCode) + " "
+          + subResponse.ReasonPhrase + "\r\n";
+      for (const auto& header : subResponse.Headers)
+      {
+        responseBody += header.first + ": " + header.second + "\r\n";
+      }
+      responseBody += "\r\n";
+      responseBody.append(subResponse.Body.begin(), subResponse.Body.end());
+      responseBody += "\r\n";
+      position = partEnd;
+    }
+    responseBody += "--" + responseBoundary + "--\r\n";
+
+    HttpResponse response;
+    response.StatusCode = 202;
+    response.ReasonPhrase = "Accepted";
+    response.Headers["Content-Type"] = "multipart/mixed; boundary=" + responseBoundary;
+    response.Body.assign(responseBody.begin(), responseBody.end());
+    return response;
+  }
+
+  MockStorageServer::HttpResponse MockStorageServer::HandleContainer(
+      HttpRequest& request,
+      const std::string& containerName)
+  {
+    auto comp = GetHeader(request.Query, "comp");
+    std::lock_guard<std::mutex> guard(m_storeMutex);
+    auto ite = m_containers.find(containerName);
+
+    if (request.Method == "PUT" && comp.empty())
+    {
+      if (ite != m_containers.end())
+      {
+        return Error(409, "Conflict", "ContainerAlreadyExists");
+      }
+      auto& container = m_containers[containerName];
+      container.ETag = "\"0x" + std::to_string(++m_etagCounter) + "\"";
+      container.LastModified = HttpDate();
+      HttpResponse response;
+      response.StatusCode = 201;
+      response.ReasonPhrase = "Created";
+      response.Headers["ETag"] = container.ETag;
+      response.Headers["Last-Modified"] = container.LastModified;
+      response.Headers["x-ms-namespace-enabled"] = "false";
+      return response;
+    }
+    if (ite == m_containers.end())
+    {
+      return Error(404, "Not Found", "ContainerNotFound");
+    }
+    if (request.Method == "DELETE")
+    {
+      m_containers.erase(ite);
+      HttpResponse response;
+      response.StatusCode = 202;
+      response.ReasonPhrase = "Accepted";
+      return response;
+    }
+    if (request.Method == "GET" && comp == "list")
+    {
+      return ListBlobs(request, containerName);
+    }
+    if (request.Method == "GET" || request.Method == "HEAD")
+    {
+      HttpResponse response;
+      response.Headers["ETag"] = ite->second.ETag;
+      response.Headers["Last-Modified"] = ite->second.LastModified;
+      response.Headers["x-ms-has-immutability-policy"] = "false";
+      response.Headers["x-ms-has-legal-hold"] = "false";
+      response.Headers["x-ms-lease-status"] = "unlocked";
+      response.Headers["x-ms-lease-state"] = "available";
+      return response;
+    }
+    if (request.Method == "PUT")
+    {
+      // Set metadata and the other container properties are accepted and ignored.
+      HttpResponse response;
+      response.Headers["ETag"] = ite->second.ETag;
+      response.Headers["Last-Modified"] = ite->second.LastModified;
+      return response;
+    }
+    return Error(400, "Bad Request", "UnsupportedHttpVerb");
+  }
+
+  MockStorageServer::HttpResponse MockStorageServer::ListBlobs(
+      const HttpRequest& request,
+      const std::string& containerName)
+  {
+    // Called with the store locked.
+    const auto& blobs = m_containers[containerName].Blobs;
+    auto prefix = GetHeader(request.Query, "prefix");
+    auto marker = GetHeader(request.Query, "marker");
+    auto maxResults = std::stoll(GetHeader(request.Query, "maxresults", "5000"));
+
+    std::string body = "<?xml version=\"1.0\" encoding=\"utf-8\"?><EnumerationResults "
+                       "ServiceEndpoint=\"http://127.0.0.1:"
+        + std::to_string(m_port) + "/" + m_options.AccountName + "/\" ContainerName=\""
+        + XmlEscape(containerName) + "\"><Prefix>" + XmlEscape(prefix) + "</Prefix><Marker>"
+        + XmlEscape(marker) + "</Marker><MaxResults>" + std::to_string(maxResults)
+        + "</MaxResults><Blobs>";
+    std::string nextMarker;
+    int64_t count = 0;
+    for (auto ite = marker.empty() ? blobs.begin() : blobs.lower_bound(marker); ite != blobs.end();
+         ++ite)
+    {
+      if (ite->first.compare(0, prefix.size(), prefix) != 0)
+      {
+        continue;
+      }
+      if (count == maxResults)
+      {
+        nextMarker = ite->first;
+        break;
+      }
+      ++count;
+      const auto& blob = ite->second;
+      body += "<Blob><Name>" + XmlEscape(ite->first) + "</Name><Properties><Creation-Time>"
+          + blob.CreationTime + "</Creation-Time><Last-Modified>" + blob.LastModified
+          + "</Last-Modified><Etag>" + XmlEscape(blob.ETag) + "</Etag><Content-Length>"
+          + std::to_string(blob.Data.size())
+          + "</Content-Length><Content-Type>application/octet-stream</Content-Type><BlobType>"
+          + blob.Type
+          + "</BlobType><AccessTier>Hot</AccessTier><AccessTierInferred>true</AccessTierInferred>"
+            "<LeaseStatus>unlocked</LeaseStatus><LeaseState>available</LeaseState>"
+            "<ServerEncrypted>true</ServerEncrypted></Properties></Blob>";
+    }
+    body += "</Blobs><NextMarker>" + XmlEscape(nextMarker) + "</NextMarker></EnumerationResults>";
+
+    HttpResponse response;
+    response.Headers["Content-Type"] = "application/xml";
+    response.Body.assign(body.begin(), body.end());
+    return response;
+  }
+
+  MockStorageServer::HttpResponse MockStorageServer::HandleBlob(
+      HttpRequest& request,
+      const std::string& containerName,
+      const std::string& blobName)
+  {
+    auto comp = GetHeader(request.Query, "comp");
+    auto action = GetHeader(request.Query, "action");
+    auto resource = GetHeader(request.Query, "resource");
+
+    std::unique_lock<std::mutex> lock(m_storeMutex);
+    auto containerIte = m_containers.find(containerName);
+    if (containerIte == m_containers.end())
+    {
+      return Error(404, "Not Found", "ContainerNotFound");
+    }
+    auto& blobs = containerIte->second.Blobs;
+    auto blobIte = blobs.find(blobName);
+
+    HttpResponse response;
+    response.StatusCode = 201;
+    response.ReasonPhrase = "Created";
+    response.Headers["x-ms-request-server-encrypted"] = "true";
+
+    if (request.Method == "PUT" && comp.empty())
+    {
+      // Put Blob, or Create Path of the DFS endpoint.
+      auto& blob = blobs[blobName];
+      blob = Blob();
+      blob.CreationTime = HttpDate();
+      if (resource == "file" || resource == "directory")
+      {
+        blob.Type = "BlockBlob";
+      }
+      else
+      {
+        blob.Type = GetHeader(request.Headers, "x-ms-blob-type", "BlockBlob");
+      }
+      if (blob.Type == "PageBlob")
+      {
+        blob.Data.resize(static_cast<std::size_t>(
+            std::stoll(GetHeader(request.Headers, "x-ms-blob-content-length", "0"))));
+      }
+      else if (blob.Type == "BlockBlob")
+      {
+        blob.Data = std::move(request.Body);
+      }
+      for (const auto& header : request.Headers)
+      {
+        if (header.first.compare(0, 10, "x-ms-meta-") == 0)
+        {
+          blob.Metadata[header.first.substr(10)] = header.second;
+        }
+      }
+      Touch(blob);
+      SetBlobHeaders(response, blob);
+      return response;
+    }
+    if (request.Method == "PUT" && comp == "block")
+    {
+      if (blobIte == blobs.end())
+      {
+        blobIte = blobs.emplace(blobName, Blob()).first;
+        blobIte->second.CreationTime = HttpDate();
+        Touch(blobIte->second);
+      }
+      blobIte->second.UncommittedBlocks[GetHeader(request.Query, "blockid")]
+          = std::move(request.Body);
+      return response;
+    }
+    if (request.Method == "PUT" && comp == "blocklist")
+    {
+      if (blobIte == blobs.end())
+      {
+        blobIte = blobs.emplace(blobName, Blob()).first;
+        blobIte->second.CreationTime = HttpDate();
+      }
+      auto& blob = blobIte->second;
+      std::string body(request.Body.begin(), request.Body.end());
+      std::vector<uint8_t> data;
+      std::map<std::string, std::vector<uint8_t>> committed;
+      std::size_t position = 0;
+      while ((position = body.find('<', position)) != std::string::npos)
+      {
+        auto nameEnd = body.find('>', position);
+        auto name = body.substr(position + 1, nameEnd - position - 1);
+        position = nameEnd;
+        if (name != "Latest" && name != "Committed" && name != "Uncommitted")
+        {
+          continue;
+        }
+        auto valueEnd = body.find("</", nameEnd);
+        auto blockId = body.substr(nameEnd + 1, valueEnd - nameEnd - 1);
+        auto uncommitted = blob.UncommittedBlocks.find(blockId);
+        auto committedBlock = blob.CommittedBlocks.find(blockId);
+        const std::vector<uint8_t>* block = nullptr;
+        if (name != "Committed" && uncommitted != blob.UncommittedBlocks.end())
+        {
+          block = &uncommitted->second;
+        }
+        else if (name != "Uncommitted" && committedBlock != blob.CommittedBlocks.end())
+        {
+          block = &committedBlock->second;
+        }
+        if (!block)
+        {
+          return Error(400, "Bad Request", "InvalidBlockList");
+        }
+        data.insert(data.end(), block->begin(), block->end());
+        committed[blockId] = *block;
+      }
+      blob.Type = "BlockBlob";
+      blob.Data = std::move(data);
+      blob.CommittedBlocks = std::move(committed);
+      blob.UncommittedBlocks.clear();
+      blob.CommittedBlockCount = static_cast<int64_t>(blob.CommittedBlocks.size());
+      Touch(blob);
+      SetBlobHeaders(response, blob);
+      return response;
+    }
+
+    if (blobIte == blobs.end())
+    {
+      return Error(404, "Not Found", "BlobNotFound");
+    }
+    auto& blob = blobIte->second;
+
+    if (request.Method == "PUT" && comp == "appendblock")
+    {
+      response.Headers["x-ms-blob-append-offset"] = std::to_string(blob.Data.size());
+      blob.Data.insert(blob.Data.end(), request.Body.begin(), request.Body.end());
+      ++blob.CommittedBlockCount;
+      response.Headers["x-ms-blob-committed-block-count"]
+          = std::to_string(blob.CommittedBlockCount);
+      Touch(blob);
+      SetBlobHeaders(response, blob);
+      return response;
+    }
+    if (request.Method == "PUT" && comp == "page")
+    {
+      int64_t first = 0;
+      int64_t last = -1;
+      auto range = GetHeader(request.Headers, "x-ms-range", GetHeader(request.Headers, "range"));
+      if (!ParseRange(range, first, last) || last < first
+          || static_cast<std::size_t>(last) >= blob.Data.size())
+      {
+        return Error(416, "Range Not Satisfiable", "InvalidPageRange");
+      }
+      if (GetHeader(request.Headers, "x-ms-page-write") == "clear")
+      {
+        std::fill(blob.Data.begin() + first, blob.Data.begin() + last + 1, uint8_t(0));
+      }
+      else if (request.Body.size() == static_cast<std::size_t>(last - first + 1))
+      {
+        std::copy(request.Body.begin(), request.Body.end(), blob.Data.begin() + first);
+      }
+      else
+      {
+        return Error(400, "Bad Request", "InvalidHeaderValue");
+      }
+      ++blob.SequenceNumber;
+      response.Headers["x-ms-blob-sequence-number"] = std::to_string(blob.SequenceNumber);
+      Touch(blob);
+      SetBlobHeaders(response, blob);
+      return response;
+    }
+    if (request.Method == "PUT")
+    {
+      // Set metadata, properties or tier are accepted and ignored.
+      response.StatusCode = 200;
+      response.ReasonPhrase = "OK";
+      SetBlobHeaders(response, blob);
+      return response;
+    }
+    if (request.Method == "PATCH" && action == "append")
+    {
+      auto position = static_cast<std::size_t>(std::stoll(GetHeader(request.Query, "position")));
+      if (blob.PendingData.size() < position + request.Body.size())
+      {
+        blob.PendingData.resize(position + request.Body.size());
+      }
+      std::copy(request.Body.begin(), request.Body.end(), blob.PendingData.begin() + position);
+      response.StatusCode = 202;
+      response.ReasonPhrase = "Accepted";
+      return response;
+    }
+    if (request.Method == "PATCH" && action == "flush")
+    {
+      auto position = static_cast<std::size_t>(std::stoll(GetHeader(request.Query, "position")));
+      blob.PendingData.resize(position);
+      blob.Data = std::move(blob.PendingData);
+      blob.PendingData.clear();
+      Touch(blob);
+      response.StatusCode = 200;
+      response.ReasonPhrase = "OK";
+      SetBlobHeaders(response, blob);
+      return response;
+    }
+    if (request.Method == "DELETE")
+    {
+      // The DFS endpoint answers 200, the blob endpoint 202.
+      bool isDfs = request.Query.count("recursive") != 0;
+      blobs.erase(blobIte);
+      response.StatusCode = isDfs ? 200 : 202;
+      response.ReasonPhrase = isDfs ? "OK" : "Accepted";
+      return response;
+    }
+    if (request.Method == "HEAD")
+    {
+      response.StatusCode = 200;
+      response.ReasonPhrase = "OK";
+      SetBlobHeaders(response, blob);
+      response.Headers["x-ms-creation-time"] = blob.CreationTime;
+      response.Headers["x-ms-resource-type"] = "file";
+      response.HeadContentLength = static_cast<int64_t>(blob.Data.size());
+      return response;
+    }
+    if (request.Method == "GET")
+    {
+      auto size = static_cast<int64_t>(blob.Data.size());
+      int64_t first = 0;
+      int64_t last = size - 1;
+      auto range = GetHeader(request.Headers, "x-ms-range", GetHeader(request.Headers, "range"));
+      bool ranged = !range.empty() && ParseRange(range, first, last);
+      if (ranged)
+      {
+        if (first >= size)
+        {
+          return Error(416, "Range Not Satisfiable", "InvalidRange");
+        }
+        if (last < 0 || last >= size)
+        {
+          last = size - 1;
+        }
+        response.StatusCode = 206;
+        response.ReasonPhrase = "Partial Content";
+        response.Headers["Content-Range"] = "bytes " + std::to_string(first) + "-"
+            + std::to_string(last) + "/" + std::to_string(size);
+      }
+      else
+      {
+        response.StatusCode = 200;
+        response.ReasonPhrase = "OK";
+      }
+      SetBlobHeaders(response, blob);
+      response.Headers["x-ms-creation-time"] = blob.CreationTime;
+      if (size > 0)
+      {
+        // Copied under the lock, so that a concurrent write doesn't tear the response.
+        response.Body.assign(blob.Data.begin() + first, blob.Data.begin() + last + 1);
+      }
+      return response;
+    }
+    return Error(400, "Bad Request", "UnsupportedHttpVerb");
+  }
+
+  void MockStorageServer::Touch(Blob& blob)
+  {
+    blob.ETag = "\"0x" + std::to_string(++m_etagCounter) + "\"";
+    blob.LastModified = HttpDate();
+  }
+
+  MockStorageServer::HttpResponse MockStorageServer::Error(
+      int statusCode,
+      std::string reasonPhrase,
+      std::string errorCode)
+  {
+    HttpResponse response;
+    response.StatusCode = statusCode;
+    response.ReasonPhrase = std::move(reasonPhrase);
+    response.Headers["x-ms-error-code"] = errorCode;
+    response.Headers["Content-Type"] = "application/xml";
+    std::string body = "<?xml version=\"1.0\" encoding=\"utf-8\"?><Error><Code>" + errorCode
+        + "</Code><Message>" + response.ReasonPhrase + "</Message></Error>";
+    response.Body.assign(body.begin(), body.end());
+    return response;
+  }
+
+  void MockStorageServer::SetBlobHeaders(HttpResponse& response, const Blob& blob)
+  {
+    response.Headers["ETag"] = blob.ETag;
+    response.Headers["Last-Modified"] = blob.LastModified;
+    response.Headers["x-ms-blob-type"] = blob.Type;
+    response.Headers["x-ms-blob-committed-block-count"]
+        = std::to_string(blob.CommittedBlockCount);
+    response.Headers["x-ms-blob-sequence-number"] = std::to_string(blob.SequenceNumber);
+    response.Headers["x-ms-lease-status"] = "unlocked";
+    response.Headers["x-ms-lease-state"] = "available";
+    response.Headers["x-ms-server-encrypted"] = "true";
+    response.Headers["Content-Type"] = "application/octet-stream";
+    for (const auto& metadata : blob.Metadata)
+    {
+      response.Headers["x-ms-meta-" + metadata.first] = metadata.second;
+    }
+  }
+
+}}} // namespace Azure::Storage::Test
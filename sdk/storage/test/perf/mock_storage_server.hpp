@@ -0,0 +1,173 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace Azure { namespace Storage { namespace Test {
+
+  struct MockStorageServerOptions
+  {
+    /**
+     * @brief Port to listen on, 0 picks a free one.
+     */
+    uint16_t Port = 0;
+
+    /**
+     * @brief Delay added before answering each request.
+     */
+    std::chrono::milliseconds Latency{0};
+
+    /**
+     * @brief Bytes per second each connection sends or receives bodies at, 0 means no limit.
+     */
+    int64_t BandwidthBytesPerSecond = 0;
+
+    /**
+     * @brief Fraction of the requests answered with 503 Server Busy.
+     */
+    double ErrorRate = 0.0;
+
+    /**
+     * @brief Name of the account, the first segment of the path of every request.
+     */
+    std::string AccountName = "devstoreaccount1";
+  };
+
+  /**
+   * @brief In-memory HTTP/1.1 and HTTP/2 server emulating the blob and DFS operations used by
+   * the SDK: create and delete container or file system, put blob, put block, put block list,
+   * append block, put page, ranged get, get properties, list blobs, blob batch, create path,
+   * append data and flush data.
+   *
+   * @remark Authentication and most conditional headers are ignored. Each connection is served
+   * by its own thread. HTTP/2 is only spoken with prior knowledge (h2c), on connections starting
+   * with the HTTP/2 connection preface, and isn't throttled by BandwidthBytesPerSecond.
+   */
+  class MockStorageServer {
+  public:
+    explicit MockStorageServer(MockStorageServerOptions options = MockStorageServerOptions());
+    ~MockStorageServer();
+
+    MockStorageServer(const MockStorageServer&) = delete;
+    MockStorageServer& operator=(const MockStorageServer&) = delete;
+
+    /**
+     * @brief Starts listening on 127.0.0.1.
+     */
+    void Start();
+
+    /**
+     * @brief Stops listening, closes the connections and waits for their threads.
+     */
+    void Stop();
+
+    uint16_t GetPort() const { return m_port; }
+
+    /**
+     * @brief Connection string with blob and DFS endpoints pointing to this server.
+     */
+    std::string GetConnectionString() const;
+
+    uint64_t GetRequestCount() const { return m_requestCount.load(); }
+
+    uint64_t GetConnectionCount() const { return m_connectionCount.load(); }
+
+  private:
+    struct HttpRequest
+    {
+      std::string Method;
+      std::string Path;
+      std::map<std::string, std::string> Query;
+      std::map<std::string, std::string> Headers;
+      std::vector<uint8_t> Body;
+    };
+
+    struct HttpResponse
+    {
+      int StatusCode = 200;
+      std::string ReasonPhrase = "OK";
+      std::map<std::string, std::string> Headers;
+      std::vector<uint8_t> Body;
+      // Content-Length of the answer to a HEAD request, which has no body.
+      int64_t HeadContentLength = -1;
+    };
+
+    struct Blob
+    {
+      std::string Type = "BlockBlob";
+      std::vector<uint8_t> Data;
+      std::map<std::string, std::vector<uint8_t>> UncommittedBlocks;
+      std::map<std::string, std::vector<uint8_t>> CommittedBlocks;
+      std::vector<uint8_t> PendingData;
+      std::map<std::string, std::string> Metadata;
+      std::string ETag;
+      std::string LastModified;
+      std::string CreationTime;
+      int64_t CommittedBlockCount = 0;
+      int64_t SequenceNumber = 0;
+    };
+
+    struct Container
+    {
+      std::string ETag;
+      std::string LastModified;
+      std::map<std::string, Blob> Blobs;
+    };
+
+    void AcceptConnections();
+    void ServeConnection(int socket);
+    // Serves an HTTP/2 connection with prior knowledge, once its preface was received.
+    void ServeHttp2Connection(int socket);
+    HttpResponse Respond(HttpRequest& request);
+    bool ReadRequest(int socket, std::string& buffer, HttpRequest& request);
+    static bool ParseRequestHead(const std::string& head, HttpRequest& request);
+    std::vector<std::pair<std::string, std::string>> GetResponseHeaders(
+        const HttpRequest& request,
+        const HttpResponse& response) const;
+    void WriteResponse(int socket, const HttpRequest& request, const HttpResponse& response);
+    void Throttle(std::chrono::steady_clock::time_point start, int64_t bytes) const;
+
+    HttpResponse Handle(HttpRequest& request);
+    HttpResponse HandleBatch(const HttpRequest& request);
+    HttpResponse HandleContainer(HttpRequest& request, const std::string& containerName);
+    HttpResponse HandleBlob(
+        HttpRequest& request,
+        const std::string& containerName,
+        const std::string& blobName);
+    HttpResponse ListBlobs(const HttpRequest& request, const std::string& containerName);
+
+    void Touch(Blob& blob);
+    static HttpResponse Error(int statusCode, std::string reasonPhrase, std::string errorCode);
+    static void SetBlobHeaders(HttpResponse& response, const Blob& blob);
+
+    MockStorageServerOptions m_options;
+    uint16_t m_port = 0;
+    int m_listenSocket = -1;
+    std::thread m_acceptThread;
+    std::atomic<bool> m_stopping{false};
+    std::atomic<uint64_t> m_requestCount{0};
+    std::atomic<uint64_t> m_connectionCount{0};
+
+    std::mutex m_connectionsMutex;
+    std::condition_variable m_connectionsCv;
+    std::vector<int> m_connections;
+
+    std::mutex m_storeMutex;
+    std::map<std::string, Container> m_containers;
+    uint64_t m_etagCounter = 0;
+    std::mt19937_64 m_random;
+  };
+
+}}} // namespace Azure::Storage::Test
@@ -0,0 +1,625 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// SPDX-License-Identifier: MIT
+
+// Runs upload, download, small blob, list and ranges scenarios against the in-process mock storage
+// server, or a real account with --connection-string, and reports throughput and latency
+// percentiles.
+//
+// azure-storage-benchmark [--scenario upload|download|small|list|ranges|all] [--size-mb N]
+//     [--chunk-mb N] [--concurrency N] [--iterations N] [--ops N] [--small-size-kb N]
+//     [--latency-ms N] [--bandwidth-mbps N] [--error-rate F] [--connection-string S]
+//     [--file PATH [--read-ahead N] [--write-behind-mb N] [--file-options LIST]]
+//     [--block-cache NAME]
+//
+// With --file, the upload and download scenarios transfer the file at PATH, created with the
+// content of the blob, instead of a buffer. --file-options is a comma separated list of the
+// preallocate, direct and drop-cache options of the downloads and the map option of the uploads.
+// The stream option uploads the file with UploadFromStream, read as a stream of unknown length,
+// and downloads with OpenRead, reading the stream into the buffer.
+//
+// With --block-cache, the downloads go through a new shared block cache NAME, sized to hold the
+// blob twice in blocks of --chunk-mb, so that the iterations after the first one are served from it.
+
+#include "blobs/blob.hpp"
+#include "http/policy.hpp"
+#include "mock_storage_server.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+  using Azure::Core::Http::LatencyHistogram;
+  using Azure::Core::Http::RequestTimingHistograms;
+  using namespace Azure::Storage::Blobs;
+
+  constexpr int64_t c_KB = 1024;
+  constexpr int64_t c_MB = 1024 * 1024;
+
+  struct BenchmarkOptions
+  {
+    std::string Scenario = "all";
+    int64_t SizeMb = 256;
+    int64_t ChunkMb = 8;
+    int Concurrency = 16;
+    int Iterations = 3;
+    int Ops = 2000;
+    int64_t SmallSizeKb = 4;
+    int LatencyMs = 0;
+    int64_t BandwidthMbps = 0;
+    double ErrorRate = 0.0;
+    std::string ConnectionString;
+    std::string File;
+    int ReadAhead = 0;
+    int64_t WriteBehindMb = 0;
+    std::string FileOptions;
+    std::string BlockCache;
+  };
+
+  struct Context
+  {
+    BenchmarkOptions Options;
+    std::string ConnectionString;
+    std::string ContainerName;
+  };
+
+  // Reads a file without giving its length, as UploadFromStream gets data from a pipe.
+  class UnknownLengthFileStream : public Azure::Core::Http::BodyStream {
+  public:
+    explicit UnknownLengthFileStream(const std::string& file) : m_file(file, std::ios::binary) {}
+
+    int64_t Length() const override { return -1; }
+
+    int64_t Read(Azure::Core::Context& context, uint8_t* buffer, int64_t count) override
+    {
+      context.ThrowIfCanceled();
+      m_file.read(reinterpret_cast<char*>(buffer), static_cast<std::streamsize>(count));
+      return static_cast<int64_t>(m_file.gcount());
+    }
+
+  private:
+    std::ifstream m_file;
+  };
+
+  // Each scenario uses its own client, so that the latencies of its requests are reported apart.
+  BlobContainerClient GetContainer(
+      const Context& context,
+      std::shared_ptr<RequestTimingHistograms> requests)
+  {
+    BlobContainerClientOptions clientOptions;
+    clientOptions.PerOperationPolicies.emplace_back(
+        std::make_unique<Azure::Core::Http::InstrumentationPolicy>(std::move(requests)));
+    return BlobContainerClient::CreateFromConnectionString(
+        context.ConnectionString, context.ContainerName, clientOptions);
+  }
+
+  void PrintUsage()
+  {
+    std::cerr << "usage: azure-storage-benchmark "
+                 "[--scenario upload|download|small|list|ranges|all] [--size-mb N] [--chunk-mb N] "
+                 "[--concurrency N] [--iterations N] [--ops N] [--small-size-kb N] "
+                 "[--latency-ms N] [--bandwidth-mbps N] [--error-rate F] "
+                 "[--connection-string S] [--file PATH [--read-ahead N] [--write-behind-mb N] "
+                 "[--file-options preallocate,direct,drop-cache,map]] [--block-cache NAME]"
+              << std::endl;
+  }
+
+  bool ParseArguments(int argc, char** argv, BenchmarkOptions& options)
+  {
+    for (int i = 1; i < argc; ++i)
+    {
+      std::string name = argv[i];
+      if (i + 1 == argc)
+      {
+        return false;
+      }
+      std::string value = argv[++i];
+      if (name == "--scenario")
+      {
+        options.Scenario = value;
+      }
+      else if (name == "--size-mb")
+      {
+        options.SizeMb = std::stoll(value);
+      }
+      else if (name == "--chunk-mb")
+      {
+        options.ChunkMb = std::stoll(value);
+      }
+      else if (name == "--concurrency")
+      {
+        options.Concurrency = std::stoi(value);
+      }
+      else if (name == "--iterations")
+      {
+        options.Iterations = std::stoi(value);
+      }
+      else if (name == "--ops")
+      {
+        options.Ops = std::stoi(value);
+      }
+      else if (name == "--small-size-kb")
+      {
+        options.SmallSizeKb = std::stoll(value);
+      }
+      else if (name == "--latency-ms")
+      {
+        options.LatencyMs = std::stoi(value);
+      }
+      else if (name == "--bandwidth-mbps")
+      {
+        options.BandwidthMbps = std::stoll(value);
+      }
+      else if (name == "--error-rate")
+      {
+        options.ErrorRate = std::stod(value);
+      }
+      else if (name == "--connection-string")
+      {
+        options.ConnectionString = value;
+      }
+      else if (name == "--file")
+      {
+        options.File = value;
+      }
+      else if (name == "--read-ahead")
+      {
+        options.ReadAhead = std::stoi(value);
+      }
+      else if (name == "--write-behind-mb")
+      {
+        options.WriteBehindMb = std::stoll(value);
+      }
+      else if (name == "--file-options")
+      {
+        options.FileOptions = value;
+      }
+      else if (name == "--block-cache")
+      {
+        options.BlockCache = value;
+      }
+      else
+      {
+        return false;
+      }
+    }
+    return options.Concurrency > 0 && options.Iterations > 0 && options.Ops > 0;
+  }
+
+  double Seconds(std::chrono::steady_clock::duration duration)
+  {
+    return std::chrono::duration<double>(duration).count();
+  }
+
+  double Milliseconds(std::chrono::microseconds duration)
+  {
+    return static_cast<double>(duration.count()) / 1000.0;
+  }
+
+  void PrintLatency(const std::string& name, const LatencyHistogram& histogram)
+  {
+    std::printf(
+        "  %-40s %8llu  p50 %9.3f ms  p90 %9.3f ms  p99 %9.3f ms\n",
+        name.data(),
+        static_cast<unsigned long long>(histogram.Count()),
+        Milliseconds(histogram.Percentile(50)),
+        Milliseconds(histogram.Percentile(90)),
+        Milliseconds(histogram.Percentile(99)));
+  }
+
+  // Prints the latencies of the requests made by a scenario, per operation.
+  void PrintRequests(const RequestTimingHistograms& requests)
+  {
+    std::printf("  requests:\n");
+    for (const auto& operation : requests.GetOperations())
+    {
+      PrintLatency(operation, requests.GetHistograms(operation)->Total);
+    }
+  }
+
+  std::vector<uint8_t> RandomBuffer(std::size_t size)
+  {
+    std::vector<uint8_t> buffer(size);
+    uint64_t state = 0x9E3779B97F4A7C15ULL;
+    for (std::size_t i = 0; i < size; ++i)
+    {
+      state ^= state << 13;
+      state ^= state >> 7;
+      state ^= state << 17;
+      buffer[i] = static_cast<uint8_t>(state);
+    }
+    return buffer;
+  }
+
+  // Runs operation(i) for i in [0, ops) on the given number of threads and records the latency of
+  // each call.
+  template <class Operation>
+  void RunParallel(int ops, int concurrency, LatencyHistogram& latencies, Operation operation)
+  {
+    std::atomic<int> next{0};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < concurrency; ++t)
+    {
+      threads.emplace_back([&]() {
+        for (int i = next++; i < ops; i = next++)
+        {
+          auto start = std::chrono::steady_clock::now();
+          operation(i);
+          latencies.Record(std::chrono::duration_cast<std::chrono::microseconds>(
+              std::chrono::steady_clock::now() - start));
+        }
+      });
+    }
+    for (auto& thread : threads)
+    {
+      thread.join();
+    }
+  }
+
+  void RunUploadDownload(Context& context, bool upload, bool download)
+  {
+    const auto& options = context.Options;
+    auto size = static_cast<std::size_t>(options.SizeMb * c_MB);
+    auto buffer = RandomBuffer(size);
+
+    UploadBlobOptions uploadOptions;
+    uploadOptions.ChunkSize = options.ChunkMb * c_MB;
+    uploadOptions.Concurrency = options.Concurrency;
+    uploadOptions.FileReadAhead = options.ReadAhead;
+    uploadOptions.MapFile = options.FileOptions.find("map") != std::string::npos;
+    DownloadBlobToBufferOptions downloadOptions;
+    downloadOptions.InitialChunkSize = options.ChunkMb * c_MB;
+    downloadOptions.ChunkSize = options.ChunkMb * c_MB;
+    downloadOptions.Concurrency = options.Concurrency;
+    if (options.WriteBehindMb > 0)
+    {
+      downloadOptions.MaxFileWriteBehind = options.WriteBehindMb * c_MB;
+    }
+    downloadOptions.PreallocateFile = options.FileOptions.find("preallocate") != std::string::npos;
+    downloadOptions.DirectFileWrite = options.FileOptions.find("direct") != std::string::npos;
+    downloadOptions.DropFileCache = options.FileOptions.find("drop-cache") != std::string::npos;
+    if (!options.BlockCache.empty())
+    {
+      Azure::Storage::SharedBlockCache::Remove(options.BlockCache);
+      Azure::Storage::SharedBlockCacheOptions cacheOptions;
+      cacheOptions.BlockSize = options.ChunkMb * c_MB;
+      // Twice the blocks of the blob, as they are spread over the sets of the cache by hash.
+      cacheOptions.BlockCount = 2 * ((options.SizeMb + options.ChunkMb - 1) / options.ChunkMb);
+      downloadOptions.BlockCache
+          = std::make_shared<Azure::Storage::SharedBlockCache>(options.BlockCache, cacheOptions);
+    }
+    OpenReadBlobOptions openReadOptions;
+    openReadOptions.ChunkSize = options.ChunkMb * c_MB;
+    openReadOptions.Concurrency = options.Concurrency;
+    if (!options.File.empty())
+    {
+      std::ofstream file(options.File, std::ios::binary | std::ios::trunc);
+      file.write(reinterpret_cast<const char*>(buffer.data()), static_cast<std::streamsize>(size));
+    }
+
+    // Downloads need the blob, which also warms the server up.
+    GetContainer(context, std::make_shared<RequestTimingHistograms>())
+        .GetBlockBlobClient("large-blob")
+        .UploadFromBuffer(buffer.data(), buffer.size(), uploadOptions);
+
+    auto run = [&](const char* name, bool isUpload) {
+      auto requests = std::make_shared<RequestTimingHistograms>();
+      auto blob = GetContainer(context, requests).GetBlockBlobClient("large-blob");
+      LatencyHistogram latencies;
+      std::chrono::steady_clock::duration total{};
+      for (int i = 0; i < options.Iterations; ++i)
+      {
+        auto start = std::chrono::steady_clock::now();
+        if (isUpload && !options.File.empty()
+            && options.FileOptions.find("stream") != std::string::npos)
+        {
+          UnknownLengthFileStream stream(options.File);
+          blob.UploadFromStream(&stream, uploadOptions);
+        }
+        else if (isUpload && !options.File.empty())
+        {
+          blob.UploadFromFile(options.File, uploadOptions);
+        }
+        else if (isUpload)
+        {
+          blob.UploadFromBuffer(buffer.data(), buffer.size(), uploadOptions);
+        }
+        else if (options.FileOptions.find("stream") != std::string::npos)
+        {
+          auto stream = std::move(blob.OpenRead(openReadOptions)->BodyStream);
+          Azure::Core::Http::BodyStream::ReadToCount(
+              openReadOptions.Context, *stream, buffer.data(), static_cast<int64_t>(size));
+        }
+        else if (!options.File.empty())
+        {
+          blob.DownloadToFile(options.File, downloadOptions);
+        }
+        else
+        {
+          blob.DownloadToBuffer(buffer.data(), buffer.size(), downloadOptions);
+        }
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        total += elapsed;
+        latencies.Record(std::chrono::duration_cast<std::chrono::microseconds>(elapsed));
+      }
+      std::printf(
+          "%s: %lld MiB x %d, chunk %lld MiB, concurrency %d: %.1f MiB/s\n",
+          name,
+          static_cast<long long>(options.SizeMb),
+          options.Iterations,
+          static_cast<long long>(options.ChunkMb),
+          options.Concurrency,
+          static_cast<double>(options.SizeMb) * options.Iterations / Seconds(total));
+      PrintLatency("transfer", latencies);
+      PrintRequests(*requests);
+    };
+    if (upload)
+    {
+      run("upload", true);
+    }
+    if (download)
+    {
+      run("download", false);
+    }
+    if (downloadOptions.BlockCache)
+    {
+      Azure::Storage::SharedBlockCache::Remove(options.BlockCache);
+    }
+  }
+
+  void RunSmall(Context& context)
+  {
+    const auto& options = context.Options;
+    auto buffer = RandomBuffer(static_cast<std::size_t>(options.SmallSizeKb * c_KB));
+
+    for (int pass = 0; pass < 2; ++pass)
+    {
+      bool isUpload = pass == 0;
+      auto requests = std::make_shared<RequestTimingHistograms>();
+      auto container = GetContainer(context, requests);
+      std::vector<BlockBlobClient> blobs;
+      for (int i = 0; i < options.Ops; ++i)
+      {
+        blobs.push_back(container.GetBlockBlobClient("small/" + std::to_string(i)));
+      }
+      LatencyHistogram latencies;
+      auto start = std::chrono::steady_clock::now();
+      RunParallel(options.Ops, options.Concurrency, latencies, [&](int i) {
+        if (isUpload)
+        {
+          Azure::Core::Http::MemoryBodyStream content(buffer);
+          blobs[static_cast<std::size_t>(i)].Upload(&content);
+        }
+        else
+        {
+          std::vector<uint8_t> destination(buffer.size());
+          blobs[static_cast<std::size_t>(i)].DownloadToBuffer(
+              destination.data(), destination.size());
+        }
+      });
+      auto elapsed = Seconds(std::chrono::steady_clock::now() - start);
+      std::printf(
+          "small %s: %d x %lld KiB, concurrency %d: %.0f ops/s\n",
+          isUpload ? "put" : "get",
+          options.Ops,
+          static_cast<long long>(options.SmallSizeKb),
+          options.Concurrency,
+          options.Ops / elapsed);
+      PrintLatency("operation", latencies);
+      PrintRequests(*requests);
+    }
+  }
+
+  // Reads options.Ops ranges of options.SmallSizeKb at scattered offsets of a blob, as a columnar
+  // reader does, with a Download per range and then with DownloadRanges.
+  void RunRanges(Context& context)
+  {
+    const auto& options = context.Options;
+    auto content = RandomBuffer(static_cast<std::size_t>(options.SizeMb * c_MB));
+    auto setup = GetContainer(context, std::make_shared<RequestTimingHistograms>());
+    setup.GetBlockBlobClient("ranges").UploadFromBuffer(content.data(), content.size());
+
+    auto rangeSize = options.SmallSizeKb * c_KB;
+    uint64_t state = 0x2545F4914F6CDD1DULL;
+    std::vector<DownloadBlobRangeTarget> targets(static_cast<std::size_t>(options.Ops));
+    std::vector<uint8_t> destination(targets.size() * static_cast<std::size_t>(rangeSize));
+    for (std::size_t i = 0; i < targets.size(); ++i)
+    {
+      state ^= state << 13;
+      state ^= state >> 7;
+      state ^= state << 17;
+      targets[i].Offset
+          = static_cast<int64_t>(state % static_cast<uint64_t>(options.SizeMb * c_MB - rangeSize));
+      targets[i].Length = rangeSize;
+      targets[i].Buffer = destination.data() + i * static_cast<std::size_t>(rangeSize);
+    }
+    auto verify = [&]() {
+      for (const auto& target : targets)
+      {
+        if (!std::equal(
+                target.Buffer,
+                target.Buffer + target.Length,
+                content.begin() + static_cast<std::ptrdiff_t>(target.Offset)))
+        {
+          throw std::runtime_error("downloaded range differs from the blob");
+        }
+      }
+    };
+
+    for (int pass = 0; pass < 2; ++pass)
+    {
+      bool vectored = pass == 1;
+      auto requests = std::make_shared<RequestTimingHistograms>();
+      auto blob = GetContainer(context, requests).GetBlobClient("ranges");
+      LatencyHistogram latencies;
+      auto start = std::chrono::steady_clock::now();
+      for (int iteration = 0; iteration < options.Iterations; ++iteration)
+      {
+        std::fill(destination.begin(), destination.end(), uint8_t(0));
+        if (vectored)
+        {
+          DownloadBlobRangesOptions rangesOptions;
+          rangesOptions.Concurrency = options.Concurrency;
+          auto callStart = std::chrono::steady_clock::now();
+          blob.DownloadRanges(targets, rangesOptions);
+          latencies.Record(std::chrono::duration_cast<std::chrono::microseconds>(
+              std::chrono::steady_clock::now() - callStart));
+        }
+        else
+        {
+          RunParallel(options.Ops, options.Concurrency, latencies, [&](int i) {
+            const auto& target = targets[static_cast<std::size_t>(i)];
+            DownloadBlobOptions downloadOptions;
+            downloadOptions.Offset = target.Offset;
+            downloadOptions.Length = target.Length;
+            auto response = blob.Download(downloadOptions);
+            Azure::Core::Http::BodyStream::ReadToCount(
+                downloadOptions.Context, *response->BodyStream, target.Buffer, target.Length);
+          });
+        }
+        verify();
+      }
+      auto elapsed = Seconds(std::chrono::steady_clock::now() - start);
+      std::printf(
+          "ranges %s: %d x %lld KiB of %lld MiB x %d, concurrency %d: %.0f ranges/s\n",
+          vectored ? "vectored" : "single",
+          options.Ops,
+          static_cast<long long>(options.SmallSizeKb),
+          static_cast<long long>(options.SizeMb),
+          options.Iterations,
+          options.Concurrency,
+          static_cast<double>(options.Ops) * options.Iterations / elapsed);
+      PrintLatency(vectored ? "download ranges" : "download", latencies);
+      PrintRequests(*requests);
+    }
+  }
+
+  void RunList(Context& context)
+  {
+    const auto& options = context.Options;
+    std::vector<uint8_t> empty;
+    auto setup = GetContainer(context, std::make_shared<RequestTimingHistograms>());
+    LatencyHistogram createLatencies;
+    RunParallel(options.Ops, options.Concurrency, createLatencies, [&](int i) {
+      Azure::Core::Http::MemoryBodyStream content(empty);
+      setup.GetBlockBlobClient("list/" + std::to_string(i)).Upload(&content);
+    });
+
+    auto requests = std::make_shared<RequestTimingHistograms>();
+    auto container = GetContainer(context, requests);
+
+    LatencyHistogram latencies;
+    int64_t items = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < options.Iterations; ++i)
+    {
+      ListBlobsOptions listOptions;
+      listOptions.Prefix = "list/";
+      do
+      {
+        auto pageStart = std::chrono::steady_clock::now();
+        auto page = container.ListBlobsFlat(listOptions);
+        latencies.Record(std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - pageStart));
+        items += static_cast<int64_t>(page->Items.size());
+        listOptions.Marker = page->NextMarker;
+      } while (!listOptions.Marker.GetValue().empty());
+    }
+    auto elapsed = Seconds(std::chrono::steady_clock::now() - start);
+    std::printf(
+        "list: %d blobs x %d: %.0f pages/s, %.0f items/s\n",
+        options.Ops,
+        options.Iterations,
+        static_cast<double>(latencies.Count()) / elapsed,
+        static_cast<double>(items) / elapsed);
+    PrintLatency("page", latencies);
+    PrintRequests(*requests);
+  }
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+  BenchmarkOptions options;
+  try
+  {
+    if (!ParseArguments(argc, argv, options))
+    {
+      PrintUsage();
+      return 1;
+    }
+  }
+  catch (std::exception&)
+  {
+    PrintUsage();
+    return 1;
+  }
+
+  try
+  {
+    std::unique_ptr<Azure::Storage::Test::MockStorageServer> server;
+    Context context;
+    context.Options = options;
+    context.ConnectionString = options.ConnectionString;
+    context.ContainerName = "benchmark"
+        + std::to_string(std::chrono::system_clock::now().time_since_epoch().count());
+    if (context.ConnectionString.empty())
+    {
+      Azure::Storage::Test::MockStorageServerOptions serverOptions;
+      serverOptions.Latency = std::chrono::milliseconds(options.LatencyMs);
+      serverOptions.BandwidthBytesPerSecond = options.BandwidthMbps * c_MB / 8;
+      serverOptions.ErrorRate = options.ErrorRate;
+      server = std::make_unique<Azure::Storage::Test::MockStorageServer>(serverOptions);
+      server->Start();
+      context.ConnectionString = server->GetConnectionString();
+      std::printf("mock storage server listening on 127.0.0.1:%u\n", server->GetPort());
+    }
+
+    auto container = GetContainer(context, std::make_shared<RequestTimingHistograms>());
+    container.Create();
+
+    const auto& scenario = options.Scenario;
+    bool all = scenario == "all";
+    if (all || scenario == "upload" || scenario == "download")
+    {
+      RunUploadDownload(context, all || scenario == "upload", all || scenario == "download");
+    }
+    if (all || scenario == "small")
+    {
+      RunSmall(context);
+    }
+    if (all || scenario == "list")
+    {
+      RunList(context);
+    }
+    if (all || scenario == "ranges")
+    {
+      RunRanges(context);
+    }
+
+    container.Delete();
+    if (server)
+    {
+      std::printf(
+          "%llu requests served\n", static_cast<unsigned long long>(server->GetRequestCount()));
+      server->Stop();
+    }
+  }
+  catch (std::exception& e)
+  {
+    std::cerr << "benchmark failed: " << e.what() << std::endl;
+    return 1;
+  }
+  return 0;
+}